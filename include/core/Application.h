@@ -2,6 +2,10 @@
 
 #include <memory>
 #include <string>
+#include <vector>
+#include "FramePacer.h"
+#include "ImageIO.h"
+#include "../renderer/CloudQuality.h"
 
 // Forward declarations
 struct GLFWwindow;
@@ -11,33 +15,105 @@ namespace FlightSim {
 class Window;
 class Renderer;
 class Camera;
-class Aircraft;
+class SimulationThread;
 class InputManager;
 class HUD;
+class ShaderCache;
+class HeadlessContext;
+class RenderTarget;
+class FrameCapture;
+
+// Downward-looking camera mounted under the aircraft (--sensor)
+struct SensorOptions {
+    int width = 320;
+    int height = 240;
+    float rateHz = 0.0f; // 0 = every frame
+};
+
+// Command-line options (see main.cpp for the flags)
+struct LaunchOptions {
+    bool headless = false;
+    int width = 1280;
+    int height = 720;
+    
+    // Headless runs render a fixed number of frames at a fixed timestep so
+    // the output is reproducible
+    int frames = 300;
+    std::string outputPath;          // PPM of the last frame
+    std::string goldenPath;          // Reference PPM to compare the last frame against
+    int goldenTolerance = 8;         // Per-channel difference still counted as a match
+    double goldenMaxMismatch = 0.001; // Fraction of pixels allowed outside the tolerance
+    std::string profilePath;         // GPU pass timings CSV written after the run
+    
+    // Frame recording from the first frame (.y4m or raw RGBA)
+    std::string capturePath;
+    int captureFramesPerSecond = 60;
+    
+    // Windowed frame pacing
+    PacingMode pacing = PacingMode::VSync;
+    float targetFps = FramePacer::DEFAULT_TARGET_FPS; // For PacingMode::Limiter
+    
+    // Cull and submit aircraft on the GPU where GL 4.3 allows
+    bool gpuCulling = true;
+    
+    // Scenery placement file; empty places trees and buildings procedurally
+    std::string sceneryPath;
+    
+    // Highest cloud quality, and the GPU milliseconds the clouds may take
+    // in windowed runs; headless runs keep the preset
+    CloudQuality cloudQuality = CloudQuality::Medium;
+    float cloudBudgetMs = 1.5f;
+    
+    // Sensor feeds rendered alongside the main view
+    std::vector<SensorOptions> sensors;
+    std::string sensorOutputPrefix; // Last frame of sensor N written to <prefix>N.ppm
+};
 
 class Application {
 public:
-    Application();
+    explicit Application(const LaunchOptions& options = LaunchOptions());
     ~Application();
     
     bool Initialize();
     void Run();
     void Shutdown();
     
+    // Non-zero when a headless run failed its golden-image comparison
+    int GetExitCode() const { return m_exitCode; }
+    
 private:
+    bool InitializeContext();
+    void RunHeadless();
+    bool FinishHeadlessRun();
     void Update(float deltaTime);
     void Render();
     void HandleInput(float deltaTime);
+    bool StartCapture(const std::string& path);
+    bool InitializeSensors();
+    void FinishSensors();
     
     std::unique_ptr<Window> m_window;
     std::unique_ptr<Renderer> m_renderer;
     std::unique_ptr<Camera> m_camera;
-    std::unique_ptr<Aircraft> m_aircraft;
+    std::unique_ptr<SimulationThread> m_simulation;
     std::unique_ptr<InputManager> m_inputManager;
     std::unique_ptr<HUD> m_hud;
+    std::unique_ptr<ShaderCache> m_shaderCache;
+    
+    // Headless backend
+    std::unique_ptr<HeadlessContext> m_headlessContext;
+    std::unique_ptr<RenderTarget> m_offscreenTarget;
+    
+    std::unique_ptr<FrameCapture> m_frameCapture;
+    std::unique_ptr<FramePacer> m_framePacer;
+    
+    // Latest read-back frame per sensor, kept only with an output prefix
+    std::vector<Image> m_sensorFrames;
     
+    LaunchOptions m_options;
     bool m_running;
     bool m_initialized;
+    int m_exitCode;
     
     // Timing
     float m_lastFrameTime;
@@ -5,7 +5,7 @@
 
 namespace FlightSim {
 
-class Aircraft;
+struct AircraftState;
 
 enum class CameraMode {
     Cockpit,
@@ -20,7 +20,7 @@ public:
     
     void Update(const glm::vec3& aircraftPosition, const glm::vec3& aircraftForward, 
                 const glm::vec3& aircraftUp, float deltaTime);
-    void Update(const Aircraft& aircraft, float deltaTime);
+    void Update(const AircraftState& aircraft, float deltaTime);
     
     glm::mat4 GetViewMatrix() const;
     glm::mat4 GetProjectionMatrix() const;
@@ -28,8 +28,16 @@ public:
     glm::vec3 GetFront() const { return m_front; }
     glm::vec3 GetUp() const { return m_up; }
     glm::vec3 GetRight() const { return m_right; }
+    float GetNearPlane() const { return m_nearPlane; }
+    float GetFarPlane() const { return m_farPlane; }
+    float GetFov() const { return m_fov; }  // Vertical, degrees
+    float GetAspectRatio() const { return m_aspect; }
     
     void SetAspectRatio(float aspect);
+    
+    // Place the camera directly, e.g. for sensors fixed to the airframe; the
+    // mode's Update would overwrite it
+    void SetPose(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up);
     void SetMode(CameraMode mode) { m_mode = mode; }
     CameraMode GetMode() const { return m_mode; }
     void CycleMode();
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace FlightSim {
+
+class Window;
+
+enum class PacingMode {
+    Unlimited,     // Swap interval 0, no waiting
+    VSync,         // Swap interval 1
+    AdaptiveVSync, // Tear instead of waiting a whole refresh when late
+    Limiter        // Swap interval 0, software limiter at the target rate
+};
+
+// Paces the windowed main loop and measures how well it is paced.
+//
+// The wait for the next frame happens at the top of the loop, before
+// input is polled, so input and the camera are latched as late as possible.
+// The limiter sleeps in the window's event wait (input arriving meanwhile
+// is dispatched and timestamped immediately) and spins the last
+// millisecond or so for precision. A GPU fence keeps the CPU at most one
+// frame ahead, so vsync does not queue frames and add latency.
+//
+// While the window is unfocused the loop drops to LOW_POWER_FPS; while it
+// is minimized nothing should be rendered (see ShouldRender).
+class FramePacer {
+public:
+    static constexpr float DEFAULT_TARGET_FPS = 60.0f;
+    static constexpr float LOW_POWER_FPS = 10.0f;
+    static constexpr int HISTORY_LENGTH = 600; // Samples kept per metric
+    
+    struct Metrics {
+        int frameSamples = 0;
+        float averageFrameMs = 0.0f;
+        float jitterMs = 0.0f;      // Standard deviation of present-to-present time
+        float p99FrameMs = 0.0f;
+        int latencySamples = 0;
+        float averageLatencyMs = 0.0f; // First pending input event to swap return
+        float p99LatencyMs = 0.0f;
+    };
+    
+public:
+    FramePacer();
+    ~FramePacer();
+    
+    // Needs the window's context to be current
+    void Initialize(Window* window, PacingMode mode, float targetFps = DEFAULT_TARGET_FPS);
+    void Shutdown();
+    
+    void SetMode(PacingMode mode);
+    PacingMode GetMode() const { return m_mode; }
+    void CycleMode();
+    void SetTargetFps(float fps);
+    
+    static const char* GetModeName(PacingMode mode);
+    static bool ParseMode(const std::string& name, PacingMode& mode);
+    
+    // Top of the loop: block until the next frame should start
+    void WaitForNextFrame();
+    bool ShouldRender() const { return !m_minimized; }
+    bool IsLowPower() const { return m_lowPower; }
+    
+    // From input callbacks; the earliest event not yet presented is timed
+    void OnInputEvent();
+    
+    // Swap through the pacer so present times are recorded
+    void Present();
+    
+    Metrics GetMetrics() const;
+    bool WriteReport(const std::string& path) const;
+    
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    struct History {
+        std::vector<float> samples; // Ring of HISTORY_LENGTH
+        size_t next = 0;
+        size_t count = 0;
+        
+        void Add(float sample);
+    };
+    
+    void ApplySwapInterval();
+    void WaitUntil(Clock::time_point deadline);
+    
+    Window* m_window;
+    PacingMode m_mode;
+    float m_targetFps;
+    bool m_lowPower;
+    bool m_minimized;
+    
+    Clock::time_point m_nextDeadline;
+    Clock::time_point m_lastPresent;
+    bool m_hasPresented;
+    Clock::time_point m_pendingInput;
+    bool m_hasPendingInput;
+    void* m_frameFence; // GLsync of the last presented frame
+    
+    History m_frameTimes;
+    History m_latencies;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <utility>
+
+namespace FlightSim {
+
+// Create/destroy policies for GLHandle. Implemented in GLHandle.cpp so
+// this header does not pull in the GL loader.
+struct GLBufferTraits {
+    static unsigned int Create();
+    static void Destroy(unsigned int id);
+};
+
+struct GLVertexArrayTraits {
+    static unsigned int Create();
+    static void Destroy(unsigned int id); // Also drops the state cache binding
+};
+
+// Move-only owner of a single GL object name. The object is deleted when
+// the handle is destroyed, reset or assigned over; moving transfers
+// ownership and leaves the source empty (0).
+template<typename Traits>
+class GLHandle {
+public:
+    GLHandle() : m_id(0) {}
+    explicit GLHandle(unsigned int id) : m_id(id) {}
+    ~GLHandle() { Reset(); }
+    
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+    
+    GLHandle(GLHandle&& other) noexcept : m_id(std::exchange(other.m_id, 0)) {}
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            Reset(std::exchange(other.m_id, 0));
+        }
+        return *this;
+    }
+    
+    // Requires a current GL context
+    static GLHandle Create() { return GLHandle(Traits::Create()); }
+    
+    void Reset(unsigned int id = 0) {
+        if (m_id != 0) {
+            Traits::Destroy(m_id);
+        }
+        m_id = id;
+    }
+    
+    // Give up ownership without deleting the object
+    unsigned int Release() { return std::exchange(m_id, 0); }
+    
+    unsigned int Get() const { return m_id; }
+    explicit operator bool() const { return m_id != 0; }
+    
+private:
+    unsigned int m_id;
+};
+
+using GLBuffer = GLHandle<GLBufferTraits>;
+using GLVertexArray = GLHandle<GLVertexArrayTraits>;
+
+} // namespace FlightSim
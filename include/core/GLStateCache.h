@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+namespace FlightSim {
+
+// Shadow copy of the GL binding state that matters per draw. Binds that
+// would not change anything are skipped and counted, so the cost of
+// redundant state changes is visible.
+//
+// There is a single GL context, so the cache is process-wide. Code that
+// changes these bindings with raw GL calls must call Invalidate().
+class GLStateCache {
+public:
+    struct Counters {
+        uint32_t programBinds = 0;
+        uint32_t programBindsSkipped = 0;
+        uint32_t vertexArrayBinds = 0;
+        uint32_t vertexArrayBindsSkipped = 0;
+        uint32_t textureBinds = 0;
+        uint32_t textureBindsSkipped = 0;
+        uint32_t depthStateChanges = 0;
+        uint32_t depthStateChangesSkipped = 0;
+        uint32_t drawCalls = 0;
+    };
+    
+    static constexpr int MAX_TEXTURE_UNITS = 16;
+    
+public:
+    static GLStateCache& Get();
+    
+    void UseProgram(unsigned int program);
+    void BindVertexArray(unsigned int vao);
+    void BindTexture(unsigned int unit, unsigned int target, unsigned int texture);
+    void SetDepthMask(bool enabled);
+    void SetDepthFunc(unsigned int func);
+    
+    void CountDraw() { m_counters.drawCalls++; }
+    
+    // Call before deleting objects so a recycled name is not mistaken for
+    // the one still cached as bound
+    void OnProgramDeleted(unsigned int program);
+    void OnVertexArrayDeleted(unsigned int vao);
+    void OnTextureDeleted(unsigned int texture);
+    
+    // Forget everything; the next bind of each kind is always issued
+    void Invalidate();
+    
+    const Counters& GetCounters() const { return m_counters; }
+    void ResetCounters() { m_counters = Counters(); }
+    
+private:
+    GLStateCache();
+    
+    unsigned int m_program;
+    unsigned int m_vertexArray;
+    unsigned int m_activeTextureUnit;
+    unsigned int m_textures[MAX_TEXTURE_UNITS];
+    int m_depthMask;       // -1 = unknown
+    unsigned int m_depthFunc;
+    bool m_valid;
+    
+    Counters m_counters;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace FlightSim {
+
+// Windowless OpenGL 3.3 core context through EGL, for rendering on machines
+// without a display (CI, render farms). Prefers a surfaceless display
+// (EGL_MESA_platform_surfaceless, which also covers llvmpipe) and falls
+// back to the default display with a 1x1 pbuffer. There is no default
+// framebuffer to speak of; render into a RenderTarget.
+//
+// Only available when built with FLIGHTSIM_HEADLESS; otherwise Initialize
+// reports that and returns false.
+class HeadlessContext {
+public:
+    using ProcAddress = void* (*)(const char* name);
+    
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+    
+    bool Initialize();
+    void Shutdown();
+    
+    // Loader for gladLoadGLLoader
+    static ProcAddress GetProcAddressFunction();
+    
+private:
+    void* m_display;
+    void* m_context;
+    void* m_surface;
+};
+
+} // namespace FlightSim
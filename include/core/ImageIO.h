@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FlightSim {
+
+// RGBA8 image, top row first
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+struct ImageDifference {
+    double maxChannelError = 0.0;  // Largest absolute channel difference, 0-255
+    double meanChannelError = 0.0;
+    double mismatchedFraction = 0.0; // Pixels with any channel above the tolerance
+};
+
+namespace ImageIO {
+
+// Binary PPM (P6); alpha is dropped on write and set to 255 on read
+bool WritePPM(const std::string& path, const Image& image);
+bool ReadPPM(const std::string& path, Image& image);
+
+// Per-channel comparison; false if the sizes differ
+bool Compare(const Image& a, const Image& b, int tolerance, ImageDifference& difference);
+
+} // namespace ImageIO
+
+} // namespace FlightSim
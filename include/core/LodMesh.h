@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+namespace FlightSim {
+
+// Detail levels of one mesh, generated with MeshSimplifier, and the rule
+// for choosing between them by projected size. Level 0 is the source
+// mesh; each further level targets half the triangles of the one before
+// and records how far it strays from the source. Past the last level a
+// caller-provided impostor takes over (GetImpostorLevel()).
+class LodMesh {
+public:
+    static constexpr int MAX_LEVELS = 4;
+    
+    // A level is good enough while its error covers at most this many pixels
+    static constexpr float DEFAULT_PIXEL_ERROR = 1.0f;
+    // Below this projected diameter the impostor replaces the geometry
+    static constexpr float DEFAULT_IMPOSTOR_PIXELS = 32.0f;
+    // Relative change in projected size needed to leave the current level
+    static constexpr float HYSTERESIS = 0.15f;
+    
+    // Where a level's indices and vertices start in the merged mesh
+    struct MergedRange {
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t indexCount;
+    };
+    
+public:
+    LodMesh();
+    
+    // Build and upload the levels from a mesh that still has its CPU data
+    // (Mesh::HasCpuData). The source itself is left untouched. With
+    // buildMerged, all levels are also uploaded back to back into one mesh
+    // so they can be drawn by a single multi-draw-indirect call. Requires
+    // a current GL context.
+    bool Build(const Mesh& source, const VertexLayout& layout, bool buildMerged = false);
+    
+    int GetLevelCount() const { return static_cast<int>(m_levels.size()); }
+    int GetImpostorLevel() const { return GetLevelCount(); }
+    const Mesh& GetLevel(int level) const { return m_levels[level].mesh; }
+    float GetLevelError(int level) const { return m_levels[level].error; }
+    
+    bool HasMergedMesh() const { return m_merged.IsUploaded(); }
+    const Mesh& GetMergedMesh() const { return m_merged; }
+    const MergedRange& GetMergedRange(int level) const { return m_levels[level].merged; }
+    
+    float GetPixelError() const { return m_pixelError; }
+    float GetImpostorPixels() const { return m_impostorPixels; }
+    
+    // Bounding sphere around the center of the source bounds
+    const glm::vec3& GetCenter() const { return m_center; }
+    float GetRadius() const { return m_radius; }
+    
+    void SetPixelError(float pixels) { m_pixelError = pixels; }
+    void SetImpostorPixels(float pixels) { m_impostorPixels = pixels; }
+    
+    // Level for an instance covering pixelsPerUnit screen pixels per
+    // object-space unit; GetImpostorLevel() if allowImpostor and it is
+    // small enough. currentLevel (-1 if none yet) only changes once the
+    // size has moved HYSTERESIS past a threshold, so instances hovering at
+    // a threshold do not flicker between levels.
+    int SelectLevel(float pixelsPerUnit, int currentLevel, bool allowImpostor) const;
+    
+    size_t GetTriangleCount(int level) const { return m_levels[level].mesh.GetIndexCount() / 3; }
+    size_t GetGpuMemorySize() const;
+    
+private:
+    struct Level {
+        Mesh mesh;
+        float error; // Object-space distance to level 0
+        MergedRange merged;
+    };
+    
+    int PickLevel(float pixelsPerUnit, bool allowImpostor) const;
+    
+    std::vector<Level> m_levels;
+    Mesh m_merged;
+    glm::vec3 m_center;
+    float m_radius;
+    float m_pixelError;
+    float m_impostorPixels;
+};
+
+} // namespace FlightSim
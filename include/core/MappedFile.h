@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace FlightSim {
+
+// Read-only memory mapping of a whole file. The pages are faulted in by
+// the OS as they are touched, so mapping itself costs no copy.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    // Hints sequential access so the OS reads ahead; false if the file
+    // cannot be opened or mapped (empty files included)
+    bool Open(const std::string& path);
+    void Close();
+    
+    const unsigned char* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    bool IsOpen() const { return m_data != nullptr; }
+    
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+} // namespace FlightSim
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include "GLHandle.h"
+#include "VertexLayout.h"
 
 namespace FlightSim {
 
@@ -11,18 +16,53 @@ struct Vertex {
     glm::vec2 texCoords;
 };
 
+// Owns its GL objects, so a mesh is move-only. Build it by moving vertex
+// and index vectors in; nothing is copied between construction and upload.
 class Mesh {
 public:
     Mesh();
     ~Mesh();
     
-    void SetVertices(const std::vector<Vertex>& vertices);
-    void SetIndices(const std::vector<unsigned int>& indices);
-    void Upload();
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+    
+    void SetVertices(std::vector<Vertex>&& vertices);
+    void SetIndices(std::vector<unsigned int>&& indices);
+    
+    // GPU vertex format used by Upload (Standard by default). Shaders
+    // drawing the mesh apply GetVertexDecode() to read it back.
+    void SetVertexLayout(const VertexLayout& layout) { m_layout = layout; }
+    const VertexLayout& GetVertexLayout() const { return m_layout; }
+    const VertexDecode& GetVertexDecode() const { return m_decode; }
+    
+    // Encode to the vertex layout and upload. Indices are stored as 16-bit
+    // when every vertex is addressable with them. With releaseCpuData the
+    // CPU copies are freed afterwards; the mesh can then be drawn but not
+    // re-uploaded (e.g. with another layout).
+    void Upload(bool releaseCpuData = false);
+    
+    // Free the CPU copies of an uploaded mesh
+    void ReleaseCpuData();
+    bool HasCpuData() const { return !m_vertices.empty(); }
+    const std::vector<Vertex>& GetVertices() const { return m_vertices; }
+    const std::vector<unsigned int>& GetIndices() const { return m_indices; }
+    
+    // Map a packed .fsmesh file (see MeshFormat.h) and upload its vertex
+    // and index ranges straight from the mapping. No CPU copy is kept
+    // unless keepCpuData asks for a decoded one (e.g. to build LODs).
+    // Requires a current GL context.
+    bool LoadFromFile(const std::string& path, bool keepCpuData = false);
     
     void Render() const;
     void RenderInstanced(int instanceCount) const;
     
+    // drawCount DrawElementsIndirectCommands from the bound
+    // GL_DRAW_INDIRECT_BUFFER, starting at byte offset. Indexed meshes
+    // only; requires GL 4.3.
+    void RenderIndirect(size_t offset, int drawCount) const;
+    
     // Utility functions for creating basic shapes
     static Mesh CreateCube();
     static Mesh CreateSphere(int segments = 32);
@@ -30,15 +70,34 @@ public:
     static Mesh CreateAircraft(); // Simple aircraft mesh
     
     bool IsUploaded() const { return m_uploaded; }
+    unsigned int GetVAO() const { return m_VAO.Get(); }
+    size_t GetVertexCount() const { return m_vertexCount; }
+    size_t GetIndexCount() const { return m_indexCount; }
+    size_t GetGpuMemorySize() const;
+    const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+    const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
     
 private:
-    void SetupMesh();
+    void UploadBuffers(const void* vertexData, size_t vertexCount, const void* indexData, size_t indexCount,
+                       unsigned int indexType);
     void Cleanup();
     
+    // CPU copies for procedurally built meshes; empty for loaded files and
+    // after ReleaseCpuData
     std::vector<Vertex> m_vertices;
     std::vector<unsigned int> m_indices;
+    size_t m_vertexCount;
+    size_t m_indexCount;
+    unsigned int m_indexType;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    
+    VertexLayout m_layout;
+    VertexDecode m_decode;
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
     
-    unsigned int m_VAO, m_VBO, m_EBO;
+    GLVertexArray m_VAO;
+    GLBuffer m_VBO;
+    GLBuffer m_EBO;
     bool m_uploaded;
 };
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+namespace FlightSim {
+
+// Packed binary mesh (.fsmesh), written by tools/meshconv and mapped
+// directly by Mesh::LoadFromFile. Layout, all little-endian:
+//
+//   MeshFileHeader
+//   vertexCount * vertexStride bytes  at vertexOffset (16-byte aligned)
+//   indexCount * index size bytes     at indexOffset  (16-byte aligned)
+//
+// Vertices are already encoded in the VertexLayout named by format, so the
+// loader hands the mapped ranges to glBufferData without touching them.
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;  // VertexLayout stride; checked on load
+    uint32_t format;        // Bits 0-23 VertexLayout code, 24-31 index size in bytes
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+static constexpr uint32_t MESH_FILE_MAGIC = 0x48534D46; // "FMSH"
+static constexpr uint32_t MESH_FILE_VERSION = 2; // Version 1: format 0, float32 vertices and 32-bit indices
+static constexpr size_t MESH_FILE_ALIGNMENT = 16;
+
+static_assert(sizeof(MeshFileHeader) == 64, "Mesh file header must stay packed");
+
+inline uint32_t MakeMeshFileFormat(const VertexLayout& layout, uint32_t indexSize) {
+    return layout.GetCode() | indexSize << 24;
+}
+
+inline uint32_t MeshFileLayoutCode(uint32_t format) {
+    return format & 0xFFFFFF;
+}
+
+// Version 1 files leave the field zero and always use 32-bit indices
+inline uint32_t MeshFileIndexSize(uint32_t format) {
+    uint32_t size = format >> 24;
+    return size == 0 ? 4 : size;
+}
+
+inline uint64_t AlignMeshFileOffset(uint64_t offset) {
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_FILE_ALIGNMENT - 1);
+}
+
+} // namespace FlightSim
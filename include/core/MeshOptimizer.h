@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Mesh.h"
+
+namespace FlightSim {
+
+// Post-transform vertex cache efficiency of an index buffer, measured with
+// a simulated FIFO cache
+struct VertexCacheStats {
+    float acmr = 0.0f; // Vertex shader invocations per triangle (0.5 best, 3 worst)
+    float atvr = 0.0f; // Invocations per referenced vertex (1 best)
+};
+
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Triangle and vertex reordering for indexed triangle lists. None of the
+// passes change the rendered result, only the order it is produced in.
+// Usable at load time and by the offline converter (no GL dependency).
+namespace MeshOptimizer {
+
+// Most GPUs behave close to a FIFO of this many transformed vertices
+constexpr int DEFAULT_CACHE_SIZE = 16;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+                                    int cacheSize = DEFAULT_CACHE_SIZE);
+
+// Tipsify (Sander, Nehab and Barczak 2007): fans triangles around recently
+// used vertices so most of each triangle's corners are still cached
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                         int cacheSize = DEFAULT_CACHE_SIZE);
+
+// Splits the cache-optimized order into clusters and draws outward-facing
+// clusters first, so they occlude the rest. threshold bounds the ACMR a
+// cluster split may cost relative to the whole mesh (1.05 = 5%).
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                      float threshold = 1.05f, int cacheSize = DEFAULT_CACHE_SIZE);
+
+// Renumbers vertices in first-use order so vertex fetches walk the buffer
+// forwards. Unreferenced vertices are dropped; returns the new count.
+size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// All three passes in order
+MeshOptimizationStats Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                               int cacheSize = DEFAULT_CACHE_SIZE);
+
+} // namespace MeshOptimizer
+
+} // namespace FlightSim
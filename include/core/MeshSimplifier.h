@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Mesh.h"
+
+namespace FlightSim {
+
+// Quadric error metric decimation (Garland and Heckbert 1997) for indexed
+// triangle lists. Usable at load time and by the offline converter (no GL
+// dependency).
+namespace MeshSimplifier {
+
+// Collapses edges cheapest first until at most targetIndexCount indices
+// remain or the next collapse would move the surface further than
+// maxError. Vertices are neither moved nor created: an edge collapses onto
+// one of its endpoints, and vertices sharing a position (UV or normal
+// seams) move together. Open boundaries are held in place by extra planes
+// across them. Returns the largest collapse error, an estimate of the
+// object-space distance between the result and the original surface.
+// Unreferenced vertices are left in place; run
+// MeshOptimizer::OptimizeVertexFetch to drop them.
+float Simplify(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, size_t targetIndexCount,
+               float maxError);
+
+} // namespace MeshSimplifier
+
+} // namespace FlightSim
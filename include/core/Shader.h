@@ -1,43 +1,174 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
+#include "VertexLayout.h"
 
 namespace FlightSim {
 
+// 32-bit FNV-1a hash of a uniform name. constexpr so literal names can be
+// hashed at compile time.
+constexpr uint32_t HashUniformName(const char* name) {
+    uint32_t hash = 2166136261u;
+    while (*name != '\0') {
+        hash ^= static_cast<uint8_t>(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Typed handle to a uniform location, resolved once after link.
+// Setting a value through a handle does no lookup, hashing or allocation.
+template<typename T>
+class Uniform {
+public:
+    Uniform() : m_location(-1) {}
+    
+    bool IsValid() const { return m_location >= 0; }
+    int GetLocation() const { return m_location; }
+    
+private:
+    friend class Shader;
+    explicit Uniform(int location) : m_location(location) {}
+    
+    int m_location;
+};
+
+// Active uniform as reported by glGetActiveUniform
+struct UniformInfo {
+    std::string name;
+    uint32_t hash;
+    int location;
+    unsigned int type;  // GL type enum (GL_FLOAT_VEC3, GL_FLOAT_MAT4, ...)
+    int size;           // Array length, 1 for non-arrays
+};
+
+// Handles for the uniforms a mesh vertex shader declares to read
+// compressed vertex layouts (see VertexLayout)
+struct VertexDecodeUniforms {
+    Uniform<glm::vec3> positionOffset;
+    Uniform<glm::vec3> positionScale;
+    Uniform<bool> octahedralNormals;
+};
+
+class ShaderCache;
+
 class Shader {
+public:
+    using LinkedCallback = std::function<void(const Shader&)>;
+    
 public:
     Shader();
     ~Shader();
     
+    // Program cache used by all shaders; also tracks asynchronous loads
+    static void SetProgramCache(ShaderCache* cache);
+    
+    // Synchronous load: compiles (or fetches from the cache) and links
     bool LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
     bool LoadFromStrings(const std::string& vertexSource, const std::string& fragmentSource);
     
+    // Asynchronous load: submits compile and link without waiting on the
+    // driver. The program is finished by FinishLoad (or by
+    // ShaderCache::FinishPending when a cache is set), which then invokes
+    // onLinked so callers can resolve their uniform handles.
+    bool BeginLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                            LinkedCallback onLinked = nullptr);
+    bool BeginLoadFromStrings(const std::string& vertexSource, const std::string& fragmentSource,
+                              LinkedCallback onLinked = nullptr);
+    bool IsLinkComplete() const;
+    bool FinishLoad();
+    
+    // Synchronous compute program load (GL 4.3). Not cached: compute
+    // programs are small and only built where the GPU supports them.
+    bool LoadComputeFromString(const std::string& computeSource);
+    
+    bool IsLoadedFromCache() const { return m_loadedFromCache; }
+    
     void Use() const;
     void Unbind() const;
     
-    // Uniform setters
-    void SetBool(const std::string& name, bool value);
-    void SetInt(const std::string& name, int value);
-    void SetFloat(const std::string& name, float value);
-    void SetVec2(const std::string& name, const glm::vec2& value);
-    void SetVec3(const std::string& name, const glm::vec3& value);
-    void SetVec4(const std::string& name, const glm::vec4& value);
-    void SetMat3(const std::string& name, const glm::mat3& value);
-    void SetMat4(const std::string& name, const glm::mat4& value);
+    // Resolve a typed handle against the reflected uniform table.
+    // Call after loading; returns an invalid handle if the uniform is inactive.
+    template<typename T>
+    Uniform<T> GetUniform(const char* name) const;
+    
+    // Per-draw setters through pre-resolved handles
+    void Set(Uniform<bool> uniform, bool value) const;
+    void Set(Uniform<int> uniform, int value) const;
+    void Set(Uniform<float> uniform, float value) const;
+    void Set(Uniform<glm::vec2> uniform, const glm::vec2& value) const;
+    void Set(Uniform<glm::vec3> uniform, const glm::vec3& value) const;
+    void Set(Uniform<glm::vec4> uniform, const glm::vec4& value) const;
+    void Set(Uniform<glm::mat3> uniform, const glm::mat3& value) const;
+    void Set(Uniform<glm::mat4> uniform, const glm::mat4& value) const;
+    
+    // Consecutive elements of a uniform array, starting at element 0
+    void Set(Uniform<float> uniform, const float* values, int count) const;
+    void Set(Uniform<glm::vec4> uniform, const glm::vec4* values, int count) const;
+    void Set(Uniform<glm::mat4> uniform, const glm::mat4* values, int count) const;
+    
+    // Vertex decode uniforms: positionOffset, positionScale, octahedralNormals
+    VertexDecodeUniforms GetVertexDecodeUniforms() const;
+    void Set(const VertexDecodeUniforms& uniforms, const VertexDecode& decode) const;
+    
+    // Name-based setters for one-off use; these look the name up on every call
+    void SetBool(const char* name, bool value);
+    void SetInt(const char* name, int value);
+    void SetFloat(const char* name, float value);
+    void SetVec2(const char* name, const glm::vec2& value);
+    void SetVec3(const char* name, const glm::vec3& value);
+    void SetVec4(const char* name, const glm::vec4& value);
+    void SetMat3(const char* name, const glm::mat3& value);
+    void SetMat4(const char* name, const glm::mat4& value);
+    
+    // Location lookup keyed by HashUniformName(name), -1 if inactive
+    int GetUniformLocation(uint32_t nameHash) const;
+    
+    const std::vector<UniformInfo>& GetActiveUniforms() const { return m_uniforms; }
     
     unsigned int GetID() const { return m_programID; }
     bool IsValid() const { return m_programID != 0; }
     
+    // Whole file as a string, empty if it cannot be read. For callers that
+    // add code to a shader file before loading it from strings.
+    static std::string ReadFile(const std::string& filePath);
+    
+    // Insert code after the #version line, where declarations must start
+    static std::string InsertAfterVersion(const std::string& source, const std::string& code);
+    
 private:
+    friend class ShaderCache;
+    
     unsigned int CompileShader(const std::string& source, unsigned int type);
-    bool LinkProgram(unsigned int vertexShader, unsigned int fragmentShader);
-    int GetUniformLocation(const std::string& name);
-    std::string ReadFile(const std::string& filePath);
+    bool CheckCompileStatus(unsigned int shader);
+    bool CheckLinkStatus();
+    void ReleaseStageShaders();
+    void DetachFromCache() { m_registeredWithCache = false; }
+    void ReflectUniforms();
+    const UniformInfo* FindUniform(uint32_t nameHash) const;
+    const UniformInfo* FindUniform(const char* name) const;
+    int FindLocation(const char* name) const;
     
     unsigned int m_programID;
-    mutable std::unordered_map<std::string, int> m_uniformLocationCache;
+    
+    // In-flight load state
+    unsigned int m_vertexShader;
+    unsigned int m_fragmentShader;
+    uint64_t m_cacheKey;
+    bool m_loadPending;
+    bool m_loadedFromCache;
+    bool m_registeredWithCache;
+    LinkedCallback m_onLinked;
+    
+    static ShaderCache* s_programCache;
+    
+    // Reflected active uniforms, sorted by name hash. Names whose hashes
+    // collide are left out, so a hash hit is always the right uniform.
+    std::vector<UniformInfo> m_uniforms;
 };
 
-} // namespace FlightSim 
\ No newline at end of file
+} // namespace FlightSim
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FlightSim {
+
+class Shader;
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary)
+// keyed by a hash of the shader sources and the driver identification
+// strings, plus the list of programs whose compilation is still in flight.
+class ShaderCache {
+public:
+    struct Stats {
+        int cacheHits = 0;
+        int cacheMisses = 0;
+        int cacheStores = 0;
+        int programsLinked = 0;
+    };
+    
+public:
+    ShaderCache();
+    ~ShaderCache();
+    
+    // Must be called with a current GL context
+    bool Initialize(const std::string& directory);
+    
+    uint64_t MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+    
+    // Load a cached binary into program; false on miss or driver rejection
+    bool LoadProgram(uint64_t key, unsigned int program);
+    void StoreProgram(uint64_t key, unsigned int program);
+    
+    // Programs submitted with Shader::BeginLoadFromStrings register here and
+    // are finished in completion order by FinishPending.
+    void AddPending(Shader* shader);
+    void RemovePending(Shader* shader);
+    bool FinishPending();
+    
+    bool IsBinaryCacheAvailable() const { return m_binaryCacheAvailable; }
+    bool IsParallelCompileAvailable() const { return m_parallelCompileAvailable; }
+    const Stats& GetStats() const { return m_stats; }
+    
+private:
+    std::string GetCachePath(uint64_t key) const;
+    
+    std::string m_directory;
+    std::string m_driverString;
+    bool m_binaryCacheAvailable;
+    bool m_parallelCompileAvailable;
+    
+    std::vector<Shader*> m_pending;
+    Stats m_stats;
+    unsigned int m_tempFileCounter; // Makes temporary file names unique
+};
+
+} // namespace FlightSim
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <thread>
+#include "TripleBuffer.h"
+#include "SpscQueue.h"
+#include "WorldSnapshot.h"
+#include "../physics/Aircraft.h"
+#include "../physics/TrailRecorder.h"
+
+namespace FlightSim {
+
+class Traffic;
+
+// Runs aircraft and traffic physics at a fixed rate on its own thread.
+// Each tick is published as an immutable WorldSnapshot through a triple
+// buffer, so the render thread never waits on the simulation and always
+// draws the latest complete tick. Input travels the other way through a
+// lock-free command queue.
+class SimulationThread {
+public:
+    static constexpr double FIXED_TIMESTEP = 1.0 / 120.0;
+    static constexpr int MAX_STEPS_PER_UPDATE = 8; // Drop time rather than spiral after a stall
+    
+    struct Command {
+        enum class Type {
+            Controls,
+            ResetAircraft,
+            SetTrafficCount
+        };
+        
+        Type type = Type::Controls;
+        ControlInputs controls;
+        int trafficCount = 0;
+    };
+    
+public:
+    SimulationThread();
+    ~SimulationThread();
+    
+    // Spawns traffic and publishes the initial snapshot
+    bool Initialize(int trafficCount, float trafficRadius);
+    
+    // Free-running mode: ticks in real time on a worker thread
+    void Start();
+    void Stop();
+    bool IsRunning() const { return m_thread.joinable(); }
+    
+    // Stepped mode: run the ticks covering deltaTime on the calling thread.
+    // Used by headless runs so results do not depend on scheduling.
+    void Advance(double deltaTime);
+    
+    // Render thread. Commands are dropped (and false returned) if the
+    // simulation has fallen a full queue behind.
+    bool PushCommand(const Command& command);
+    
+    // Render thread. Picks up the newest published snapshot, if any, and
+    // returns true if it changed; GetSnapshot stays valid until the next call.
+    bool AcquireSnapshot() { return m_snapshots.Acquire(); }
+    const WorldSnapshot& GetSnapshot() const { return m_snapshots.GetReadBuffer(); }
+    
+private:
+    void ThreadLoop();
+    void ProcessCommands();
+    void Step(float deltaTime);
+    void Publish();
+    void ResetTrafficTrails();
+    
+    std::unique_ptr<Aircraft> m_aircraft;
+    std::unique_ptr<Traffic> m_traffic;
+    float m_trafficRadius;
+    
+    // Simulation-thread state
+    ControlInputs m_controls;
+    std::vector<TrailRecorder> m_trails; // Player, then tracked traffic
+    HUDValues m_hudValues;
+    uint64_t m_tick;
+    double m_accumulator;
+    
+    TripleBuffer<WorldSnapshot> m_snapshots;
+    SpscQueue<Command, 256> m_commands;
+    
+    std::thread m_thread;
+    std::atomic<bool> m_stopRequested;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "GLHandle.h"
+
+namespace FlightSim {
+
+// Per-frame upload ring for dynamic vertex and instance data.
+//
+// With buffer storage (GL 4.4 or ARB_buffer_storage) the buffer is mapped
+// once, persistent and coherent, and split into PARTITION_COUNT
+// partitions. Each frame hands out sub-allocations from the next
+// partition; BeginFrame waits on the fence EndFrame placed after that
+// partition's last use, which has normally signaled two frames ago. An
+// upload is then a memcpy into the mapping with no driver involvement.
+//
+// Without buffer storage the buffer holds a single partition whose storage
+// is orphaned in BeginFrame. Allocations are written to a client-side copy
+// and uploaded by Commit, so callers use both paths the same way.
+//
+// Allocations are valid until the next BeginFrame. One that does not fit
+// the partition fails (empty Allocation) and the partitions grow before
+// the next frame, so callers should expect a rare skipped upload.
+class StreamingBuffer {
+public:
+    static constexpr int PARTITION_COUNT = 3;
+    
+    struct Allocation {
+        void* data = nullptr; // Write only; never read back from it
+        size_t offset = 0;    // Bytes from the start of GetBuffer()
+        size_t size = 0;
+        
+        explicit operator bool() const { return data != nullptr; }
+    };
+    
+public:
+    StreamingBuffer();
+    ~StreamingBuffer();
+    
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+    
+    static bool IsPersistentSupported();
+    
+    bool Initialize(size_t partitionSize);
+    void Shutdown();
+    
+    void BeginFrame();
+    void EndFrame();
+    
+    // Alignment need not be a power of two, so a vertex stride works when
+    // the offset is used as a first vertex
+    Allocation Allocate(size_t size, size_t alignment = 16);
+    
+    // Make the written allocation visible to the GPU. Must come before the
+    // draw that reads it; a no-op for the persistent mapping.
+    void Commit(const Allocation& allocation);
+    
+    // May change in BeginFrame when the partitions grow
+    unsigned int GetBuffer() const { return m_buffer.Get(); }
+    bool IsPersistent() const { return m_mapped != nullptr; }
+    
+    size_t GetPartitionSize() const { return m_partitionSize; }
+    size_t GetFrameBytes() const { return m_frameOffset; } // Allocated so far this frame
+    int GetStallCount() const { return m_stallCount; }     // BeginFrame waits that blocked
+    size_t GetGpuMemorySize() const;
+    
+private:
+    bool CreateStorage(size_t partitionSize);
+    void ReleaseStorage();
+    void WaitForPartition(int partition);
+    
+    GLBuffer m_buffer;
+    void* m_mapped;                       // Persistent mapping of every partition
+    std::vector<unsigned char> m_staging; // Fallback: the frame's data before Commit
+    void* m_fences[PARTITION_COUNT];      // GLsync of each partition's last frame
+    
+    size_t m_partitionSize;
+    size_t m_requiredSize; // Largest frame that was asked for, grown to in BeginFrame
+    int m_partition;
+    size_t m_frameOffset;
+    size_t m_frameOverflow; // Bytes of this frame's failed allocations
+    int m_stallCount;
+};
+
+} // namespace FlightSim
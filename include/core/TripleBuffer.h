@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace FlightSim {
+
+// Lock-free single-producer/single-consumer triple buffer. The writer fills
+// its private slot and publishes it by swapping with the shared middle
+// slot; the reader swaps the middle slot with its own when a newer one is
+// available. Neither side ever waits, the reader always sees the latest
+// complete value, and intermediate values may be skipped.
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_middle(1), m_writeIndex(0), m_readIndex(2) {}
+    
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+    
+    // Writer thread
+    T& GetWriteBuffer() { return m_buffers[m_writeIndex]; }
+    
+    void Publish() {
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_writeIndex | FRESH_BIT), std::memory_order_acq_rel);
+        m_writeIndex = previous & INDEX_MASK;
+    }
+    
+    // Reader thread. Returns true if a newer value was published since the
+    // last call; the read buffer stays valid until the next Acquire.
+    bool Acquire() {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+            return false;
+        }
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_readIndex), std::memory_order_acq_rel);
+        m_readIndex = previous & INDEX_MASK;
+        return true;
+    }
+    
+    const T& GetReadBuffer() const { return m_buffers[m_readIndex]; }
+    
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH_BIT = 0x4;
+    
+    T m_buffers[3];
+    
+    // Middle slot index plus a flag set by Publish and cleared by Acquire
+    alignas(64) std::atomic<uint8_t> m_middle;
+    alignas(64) uint8_t m_writeIndex;
+    alignas(64) uint8_t m_readIndex;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace FlightSim {
+
+struct Vertex;
+
+enum class PositionEncoding : uint8_t {
+    Float32 = 0,
+    Unorm16 = 1       // Quantized to the mesh bounds; decoded with VertexDecode
+};
+
+enum class NormalEncoding : uint8_t {
+    Float32 = 0,
+    Octahedral16 = 1, // Two snorm16 components
+    Octahedral8 = 2   // Two snorm8 components, padded to four bytes
+};
+
+enum class TexCoordEncoding : uint8_t {
+    Float32 = 0,
+    Half16 = 1,
+    Unorm16 = 2       // Only for coordinates within [0, 1]
+};
+
+// One glVertexAttribPointer call
+struct VertexAttribute {
+    unsigned int location;
+    unsigned int type;  // GL component type
+    int components;
+    bool normalized;
+    uint32_t offset;
+};
+
+// Uniform values a vertex shader needs to turn encoded attributes back
+// into object space. For Float32 positions the offset is 0 and the scale 1.
+struct VertexDecode {
+    glm::vec3 positionOffset{0.0f};
+    glm::vec3 positionScale{1.0f};
+    bool octahedralNormals = false;
+};
+
+// Packed vertex format built from per-attribute encodings. Attributes keep
+// locations 0-2 (position, normal, texture coordinates) and 4-byte aligned
+// offsets, so the same shaders read every layout given the decode uniforms.
+// Makes no GL calls, so offline tools can use it; Mesh applies it to a VAO.
+class VertexLayout {
+public:
+    VertexLayout(PositionEncoding position = PositionEncoding::Float32,
+                 NormalEncoding normal = NormalEncoding::Float32,
+                 TexCoordEncoding texCoord = TexCoordEncoding::Float32);
+    
+    // 32 bytes of float32, identical to Vertex
+    static VertexLayout Standard() { return VertexLayout(); }
+    // 16 bytes: quantized positions, octahedral normals, half-float UVs
+    static VertexLayout Compact() {
+        return VertexLayout(PositionEncoding::Unorm16, NormalEncoding::Octahedral16, TexCoordEncoding::Half16);
+    }
+    
+    // Encodings packed into one word for the mesh file header
+    uint32_t GetCode() const;
+    static bool FromCode(uint32_t code, VertexLayout& layout);
+    
+    PositionEncoding GetPositionEncoding() const { return m_position; }
+    NormalEncoding GetNormalEncoding() const { return m_normal; }
+    TexCoordEncoding GetTexCoordEncoding() const { return m_texCoord; }
+    
+    uint32_t GetStride() const { return m_stride; }
+    const std::vector<VertexAttribute>& GetAttributes() const { return m_attributes; }
+    bool IsStandard() const;
+    
+    // Pack count vertices into out (count * GetStride() bytes). Positions
+    // are quantized against boundsMin/boundsMax.
+    void Encode(const Vertex* vertices, size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+                std::vector<uint8_t>& out) const;
+    // Inverse of Encode, up to quantization: unpack count vertices of data
+    void Decode(const uint8_t* data, size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+                std::vector<Vertex>& out) const;
+    VertexDecode GetDecode(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+    
+private:
+    PositionEncoding m_position;
+    NormalEncoding m_normal;
+    TexCoordEncoding m_texCoord;
+    uint32_t m_stride;
+    std::vector<VertexAttribute> m_attributes;
+};
+
+} // namespace FlightSim
@@ -26,6 +26,12 @@ public:
     void SwapBuffers();
     void PollEvents();
     
+    // Sleep until an event arrives or the timeout passes, then dispatch
+    void WaitEvents(double timeoutSeconds);
+    
+    bool IsFocused() const;
+    bool IsMinimized() const;
+    
     void SetKeyCallback(KeyCallback callback);
     void SetMouseCallback(MouseCallback callback);
     void SetScrollCallback(ScrollCallback callback);
@@ -33,9 +39,14 @@ public:
     
     int GetWidth() const { return m_width; }
     int GetHeight() const { return m_height; }
+    void GetFramebufferSize(int& width, int& height) const;
     GLFWwindow* GetHandle() const { return m_window; }
     
     void SetVSync(bool enabled);
+    
+    // Sync to vblank but swap immediately when a frame misses it; falls back
+    // to plain vsync and returns false without swap_control_tear
+    bool SetAdaptiveVSync();
     void SetCursorMode(int mode);
     
 private:
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../physics/Aircraft.h"
+#include "../physics/TrailRecorder.h"
+#include "../ui/HUDValues.h"
+
+namespace FlightSim {
+
+// Everything the render thread needs from one simulation tick. Published
+// whole through a triple buffer, so it is never modified after publishing.
+struct WorldSnapshot {
+    static constexpr size_t MAX_TRAILS = 32; // Player plus the first tracked traffic
+    
+    uint64_t tick = 0;
+    double simulationTime = 0.0;
+    
+    AircraftState player;
+    std::vector<AircraftState> traffic;
+    std::vector<TrailUpdate> trails;    // Player first, then traffic in state order
+    HUDValues hud;
+};
+
+} // namespace FlightSim
@@ -31,6 +31,7 @@ struct AircraftState {
     float heading = 0.0f;         // degrees
     float pitch = 0.0f;           // degrees
     float roll = 0.0f;            // degrees
+    float throttle = 0.0f;        // 0.0 to 1.0, last commanded
 };
 
 class Aircraft {
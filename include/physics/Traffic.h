@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Aircraft.h"
+
+namespace FlightSim {
+
+// Kinematic background traffic. Each aircraft flies a level circular
+// holding pattern, which is cheap enough to update tens of thousands of
+// aircraft per frame and gives the renderer a realistic population.
+class Traffic {
+public:
+    Traffic();
+    ~Traffic();
+    
+    void Spawn(int count, const glm::vec3& center, float radius, unsigned int seed = 1);
+    void Clear();
+    
+    void Update(float deltaTime);
+    
+    const std::vector<AircraftState>& GetStates() const { return m_states; }
+    size_t GetCount() const { return m_states.size(); }
+    
+private:
+    struct Orbit {
+        glm::vec3 center;
+        float radius;
+        float angularSpeed; // rad/s, sign gives direction
+        float phase;        // rad
+    };
+    
+    void UpdateState(const Orbit& orbit, AircraftState& state) const;
+    
+    std::vector<Orbit> m_orbits;
+    std::vector<AircraftState> m_states;
+};
+
+} // namespace FlightSim
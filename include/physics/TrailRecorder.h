@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace FlightSim {
+
+// One committed trail vertex; matches the RGBA32F texel layout on the GPU
+struct TrailPoint {
+    glm::vec3 position;
+    float time; // Simulation time in seconds
+};
+
+// What the renderer needs to extend one trail. Points are numbered from
+// the start of the trail; recentPoints ends at committedCount and covers
+// the last PUBLISH_WINDOW_TICKS of commits, so a renderer that skipped a
+// few snapshots can still pick up every point it missed.
+struct TrailUpdate {
+    uint32_t generation = 0;   // Changes when the trail is restarted
+    uint64_t committedCount = 0;
+    std::vector<TrailPoint> recentPoints;
+    glm::vec3 head{0.0f};      // Current position, joined to the last committed point
+};
+
+// Records an aircraft's path with streaming curvature decimation. Every
+// sample extends the live segment from the last committed point; a sample
+// is only committed once keeping it straight would put a skipped sample
+// more than the tolerance off the line, so straight and gently curving
+// flight costs a handful of points per kilometre however long it lasts.
+class TrailRecorder {
+public:
+    static constexpr uint64_t PUBLISH_WINDOW_TICKS = 240;
+    static constexpr size_t MAX_PENDING_SAMPLES = 256;
+    
+public:
+    TrailRecorder(float tolerance = 1.0f, float maxSegmentLength = 2000.0f);
+    
+    void Reset(const glm::vec3& position, float time);
+    void AddSample(const glm::vec3& position, float time, uint64_t tick);
+    
+    // Copy the commits made since tick - PUBLISH_WINDOW_TICKS into update;
+    // reuses update's storage
+    void Fill(TrailUpdate& update) const;
+    
+    uint64_t GetCommittedCount() const { return m_committedCount; }
+    
+private:
+    struct Commit {
+        TrailPoint point;
+        uint64_t tick;
+    };
+    
+    void CommitPoint(const TrailPoint& point, uint64_t tick);
+    bool FitsSegment(const glm::vec3& start, const glm::vec3& end) const;
+    
+    float m_tolerance;
+    float m_maxSegmentLength;
+    
+    uint32_t m_generation;
+    uint64_t m_committedCount;
+    uint64_t m_lastTick;
+    std::deque<Commit> m_recent;        // Commits inside the publish window
+    std::vector<TrailPoint> m_pending;  // Samples since the last commit
+    glm::vec3 m_anchor;                 // Last committed position
+    glm::vec3 m_head;
+};
+
+} // namespace FlightSim
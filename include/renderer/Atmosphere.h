@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <glm/glm.hpp>
+#include "../core/Shader.h"
+
+namespace FlightSim {
+
+// Handles for the uniforms declared by Atmosphere::AddShaderFunctions
+struct AtmosphereUniforms {
+    Uniform<int> transmittanceLut;
+    Uniform<int> scatteringLut;
+    Uniform<int> irradianceLut;
+    Uniform<glm::vec3> sunDirection;
+    Uniform<float> exposure;
+};
+
+// Precomputed atmospheric scattering (after Bruneton and Neyret 2008 and
+// Elek 2009). Three lookup tables are rendered once at startup:
+//   transmittance (altitude, view zenith)              2D
+//   single scattering (altitude, view zenith, sun zenith) 3D
+//   ground irradiance from the sky (altitude, sun zenith) 2D
+// The sun zenith is a table dimension, so moving the sun or changing the
+// time of day is free; nothing is recomputed per frame.
+//
+// Shaders get the lookup functions through AddShaderFunctions and bind
+// the tables with Apply. World space is meters with the ground at y = 0.
+class Atmosphere {
+public:
+    static constexpr int TRANSMITTANCE_WIDTH = 256;  // View zenith
+    static constexpr int TRANSMITTANCE_HEIGHT = 64;  // Altitude
+    static constexpr int SCATTERING_WIDTH = 128;     // View zenith
+    static constexpr int SCATTERING_HEIGHT = 32;     // Sun zenith
+    static constexpr int SCATTERING_DEPTH = 32;      // Altitude
+    static constexpr int IRRADIANCE_WIDTH = 64;      // Sun zenith
+    static constexpr int IRRADIANCE_HEIGHT = 16;     // Altitude
+    
+public:
+    Atmosphere();
+    ~Atmosphere();
+    
+    // Builds the tables; needs a current GL context. Restores the
+    // framebuffer and viewport bound on entry.
+    bool Initialize();
+    void Shutdown();
+    
+    // Direction towards the sun
+    void SetSunDirection(const glm::vec3& direction);
+    const glm::vec3& GetSunDirection() const { return m_sunDirection; }
+    
+    // 0.0 = midnight, 0.25 = sunrise, 0.5 = noon, 0.75 = sunset
+    void SetTimeOfDay(float time);
+    float GetTimeOfDay() const { return m_timeOfDay; }
+    
+    // Radiance scale applied before tone mapping
+    void SetExposure(float exposure) { m_exposure = exposure; }
+    
+    // Insert the atmosphere GLSL library after the #version line of a
+    // fragment shader. It declares the AtmosphereUniforms and provides
+    //   WorldToAtmosphere, GetSkyRadiance, GetSkyRadianceToPoint,
+    //   GetSunAndSkyIrradiance, ToDisplay
+    static std::string AddShaderFunctions(const std::string& source);
+    static AtmosphereUniforms GetUniforms(const Shader& shader);
+    
+    // Bind the tables and set the sun and exposure; call from a material
+    void Apply(const Shader& shader, const AtmosphereUniforms& uniforms) const;
+    
+    bool IsReady() const { return m_ready; }
+    
+private:
+    bool CreateTextures();
+    bool RenderTables();
+    
+    unsigned int m_transmittanceTexture;
+    unsigned int m_scatteringTexture;
+    unsigned int m_irradianceTexture;
+    
+    glm::vec3 m_sunDirection;
+    float m_timeOfDay;
+    float m_exposure;
+    bool m_ready;
+};
+
+} // namespace FlightSim
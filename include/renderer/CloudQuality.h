@@ -0,0 +1,14 @@
+#pragma once
+
+namespace FlightSim {
+
+// Presets of VolumetricClouds, cheapest first
+enum class CloudQuality {
+    Off,
+    Low,    // 32 steps, 3 light samples, no detail noise, 20 km
+    Medium, // 48 steps, 4 light samples, 30 km
+    High,   // 64 steps, 6 light samples, 40 km
+    Ultra   // 96 steps, 6 light samples, 50 km
+};
+
+} // namespace FlightSim
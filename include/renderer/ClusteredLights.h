@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../core/Shader.h"
+
+namespace FlightSim {
+
+class Camera;
+class StreamingBuffer;
+
+// Small omnidirectional light: runway, approach, navigation or beacon
+struct PointLight {
+    glm::vec3 position; // World space
+    float radius;       // Meters; the light ends smoothly here
+    glm::vec3 color;    // Linear, times intensity (irradiance at 1 m)
+};
+
+// Handles for the uniforms declared by ClusteredLights::AddShaderFunctions
+struct LocalLightUniforms {
+    Uniform<bool> enabled;
+    Uniform<int> lights;
+    Uniform<int> clusters;
+    Uniform<int> indices;
+    Uniform<int> lightsOffset;
+    Uniform<int> clustersOffset;
+    Uniform<int> indicesOffset;
+    Uniform<glm::mat4> view;
+    Uniform<glm::vec4> projection;
+};
+
+// Clustered forward shading for many local lights.
+//
+// Each frame the lights are binned on the CPU into a froxel grid over the
+// main camera's frustum: TILES_X x TILES_Y screen tiles times SLICES depth
+// slices, exponential in depth after a first slice up to FIRST_SLICE_DEPTH.
+// A light is added to every cluster its bounding sphere may touch, tested
+// per slice so nearby lights stay tight. The lights, one (first, count)
+// range per cluster and the index list go into the streaming buffer and
+// are read through texture buffers, so shaders stay at GL 3.3. GL 3.3 only
+// guarantees 65536 texels per texture buffer, so with GL 4.3 or
+// ARB_texture_buffer_range each list is attached as its own range, and
+// otherwise a frame whose lists lie past the limit gets no local lights.
+//
+// A fragment finds its cluster from its world position, so any view can
+// use the lists: points outside the main camera's grid get no local light.
+// Binning cost grows with the clusters each light covers, and shading cost
+// with the lights in one cluster, not with the total.
+class ClusteredLights {
+public:
+    static constexpr int TILES_X = 16;
+    static constexpr int TILES_Y = 9;
+    static constexpr int SLICES = 24;
+    static constexpr int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+    static constexpr float FIRST_SLICE_DEPTH = 5.0f; // Meters
+    static constexpr size_t MAX_LIGHTS = 65535;      // 16-bit indices
+    
+public:
+    ClusteredLights();
+    ~ClusteredLights();
+    
+    bool Initialize();
+    void Shutdown();
+    
+    // Lights beyond this distance from the camera are dropped
+    void SetMaxDistance(float distance) { m_maxDistance = distance; }
+    
+    // Collect this frame's lights. The radius is where the light's
+    // irradiance falls below what is visible at night.
+    void Clear() { m_lights.clear(); }
+    void AddLight(const glm::vec3& position, const glm::vec3& color, float intensity);
+    void AddLights(const std::vector<PointLight>& lights);
+    static PointLight MakeLight(const glm::vec3& position, const glm::vec3& color, float intensity);
+    
+    // Bin the lights for the camera and upload the lists. If the stream is
+    // full, shaders see no local lights this frame.
+    void Build(const Camera& camera, StreamingBuffer& stream);
+    
+    // Insert the local light GLSL library after the #version line of a
+    // fragment shader. It declares the LocalLightUniforms and provides
+    //   vec3 GetLocalLightIrradiance(vec3 worldPosition, vec3 normal, vec3 viewDir,
+    //                                float shininess, out vec3 specular)
+    // with specular the normalized Blinn-Phong highlight of the same lights.
+    static std::string AddShaderFunctions(const std::string& source);
+    static LocalLightUniforms GetUniforms(const Shader& shader);
+    
+    // Bind the light lists; call from a material
+    void Apply(const Shader& shader, const LocalLightUniforms& uniforms) const;
+    
+    size_t GetLightCount() const { return m_lights.size(); }
+    size_t GetBinnedLightCount() const { return m_binnedCount; }
+    size_t GetIndexCount() const { return m_indices.size(); }
+    
+private:
+    template<typename Visit>
+    void VisitClusters(const glm::vec3& center, float radius, Visit&& visit) const;
+    int GetSlice(float depth) const;
+    
+    std::vector<PointLight> m_lights;
+    float m_maxDistance;
+    
+    // Built by the last Build; capacity is kept between frames
+    std::vector<glm::vec4> m_lightData;   // Two texels per light
+    std::vector<glm::vec4> m_viewSpheres; // View-space center and radius
+    std::vector<uint32_t> m_clusters;     // (first index, count) per cluster
+    std::vector<uint16_t> m_indices;
+    size_t m_binnedCount;
+    
+    // Texture buffer limits, queried at Initialize
+    int m_maxTexels;
+    bool m_rangeSupported;
+    size_t m_rangeAlignment; // Bytes; range offsets must be multiples
+    
+    // Grid of the last Build
+    glm::mat4 m_view;
+    glm::vec4 m_projection; // x, y scale to NDC; z, w map log depth to slices
+    float m_sliceDepths[SLICES + 1];
+    
+    unsigned int m_lightTexture;
+    unsigned int m_clusterTexture;
+    unsigned int m_indexTexture;
+    int m_lightsOffset; // In texels of each texture's format
+    int m_clustersOffset;
+    int m_indicesOffset;
+    bool m_valid;
+};
+
+} // namespace FlightSim
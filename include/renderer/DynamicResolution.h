@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include "../core/GLHandle.h"
+#include "../core/Shader.h"
+
+namespace FlightSim {
+
+class GpuProfiler;
+
+// Renders the 3D scene below native resolution when the GPU runs over its
+// frame budget. A PI controller drives the rendered pixel count from the
+// measured GPU frame time; the scene goes into the corner of a
+// native-sized target (so scale changes never reallocate) and is upscaled
+// with contrast-adaptive sharpening. The scene and resolve targets are
+// render graph transients declared by the renderer; passes after the
+// upscale, such as the HUD, draw at native resolution.
+class DynamicResolution {
+public:
+    static constexpr float MIN_SCALE = 0.5f; // Per axis
+    static constexpr float MAX_SCALE = 1.0f;
+    
+public:
+    DynamicResolution();
+    ~DynamicResolution();
+    
+    // samples matches the output framebuffer's MSAA; the scene is resolved
+    // before upscaling
+    bool Initialize(int samples);
+    void Shutdown();
+    
+    // Output size, which is also the size of the scene targets
+    bool Resize(int width, int height);
+    int GetOutputWidth() const { return m_outputWidth; }
+    int GetOutputHeight() const { return m_outputHeight; }
+    int GetSamples() const { return m_samples; }
+    
+    void SetFrameBudget(float milliseconds) { m_frameBudgetMs = milliseconds; }
+    float GetFrameBudget() const { return m_frameBudgetMs; }
+    
+    // 0 = plain bilinear upscale, 1 = strongest sharpening
+    void SetSharpness(float sharpness) { m_sharpness = sharpness; }
+    
+    // Step the controller once per new GPU frame time sample
+    void Update(const GpuProfiler& profiler);
+    
+    // Draw the scene, rendered into the lower-left GetRenderWidth() x
+    // GetRenderHeight() of sceneTexture, over the bound output framebuffer
+    // and clear its depth for the passes after it
+    void Upscale(unsigned int sceneTexture, int textureWidth, int textureHeight);
+    
+    float GetScale() const { return m_scale; }
+    int GetRenderWidth() const { return m_renderWidth; }
+    int GetRenderHeight() const { return m_renderHeight; }
+    
+private:
+    void UpdateRenderSize();
+    
+    std::unique_ptr<Shader> m_upscaleShader;
+    struct UpscaleUniforms {
+        Uniform<int> sceneTexture;
+        Uniform<glm::vec2> uvScale;
+        Uniform<glm::vec2> texelSize;
+        Uniform<float> sharpness;
+    } m_upscaleUniforms;
+    GLVertexArray m_emptyVAO;
+    int m_samples;
+    
+    int m_outputWidth;
+    int m_outputHeight;
+    int m_renderWidth;
+    int m_renderHeight;
+    
+    // Controller state; the controlled value is the rendered pixel fraction
+    float m_frameBudgetMs;
+    float m_sharpness;
+    float m_scale;
+    float m_integral;
+    int m_lastSample;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PixelReadbackRing.h"
+
+namespace FlightSim {
+
+enum class CaptureFormat {
+    Y4M,     // YUV 4:2:0 video stream, playable and encodable by ffmpeg
+    RawRGBA  // Headerless RGBA8 frames, top row first
+};
+
+// Records rendered frames to disk. Frames are read back through a PBO ring
+// and handed to a writer thread that converts and writes them, so the
+// render thread neither waits on glReadPixels nor on the disk. Frames are
+// never dropped: if the writer falls MAX_BUFFERED_FRAMES behind, the render
+// thread blocks until a buffer is free and the stall is counted. Only a
+// GPU that does not finish a readback within a second loses frames.
+class FrameCapture {
+public:
+    static constexpr int READBACK_DEPTH = 3;
+    static constexpr int MAX_BUFFERED_FRAMES = 8;
+    
+    struct Stats {
+        int framesCaptured = 0;
+        int framesWritten = 0;
+        int readbackStalls = 0; // Render thread waited on the GPU
+        int writerStalls = 0;   // Render thread waited on the writer
+        int framesDropped = 0;  // Readback timed out
+    };
+    
+public:
+    FrameCapture();
+    ~FrameCapture();
+    
+    // Must be called with a current GL context
+    bool Start(const std::string& path, int width, int height, int framesPerSecond, CaptureFormat format);
+    void Stop();
+    bool IsActive() const { return m_active; }
+    
+    // Queue a readback of the finished frame in framebuffer (0 = back
+    // buffer); call after rendering and before swapping
+    void CaptureFrame(unsigned int framebuffer);
+    
+    Stats GetStats() const;
+    
+    // .y4m selects Y4M, anything else raw RGBA
+    static CaptureFormat FormatFromPath(const std::string& path);
+    
+private:
+    void EnqueueFrame(const uint8_t* pixels);
+    void WriterLoop();
+    void WriteFrame(const std::vector<uint8_t>& pixels);
+    
+    PixelReadbackRing m_readback;
+    std::ofstream m_file;
+    CaptureFormat m_format;
+    int m_width;
+    int m_height;
+    bool m_active;
+    
+    // Frames move from the free list to the write queue and back
+    std::thread m_writer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::vector<uint8_t>> m_writeQueue;
+    std::vector<std::vector<uint8_t>> m_freeBuffers;
+    int m_allocatedBuffers;
+    bool m_stopping;
+    Stats m_stats;
+    
+    // Writer thread only
+    std::vector<uint8_t> m_conversion;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "../core/LodMesh.h"
+#include "../core/Shader.h"
+
+namespace FlightSim {
+
+class Mesh;
+class RenderQueue;
+
+// GPU-driven culling and submission of instanced aircraft (GL 4.3).
+//
+// The instances TrafficRenderer uploads are read as a storage buffer. Per
+// view one compute dispatch tests every instance's bounding sphere against
+// the frustum and appends the survivors to its level's region of the
+// view's instance buffer, counting them straight into the view's indirect
+// commands. One glMultiDrawElementsIndirect over LodMesh's merged mesh
+// then draws every level, and one indirect draw of the quad draws the
+// impostors. The CPU cost of a view is constant: no per-instance work,
+// no readback and no per-level draw.
+//
+// The main view also picks each instance's level (with the hysteresis of
+// LodMesh::SelectLevel, state kept on the GPU) and rejects instances
+// hidden behind the previous frame's depth (BuildDepthPyramid). Other
+// views reuse the main view's levels.
+class GpuCulling {
+public:
+    enum View {
+        MAIN_VIEW,
+        SHADOW_VIEW, // Skips impostors
+        SENSOR_VIEW,
+        VIEW_COUNT
+    };
+    
+public:
+    GpuCulling();
+    ~GpuCulling();
+    
+    // Compute shaders, storage buffers and indirect draws
+    static bool IsSupported();
+    
+    // lods must have a merged mesh; impostorQuad may be null
+    bool Initialize(const LodMesh& lods, const Mesh* impostorQuad);
+    void Shutdown();
+    
+    // Instances for this frame's dispatches, e.g. TrafficRenderer's
+    // allocation; offset must meet the storage buffer offset alignment.
+    // A changed count starts every instance's level over.
+    void SetInstances(unsigned int buffer, size_t offset, size_t count);
+    
+    // pixelsPerUnit is the screen pixels per object-space unit at distance 1
+    void CullMain(const glm::mat4& viewProjection, const glm::vec3& viewPos, float nearPlane, float pixelsPerUnit,
+                  bool allowImpostors);
+    void Cull(View view, const glm::mat4& viewProjection);
+    
+    // Queue the indirect draws of a culled view. The material's prepareDraw
+    // must call BindView with the packet's userData.
+    void SubmitDraws(RenderQueue& queue, View view, const Shader& shader, uint32_t material) const;
+    void SubmitImpostorDraws(RenderQueue& queue, View view, const Shader& shader, uint32_t material) const;
+    void BindView(uint32_t view) const;
+    
+    // Max-reduced mip chain of the main view's depth, read by the next
+    // frame's CullMain. The source framebuffer's depth must be
+    // DEPTH24_STENCIL8; only its width x height corner is used.
+    void BuildDepthPyramid(unsigned int sourceFramebuffer, int width, int height, const glm::mat4& viewProjection);
+    void InvalidateDepthPyramid() { m_pyramidValid = false; }
+    unsigned int GetDepthPyramid() const { return m_pyramid; }
+    
+    // Instances of a level drawn by the view's last cull. Reads back from
+    // the GPU, so for reports only.
+    int ReadVisibleCount(View view, int level) const;
+    
+    size_t GetGpuMemorySize() const;
+    
+private:
+    struct CullUniforms {
+        Uniform<int> instanceCount;
+        Uniform<glm::vec4> frustumPlanes;
+        Uniform<glm::vec3> boundsCenter;
+        Uniform<float> boundsRadius;
+        Uniform<bool> selectLevels;
+        Uniform<bool> drawImpostors;
+        Uniform<glm::vec3> viewPos;
+        Uniform<float> nearPlane;
+        Uniform<float> pixelsPerUnit;
+        Uniform<int> levelCount;
+        Uniform<float> levelErrors;
+        Uniform<float> pixelError;
+        Uniform<float> impostorPixels;
+        Uniform<bool> occlusionCulling;
+        Uniform<glm::mat4> pyramidViewProjection;
+        Uniform<glm::vec2> pyramidSize;
+        Uniform<int> pyramidLevels;
+    };
+    
+    struct PyramidUniforms {
+        Uniform<bool> copyDepth;
+        Uniform<glm::vec2> sourceSize;
+        Uniform<glm::vec2> targetSize;
+    };
+    
+    void Dispatch(View view, const glm::mat4& viewProjection, bool selectLevels, bool drawImpostors,
+                  bool occlusionCulling);
+    void EnsureCapacity(size_t instanceCount);
+    void EnsurePyramid(int width, int height);
+    void WriteCommandTemplate();
+    
+    const LodMesh* m_lods;
+    const Mesh* m_impostorQuad;
+    int m_levelCount;
+    bool m_drawImpostors; // Impostors allowed by the last CullMain
+    
+    Shader m_cullShader;
+    Shader m_pyramidShader;
+    CullUniforms m_cullUniforms;
+    PyramidUniforms m_pyramidUniforms;
+    
+    // Input, and the level each instance was drawn with (-1 = none yet)
+    unsigned int m_instanceBuffer;
+    size_t m_instanceOffset;
+    size_t m_instanceCount;
+    unsigned int m_levelBuffer;
+    
+    // Per view: instances grouped by level, capacity slots per level plus
+    // the impostors, and one indirect command per level plus the impostors
+    unsigned int m_visibleBuffers[VIEW_COUNT];
+    unsigned int m_commandBuffers[VIEW_COUNT];
+    size_t m_capacity;
+    
+    // Commands with zero instances, copied over a view's before its cull
+    unsigned int m_commandTemplate;
+    
+    unsigned int m_depthCopy;            // DEPTH24_STENCIL8 blit target
+    unsigned int m_depthCopyFramebuffer;
+    unsigned int m_pyramid;              // R32F, farthest depth per texel
+    int m_pyramidWidth;
+    int m_pyramidHeight;
+    int m_pyramidLevels;
+    int m_validWidth;                    // Region written by the last build
+    int m_validHeight;
+    int m_validLevels;
+    glm::mat4 m_pyramidViewProjection;
+    bool m_pyramidValid;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace FlightSim {
+
+// Per-pass GPU timing with GL_TIMESTAMP queries. Each frame's queries are
+// read back FRAME_LATENCY frames later, so results are never waited on;
+// a frame whose queries are still pending by then is dropped instead.
+class GpuProfiler {
+public:
+    static constexpr int FRAME_LATENCY = 4;
+    static constexpr int HISTORY_LENGTH = 240; // Samples kept per scope
+    
+    struct ScopeStats {
+        std::string name;
+        int sampleCount;
+        float lastMs;
+        float averageMs;
+        float p50Ms;
+        float p95Ms;
+        float p99Ms;
+    };
+    
+public:
+    GpuProfiler();
+    ~GpuProfiler();
+    
+    // Must be called with a current GL context; false if timer queries are unsupported
+    bool Initialize();
+    void Shutdown();
+    
+    void BeginFrame();
+    void EndFrame();
+    
+    // Scopes may nest. The name must outlive the profiler (string literals);
+    // a scope opened several times in one frame is summed.
+    void BeginScope(const char* name);
+    void EndScope();
+    
+    // Rolling statistics over the last HISTORY_LENGTH frames, "Frame" first
+    std::vector<ScopeStats> GetStats() const;
+    
+    // Write the current statistics as CSV for regression tracking
+    bool WriteReport(const std::string& path) const;
+    
+    // Whole-frame GPU time of the newest collected frame, 0 before the
+    // first. The count tells a fresh sample from one already seen.
+    float GetLatestFrameMs() const;
+    int GetCollectedFrameCount() const { return m_collectedFrames; }
+    
+    // Newest sample of one scope, 0 if it has none; a scope skipped by
+    // later frames keeps its last sample
+    float GetLatestScopeMs(const char* name) const;
+    
+    bool IsEnabled() const { return m_enabled; }
+    int GetDroppedFrameCount() const { return m_droppedFrames; }
+    
+private:
+    struct PendingScope {
+        int scope;
+        unsigned int beginQuery;
+        unsigned int endQuery;
+    };
+    
+    struct FrameQueries {
+        std::vector<unsigned int> queries; // Pool, grown on demand
+        size_t usedQueries = 0;
+        std::vector<PendingScope> scopes;
+        bool submitted = false;
+    };
+    
+    struct ScopeHistory {
+        const char* name;
+        std::vector<float> samples; // Ring of HISTORY_LENGTH
+        size_t next = 0;
+        size_t count = 0;
+    };
+    
+    int FindScope(const char* name);
+    unsigned int AllocateQuery(FrameQueries& frame);
+    void CollectFrame(FrameQueries& frame);
+    
+    bool m_enabled;
+    bool m_inFrame;
+    int m_frameIndex;
+    int m_droppedFrames;
+    int m_collectedFrames;
+    
+    FrameQueries m_frames[FRAME_LATENCY];
+    std::vector<int> m_openScopes;  // Indices into the current frame's scopes
+    std::vector<ScopeHistory> m_history;
+    std::vector<double> m_frameTotals; // Scratch for CollectFrame
+};
+
+} // namespace FlightSim
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "../core/Mesh.h"
+#include "../core/Shader.h"
+
+namespace FlightSim {
+
+// Octahedral impostor: a mesh baked from GRID x GRID directions spread
+// evenly over the sphere into one RGBA8 atlas. Each frame stores the
+// object-space normal in rgb and coverage in alpha, so impostors are lit
+// at draw time like the geometry they replace. A view direction maps to
+// its frame with the octahedral encoding also used for packed normals.
+//
+// Drawn as one camera-facing quad per instance (GetQuad) through the
+// same per-instance attributes as the aircraft (see TrafficRenderer).
+class ImpostorAtlas {
+public:
+    static constexpr int GRID = 16;
+    static constexpr int FRAME_SIZE = 64; // Pixels per frame side
+    
+    struct Uniforms {
+        Uniform<int> atlas;
+        Uniform<int> grid;
+        Uniform<glm::vec3> center;
+        Uniform<float> radius;
+    };
+    
+public:
+    ImpostorAtlas();
+    ~ImpostorAtlas();
+    
+    bool Initialize();
+    void Shutdown();
+    
+    // Render every frame of the mesh, whose bounding sphere is center and
+    // radius in object space. Restores the caller's framebuffer and
+    // viewport.
+    bool Bake(const Mesh& mesh, const glm::vec3& center, float radius);
+    
+    const Mesh& GetQuad() const { return m_quad; }
+    unsigned int GetTexture() const { return m_texture; }
+    size_t GetGpuMemorySize() const;
+    
+    // For impostor shaders: bind the atlas and set the frame layout
+    static Uniforms GetUniforms(const Shader& shader);
+    void Apply(const Shader& shader, const Uniforms& uniforms) const;
+    
+private:
+    Mesh m_quad;
+    unsigned int m_texture;
+    glm::vec3 m_center;
+    float m_radius;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace FlightSim {
+
+// Asynchronous framebuffer readback through a ring of pixel-pack buffers.
+// Queue starts a glReadPixels into the next buffer, which returns without
+// waiting for the GPU; Collect maps buffers whose fence has signaled, so a
+// frame is normally read back a couple of frames after it was queued.
+class PixelReadbackRing {
+public:
+    using Consumer = std::function<void(const uint8_t* pixels)>;
+    
+public:
+    PixelReadbackRing();
+    ~PixelReadbackRing();
+    
+    PixelReadbackRing(const PixelReadbackRing&) = delete;
+    PixelReadbackRing& operator=(const PixelReadbackRing&) = delete;
+    
+    // RGBA8 readbacks of width x height, depth buffers deep
+    bool Initialize(int width, int height, int depth);
+    void Shutdown();
+    
+    // Read the color buffer of framebuffer (0 = default back buffer).
+    // Returns false if every buffer is still in flight; Collect first.
+    bool Queue(unsigned int framebuffer);
+    
+    // Pass finished readbacks to consumer, oldest first, as bottom-up RGBA8
+    // rows. With waitForOldest the oldest pending readback is waited on for
+    // up to a second; otherwise only those already complete are collected.
+    // Unfinished readbacks stay pending for the next call. Returns the count.
+    int Collect(const Consumer& consumer, bool waitForOldest);
+    
+    int GetPendingCount() const { return m_pending; }
+    size_t GetFrameSize() const { return static_cast<size_t>(m_width) * m_height * 4; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    
+private:
+    struct Slot {
+        unsigned int buffer = 0;
+        void* fence = nullptr; // GLsync
+    };
+    
+    std::vector<Slot> m_slots;
+    int m_head;    // Next slot to queue into
+    int m_pending; // Slots in flight, oldest at m_head - m_pending
+    int m_width;
+    int m_height;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+namespace FlightSim {
+
+class GpuProfiler;
+
+// Index of a resource in the current frame's graph
+using RenderResource = int;
+static constexpr RenderResource NO_RENDER_RESOURCE = -1;
+
+struct RenderTextureDesc {
+    int width = 0;
+    int height = 0;
+    unsigned int format = 0; // Sized internal format, e.g. GL_RGBA8 or GL_DEPTH24_STENCIL8
+    int samples = 0;         // > 1 for a multisampled texture
+    
+    bool operator==(const RenderTextureDesc& other) const {
+        return width == other.width && height == other.height && format == other.format &&
+               samples == other.samples;
+    }
+};
+
+// Per-frame graph of render passes. Each frame the renderer declares its
+// passes with the resources they read and write, then compiles and runs
+// the graph:
+//  - passes whose results nothing reads are culled, unless they write an
+//    output (imported targets marked as such) or declare a side effect;
+//  - passes run in declaration order, which must write a resource before
+//    reading it;
+//  - transient textures exist only between their first and last use.
+//    Physical textures are pooled by description and handed to the next
+//    transient whose lifetime starts after the previous one's ended, so
+//    the pool holds only the peak number of simultaneously live targets.
+//    Pool entries unused for POOL_RETIRE_FRAMES frames are deleted.
+//
+// Each pass runs inside a GPU profiler scope of its name.
+class RenderGraph {
+public:
+    static constexpr int POOL_RETIRE_FRAMES = 120;
+    
+    class Builder {
+    public:
+        void Read(RenderResource resource);
+        void Write(RenderResource resource);
+        
+        // Keep the pass even if nothing reads what it writes (readbacks)
+        void SetSideEffect();
+        
+    private:
+        friend class RenderGraph;
+        Builder(RenderGraph& graph, int pass) : m_graph(graph), m_pass(pass) {}
+        
+        RenderGraph& m_graph;
+        int m_pass;
+    };
+    
+    using SetupFunction = std::function<void(Builder& builder)>;
+    using ExecuteFunction = std::function<void(RenderGraph& graph)>;
+    
+    struct PassReport {
+        const char* name;
+        bool culled;
+    };
+    
+    struct ResourceReport {
+        const char* name;
+        bool imported;
+        int physical; // Pool entry, -1 if imported or unused this frame
+        size_t bytes;
+    };
+    
+    // Summary of the last executed frame
+    struct Report {
+        std::vector<PassReport> passes;
+        std::vector<ResourceReport> resources;
+        size_t transientBytes = 0; // Sum over transient resources, as if none shared memory
+        size_t pooledBytes = 0;    // Memory actually held by the pool
+        int pooledTextures = 0;
+    };
+    
+public:
+    RenderGraph();
+    ~RenderGraph();
+    
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+    
+    void Shutdown();
+    
+    // Start declaring a new frame; the pool and its framebuffers are kept
+    void Reset();
+    
+    // Transient texture allocated for the lifetime of its readers and writers
+    RenderResource CreateTexture(const char* name, const RenderTextureDesc& desc);
+    
+    // Resources owned outside the graph. A framebuffer is bound as is by
+    // BindTarget; a texture is only tracked for ordering and culling.
+    RenderResource ImportFramebuffer(const char* name, unsigned int framebuffer, int width, int height);
+    RenderResource ImportTexture(const char* name, unsigned int texture);
+    
+    // Outputs keep their writers alive
+    void MarkOutput(RenderResource resource);
+    
+    void AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute);
+    
+    // Cull, then allocate transients and run the surviving passes in order.
+    // Leaves the framebuffer bound by the last pass.
+    void Execute(GpuProfiler* profiler);
+    
+    // For use inside a pass: the texture behind a resource, or a
+    // framebuffer with the given attachments. BindTarget also sets the
+    // viewport to the whole target.
+    unsigned int GetTexture(RenderResource resource) const;
+    unsigned int GetFramebuffer(RenderResource color, RenderResource depth = NO_RENDER_RESOURCE);
+    void BindTarget(RenderResource color, RenderResource depth = NO_RENDER_RESOURCE);
+    const RenderTextureDesc& GetDesc(RenderResource resource) const { return m_resources[resource].desc; }
+    
+    // Updated by every Execute. WriteReport adds the passes' rolling GPU
+    // times when given the profiler they ran under.
+    const Report& GetReport() const { return m_report; }
+    void WriteReport(std::ostream& stream, const GpuProfiler* profiler) const;
+    
+    static size_t GetTextureBytes(const RenderTextureDesc& desc);
+    
+private:
+    struct Resource {
+        const char* name;
+        RenderTextureDesc desc;
+        bool imported;
+        bool isFramebuffer;
+        bool output;
+        unsigned int object;   // Imported framebuffer or texture
+        int physical;          // Pool entry while allocated
+        int readers;           // Live passes reading it, during culling
+        int firstPass;
+        int lastPass;
+        std::vector<int> writers;
+    };
+    
+    struct Pass {
+        const char* name;
+        ExecuteFunction execute;
+        std::vector<RenderResource> reads;
+        std::vector<RenderResource> writes;
+        bool sideEffect;
+        int references; // Written resources still read, during culling
+        bool culled;
+    };
+    
+    struct PooledTexture {
+        RenderTextureDesc desc;
+        unsigned int texture;
+        int lastUsedFrame;
+        bool inUse;
+    };
+    
+    struct CachedFramebuffer {
+        unsigned int color;
+        unsigned int depth;
+        unsigned int framebuffer;
+    };
+    
+    void Cull();
+    void ComputeLifetimes();
+    int Acquire(const RenderTextureDesc& desc);
+    void RetireUnused();
+    void BuildReport();
+    
+    // Only the first m_*Count entries belong to this frame; the rest keep
+    // their storage so steady-state frames do not allocate
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    int m_resourceCount;
+    int m_passCount;
+    std::vector<PooledTexture> m_pool;
+    std::vector<CachedFramebuffer> m_framebuffers;
+    std::vector<RenderResource> m_unread; // Scratch for Cull
+    int m_frame;
+    Report m_report;
+};
+
+} // namespace FlightSim
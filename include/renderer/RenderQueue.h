@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FlightSim {
+
+class Shader;
+class Mesh;
+class GpuProfiler;
+struct DrawPacket;
+
+// Pipeline state group; also the most significant bits of the sort key
+enum class RenderLayer : uint8_t {
+    Opaque = 0,      // Depth test and write, sorted by state then front to back
+    Sky = 1,         // Drawn after opaque geometry at max depth (LEQUAL, no write)
+    Transparent = 2, // Depth test without write, sorted back to front
+    Overlay = 3      // No depth test
+};
+
+// Per-frame material: uniform upload shared by every packet that uses it.
+// apply runs when the material (or the program) changes between packets;
+// prepareDraw, if set, runs per packet after its VAO is bound. label names
+// the GPU profiler scope its packets are timed under.
+struct RenderMaterial {
+    const char* label;
+    void (*apply)(const Shader& shader, const void* context);
+    void (*prepareDraw)(const DrawPacket& packet, const void* context);
+    const void* context;
+};
+
+struct DrawPacket {
+    uint64_t key;
+    const Shader* shader;
+    const Mesh* mesh;
+    uint32_t material;
+    uint32_t instanceCount; // 0 for a non-instanced draw
+    uint32_t userData;      // Passed through to RenderMaterial::prepareDraw
+    
+    // Multi-draw-indirect packets (drawCount > 0) read their commands from
+    // the GL_DRAW_INDIRECT_BUFFER bound by prepareDraw
+    uint32_t indirectOffset; // In bytes
+    uint32_t drawCount;
+};
+
+// Subsystems submit draw packets; the queue sorts them by a 64-bit key and
+// executes them through the GL state cache, so packets that share a
+// program, material or VAO are drawn back to back without rebinding.
+class RenderQueue {
+public:
+    RenderQueue();
+    
+    // Start a new frame. Storage is kept so steady-state frames do not allocate.
+    void Clear();
+    
+    // View-space distance mapped to the far end of the depth bits
+    void SetMaxDepth(float maxDepth) { m_maxDepth = maxDepth; }
+    
+    // Optional; packets are timed per material label when set
+    void SetProfiler(GpuProfiler* profiler) { m_profiler = profiler; }
+    
+    uint32_t AddMaterial(const RenderMaterial& material);
+    void Submit(RenderLayer layer, const Shader& shader, const Mesh& mesh, uint32_t material,
+                float viewDepth, uint32_t instanceCount = 0, uint32_t userData = 0);
+    void SubmitIndirect(RenderLayer layer, const Shader& shader, const Mesh& mesh, uint32_t material,
+                        float viewDepth, uint32_t indirectOffset, uint32_t drawCount, uint32_t userData = 0);
+    
+    void Sort();
+    void Execute();
+    
+    size_t GetPacketCount() const { return m_packets.size(); }
+    
+    static uint64_t MakeKey(RenderLayer layer, unsigned int program, uint32_t material,
+                            unsigned int vao, float depth01);
+                            
+private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t packet;
+    };
+    
+    void ApplyLayerState(RenderLayer layer);
+    
+    std::vector<DrawPacket> m_packets;
+    std::vector<RenderMaterial> m_materials;
+    std::vector<SortEntry> m_order;
+    std::vector<SortEntry> m_scratch;
+    GpuProfiler* m_profiler;
+    float m_maxDepth;
+    bool m_sorted;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace FlightSim {
+
+// Offscreen framebuffer with an RGBA8 color and a depth-stencil renderbuffer.
+// The color buffer can instead be a texture for passes that sample the
+// result, or both buffers multisampled for passes that resolve it.
+class RenderTarget {
+public:
+    RenderTarget();
+    ~RenderTarget();
+    
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+    
+    // samples > 1 and colorTexture are exclusive; resolve with a blit first
+    bool Initialize(int width, int height, int samples = 0, bool colorTexture = false);
+    void Shutdown();
+    
+    // Bind for drawing and set the viewport to the target size
+    void Bind() const;
+    static void BindDefault();
+    
+    // Synchronous readback as tightly packed RGBA8, top row first; single-sampled only
+    void ReadPixels(std::vector<uint8_t>& pixels) const;
+    
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetSamples() const { return m_samples; }
+    unsigned int GetFramebuffer() const { return m_framebuffer; }
+    unsigned int GetColorTexture() const { return m_colorTexture; } // 0 unless requested
+    
+private:
+    unsigned int m_framebuffer;
+    unsigned int m_colorBuffer;
+    unsigned int m_colorTexture;
+    unsigned int m_depthBuffer;
+    int m_width;
+    int m_height;
+    int m_samples;
+};
+
+} // namespace FlightSim
@@ -1,17 +1,39 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <ostream>
+#include <string>
 #include <vector>
 #include <glm/glm.hpp>
 #include "../core/Shader.h"
 #include "../core/Camera.h"
+#include "../core/GLStateCache.h"
+#include "../core/GLHandle.h"
+#include "../core/LodMesh.h"
+#include "../core/StreamingBuffer.h"
+#include "Atmosphere.h"
+#include "ClusteredLights.h"
+#include "ShadowCascades.h"
+#include "Scenery.h"
 #include "SkyBox.h"
 #include "Terrain.h"
+#include "TrafficRenderer.h"
+#include "TrailRenderer.h"
+#include "VolumetricClouds.h"
+#include "RenderQueue.h"
+#include "GpuProfiler.h"
+#include "DynamicResolution.h"
+#include "SensorViews.h"
+#include "RenderGraph.h"
+#include "ImpostorAtlas.h"
+#include "GpuCulling.h"
 
 namespace FlightSim {
 
-class Aircraft;
 class Mesh;
+struct AircraftState;
+struct WorldSnapshot;
 
 class Renderer {
 public:
@@ -24,52 +46,195 @@ public:
     void BeginFrame();
     void EndFrame();
     
-    void RenderScene(const Camera& camera, const Aircraft& aircraft);
+    // Draws the player, traffic and trail from one published simulation snapshot
+    void RenderScene(const Camera& camera, const WorldSnapshot& world);
+    
+    const TrafficRenderer* GetTrafficRenderer() const { return m_trafficRenderer.get(); }
+    const TrailRenderer* GetTrailRenderer() const { return m_trailRenderer.get(); }
+    
+    // GL state changes issued and skipped during the previous frame
+    const GLStateCache::Counters& GetStateCounters() const { return m_lastFrameStateCounters; }
+    size_t GetDrawPacketCount() const { return m_renderQueue ? m_renderQueue->GetPacketCount() : 0; }
+    
+    // Per-pass GPU timings; passes outside the renderer (HUD) open their own scopes
+    GpuProfiler* GetGpuProfiler() { return m_gpuProfiler.get(); }
+    
+    // Ring for per-frame vertex and instance uploads, cycled by
+    // BeginFrame/EndFrame; also used by passes outside the renderer
+    StreamingBuffer* GetStreamingBuffer() { return m_streamingBuffer.get(); }
+    
+    // Passes, culling and transient target memory of the last RenderScene
+    const RenderGraph* GetRenderGraph() const { return m_renderGraph.get(); }
+    
+    // Aircraft detail levels and how many instances used each last frame
+    const LodMesh* GetAircraftLods() const { return m_aircraftLods.get(); }
+    void WriteLodReport(std::ostream& stream) const;
+    
+    // Cull aircraft, pick their levels and build their draws on the GPU
+    // (GL 4.3). Without support the CPU path is used regardless.
+    void SetGpuCulling(bool enabled) { m_gpuCullingEnabled = enabled; }
+    bool IsGpuCullingActive() const { return m_gpuCullingEnabled && m_gpuCulling; }
+    float GetFPS() const { return m_currentFPS; }
     void SetViewport(int width, int height);
     
+    // Render the scene below native resolution when the GPU is over budget;
+    // needs the output size from SetViewport. Passes after RenderScene stay native.
+    void SetDynamicResolution(bool enabled);
+    bool IsDynamicResolutionEnabled() const { return m_dynamicResolutionEnabled; }
+    DynamicResolution* GetDynamicResolution() { return m_dynamicResolution.get(); }
+    
+    // Extra camera views drawn by RenderScene into a texture array, each at
+    // its own rate on the simulation clock
+    SensorViews* GetSensorViews() { return m_sensorViews.get(); }
+    
     // Lighting
     void SetDirectionalLight(const glm::vec3& direction, const glm::vec3& color);
     void SetAmbientLight(const glm::vec3& color);
     
-    // Fog settings for atmosphere
-    void SetFog(float density, const glm::vec3& color);
+    // Sun position for sky, lighting and aerial perspective
+    void SetTimeOfDay(float time);
+    const Atmosphere* GetAtmosphere() const { return m_atmosphere.get(); }
+    
+    // Airfield and aircraft lights, binned for the main camera each frame
+    const ClusteredLights* GetLocalLights() const { return m_localLights.get(); }
+    
+    // Trees and buildings, placed procedurally by Initialize unless a
+    // placement file replaces them (see Scenery::LoadPlacementFile)
+    bool LoadScenery(const std::string& path);
+    const Scenery* GetScenery() const { return m_scenery.get(); }
+    
+    // Cloud layer between the sky and the scene; null if it could not be
+    // set up. Its quality and GPU budget are set through it.
+    VolumetricClouds* GetClouds() { return m_clouds.get(); }
     
-    void RenderInstruments(const Aircraft& aircraft);
+    void RenderInstruments(const AircraftState& state);
     
 private:
     void SetupOpenGL();
-    void RenderAircraft(const Camera& camera, const Aircraft& aircraft, 
-                       const glm::mat4& view, const glm::mat4& projection);
-    void RenderOrientationIndicators(const Aircraft& aircraft, 
-                                    const glm::mat4& view, const glm::mat4& projection);
-    void RenderArrow(const glm::vec3& start, const glm::vec3& end, 
-                     const glm::vec3& color, const glm::mat4& view, const glm::mat4& projection);
-    void RenderFlightPath(const Aircraft& aircraft, 
-                         const glm::mat4& view, const glm::mat4& projection);
-    void RenderGroundGrid(const glm::mat4& view, const glm::mat4& projection);
+    void UpdateLocalLights(const Camera& camera, const WorldSnapshot& world);
+    void SubmitAircraft(const Camera& camera, const WorldSnapshot& world, int viewportHeight);
+    void SubmitAircraftInstance(size_t index, const AircraftState& state, const Camera& camera,
+                                float pixelsPerUnitAtUnitDistance);
+    void SubmitAircraftDraws(RenderQueue& queue, const Camera& camera, GpuCulling::View view);
+    void RenderShadows(const Camera& camera);
+    void DrawScene(const Camera& camera, const WorldSnapshot& world, int width, int height);
+    void RenderSensorViews(const WorldSnapshot& world);
+    static void ApplyAircraftMaterial(const Shader& shader, const void* context);
+    static void PrepareAircraftDraw(const DrawPacket& packet, const void* context);
+    static void ApplyAircraftShadowMaterial(const Shader& shader, const void* context);
+    static void PrepareAircraftShadowDraw(const DrawPacket& packet, const void* context);
+    static void ApplyImpostorMaterial(const Shader& shader, const void* context);
+    static void PrepareImpostorDraw(const DrawPacket& packet, const void* context);
+    void BindAircraftInstances(const DrawPacket& packet) const;
+    void AddOrientationIndicators(const AircraftState& state);
+    void AddGroundGrid();
+    void AddDebugLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color);
+    void RenderDebugLines(const glm::mat4& viewProjection);
+    void ResolveUniforms();
     
     // Shaders
     std::unique_ptr<Shader> m_aircraftShader;
+    std::unique_ptr<Shader> m_aircraftShadowShader;
+    std::unique_ptr<Shader> m_impostorShader;
     std::unique_ptr<Shader> m_terrainShader;
     std::unique_ptr<Shader> m_hudShader;
+    std::unique_ptr<Shader> m_debugLineShader;
+    
+    // Aircraft shader uniform handles, resolved once after link
+    struct AircraftUniforms {
+        Uniform<glm::mat4> view;
+        Uniform<glm::mat4> projection;
+        Uniform<glm::vec3> viewPos;
+        Uniform<float> specularStrength;
+        Uniform<glm::vec3> materialDiffuse;
+        Uniform<glm::vec3> materialSpecular;
+        Uniform<float> materialShininess;
+        VertexDecodeUniforms vertexDecode;
+        AtmosphereUniforms atmosphere;
+        ShadowUniforms shadows;
+        LocalLightUniforms localLights;
+    } m_aircraftUniforms;
+    
+    struct AircraftShadowUniforms {
+        Uniform<glm::mat4> lightViewProjection;
+        Uniform<glm::vec3> positionOffset;
+        Uniform<glm::vec3> positionScale;
+    } m_aircraftShadowUniforms;
+    
+    Uniform<glm::mat4> m_debugLineViewProjection;
+    
+    struct ImpostorUniforms {
+        Uniform<glm::mat4> view;
+        Uniform<glm::mat4> projection;
+        Uniform<glm::vec3> viewPos;
+        Uniform<glm::vec3> materialDiffuse;
+        ImpostorAtlas::Uniforms impostor;
+        AtmosphereUniforms atmosphere;
+        ShadowUniforms shadows;
+    } m_impostorUniforms;
     
     // Scene objects
+    std::unique_ptr<Atmosphere> m_atmosphere;
+    std::unique_ptr<ShadowCascades> m_shadows;
+    std::unique_ptr<ClusteredLights> m_localLights;
+    std::vector<PointLight> m_airfieldLights; // Static; aircraft lights are added per frame
     std::unique_ptr<SkyBox> m_skybox;
     std::unique_ptr<Terrain> m_terrain;
-    std::unique_ptr<Mesh> m_aircraftMesh;
+    std::unique_ptr<Scenery> m_scenery;
+    std::unique_ptr<VolumetricClouds> m_clouds;        // Null if setup failed
+    std::unique_ptr<LodMesh> m_aircraftLods;
+    std::unique_ptr<ImpostorAtlas> m_aircraftImpostor; // Null if baking failed
+    std::vector<int8_t> m_aircraftLodState;            // Per instance, player first; -1 = none yet
+    std::unique_ptr<TrafficRenderer> m_trafficRenderer;
+    std::unique_ptr<GpuCulling> m_gpuCulling;           // Null without GL 4.3
+    std::unique_ptr<TrailRenderer> m_trailRenderer;
     
-    // Lighting
+    // Orientation indicators and ground grid, collected each frame and
+    // drawn as one line list from the streaming buffer
+    struct DebugLineVertex {
+        glm::vec3 position;
+        glm::vec3 color;
+    };
+    std::vector<DebugLineVertex> m_debugLines;
+    GLVertexArray m_debugLineVAO;
+    
+    // Sorted draw packets for the current frame
+    std::unique_ptr<RenderQueue> m_renderQueue;
+    std::unique_ptr<RenderQueue> m_shadowQueue; // One cascade at a time
+    std::unique_ptr<RenderQueue> m_sensorQueue; // One sensor view at a time
+    std::unique_ptr<GpuProfiler> m_gpuProfiler;
+    std::unique_ptr<StreamingBuffer> m_streamingBuffer;
+    std::unique_ptr<DynamicResolution> m_dynamicResolution;
+    std::unique_ptr<SensorViews> m_sensorViews;
+    std::unique_ptr<RenderGraph> m_renderGraph;
+    GLStateCache::Counters m_lastFrameStateCounters;
+    
+    // Camera state captured at submit time for material callbacks
+    glm::mat4 m_frameView;
+    glm::mat4 m_frameProjection;
+    glm::vec3 m_frameViewPos;
+    glm::mat4 m_frameLightViewProjection;
+    
+    // Inputs of the RenderScene call whose graph is executing
+    const Camera* m_frameCamera;
+    const WorldSnapshot* m_frameWorld;
+    
+    bool m_initialized;
+    
+    // Lighting; the sun comes from the atmosphere
+    float m_specularStrength;
     glm::vec3 m_directionalLightDir;
     glm::vec3 m_directionalLightColor;
     glm::vec3 m_ambientLightColor;
     
-    // Fog
-    float m_fogDensity;
-    glm::vec3 m_fogColor;
-    
     // Render settings
     bool m_wireframeMode;
     bool m_showInstruments;
+    bool m_dynamicResolutionEnabled;
+    bool m_dynamicResolutionActive; // Scene goes through the scaled target this frame
+    bool m_gpuCullingEnabled;
+    int m_viewportWidth;
+    int m_viewportHeight;
     
     // Performance tracking
     int m_frameCount;
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../core/GLHandle.h"
+#include "../core/Mesh.h"
+#include "../core/Shader.h"
+#include "Atmosphere.h"
+#include "ClusteredLights.h"
+#include "ShadowCascades.h"
+
+namespace FlightSim {
+
+class Camera;
+class RenderQueue;
+class Terrain;
+struct DrawPacket;
+
+enum class SceneryType : uint8_t {
+    Tree = 0,
+    Building = 1,
+    Count
+};
+
+// One object to place; y is taken from the terrain
+struct SceneryPlacement {
+    SceneryType type;
+    glm::vec2 position; // World x, z
+    float scale;
+    float heading;      // Radians about +Y
+};
+
+// Per-instance vertex data read by the scenery shaders (locations 3-4)
+struct SceneryInstance {
+    glm::vec4 positionScale; // xyz = world position of the base, w = uniform scale
+    glm::vec4 params;        // xy = cos/sin of the heading, z = density rank, w = tint
+};
+
+// Static instanced scenery: trees and buildings.
+//
+// Instances are bucketed into CELL_SIZE cells and stored once in a static
+// buffer, grouped by cell and then by type, with precomputed bounds. The
+// cells are the leaves of a quadtree whose nodes carry the union of their
+// children's bounds, so a view rejects or accepts whole regions with one
+// box test and only the cells on the frustum's boundary are tested alone.
+// Each visible cell is one instanced draw per type; the per-frame CPU cost
+// is the tree walk and the packets, independent of the instance count.
+//
+// Density fades with distance from the main camera. Each cell's instances
+// are shuffled and carry their rank in that order; a cell draws the prefix
+// its nearest point's density keeps, and the vertex shader shrinks each
+// instance to nothing as its own distance pushes the density below its
+// rank, so thinning is gradual and never pops a whole cell.
+class Scenery {
+public:
+    static constexpr float CELL_SIZE = 64.0f; // Meters
+    
+public:
+    Scenery();
+    ~Scenery();
+    
+    bool Initialize();
+    void Shutdown();
+    
+    // Replace the instances. Procedural placement scatters forest on
+    // gentle slopes below the tree line and buildings on flat ground next
+    // to the airfield; a placement file lists one object per line as
+    //   tree|building <x> <z> [scale] [heading in degrees]
+    // with # starting a comment. Placements off the terrain are skipped.
+    void GenerateProcedural(const Terrain& terrain, unsigned int seed = 1);
+    bool LoadPlacementFile(const std::string& path, const Terrain& terrain);
+    void SetPlacements(const std::vector<SceneryPlacement>& placements, const Terrain& terrain);
+    
+    // Density is full up to start meters from the camera and falls to
+    // minimum at end; nothing is drawn beyond maxDistance
+    void SetDensityFade(float start, float end, float minimum);
+    void SetMaxDistance(float distance) { m_maxDistance = distance; }
+    
+    // Queue one instanced draw per visible cell and type, lit like the
+    // terrain. The main view's camera is also the density fade origin of
+    // later dynamic SubmitShadow calls, and only it updates the stats.
+    void Submit(RenderQueue& queue, const Camera& camera, const Atmosphere& atmosphere,
+                const ShadowCascades& shadows, const ClusteredLights& lights, bool mainView);
+    
+    // Cached shadow cascades are thinned around a fixed origin, so what
+    // they hold does not go stale as the camera moves. Returns true when
+    // the main camera has moved far enough from it that the thinning
+    // visibly differs; the origin then moves to the camera and the caller
+    // must redraw every cached cascade.
+    bool UpdateCachedShadowOrigin();
+    
+    // Queue depth-only draws of the cells inside a shadow cascade, thinned
+    // like the main view, or around the cached origin if cached
+    void SubmitShadow(RenderQueue& queue, const glm::mat4& lightViewProjection, bool cached);
+    
+    size_t GetInstanceCount() const { return m_instanceCount; }
+    size_t GetCellCount() const { return m_cells.size(); }
+    size_t GetGpuMemorySize() const;
+    
+    // Last main view Submit
+    int GetVisibleCellCount() const { return m_visibleCells; }
+    int GetDrawCallCount() const { return m_drawCalls; }
+    size_t GetDrawnInstanceCount() const { return m_drawnInstances; }
+    
+private:
+    static constexpr int TYPE_COUNT = static_cast<int>(SceneryType::Count);
+    static constexpr uint32_t NO_NODE = 0xFFFFFFFFu;
+    
+    struct Cell {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        uint32_t first[TYPE_COUNT]; // Instance ranges in the buffer
+        uint32_t count[TYPE_COUNT];
+    };
+    
+    // Quadtree node over the cell grid; a leaf refers to its cell instead
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        uint32_t children[4];
+        uint32_t childCount;
+        int32_t cell; // -1 for inner nodes
+    };
+    
+    struct SceneryUniforms {
+        Uniform<glm::mat4> view;
+        Uniform<glm::mat4> projection;
+        Uniform<glm::vec3> viewPos;
+        Uniform<glm::vec3> fadeOrigin;
+        Uniform<glm::vec3> densityFade;
+        Uniform<glm::vec3> primaryColor;
+        Uniform<glm::vec3> secondaryColor;
+        VertexDecodeUniforms vertexDecode;
+        AtmosphereUniforms atmosphere;
+        ShadowUniforms shadows;
+        LocalLightUniforms localLights;
+    };
+    
+    struct ShadowPassUniforms {
+        Uniform<glm::mat4> lightViewProjection;
+        Uniform<glm::vec3> fadeOrigin;
+        Uniform<glm::vec3> densityFade;
+        Uniform<glm::vec3> positionOffset;
+        Uniform<glm::vec3> positionScale;
+    };
+    
+    bool SetupShaders();
+    void CreateMeshes();
+    uint32_t BuildNode(int x0, int z0, int x1, int z1, const std::vector<int32_t>& cellGrid, int gridWidth);
+    void SubmitCells(RenderQueue& queue, const glm::mat4& viewProjection, const glm::vec3& fadeOrigin,
+                     const Shader& shader, uint32_t material, bool collectStats);
+    float GetDensity(float distance) const;
+    static void ApplyMaterial(const Shader& shader, const void* context);
+    static void PrepareDraw(const DrawPacket& packet, const void* context);
+    static void ApplyShadowMaterial(const Shader& shader, const void* context);
+    static void PrepareShadowDraw(const DrawPacket& packet, const void* context);
+    void BindInstances(const DrawPacket& packet) const;
+    
+    std::unique_ptr<Shader> m_shader;
+    std::unique_ptr<Shader> m_shadowShader;
+    SceneryUniforms m_uniforms;
+    ShadowPassUniforms m_shadowUniforms;
+    
+    // Per type; userData of a packet is its first instance, the mesh tells the type
+    Mesh m_meshes[TYPE_COUNT];
+    glm::vec3 m_primaryColors[TYPE_COUNT];
+    glm::vec3 m_secondaryColors[TYPE_COUNT];
+    
+    GLBuffer m_instanceBuffer;
+    size_t m_instanceCount;
+    std::vector<Cell> m_cells;
+    std::vector<Node> m_nodes;
+    uint32_t m_root; // NO_NODE without instances
+    
+    // Walk state, kept so steady-state frames do not allocate
+    struct StackEntry {
+        uint32_t node;
+        uint32_t planeMask; // Planes the node is not yet known to be inside
+    };
+    std::vector<StackEntry> m_stack;
+    
+    float m_fadeStart;
+    float m_fadeEnd;
+    float m_minDensity;
+    float m_maxDistance;
+    
+    // Frame state captured at submit time for the material callbacks
+    glm::mat4 m_view;
+    glm::mat4 m_projection;
+    glm::vec3 m_viewPos;
+    glm::vec3 m_fadeOrigin;
+    const Atmosphere* m_atmosphere;
+    const ShadowCascades* m_shadows;
+    const ClusteredLights* m_lights;
+    glm::mat4 m_lightViewProjection;
+    glm::vec3 m_shadowFadeOrigin; // Of the shadow pass being submitted
+    
+    glm::vec3 m_mainViewPos;       // Camera of the last main view Submit
+    glm::vec3 m_cachedShadowOrigin;
+    bool m_cachedShadowOriginValid;
+    
+    int m_visibleCells;
+    int m_drawCalls;
+    size_t m_drawnInstances;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "../core/Camera.h"
+#include "PixelReadbackRing.h"
+
+namespace FlightSim {
+
+// Extra camera views rendered each frame for synthetic sensor feeds
+// (cockpit side windows, downward-looking cameras). Every view owns one
+// layer of an RGBA8 texture array that downstream GPU passes can sample;
+// views smaller than the array draw into the layer's lower-left corner.
+//
+// Views share the frame's submission work with the main camera: traffic
+// instances are uploaded and the shadow cascades drawn once, and only the
+// view-dependent packets are queued again per view. Each view runs at its
+// own rate and can read back through a PBO ring, whose consumer receives
+// the mapped buffer directly.
+class SensorViews {
+public:
+    static constexpr int MAX_VIEWS = 8;
+    static constexpr int READBACK_DEPTH = 3;
+    
+    struct Stats {
+        int framesRendered = 0;
+        int framesReadBack = 0;
+        int readbacksDropped = 0; // Every PBO still in flight when the view rendered,
+                                  // or the GPU never finished them before Flush
+    };
+    
+public:
+    SensorViews();
+    ~SensorViews();
+    
+    bool Initialize();
+    void Shutdown();
+    
+    // Returns the view index (= texture layer), or -1 on failure. rateHz 0
+    // renders every frame. The consumer, if set, gets every rendered frame
+    // as bottom-up RGBA8 rows of width x height, a couple of frames late.
+    int AddView(int width, int height, float rateHz = 0.0f,
+                PixelReadbackRing::Consumer consumer = nullptr);
+    int GetViewCount() const { return static_cast<int>(m_views.size()); }
+    
+    // Views keep their own camera; set its pose before each frame
+    Camera& GetCamera(int view) { return m_views[view].camera; }
+    const Camera& GetCamera(int view) const { return m_views[view].camera; }
+    
+    // True if the view's period has elapsed since it last rendered
+    bool IsDue(int view, float time) const;
+    
+    // Bind the view's layer and viewport and clear it. EndView queues its
+    // readback; End restores the framebuffer and viewport bound before the
+    // first view.
+    void BeginView(int view, float time);
+    void EndView(int view);
+    void End();
+    
+    // Hand finished readbacks to their consumers without waiting; Flush
+    // waits for every pending one
+    void Collect();
+    void Flush();
+    
+    unsigned int GetTexture() const { return m_colorTexture; }
+    int GetWidth(int view) const { return m_views[view].width; }
+    int GetHeight(int view) const { return m_views[view].height; }
+    const Stats& GetStats(int view) const { return m_views[view].stats; }
+    
+private:
+    struct View {
+        Camera camera;
+        int width;
+        int height;
+        float period;       // Seconds, 0 = every frame
+        float lastRendered; // Negative until the first frame
+        PixelReadbackRing::Consumer consumer;
+        std::unique_ptr<PixelReadbackRing> readback;
+        Stats stats;
+    };
+    
+    bool Allocate(int width, int height, int layers);
+    
+    std::vector<View> m_views;
+    
+    // Layered color array and one depth buffer reused by every view
+    unsigned int m_colorTexture;
+    unsigned int m_depthBuffer;
+    unsigned int m_framebuffer;
+    int m_arrayWidth;
+    int m_arrayHeight;
+    int m_arrayLayers;
+    
+    // Caller state saved by the first BeginView of a frame
+    int m_previousFramebuffer;
+    int m_previousViewport[4];
+    bool m_inPass;
+};
+
+} // namespace FlightSim
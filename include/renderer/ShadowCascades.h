@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <glm/glm.hpp>
+#include "../core/Shader.h"
+
+namespace FlightSim {
+
+class Camera;
+
+// Handles for the uniforms declared by ShadowCascades::AddShaderFunctions
+struct ShadowUniforms {
+    Uniform<int> shadowMap;
+    Uniform<glm::mat4> shadowMatrices;
+    Uniform<glm::vec4> shadowNormalOffsets;
+};
+
+// Cascaded shadow maps for the sun, one layer of a depth texture array per
+// cascade. Each cascade is fit to the bounding sphere of its view frustum
+// slice and snapped to whole texels in a light basis that depends only on
+// the sun, so shadow edges do not shimmer as the camera turns or moves.
+//
+// Only cascade 0 holds moving casters (aircraft) and is redrawn every
+// frame. The outer cascades hold static terrain: they cover a margin
+// around their slice and are redrawn only when the sun moves or the slice
+// leaves that margin, so their cost stays flat as the terrain grows.
+class ShadowCascades {
+public:
+    static constexpr int CASCADE_COUNT = 4;
+    static constexpr int RESOLUTION = 2048;
+    
+public:
+    ShadowCascades();
+    ~ShadowCascades();
+    
+    bool Initialize();
+    void Shutdown();
+    
+    // Far end of the last cascade; clamped to the camera far plane
+    void SetShadowDistance(float distance) { m_shadowDistance = distance; }
+    
+    // Redraw the static cascades next frame, e.g. after the terrain changed
+    void InvalidateStatic();
+    
+    // Fit the cascades to the camera and decide which need drawing
+    void Update(const Camera& camera, const glm::vec3& sunDirection);
+    
+    bool NeedsRender(int cascade) const { return m_cascades[cascade].dirty; }
+    static bool IsDynamic(int cascade) { return cascade == 0; }
+    const glm::mat4& GetViewProjection(int cascade) const { return m_cascades[cascade].viewProjection; }
+    int GetRenderedCascadeCount() const { return m_renderedCount; }
+    
+    // Bind the cascade's layer as the depth target and clear it. End
+    // restores the framebuffer and viewport bound before the first cascade.
+    void BeginCascade(int cascade);
+    void End();
+    
+    // Insert the shadow GLSL library after the #version line of a fragment
+    // shader. It declares the ShadowUniforms and provides
+    //   float GetSunShadow(vec3 worldPosition, vec3 normal)  0 = shadowed, 1 = lit
+    static std::string AddShaderFunctions(const std::string& source);
+    static ShadowUniforms GetUniforms(const Shader& shader);
+    
+    // Bind the depth array and set the cascade matrices; call from a material
+    void Apply(const Shader& shader, const ShadowUniforms& uniforms) const;
+    
+    bool IsReady() const { return m_ready; }
+    unsigned int GetDepthTexture() const { return m_depthTexture; }
+    
+private:
+    struct Cascade {
+        glm::mat4 viewProjection;  // World to light clip space, for drawing
+        glm::vec3 sunDirection;    // Sun the cascade was last drawn with
+        glm::vec3 center;          // Snapped center in light view space
+        float halfExtent;          // Meters
+        bool dirty;
+        bool valid;
+    };
+    
+    unsigned int m_depthTexture;
+    unsigned int m_framebuffer;
+    
+    Cascade m_cascades[CASCADE_COUNT];
+    glm::mat4 m_shadowMatrices[CASCADE_COUNT]; // World to [0, 1] texture space
+    glm::vec4 m_normalOffsets;                 // Per cascade, meters
+    float m_shadowDistance;
+    int m_renderedCount;
+    
+    // Caller state saved by the first BeginCascade of a frame
+    int m_previousFramebuffer;
+    int m_previousViewport[4];
+    bool m_inPass;
+    
+    bool m_ready;
+};
+
+} // namespace FlightSim
@@ -4,11 +4,16 @@
 #include <glm/glm.hpp>
 #include "../core/Shader.h"
 #include "../core/Mesh.h"
+#include "Atmosphere.h"
 
 namespace FlightSim {
 
 class Camera;
+class RenderQueue;
 
+// Sky from the precomputed atmosphere, drawn as one fullscreen triangle at
+// maximum depth. It goes after opaque geometry, so early depth testing
+// rejects every pixel that terrain or aircraft already cover.
 class SkyBox {
 public:
     SkyBox();
@@ -17,31 +22,27 @@ public:
     bool Initialize();
     void Shutdown();
     
-    void Render(const Camera& camera);
-    
-    // Sky settings
-    void SetSkyColor(const glm::vec3& topColor, const glm::vec3& bottomColor);
-    void SetSunPosition(const glm::vec3& position);
-    void SetTimeOfDay(float time); // 0.0 = midnight, 0.5 = noon, 1.0 = midnight
+    // Queue the sky draw; the atmosphere must outlive the frame
+    void Submit(RenderQueue& queue, const Camera& camera, const Atmosphere& atmosphere);
     
 private:
     void CreateSkyMesh();
     void SetupShaders();
-    void UpdateSkyColors();
+    static void ApplyMaterial(const Shader& shader, const void* context);
     
     std::unique_ptr<Shader> m_skyShader;
     std::unique_ptr<Mesh> m_skyMesh;
     
-    // Sky properties
-    glm::vec3 m_topColor;
-    glm::vec3 m_bottomColor;
-    glm::vec3 m_sunPosition;
-    float m_timeOfDay;
+    struct SkyUniforms {
+        Uniform<glm::mat4> inverseViewProjection;
+        Uniform<glm::vec3> cameraPosition;
+        AtmosphereUniforms atmosphere;
+    } m_skyUniforms;
     
-    // Atmospheric parameters
-    float m_sunIntensity;
-    glm::vec3 m_sunColor;
-    glm::vec3 m_horizonColor;
+    // Frame state captured at submit time for ApplyMaterial
+    glm::mat4 m_inverseViewProjection;
+    glm::vec3 m_cameraPosition;
+    const Atmosphere* m_atmosphere;
 };
 
 } // namespace FlightSim 
\ No newline at end of file
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include "../core/Shader.h"
 #include "../core/Mesh.h"
+#include "Atmosphere.h"
+#include "ClusteredLights.h"
+#include "ShadowCascades.h"
 
 namespace FlightSim {
 
 class Camera;
+class RenderQueue;
 
 class Terrain {
 public:
@@ -17,11 +22,18 @@ public:
     bool Initialize();
     void Shutdown();
     
-    void Render(const Camera& camera);
+    // Queue the terrain draw for this frame; lit and fogged by the
+    // atmosphere, plus the local lights
+    void Submit(RenderQueue& queue, const Camera& camera, const Atmosphere& atmosphere,
+                const ShadowCascades& shadows, const ClusteredLights& lights);
+    
+    // Queue a depth-only draw into a shadow cascade
+    void SubmitShadow(RenderQueue& queue, const glm::mat4& lightViewProjection);
     
     // Terrain generation
     void GenerateTerrain(int width, int height, float scale = 1.0f);
     float GetHeightAt(float x, float z) const;
+    float GetSize() const { return m_terrainScale; } // Side of the square, centered on the origin
     
     // Settings
     void SetTerrainColor(const glm::vec3& color) { m_terrainColor = color; }
@@ -30,10 +42,40 @@ public:
 private:
     void CreateTerrainMesh();
     void SetupShaders();
+    static void ApplyMaterial(const Shader& shader, const void* context);
+    static void ApplyShadowMaterial(const Shader& shader, const void* context);
     
     std::unique_ptr<Shader> m_terrainShader;
+    std::unique_ptr<Shader> m_shadowShader;
     std::unique_ptr<Mesh> m_terrainMesh;
     
+    struct TerrainUniforms {
+        Uniform<glm::mat4> model;
+        Uniform<glm::mat4> view;
+        Uniform<glm::mat4> projection;
+        Uniform<glm::vec3> terrainColor;
+        Uniform<glm::vec3> viewPos;
+        VertexDecodeUniforms vertexDecode;
+        AtmosphereUniforms atmosphere;
+        ShadowUniforms shadows;
+        LocalLightUniforms localLights;
+    } m_terrainUniforms;
+    
+    struct ShadowPassUniforms {
+        Uniform<glm::mat4> lightViewProjection;
+        Uniform<glm::vec3> positionOffset;
+        Uniform<glm::vec3> positionScale;
+    } m_shadowUniforms;
+    
+    // Frame state captured at submit time for ApplyMaterial
+    glm::mat4 m_view;
+    glm::mat4 m_projection;
+    glm::vec3 m_viewPos;
+    const Atmosphere* m_atmosphere;
+    const ShadowCascades* m_shadows;
+    const ClusteredLights* m_lights;
+    glm::mat4 m_lightViewProjection;
+    
     // Terrain properties
     int m_gridSize;
     float m_terrainScale;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace FlightSim {
+
+class Mesh;
+class Shader;
+class RenderQueue;
+class StreamingBuffer;
+
+// Per-instance vertex data read by aircraft.vert (locations 3-5)
+struct AircraftInstance {
+    glm::vec4 positionScale; // xyz = world position, w = uniform scale
+    glm::vec4 rotation;      // Orientation quaternion as (x, y, z, w)
+    glm::vec4 tint;          // rgb = tint, a unused
+};
+
+// Collects aircraft instances per (mesh, LOD) batch and draws each batch
+// with a single instanced draw. Each frame's instances are written into
+// one allocation of the renderer's StreamingBuffer.
+class TrafficRenderer {
+public:
+    TrafficRenderer();
+    ~TrafficRenderer();
+    
+    bool Initialize(StreamingBuffer& stream);
+    void Shutdown();
+    
+    // Start collecting instances for a new frame. Batch storage is kept so
+    // steady-state frames do not allocate.
+    void Begin();
+    void Submit(const Mesh& mesh, int lod, const glm::vec3& position, const glm::quat& orientation,
+                const glm::vec3& tint, float scale = 1.0f);
+    
+    // Copy all instances into the streaming buffer, then queue one
+    // instanced packet per batch. The packet's userData is the batch's first
+    // instance; the material's prepareDraw must call BindBatch with it.
+    // Only batches with lodBegin <= lod < lodEnd are queued, so levels drawn
+    // with different shaders (impostors) or skipped (in shadows) can be split.
+    void Upload();
+    void SubmitDraws(RenderQueue& queue, const Shader& shader, uint32_t material, int lodBegin = 0,
+                     int lodEnd = INT_MAX);
+    void BindBatch(uint32_t firstInstance) const;
+    
+    // Point the per-instance attributes at firstInstance of an array of
+    // AircraftInstance starting offset bytes into buffer (e.g. one written
+    // by GPU culling)
+    static void BindInstanceAttributes(unsigned int buffer, size_t offset, size_t firstInstance);
+    
+    // All instances in batch order, valid after Upload until the next frame.
+    // The offset is aligned for binding as a storage buffer.
+    unsigned int GetInstanceBuffer() const { return m_instanceBuffer; }
+    size_t GetInstanceOffset() const { return m_instanceOffset; }
+    
+    int GetDrawCallCount() const { return m_drawCalls; }
+    int GetInstanceCount() const { return m_instanceCount; }
+    int GetInstanceCount(int lod) const;
+    
+private:
+    struct Batch {
+        const Mesh* mesh;
+        int lod;
+        std::vector<AircraftInstance> instances;
+        size_t firstInstance; // In this frame's allocation after Upload
+    };
+    
+    Batch& GetBatch(const Mesh& mesh, int lod);
+    
+    std::vector<Batch> m_batches;
+    
+    StreamingBuffer* m_stream;
+    unsigned int m_instanceBuffer; // This frame's allocation
+    size_t m_instanceOffset;
+    
+    // Stats for the last uploaded frame
+    int m_drawCalls;
+    int m_instanceCount;
+};
+
+} // namespace FlightSim
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../core/Shader.h"
+#include "../physics/TrailRecorder.h"
+
+namespace FlightSim {
+
+// Flight-path trails kept on the GPU. Each trail owns a fixed ring of up
+// to POINTS_PER_TRAIL points in one buffer texture, shorter when the
+// driver's texture buffer size limit cannot hold every full ring (GL 3.3
+// only guarantees 65536 texels). New points are written
+// with sub-range uploads as they are committed, so the per-frame CPU cost
+// is the new points plus a small per-trail header, not the trail length.
+// Line quads are expanded in the vertex shader from gl_VertexID and all
+// trails are drawn with a single glMultiDrawArrays.
+class TrailRenderer {
+public:
+    static constexpr int POINTS_PER_TRAIL = 1 << 16;
+    
+public:
+    TrailRenderer();
+    ~TrailRenderer();
+    
+    bool Initialize(int maxTrails);
+    void Shutdown();
+    
+    // Upload whatever each trail committed since the last call. Trails
+    // beyond maxTrails are ignored.
+    void Update(const std::vector<TrailUpdate>& trails);
+    
+    // Drawn with depth test, without depth writes; older segments fade
+    void Render(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float currentTime);
+    
+    // Points currently resident across all trails
+    uint64_t GetPointCount() const;
+    int GetPointsPerTrail() const { return m_pointsPerTrail; }
+    int GetMissedPointCount() const { return m_missedPoints; }
+    
+private:
+    struct TrailSlot {
+        uint32_t generation = 0;
+        uint64_t uploadedCount = 0; // Committed points written to the ring
+        glm::vec3 head{0.0f};
+        bool active = false;
+    };
+    
+    void SetupShaders();
+    void UploadPoints(int slot, uint64_t firstIndex, const TrailPoint* points, size_t count);
+    
+    std::unique_ptr<Shader> m_trailShader;
+    
+    struct TrailUniforms {
+        Uniform<glm::mat4> view;
+        Uniform<glm::mat4> projection;
+        Uniform<float> nearPlane;
+        Uniform<float> aspect;
+        Uniform<float> halfWidth;
+        Uniform<float> currentTime;
+        Uniform<int> points;
+        Uniform<int> headers;
+        Uniform<int> pointsPerTrail;
+    } m_trailUniforms;
+    
+    // Ring storage and per-trail headers (ring start, count, head position)
+    unsigned int m_pointBuffer;
+    unsigned int m_pointTexture;
+    unsigned int m_headerBuffer;
+    unsigned int m_headerTexture;
+    unsigned int m_emptyVAO;
+    
+    int m_maxTrails;
+    int m_pointsPerTrail; // Ring length that fits the texture buffer limit
+    std::vector<TrailSlot> m_slots;
+    std::vector<glm::vec4> m_headers;
+    std::vector<int> m_drawFirst;
+    std::vector<int> m_drawCount;
+    int m_missedPoints; // Points lost because the renderer fell too far behind
+};
+
+} // namespace FlightSim
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <glm/glm.hpp>
+#include "../core/GLHandle.h"
+#include "../core/Shader.h"
+#include "Atmosphere.h"
+#include "CloudQuality.h"
+
+namespace FlightSim {
+
+class Camera;
+class GpuProfiler;
+
+// Raymarched cloud layer between CLOUD_BOTTOM and CLOUD_TOP.
+//
+// Density comes from tiling 3D noise rendered once at startup: a
+// Perlin-Worley shape volume with Worley octaves that erode it, a finer
+// Worley detail volume for the edges, and a 2D weather map of coverage
+// and cloud type. Clouds are lit by the atmosphere's sun and sky light
+// with a short march towards the sun, and get aerial perspective at
+// their mean depth.
+//
+// The march runs at half resolution per axis, and of those pixels only
+// one checkerboard half each frame: one pixel in eight of the output.
+// A resolve pass fills the other half by reprojecting the previous
+// frame's result through the previous camera matrices, clamped to the
+// freshly marched neighbors so moving clouds do not smear, and blends
+// marched pixels with their history to hide the step jitter. The result
+// is composited over the sky and behind nearer scene depth.
+//
+// GPU time of the march and resolve is kept under a budget by stepping
+// the quality below the chosen preset, never above it.
+class VolumetricClouds {
+public:
+    static constexpr float CLOUD_BOTTOM = 1500.0f; // Meters
+    static constexpr float CLOUD_TOP = 3000.0f;
+    
+    // Profiler scope whose time the budget controls; the renderer gives
+    // the graph pass that calls Render this name
+    static constexpr const char* PASS_NAME = "Clouds";
+    
+public:
+    VolumetricClouds();
+    ~VolumetricClouds();
+    
+    // Renders the noise volumes; needs a current GL context
+    bool Initialize();
+    void Shutdown();
+    
+    // Buffer size follows the output, not the dynamic resolution scale;
+    // a new size drops the history
+    bool Resize(int width, int height);
+    
+    // The preset is the highest quality the budget controller may use
+    void SetQuality(CloudQuality quality);
+    CloudQuality GetQuality() const { return m_quality; }
+    CloudQuality GetActiveQuality() const { return m_activeQuality; }
+    bool IsEnabled() const { return m_activeQuality != CloudQuality::Off; }
+    void CycleQuality();
+    
+    static const char* GetQualityName(CloudQuality quality);
+    static bool ParseQuality(const std::string& name, CloudQuality& quality);
+    
+    // GPU milliseconds allowed for the march and resolve; 0 keeps the
+    // preset regardless of cost
+    void SetBudget(float milliseconds);
+    float GetBudget() const { return m_budgetMs; }
+    
+    // 0 = clear sky, 1 = overcast
+    void SetCoverage(float coverage);
+    
+    // Meters per second; the noise drifts with the simulation clock
+    void SetWind(const glm::vec2& wind) { m_wind = wind; }
+    
+    // Step the budget controller once per new GPU sample
+    void Update(const GpuProfiler& profiler);
+    
+    // March and resolve into the next history buffer. Binds its own
+    // framebuffers and viewport; the caller restores its target.
+    void Render(const Camera& camera, const Atmosphere& atmosphere, double time);
+    
+    // Resolved clouds of the last Render, for render graph tracking
+    unsigned int GetTexture() const { return m_historyColor[m_current]; }
+    
+    // Blend the clouds over the bound target, whose lower-left width x
+    // height holds the scene. Depth tested, not written.
+    void Composite(const Camera& camera, const Atmosphere& atmosphere, int width, int height);
+    
+    // Smoothed GPU time of PASS_NAME, 0 before the first sample
+    float GetCostMs() const { return m_costMs; }
+    int GetMarchedPixelCount() const { return m_marchWidth * m_height; }
+    size_t GetGpuMemorySize() const;
+    void WriteReport(std::ostream& stream) const;
+    
+private:
+    struct MarchUniforms {
+        Uniform<int> shapeNoise;
+        Uniform<int> detailNoise;
+        Uniform<int> weatherMap;
+        Uniform<glm::mat4> inverseViewProjection;
+        Uniform<glm::vec3> viewPos;
+        Uniform<glm::vec2> cloudSize;
+        Uniform<int> frameIndex;
+        Uniform<int> primarySteps;
+        Uniform<int> lightSteps;
+        Uniform<bool> detailEnabled;
+        Uniform<float> maxDistance;
+        Uniform<float> coverage;
+        Uniform<glm::vec3> windOffset;
+        AtmosphereUniforms atmosphere;
+    };
+    
+    struct ResolveUniforms {
+        Uniform<int> marchedColor;
+        Uniform<int> marchedDepth;
+        Uniform<int> historyColor;
+        Uniform<glm::mat4> inverseViewProjection;
+        Uniform<glm::mat4> previousViewProjection;
+        Uniform<glm::vec3> viewPos;
+        Uniform<glm::vec2> cloudSize;
+        Uniform<int> frameIndex;
+        Uniform<bool> historyValid;
+    };
+    
+    struct CompositeUniforms {
+        Uniform<int> cloudColor;
+        Uniform<int> cloudDepth;
+        Uniform<glm::mat4> viewProjection;
+        Uniform<glm::mat4> inverseViewProjection;
+        Uniform<glm::vec3> viewPos;
+        Uniform<glm::vec2> renderSize;
+        AtmosphereUniforms atmosphere;
+    };
+    
+    bool SetupShaders();
+    bool RenderNoise();
+    void ReleaseTargets();
+    void SetActiveQuality(CloudQuality quality);
+    
+    std::unique_ptr<Shader> m_marchShader;
+    std::unique_ptr<Shader> m_resolveShader;
+    std::unique_ptr<Shader> m_compositeShader;
+    MarchUniforms m_marchUniforms;
+    ResolveUniforms m_resolveUniforms;
+    CompositeUniforms m_compositeUniforms;
+    GLVertexArray m_emptyVAO;
+    
+    // Tiling noise, rendered once
+    unsigned int m_shapeNoise;  // RGBA8 3D: Perlin-Worley, Worley fbm x3
+    unsigned int m_detailNoise; // RGBA8 3D: Worley fbm x3
+    unsigned int m_weatherMap;  // RGBA8 2D: coverage, type
+    
+    // Marched half of the checkerboard: (scattered radiance, transmittance)
+    // and mean cloud depth in meters; full-size history ping-pongs
+    unsigned int m_marchColor;
+    unsigned int m_marchDepth;
+    unsigned int m_marchFramebuffer;
+    unsigned int m_historyColor[2];
+    unsigned int m_historyDepth[2];
+    unsigned int m_historyFramebuffers[2];
+    int m_current;   // History written by the last Render
+    int m_width;     // Cloud buffer, half the output per axis
+    int m_height;
+    int m_marchWidth;
+    bool m_historyValid;
+    
+    // Camera of the last Render, for reprojection
+    glm::mat4 m_previousViewProjection;
+    int m_frameIndex;
+    
+    CloudQuality m_quality;
+    CloudQuality m_activeQuality;
+    float m_coverage;
+    glm::vec2 m_wind;
+    
+    // Budget controller
+    float m_budgetMs;
+    float m_costMs;
+    int m_costSamples;   // Since the last quality change
+    int m_cooldown;      // Samples to wait before the next change
+    int m_lastSample;
+};
+
+} // namespace FlightSim
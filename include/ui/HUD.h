@@ -2,29 +2,42 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include "../physics/Aircraft.h"
+#include "HUDValues.h"
 #include "core/Shader.h"
+#include "core/GLStateCache.h"
+#include "renderer/GpuProfiler.h"
 
 namespace FlightSim {
 
 struct AircraftState;
 class Camera;
+class StreamingBuffer;
 
 class HUD {
 public:
     HUD();
     ~HUD();
     
-    bool Initialize();
+    // Vertices are streamed through the renderer's ring each frame
+    bool Initialize(StreamingBuffer& stream);
     void Shutdown();
     
-    void Update(const AircraftState& state, float deltaTime);
+    // Smoothed readouts computed by the simulation for the current snapshot
+    void SetValues(const HUDValues& values) { m_values = values; }
     void Render(const Camera& camera, const AircraftState& state);
     
     void SetEnabled(bool enabled) { m_enabled = enabled; }
     bool IsEnabled() const { return m_enabled; }
     
+    // Optional panel with frame rate, GPU pass timings and state-change counts
+    void TogglePerformanceOverlay() { m_showPerformance = !m_showPerformance; }
+    bool IsPerformanceOverlayVisible() const { return m_showPerformance; }
+    void RenderPerformanceOverlay(float fps, const std::vector<GpuProfiler::ScopeStats>& gpuScopes,
+                                  const GLStateCache::Counters& stateCounters);
+                                  
 private:
     void SetupBuffers();
     void RenderCrosshair();
@@ -35,24 +48,45 @@ private:
     void RenderVerticalSpeedIndicator(const AircraftState& state);
     void RenderEngineInstruments(const AircraftState& state);
     void RenderFlightInfo(const AircraftState& state);
+    void RenderControlIndicators(const AircraftState& state);
     
-    // Rendering helpers
+    // Rendering helpers. Each appends triangles to the current batch, which
+    // Flush draws in order with a single draw call.
     void RenderText(const std::string& text, float x, float y, float scale, const glm::vec3& color);
     void RenderLine(const glm::vec2& start, const glm::vec2& end, const glm::vec3& color, float width = 1.0f);
     void RenderQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec3& color);
     void RenderCircle(const glm::vec2& center, float radius, const glm::vec3& color, int segments = 32);
+    void AddQuad(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d,
+                 const glm::vec3& color);
+    void Flush();
     
     std::unique_ptr<Shader> m_hudShader;
     std::unique_ptr<Shader> m_textShader;
     
+    struct HUDUniforms {
+        Uniform<glm::mat4> projection;
+        Uniform<float> alpha;
+    } m_hudUniforms;
+    
+    struct HUDVertex {
+        glm::vec2 position;
+        glm::vec3 color;
+    };
+    
+    // Triangles of the current batch; capacity is kept between frames
+    std::vector<HUDVertex> m_vertices;
+    
     // OpenGL objects
-    unsigned int m_VAO, m_VBO;
+    StreamingBuffer* m_stream;
+    unsigned int m_VAO;
     unsigned int m_fontTexture;
     
     // HUD settings
     bool m_enabled;
     float m_hudScale;
-    glm::vec3 m_hudColor;
+    float m_hudAlpha;
+    bool m_showDebugInfo;
+    bool m_showPerformance;
     
     // Instrument positions (normalized screen coordinates)
     struct InstrumentLayout {
@@ -65,12 +99,7 @@ private:
         glm::vec2 infoPos{0.1f, 0.1f};
     } m_layout;
     
-    // Animation/smoothing
-    float m_smoothedAltitude;
-    float m_smoothedSpeed;
-    float m_smoothedHeading;
-    float m_smoothedPitch;
-    float m_smoothedRoll;
+    HUDValues m_values;
 };
 
 } // namespace FlightSim 
\ No newline at end of file
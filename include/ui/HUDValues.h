@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace FlightSim {
+
+struct AircraftState;
+
+// Smoothed instrument readouts. Updated on the simulation thread each tick
+// and handed to the HUD with the world snapshot.
+struct HUDValues {
+    float altitude = 0.0f;
+    float speed = 0.0f;
+    float verticalSpeed = 0.0f;
+    float heading = 0.0f;
+    float pitch = 0.0f;
+    float roll = 0.0f;
+    glm::vec3 color{0.0f, 1.0f, 0.0f};
+    
+    void Update(const AircraftState& state, float deltaTime);
+};
+
+} // namespace FlightSim
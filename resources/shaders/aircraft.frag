@@ -1,73 +1,55 @@
 #version 330 core
+// The renderer inserts the atmosphere, shadow and local light libraries
+// (see Atmosphere, ShadowCascades and ClusteredLights) here
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
 in vec3 WorldPos;
+flat in vec3 AircraftColor;
 
 // Lighting uniforms
-uniform vec3 lightPos;
-uniform vec3 lightColor;
 uniform vec3 viewPos;
-uniform float ambientStrength;
-uniform float diffuseStrength;
 uniform float specularStrength;
 
 // Material uniforms
-uniform vec3 material_ambient;
 uniform vec3 material_diffuse;
 uniform vec3 material_specular;
 uniform float material_shininess;
 
-// Aircraft color
-uniform vec3 aircraftColor;
-
-// Fog uniforms
-uniform float fogDensity;
-uniform vec3 fogColor;
-
 void main() {
     // Normalize vectors
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
     vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 point = WorldToAtmosphere(FragPos);
     
-    // Ambient lighting
-    vec3 ambient = ambientStrength * lightColor * material_ambient;
-    
-    // Diffuse lighting
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diffuseStrength * diff * lightColor * material_diffuse;
+    // Sun and sky light; colors are display values, lighting is linear
+    vec3 albedo = pow(material_diffuse * AircraftColor, vec3(2.2));
+    vec3 skyIrradiance;
+    vec3 sunIrradiance = GetSunAndSkyIrradiance(point, norm, skyIrradiance);
+    sunIrradiance *= GetSunShadow(FragPos, norm);
+    vec3 result = albedo / PI * (sunIrradiance + skyIrradiance);
     
-    // Specular lighting
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
-    vec3 specular = specularStrength * spec * lightColor * material_specular;
+    // Normalized Blinn-Phong highlight from the sun
+    vec3 halfway = normalize(sunDirection + viewDir);
+    float spec = pow(max(dot(norm, halfway), 0.0), material_shininess) * (material_shininess + 8.0) / (8.0 * PI);
+    result += specularStrength * spec * material_specular * sunIrradiance;
     
-    // Combine lighting
-    vec3 result = ambient + diffuse + specular;
-    
-    // Apply aircraft color
-    result *= aircraftColor;
-    
-    // Add some variation based on position for better visibility
-    float heightFactor = smoothstep(0.0, 100.0, FragPos.y);
-    result += vec3(0.1) * heightFactor;
+    // Navigation, beacon and runway lights from this fragment's cluster
+    vec3 localSpecular;
+    vec3 localIrradiance = GetLocalLightIrradiance(FragPos, norm, viewDir, material_shininess, localSpecular);
+    result += albedo / PI * localIrradiance + specularStrength * material_specular * localSpecular;
     
     // Add edge highlighting for better aircraft definition
     float edgeFactor = 1.0 - max(dot(norm, viewDir), 0.0);
     edgeFactor = pow(edgeFactor, 3.0);
-    result += vec3(0.2) * edgeFactor;
-    
-    // Apply fog
-    float distance = length(viewPos - FragPos);
-    float fogFactor = exp(-fogDensity * distance);
-    fogFactor = clamp(fogFactor, 0.0, 1.0);
-    result = mix(fogColor, result, fogFactor);
+    result += albedo * skyIrradiance * edgeFactor;
     
-    // Ensure minimum brightness for visibility
-    result = max(result, vec3(0.1));
+    // Aerial perspective
+    vec3 transmittance;
+    vec3 inScatter = GetSkyRadianceToPoint(WorldToAtmosphere(viewPos), point, transmittance);
+    result = result * transmittance + inScatter;
     
-    FragColor = vec4(result, 1.0);
+    FragColor = vec4(ToDisplay(result), 1.0);
 } 
\ No newline at end of file
@@ -3,20 +3,44 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
+// Per-instance attributes (divisor 1)
+layout (location = 3) in vec4 iPositionScale; // xyz = position, w = scale
+layout (location = 4) in vec4 iRotation;      // quaternion (x, y, z, w)
+layout (location = 5) in vec4 iTint;
+
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 out vec3 WorldPos;
+flat out vec3 AircraftColor;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Vertex decode for compressed mesh layouts (see VertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
+
+vec3 decodeNormal(vec3 encoded) {
+    if (!octahedralNormals) return encoded;
+    vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 rotateByQuat(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 position = positionOffset + aPos * positionScale;
+    FragPos = iPositionScale.xyz + rotateByQuat(iRotation, position * iPositionScale.w);
+    Normal = rotateByQuat(iRotation, decodeNormal(aNormal));
     TexCoord = aTexCoord;
-    WorldPos = aPos;
+    WorldPos = position;
+    AircraftColor = iTint.rgb;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
-} 
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// Per-instance attributes (divisor 1), as in aircraft.vert
+layout (location = 3) in vec4 iPositionScale; // xyz = position, w = scale
+layout (location = 4) in vec4 iRotation;      // quaternion (x, y, z, w)
+
+uniform mat4 lightViewProjection;
+
+// Vertex decode for compressed mesh layouts (see VertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 rotateByQuat(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() {
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 worldPosition = iPositionScale.xyz + rotateByQuat(iRotation, position * iPositionScale.w);
+    gl_Position = lightViewProjection * vec4(worldPosition, 1.0);
+}
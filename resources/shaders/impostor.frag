@@ -0,0 +1,40 @@
+#version 330 core
+// The renderer inserts the atmosphere and shadow libraries (see Atmosphere
+// and ShadowCascades) here
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec2 AtlasCoord;
+flat in vec4 Rotation;
+flat in vec3 AircraftColor;
+
+uniform sampler2D impostorAtlas;
+uniform vec3 viewPos;
+uniform vec3 material_diffuse;
+
+vec3 rotateByQuat(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() {
+    // rgb holds the object-space normal premultiplied by coverage
+    vec4 texel = texture(impostorAtlas, AtlasCoord);
+    if (texel.a < 0.5) discard;
+    vec3 norm = normalize(rotateByQuat(Rotation, texel.rgb / texel.a * 2.0 - 1.0));
+    vec3 point = WorldToAtmosphere(FragPos);
+    
+    // Diffuse sun and sky light as in aircraft.frag; highlights are below
+    // a pixel at impostor distances
+    vec3 albedo = pow(material_diffuse * AircraftColor, vec3(2.2));
+    vec3 skyIrradiance;
+    vec3 sunIrradiance = GetSunAndSkyIrradiance(point, norm, skyIrradiance);
+    sunIrradiance *= GetSunShadow(FragPos, norm);
+    vec3 result = albedo / PI * (sunIrradiance + skyIrradiance);
+    
+    // Aerial perspective
+    vec3 transmittance;
+    vec3 inScatter = GetSkyRadianceToPoint(WorldToAtmosphere(viewPos), point, transmittance);
+    result = result * transmittance + inScatter;
+    
+    FragColor = vec4(ToDisplay(result), 1.0);
+}
@@ -0,0 +1,66 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; // Quad corner in [-1, 1]^2
+
+// Per-instance attributes (divisor 1), as in aircraft.vert
+layout (location = 3) in vec4 iPositionScale; // xyz = position, w = scale
+layout (location = 4) in vec4 iRotation;      // quaternion (x, y, z, w)
+layout (location = 5) in vec4 iTint;
+
+out vec3 FragPos;
+out vec2 AtlasCoord;
+flat out vec4 Rotation;
+flat out vec3 AircraftColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+
+// Atlas layout (see ImpostorAtlas)
+uniform int impostorGrid;
+uniform vec3 impostorCenter;
+uniform float impostorRadius;
+
+vec3 rotateByQuat(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec2 encodeOctahedral(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 encoded = n.xy;
+    if (n.z < 0.0) {
+        encoded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return encoded;
+}
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    float scale = iPositionScale.w;
+    vec3 center = iPositionScale.xyz + rotateByQuat(iRotation, impostorCenter * scale);
+    
+    // The view direction in object space picks the nearest baked frame
+    vec4 inverseRotation = vec4(-iRotation.xyz, iRotation.w);
+    vec3 toViewer = normalize(rotateByQuat(inverseRotation, viewPos - center));
+    float grid = float(impostorGrid);
+    vec2 cell = clamp(floor((encodeOctahedral(toViewer) * 0.5 + 0.5) * grid), 0.0, grid - 1.0);
+    
+    // Orient the quad like the camera that baked the frame
+    vec3 direction = decodeOctahedral((cell + 0.5) / grid * 2.0 - 1.0);
+    vec3 up = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, direction));
+    up = cross(direction, right);
+    vec3 corner = (right * aPos.x + up * aPos.y) * impostorRadius;
+    
+    FragPos = center + rotateByQuat(iRotation, corner * scale);
+    AtlasCoord = (cell + aPos.xy * 0.5 + 0.5) / grid;
+    Rotation = iRotation;
+    AircraftColor = iTint.rgb;
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -3,24 +3,48 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <chrono>
+#include <cstring>
 
 #include "core/Window.h"
 #include "core/Camera.h"
+#include "core/Shader.h"
+#include "core/ShaderCache.h"
+#include "core/HeadlessContext.h"
+#include "core/ImageIO.h"
+#include "core/SimulationThread.h"
+#include "core/WorldSnapshot.h"
 #include "renderer/Renderer.h"
-#include "physics/Aircraft.h"
+#include "renderer/RenderTarget.h"
+#include "renderer/FrameCapture.h"
+#include "renderer/VolumetricClouds.h"
 #include "input/InputManager.h"
 #include "ui/HUD.h"
 
 namespace FlightSim {
 
 // Application settings
-static constexpr int WINDOW_WIDTH = 1280;
-static constexpr int WINDOW_HEIGHT = 720;
 static constexpr const char* WINDOW_TITLE = "Professional Flight Simulator v1.0";
+static constexpr const char* SHADER_CACHE_DIR = "shader_cache";
+static constexpr const char* GPU_PROFILE_PATH = "gpu_profile.csv";
+static constexpr const char* FRAME_PACING_PATH = "frame_pacing.csv";
+static constexpr const char* CAPTURE_PATH = "capture.y4m";
 
-Application::Application()
-    : m_running(false)
+// Background traffic around the origin; T toggles the stress-test density
+static constexpr int TRAFFIC_COUNT = 200;
+static constexpr int HEAVY_TRAFFIC_COUNT = 10000;
+static constexpr float TRAFFIC_RADIUS = 20000.0f;
+
+// Sensor cameras hang this far below the aircraft origin, looking down
+static constexpr float SENSOR_MOUNT_OFFSET = 2.0f; // Meters
+
+// Headless runs step the simulation by a fixed amount per frame regardless of frame cost
+static constexpr float HEADLESS_TIMESTEP = 1.0f / 60.0f;
+
+Application::Application(const LaunchOptions& options)
+    : m_options(options)
+    , m_running(false)
     , m_initialized(false)
+    , m_exitCode(0)
     , m_lastFrameTime(0.0f)
     , m_deltaTime(0.0f) {
 }
@@ -34,29 +58,22 @@ bool Application::Initialize() {
         return true;
     }
     
-    // Initialize GLFW
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return false;
-    }
+    auto startupBegin = std::chrono::steady_clock::now();
     
-    // Create window
-    m_window = std::make_unique<Window>(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE);
-    if (!m_window->Initialize()) {
-        std::cerr << "Failed to create window" << std::endl;
+    if (!InitializeContext()) {
         return false;
     }
     
-    // Initialize GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        return false;
-    }
+    // Program binaries are cached across runs; shaders created from here on
+    // are submitted asynchronously and finished together below
+    m_shaderCache = std::make_unique<ShaderCache>();
+    m_shaderCache->Initialize(SHADER_CACHE_DIR);
+    Shader::SetProgramCache(m_shaderCache.get());
     
     // Create subsystems
     m_camera = std::make_unique<Camera>();
     m_renderer = std::make_unique<Renderer>();
-    m_aircraft = std::make_unique<Aircraft>();
+    m_simulation = std::make_unique<SimulationThread>();
     m_inputManager = std::make_unique<InputManager>();
     m_hud = std::make_unique<HUD>();
     
@@ -65,81 +82,323 @@ bool Application::Initialize() {
         std::cerr << "Failed to initialize renderer" << std::endl;
         return false;
     }
+    m_renderer->SetGpuCulling(m_options.gpuCulling);
+    if (!m_options.sceneryPath.empty() && !m_renderer->LoadScenery(m_options.sceneryPath)) {
+        return false;
+    }
+    if (VolumetricClouds* clouds = m_renderer->GetClouds()) {
+        clouds->SetQuality(m_options.cloudQuality);
+        if (!m_options.headless) {
+            clouds->SetBudget(m_options.cloudBudgetMs);
+        }
+    }
     
-    if (!m_hud->Initialize()) {
+    if (!m_hud->Initialize(*m_renderer->GetStreamingBuffer())) {
         std::cerr << "Failed to initialize HUD" << std::endl;
         return false;
     }
     
-    // Set up input callbacks
-    m_window->SetKeyCallback([this](int key, int scancode, int action, int mods) {
-        m_inputManager->ProcessKeyboard(key, scancode, action, mods);
-    });
+    if (!InitializeSensors()) {
+        return false;
+    }
     
-    m_window->SetMouseCallback([this](double xpos, double ypos) {
-        m_inputManager->ProcessMouse(xpos, ypos);
-    });
+    auto shadersBegin = std::chrono::steady_clock::now();
+    if (!m_shaderCache->FinishPending()) {
+        std::cerr << "Failed to build shader programs" << std::endl;
+        return false;
+    }
+    auto startupEnd = std::chrono::steady_clock::now();
     
-    m_window->SetScrollCallback([this](double xoffset, double yoffset) {
-        m_inputManager->ProcessScroll(xoffset, yoffset);
-    });
+    const ShaderCache::Stats& shaderStats = m_shaderCache->GetStats();
+    std::chrono::duration<double, std::milli> startupTime = startupEnd - startupBegin;
+    std::chrono::duration<double, std::milli> shaderWaitTime = startupEnd - shadersBegin;
+    std::cout << "Startup (" << (shaderStats.cacheMisses == 0 && shaderStats.cacheHits > 0 ? "warm" : "cold")
+              << "): " << startupTime.count() << " ms, waited " << shaderWaitTime.count()
+              << " ms on " << shaderStats.programsLinked << " shader programs ("
+              << shaderStats.cacheHits << " cached, " << shaderStats.cacheMisses << " compiled"
+              << (m_shaderCache->IsParallelCompileAvailable() ? ", parallel" : "") << ")" << std::endl;
     
-    m_window->SetResizeCallback([this](int width, int height) {
-        glViewport(0, 0, width, height);
-        m_camera->SetAspectRatio(static_cast<float>(width) / static_cast<float>(height));
-    });
+    if (!m_simulation->Initialize(TRAFFIC_COUNT, TRAFFIC_RADIUS)) {
+        std::cerr << "Failed to initialize simulation" << std::endl;
+        return false;
+    }
+    
+    if (m_options.headless) {
+        // Everything renders into an offscreen target at the requested size
+        m_offscreenTarget = std::make_unique<RenderTarget>();
+        if (!m_offscreenTarget->Initialize(m_options.width, m_options.height)) {
+            std::cerr << "Failed to create offscreen render target" << std::endl;
+            return false;
+        }
+        m_offscreenTarget->Bind();
+    } else {
+        m_framePacer = std::make_unique<FramePacer>();
+        m_framePacer->Initialize(m_window.get(), m_options.pacing, m_options.targetFps);
+        
+        // Set up input callbacks; the pacer times each event to its frame's swap
+        m_window->SetKeyCallback([this](int key, int scancode, int action, int mods) {
+            m_framePacer->OnInputEvent();
+            m_inputManager->ProcessKeyboard(key, scancode, action, mods);
+        });
+        
+        m_window->SetMouseCallback([this](double xpos, double ypos) {
+            m_framePacer->OnInputEvent();
+            m_inputManager->ProcessMouse(xpos, ypos);
+        });
+        
+        m_window->SetScrollCallback([this](double xoffset, double yoffset) {
+            m_framePacer->OnInputEvent();
+            m_inputManager->ProcessScroll(xoffset, yoffset);
+        });
+        
+        m_window->SetResizeCallback([this](int width, int height) {
+            // Minimizing reports 0x0, which has no aspect ratio
+            if (width <= 0 || height <= 0) return;
+            
+            // A recording has a fixed frame size
+            if (m_frameCapture->IsActive()) {
+                m_frameCapture->Stop();
+            }
+            m_renderer->SetViewport(width, height);
+            m_camera->SetAspectRatio(static_cast<float>(width) / static_cast<float>(height));
+        });
+    }
+    
+    // Headless runs keep a fixed resolution so their output is reproducible
+    if (!m_options.headless) {
+        int framebufferWidth = 0;
+        int framebufferHeight = 0;
+        m_window->GetFramebufferSize(framebufferWidth, framebufferHeight);
+        m_renderer->SetViewport(framebufferWidth, framebufferHeight);
+        m_renderer->SetDynamicResolution(true);
+    }
     
     // Set initial camera aspect ratio
-    m_camera->SetAspectRatio(static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT));
+    m_camera->SetAspectRatio(static_cast<float>(m_options.width) / static_cast<float>(m_options.height));
+    
+    m_frameCapture = std::make_unique<FrameCapture>();
+    if (!m_options.capturePath.empty() && !StartCapture(m_options.capturePath)) {
+        return false;
+    }
     
     m_initialized = true;
     return true;
 }
 
+bool Application::InitializeContext() {
+    if (m_options.headless) {
+        m_headlessContext = std::make_unique<HeadlessContext>();
+        if (!m_headlessContext->Initialize()) {
+            std::cerr << "Failed to create headless context" << std::endl;
+            return false;
+        }
+        
+        if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddressFunction())) {
+            std::cerr << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // Initialize GLFW
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
+    
+    // Create window
+    m_window = std::make_unique<Window>(m_options.width, m_options.height, WINDOW_TITLE);
+    if (!m_window->Initialize()) {
+        std::cerr << "Failed to create window" << std::endl;
+        return false;
+    }
+    
+    // Initialize GLAD
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
 void Application::Run() {
     if (!m_initialized) {
         std::cerr << "Application not initialized" << std::endl;
         return;
     }
     
+    if (m_options.headless) {
+        RunHeadless();
+        return;
+    }
+    
+    // Physics ticks at its own fixed rate; each frame draws the newest tick
+    m_simulation->Start();
+    
     m_running = true;
     m_lastFrameTime = static_cast<float>(glfwGetTime());
     
     while (m_running && !m_window->ShouldClose()) {
+        // Wait first, then latch input, the snapshot and the camera as
+        // close to rendering as possible
+        m_framePacer->WaitForNextFrame();
+        
         float currentTime = static_cast<float>(glfwGetTime());
         m_deltaTime = currentTime - m_lastFrameTime;
         m_lastFrameTime = currentTime;
         
         m_window->PollEvents();
         HandleInput(m_deltaTime);
+        if (!m_framePacer->ShouldRender()) continue;
+        
+        m_simulation->AcquireSnapshot();
         Update(m_deltaTime);
         Render();
-        m_window->SwapBuffers();
+        m_framePacer->Present();
     }
+    
+    m_simulation->Stop();
+    FinishSensors();
+    
+    FramePacer::Metrics pacing = m_framePacer->GetMetrics();
+    std::cout << "Frame pacing (" << FramePacer::GetModeName(m_framePacer->GetMode()) << "): "
+              << pacing.averageFrameMs << " ms/frame, jitter " << pacing.jitterMs << " ms, p99 "
+              << pacing.p99FrameMs << " ms; input to swap " << pacing.averageLatencyMs << " ms (p99 "
+              << pacing.p99LatencyMs << " ms)" << std::endl;
 }
 
-void Application::Update(float deltaTime) {
-    // Get control inputs
-    ControlInputs inputs = m_inputManager->GetControlInputs();
+void Application::RunHeadless() {
+    m_running = true;
+    auto runBegin = std::chrono::steady_clock::now();
+    
+    for (int frame = 0; frame < m_options.frames && m_running; ++frame) {
+        m_deltaTime = HEADLESS_TIMESTEP;
+        m_simulation->Advance(m_deltaTime);
+        m_simulation->AcquireSnapshot();
+        Update(m_deltaTime);
+        Render();
+    }
+    
+    // Wait for the GPU so the wall time covers all submitted work
+    glFinish();
+    std::chrono::duration<double, std::milli> runTime = std::chrono::steady_clock::now() - runBegin;
+    
+    double frameMs = m_options.frames > 0 ? runTime.count() / m_options.frames : 0.0;
+    std::cout << "Headless: " << m_options.frames << " frames at " << m_options.width << "x" << m_options.height
+              << ", " << frameMs << " ms/frame (" << (frameMs > 0.0 ? 1000.0 / frameMs : 0.0) << " fps)" << std::endl;
+    
+    FinishSensors();
+    if (!FinishHeadlessRun()) {
+        m_exitCode = 1;
+    }
+    m_running = false;
+}
+
+bool Application::FinishHeadlessRun() {
+    GpuProfiler* profiler = m_renderer->GetGpuProfiler();
+    for (const GpuProfiler::ScopeStats& scope : profiler->GetStats()) {
+        std::cout << "  GPU " << scope.name << ": " << scope.averageMs << " ms avg, "
+                  << scope.p95Ms << " ms p95" << std::endl;
+    }
+    m_renderer->GetRenderGraph()->WriteReport(std::cout, profiler);
+    m_renderer->WriteLodReport(std::cout);
+    if (m_renderer->GetClouds()) {
+        m_renderer->GetClouds()->WriteReport(std::cout);
+    }
+    if (!m_options.profilePath.empty()) {
+        profiler->WriteReport(m_options.profilePath);
+    }
     
-    // Update aircraft physics
-    m_aircraft->Update(deltaTime, inputs);
+    if (m_options.outputPath.empty() && m_options.goldenPath.empty()) {
+        return true;
+    }
+    
+    Image frame;
+    frame.width = m_offscreenTarget->GetWidth();
+    frame.height = m_offscreenTarget->GetHeight();
+    m_offscreenTarget->ReadPixels(frame.pixels);
+    
+    bool success = true;
+    if (!m_options.outputPath.empty()) {
+        success = ImageIO::WritePPM(m_options.outputPath, frame);
+        if (success) {
+            std::cout << "Wrote " << m_options.outputPath << std::endl;
+        }
+    }
+    
+    if (!m_options.goldenPath.empty()) {
+        Image golden;
+        ImageDifference difference;
+        if (!ImageIO::ReadPPM(m_options.goldenPath, golden)) {
+            return false;
+        }
+        if (!ImageIO::Compare(frame, golden, m_options.goldenTolerance, difference)) {
+            std::cerr << "Golden image size " << golden.width << "x" << golden.height
+                      << " does not match output " << frame.width << "x" << frame.height << std::endl;
+            return false;
+        }
+        
+        bool match = difference.mismatchedFraction <= m_options.goldenMaxMismatch;
+        std::cout << "Golden comparison " << (match ? "passed" : "FAILED") << ": "
+                  << difference.mismatchedFraction * 100.0 << "% of pixels differ by more than "
+                  << m_options.goldenTolerance << " (max " << difference.maxChannelError
+                  << ", mean " << difference.meanChannelError << ")" << std::endl;
+        success = success && match;
+    }
+    
+    return success;
+}
+
+void Application::Update(float deltaTime) {
+    const WorldSnapshot& world = m_simulation->GetSnapshot();
     
     // Update camera
-    m_camera->Update(*m_aircraft, deltaTime);
+    m_camera->Update(world.player, deltaTime);
+    
+    // Sensors are fixed to the airframe, looking straight down
+    SensorViews* sensors = m_renderer->GetSensorViews();
+    glm::vec3 aircraftForward = world.player.orientation * glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 aircraftUp = world.player.orientation * glm::vec3(0.0f, 1.0f, 0.0f);
+    for (int view = 0; view < sensors->GetViewCount(); ++view) {
+        sensors->GetCamera(view).SetPose(world.player.position - aircraftUp * SENSOR_MOUNT_OFFSET,
+                                         -aircraftUp, aircraftForward);
+    }
     
     // Update HUD
-    m_hud->Update(m_aircraft->GetState(), deltaTime);
+    m_hud->SetValues(world.hud);
 }
 
 void Application::Render() {
     m_renderer->BeginFrame();
-    m_renderer->RenderScene(*m_camera, *m_aircraft);
-    m_hud->Render(*m_camera, m_aircraft->GetState());
+    const WorldSnapshot& world = m_simulation->GetSnapshot();
+    m_renderer->RenderScene(*m_camera, world);
+    
+    GpuProfiler* profiler = m_renderer->GetGpuProfiler();
+    profiler->BeginScope("HUD");
+    m_hud->Render(*m_camera, world.player);
+    if (m_hud->IsPerformanceOverlayVisible()) {
+        m_hud->RenderPerformanceOverlay(m_renderer->GetFPS(), profiler->GetStats(),
+                                        m_renderer->GetStateCounters());
+    }
+    profiler->EndScope();
+    
+    if (m_frameCapture->IsActive()) {
+        profiler->BeginScope("Capture");
+        m_frameCapture->CaptureFrame(m_offscreenTarget ? m_offscreenTarget->GetFramebuffer() : 0);
+        profiler->EndScope();
+    }
+    
     m_renderer->EndFrame();
 }
 
 void Application::HandleInput(float deltaTime) {
+    // Controls are sampled every frame and consumed by the next simulation tick
+    SimulationThread::Command controls;
+    controls.type = SimulationThread::Command::Type::Controls;
+    controls.controls = m_inputManager->GetControlInputs();
+    m_simulation->PushCommand(controls);
+    
     // Handle application-level input
     if (m_inputManager->IsKeyPressed(GLFW_KEY_ESCAPE)) {
         m_running = false;
@@ -157,11 +416,164 @@ void Application::HandleInput(float deltaTime) {
     // Handle aircraft reset
     static bool rKeyPressed = false;
     if (m_inputManager->IsKeyPressed(GLFW_KEY_R) && !rKeyPressed) {
-        m_aircraft->Reset();
+        SimulationThread::Command reset;
+        reset.type = SimulationThread::Command::Type::ResetAircraft;
+        m_simulation->PushCommand(reset);
         rKeyPressed = true;
     } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_R)) {
         rKeyPressed = false;
     }
+    
+    // Toggle heavy traffic for instancing stress tests
+    static bool tKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_T) && !tKeyPressed) {
+        SimulationThread::Command traffic;
+        traffic.type = SimulationThread::Command::Type::SetTrafficCount;
+        traffic.trafficCount = m_simulation->GetSnapshot().traffic.size() == static_cast<size_t>(HEAVY_TRAFFIC_COUNT)
+            ? TRAFFIC_COUNT : HEAVY_TRAFFIC_COUNT;
+        m_simulation->PushCommand(traffic);
+        tKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_T)) {
+        tKeyPressed = false;
+    }
+    
+    // Toggle the performance overlay
+    static bool pKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_P) && !pKeyPressed) {
+        m_hud->TogglePerformanceOverlay();
+        pKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_P)) {
+        pKeyPressed = false;
+    }
+    
+    // Dump GPU pass timings for regression tracking
+    static bool lKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_L) && !lKeyPressed) {
+        if (m_renderer->GetGpuProfiler()->WriteReport(GPU_PROFILE_PATH)) {
+            std::cout << "GPU profile written to " << GPU_PROFILE_PATH << std::endl;
+        }
+        if (m_framePacer && m_framePacer->WriteReport(FRAME_PACING_PATH)) {
+            std::cout << "Frame pacing metrics written to " << FRAME_PACING_PATH << std::endl;
+        }
+        m_renderer->GetRenderGraph()->WriteReport(std::cout, m_renderer->GetGpuProfiler());
+        m_renderer->WriteLodReport(std::cout);
+        if (m_renderer->GetClouds()) {
+            m_renderer->GetClouds()->WriteReport(std::cout);
+        }
+        lKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_L)) {
+        lKeyPressed = false;
+    }
+    
+    // Toggle dynamic resolution scaling
+    static bool uKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_U) && !uKeyPressed) {
+        m_renderer->SetDynamicResolution(!m_renderer->IsDynamicResolutionEnabled());
+        std::cout << "Dynamic resolution " << (m_renderer->IsDynamicResolutionEnabled() ? "on" : "off") << std::endl;
+        uKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_U)) {
+        uKeyPressed = false;
+    }
+    
+    // Cycle the cloud quality preset: off, low, medium, high, ultra
+    static bool kKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_K) && !kKeyPressed) {
+        if (VolumetricClouds* clouds = m_renderer->GetClouds()) {
+            clouds->CycleQuality();
+            std::cout << "Cloud quality: " << VolumetricClouds::GetQualityName(clouds->GetQuality()) << std::endl;
+        }
+        kKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_K)) {
+        kKeyPressed = false;
+    }
+    
+    // Cycle frame pacing: off, vsync, adaptive vsync, limiter
+    static bool mKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_M) && !mKeyPressed) {
+        if (m_framePacer) {
+            m_framePacer->CycleMode();
+            std::cout << "Frame pacing: " << FramePacer::GetModeName(m_framePacer->GetMode()) << std::endl;
+        }
+        mKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_M)) {
+        mKeyPressed = false;
+    }
+    
+    // Start or stop recording to capture.y4m
+    static bool vKeyPressed = false;
+    if (m_inputManager->IsKeyPressed(GLFW_KEY_V) && !vKeyPressed) {
+        if (m_frameCapture->IsActive()) {
+            m_frameCapture->Stop();
+        } else {
+            StartCapture(CAPTURE_PATH);
+        }
+        vKeyPressed = true;
+    } else if (!m_inputManager->IsKeyPressed(GLFW_KEY_V)) {
+        vKeyPressed = false;
+    }
+}
+
+bool Application::InitializeSensors() {
+    SensorViews* sensors = m_renderer->GetSensorViews();
+    bool keepFrames = !m_options.sensorOutputPrefix.empty();
+    m_sensorFrames.resize(keepFrames ? m_options.sensors.size() : 0);
+    
+    for (size_t i = 0; i < m_options.sensors.size(); ++i) {
+        const SensorOptions& sensor = m_options.sensors[i];
+        PixelReadbackRing::Consumer consumer;
+        if (keepFrames) {
+            Image& frame = m_sensorFrames[i];
+            frame.width = sensor.width;
+            frame.height = sensor.height;
+            frame.pixels.resize(static_cast<size_t>(sensor.width) * sensor.height * 4);
+            
+            // Readback rows are bottom-up; images are stored top row first
+            consumer = [&frame](const uint8_t* pixels) {
+                size_t rowSize = static_cast<size_t>(frame.width) * 4;
+                for (int y = 0; y < frame.height; ++y) {
+                    std::memcpy(frame.pixels.data() + (frame.height - 1 - y) * rowSize, pixels + y * rowSize, rowSize);
+                }
+            };
+        }
+        
+        if (sensors->AddView(sensor.width, sensor.height, sensor.rateHz, consumer) < 0) {
+            std::cerr << "Failed to create sensor view " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Application::FinishSensors() {
+    SensorViews* sensors = m_renderer->GetSensorViews();
+    sensors->Flush();
+    
+    for (int view = 0; view < sensors->GetViewCount(); ++view) {
+        const SensorViews::Stats& stats = sensors->GetStats(view);
+        std::cout << "Sensor " << view << " (" << sensors->GetWidth(view) << "x" << sensors->GetHeight(view)
+                  << "): " << stats.framesRendered << " frames rendered, " << stats.framesReadBack
+                  << " read back, " << stats.readbacksDropped << " dropped" << std::endl;
+        
+        if (view < static_cast<int>(m_sensorFrames.size()) && stats.framesReadBack > 0) {
+            std::string path = m_options.sensorOutputPrefix + std::to_string(view) + ".ppm";
+            if (ImageIO::WritePPM(path, m_sensorFrames[view])) {
+                std::cout << "Wrote " << path << std::endl;
+            }
+        }
+    }
+}
+
+bool Application::StartCapture(const std::string& path) {
+    int width = 0;
+    int height = 0;
+    if (m_offscreenTarget) {
+        width = m_offscreenTarget->GetWidth();
+        height = m_offscreenTarget->GetHeight();
+    } else {
+        m_window->GetFramebufferSize(width, height);
+    }
+    return m_frameCapture->Start(path, width, height, m_options.captureFramesPerSecond,
+                                 FrameCapture::FormatFromPath(path));
 }
 
 void Application::Shutdown() {
@@ -169,14 +581,25 @@ void Application::Shutdown() {
         return;
     }
     
+    m_simulation.reset();
+    
+    // Finish the recording while the GL context is still alive
+    m_frameCapture.reset();
     m_hud.reset();
     m_inputManager.reset();
-    m_aircraft.reset();
+    m_framePacer.reset();
     m_renderer.reset();
     m_camera.reset();
+    Shader::SetProgramCache(nullptr);
+    m_shaderCache.reset();
+    m_offscreenTarget.reset();
     m_window.reset();
     
-    glfwTerminate();
+    if (m_headlessContext) {
+        m_headlessContext.reset();
+    } else {
+        glfwTerminate();
+    }
     m_initialized = false;
 }
 
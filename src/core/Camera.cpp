@@ -32,12 +32,11 @@ Camera::Camera(float fov, float aspect, float nearPlane, float farPlane)
     UpdateCameraVectors();
 }
 
-void Camera::Update(const Aircraft& aircraft, float deltaTime) {
-    const AircraftState& state = aircraft.GetState();
-    glm::vec3 aircraftForward = aircraft.GetForward();
-    glm::vec3 aircraftUp = aircraft.GetUp();
+void Camera::Update(const AircraftState& aircraft, float deltaTime) {
+    glm::vec3 aircraftForward = aircraft.orientation * glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 aircraftUp = aircraft.orientation * glm::vec3(0.0f, 1.0f, 0.0f);
     
-    Update(state.position, aircraftForward, aircraftUp, deltaTime);
+    Update(aircraft.position, aircraftForward, aircraftUp, deltaTime);
 }
 
 void Camera::Update(const glm::vec3& aircraftPosition, const glm::vec3& aircraftForward, 
@@ -87,6 +86,13 @@ void Camera::SetAspectRatio(float aspect) {
     m_aspect = aspect;
 }
 
+void Camera::SetPose(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up) {
+    m_position = position;
+    m_front = glm::normalize(front);
+    m_right = glm::normalize(glm::cross(m_front, up));
+    m_up = glm::cross(m_right, m_front);
+}
+
 void Camera::ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch) {
     xoffset *= m_mouseSensitivity;
     yoffset *= m_mouseSensitivity;
@@ -0,0 +1,247 @@
+#include "core/FramePacer.h"
+#include "core/Window.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace FlightSim {
+
+// Sleeps overshoot by up to a scheduler quantum; the rest is spun
+static constexpr std::chrono::microseconds SPIN_THRESHOLD(1500);
+
+// The previous frame's GPU work normally finishes well within this
+static constexpr uint64_t MAX_FENCE_WAIT_NS = 100000000; // 100 ms
+
+static float Percentile(std::vector<float>& values, float fraction) {
+    if (values.empty()) return 0.0f;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5f);
+    return values[std::min(index, values.size() - 1)];
+}
+
+void FramePacer::History::Add(float sample) {
+    if (samples.size() < HISTORY_LENGTH) {
+        samples.resize(HISTORY_LENGTH);
+    }
+    samples[next] = sample;
+    next = (next + 1) % HISTORY_LENGTH;
+    count = std::min<size_t>(count + 1, HISTORY_LENGTH);
+}
+
+FramePacer::FramePacer()
+    : m_window(nullptr)
+    , m_mode(PacingMode::VSync)
+    , m_targetFps(DEFAULT_TARGET_FPS)
+    , m_lowPower(false)
+    , m_minimized(false)
+    , m_hasPresented(false)
+    , m_hasPendingInput(false)
+    , m_frameFence(nullptr) {
+}
+
+FramePacer::~FramePacer() {
+    Shutdown();
+}
+
+void FramePacer::Initialize(Window* window, PacingMode mode, float targetFps) {
+    m_window = window;
+    m_mode = mode;
+    SetTargetFps(targetFps);
+    m_nextDeadline = Clock::now();
+    ApplySwapInterval();
+}
+
+void FramePacer::Shutdown() {
+    if (m_frameFence) {
+        glDeleteSync(static_cast<GLsync>(m_frameFence));
+        m_frameFence = nullptr;
+    }
+    m_window = nullptr;
+}
+
+void FramePacer::SetMode(PacingMode mode) {
+    m_mode = mode;
+    m_nextDeadline = Clock::now();
+    ApplySwapInterval();
+}
+
+void FramePacer::CycleMode() {
+    switch (m_mode) {
+        case PacingMode::Unlimited:     SetMode(PacingMode::VSync); break;
+        case PacingMode::VSync:         SetMode(PacingMode::AdaptiveVSync); break;
+        case PacingMode::AdaptiveVSync: SetMode(PacingMode::Limiter); break;
+        case PacingMode::Limiter:       SetMode(PacingMode::Unlimited); break;
+    }
+}
+
+void FramePacer::SetTargetFps(float fps) {
+    m_targetFps = std::max(fps, 1.0f);
+}
+
+const char* FramePacer::GetModeName(PacingMode mode) {
+    switch (mode) {
+        case PacingMode::Unlimited:     return "off";
+        case PacingMode::VSync:         return "vsync";
+        case PacingMode::AdaptiveVSync: return "adaptive";
+        case PacingMode::Limiter:       return "limiter";
+    }
+    return "unknown";
+}
+
+bool FramePacer::ParseMode(const std::string& name, PacingMode& mode) {
+    for (PacingMode candidate : {PacingMode::Unlimited, PacingMode::VSync, PacingMode::AdaptiveVSync,
+                                 PacingMode::Limiter}) {
+        if (name == GetModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FramePacer::ApplySwapInterval() {
+    if (!m_window) return;
+    
+    // Low power is paced by the limiter alone
+    if (m_lowPower || m_mode == PacingMode::Unlimited || m_mode == PacingMode::Limiter) {
+        m_window->SetVSync(false);
+    } else if (m_mode == PacingMode::AdaptiveVSync) {
+        if (!m_window->SetAdaptiveVSync()) {
+            std::cout << "Adaptive vsync unsupported, using vsync" << std::endl;
+        }
+    } else {
+        m_window->SetVSync(true);
+    }
+}
+
+void FramePacer::WaitForNextFrame() {
+    if (!m_window) return;
+    
+    bool lowPower = !m_window->IsFocused() || m_window->IsMinimized();
+    m_minimized = m_window->IsMinimized();
+    if (lowPower != m_lowPower) {
+        m_lowPower = lowPower;
+        m_nextDeadline = Clock::now();
+        m_hasPresented = false; // The gap is not a frame time
+        ApplySwapInterval();
+    }
+    
+    // CPU at most one frame ahead of the GPU
+    if (m_frameFence) {
+        GLsync fence = static_cast<GLsync>(m_frameFence);
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, MAX_FENCE_WAIT_NS);
+        glDeleteSync(fence);
+        m_frameFence = nullptr;
+    }
+    
+    float fps = m_lowPower ? LOW_POWER_FPS : (m_mode == PacingMode::Limiter ? m_targetFps : 0.0f);
+    if (fps <= 0.0f) return;
+    
+    // Deadlines advance by whole periods so the rate does not drift; after
+    // a long frame the schedule restarts instead of rushing to catch up
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    Clock::time_point now = Clock::now();
+    if (now - m_nextDeadline > period) {
+        m_nextDeadline = now;
+    }
+    WaitUntil(m_nextDeadline);
+    m_nextDeadline += period;
+}
+
+void FramePacer::WaitUntil(Clock::time_point deadline) {
+    // Sleep in the event wait so input is dispatched as it arrives
+    for (Clock::time_point now = Clock::now(); deadline - now > SPIN_THRESHOLD; now = Clock::now()) {
+        std::chrono::duration<double> sleep = deadline - now - SPIN_THRESHOLD;
+        m_window->WaitEvents(sleep.count());
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::OnInputEvent() {
+    if (!m_hasPendingInput) {
+        m_pendingInput = Clock::now();
+        m_hasPendingInput = true;
+    }
+}
+
+void FramePacer::Present() {
+    if (!m_window) return;
+    
+    m_window->SwapBuffers();
+    Clock::time_point now = Clock::now();
+    m_frameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    // Metrics describe interactive frames only
+    if (!m_lowPower) {
+        if (m_hasPresented) {
+            m_frameTimes.Add(std::chrono::duration<float, std::milli>(now - m_lastPresent).count());
+        }
+        if (m_hasPendingInput) {
+            m_latencies.Add(std::chrono::duration<float, std::milli>(now - m_pendingInput).count());
+        }
+    }
+    m_hasPendingInput = false;
+    m_lastPresent = now;
+    m_hasPresented = true;
+}
+
+FramePacer::Metrics FramePacer::GetMetrics() const {
+    Metrics metrics;
+    std::vector<float> sorted;
+    
+    if (m_frameTimes.count > 0) {
+        sorted.assign(m_frameTimes.samples.begin(), m_frameTimes.samples.begin() + m_frameTimes.count);
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        for (float sample : sorted) {
+            sum += sample;
+            sumSquares += static_cast<double>(sample) * sample;
+        }
+        double mean = sum / sorted.size();
+        metrics.frameSamples = static_cast<int>(sorted.size());
+        metrics.averageFrameMs = static_cast<float>(mean);
+        metrics.jitterMs = static_cast<float>(std::sqrt(std::max(sumSquares / sorted.size() - mean * mean, 0.0)));
+        metrics.p99FrameMs = Percentile(sorted, 0.99f);
+    }
+    
+    if (m_latencies.count > 0) {
+        sorted.assign(m_latencies.samples.begin(), m_latencies.samples.begin() + m_latencies.count);
+        double sum = 0.0;
+        for (float sample : sorted) {
+            sum += sample;
+        }
+        metrics.latencySamples = static_cast<int>(sorted.size());
+        metrics.averageLatencyMs = static_cast<float>(sum / sorted.size());
+        metrics.p99LatencyMs = Percentile(sorted, 0.99f);
+    }
+    
+    return metrics;
+}
+
+bool FramePacer::WriteReport(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write frame pacing report: " << path << std::endl;
+        return false;
+    }
+    
+    Metrics metrics = GetMetrics();
+    file << "metric,value\n";
+    file << "mode," << GetModeName(m_mode) << '\n';
+    file << "target_fps," << m_targetFps << '\n';
+    file << "frame_samples," << metrics.frameSamples << '\n';
+    file << "frame_avg_ms," << metrics.averageFrameMs << '\n';
+    file << "frame_jitter_ms," << metrics.jitterMs << '\n';
+    file << "frame_p99_ms," << metrics.p99FrameMs << '\n';
+    file << "latency_samples," << metrics.latencySamples << '\n';
+    file << "latency_avg_ms," << metrics.averageLatencyMs << '\n';
+    file << "latency_p99_ms," << metrics.p99LatencyMs << '\n';
+    return static_cast<bool>(file);
+}
+
+} // namespace FlightSim
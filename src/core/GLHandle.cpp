@@ -0,0 +1,29 @@
+#include "core/GLHandle.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+
+namespace FlightSim {
+
+unsigned int GLBufferTraits::Create() {
+    GLuint id = 0;
+    glGenBuffers(1, &id);
+    return id;
+}
+
+void GLBufferTraits::Destroy(unsigned int id) {
+    glDeleteBuffers(1, &id);
+}
+
+unsigned int GLVertexArrayTraits::Create() {
+    GLuint id = 0;
+    glGenVertexArrays(1, &id);
+    return id;
+}
+
+void GLVertexArrayTraits::Destroy(unsigned int id) {
+    // GL may recycle the name; the cache must not think it is still bound
+    GLStateCache::Get().OnVertexArrayDeleted(id);
+    glDeleteVertexArrays(1, &id);
+}
+
+} // namespace FlightSim
@@ -0,0 +1,108 @@
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+
+namespace FlightSim {
+
+GLStateCache& GLStateCache::Get() {
+    static GLStateCache instance;
+    return instance;
+}
+
+GLStateCache::GLStateCache() {
+    Invalidate();
+}
+
+void GLStateCache::UseProgram(unsigned int program) {
+    if (m_valid && program == m_program) {
+        m_counters.programBindsSkipped++;
+        return;
+    }
+    glUseProgram(program);
+    m_program = program;
+    m_valid = true;
+    m_counters.programBinds++;
+}
+
+void GLStateCache::BindVertexArray(unsigned int vao) {
+    if (vao == m_vertexArray) {
+        m_counters.vertexArrayBindsSkipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    m_vertexArray = vao;
+    m_counters.vertexArrayBinds++;
+}
+
+void GLStateCache::BindTexture(unsigned int unit, unsigned int target, unsigned int texture) {
+    if (unit < MAX_TEXTURE_UNITS && m_textures[unit] == texture) {
+        m_counters.textureBindsSkipped++;
+        return;
+    }
+    if (unit != m_activeTextureUnit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeTextureUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if (unit < MAX_TEXTURE_UNITS) {
+        m_textures[unit] = texture;
+    }
+    m_counters.textureBinds++;
+}
+
+void GLStateCache::SetDepthMask(bool enabled) {
+    int value = enabled ? 1 : 0;
+    if (value == m_depthMask) {
+        m_counters.depthStateChangesSkipped++;
+        return;
+    }
+    glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    m_depthMask = value;
+    m_counters.depthStateChanges++;
+}
+
+void GLStateCache::SetDepthFunc(unsigned int func) {
+    if (func == m_depthFunc) {
+        m_counters.depthStateChangesSkipped++;
+        return;
+    }
+    glDepthFunc(func);
+    m_depthFunc = func;
+    m_counters.depthStateChanges++;
+}
+
+void GLStateCache::OnProgramDeleted(unsigned int program) {
+    if (m_valid && m_program == program) {
+        m_valid = false;
+    }
+}
+
+void GLStateCache::OnVertexArrayDeleted(unsigned int vao) {
+    // Deleting the bound VAO reverts the binding to zero
+    if (m_vertexArray == vao) {
+        m_vertexArray = 0;
+    }
+}
+
+void GLStateCache::OnTextureDeleted(unsigned int texture) {
+    // Deleting a bound texture reverts every unit it was bound to to zero
+    for (unsigned int& bound : m_textures) {
+        if (bound == texture) {
+            bound = 0;
+        }
+    }
+}
+
+void GLStateCache::Invalidate() {
+    // ~0u is never a valid object name, so every first bind goes through
+    m_program = 0;
+    m_valid = false;
+    m_vertexArray = ~0u;
+    m_activeTextureUnit = ~0u;
+    for (unsigned int& texture : m_textures) {
+        texture = ~0u;
+    }
+    m_depthMask = -1;
+    m_depthFunc = 0;
+}
+
+} // namespace FlightSim
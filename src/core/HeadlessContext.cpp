@@ -0,0 +1,170 @@
+#include "core/HeadlessContext.h"
+#include <iostream>
+
+#ifdef FLIGHTSIM_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+namespace FlightSim {
+
+#ifdef FLIGHTSIM_HEADLESS
+
+static bool HasExtension(const char* extensions, const char* name) {
+    if (!extensions) return false;
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        bool startsToken = p == extensions || p[-1] == ' ';
+        bool endsToken = p[length] == ' ' || p[length] == '\0';
+        if (startsToken && endsToken) return true;
+    }
+    return false;
+}
+
+static void* LoadProc(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+HeadlessContext::HeadlessContext()
+    : m_display(EGL_NO_DISPLAY)
+    , m_context(EGL_NO_CONTEXT)
+    , m_surface(EGL_NO_SURFACE) {
+}
+
+HeadlessContext::~HeadlessContext() {
+    Shutdown();
+}
+
+bool HeadlessContext::Initialize() {
+    // A surfaceless platform display needs no X11/Wayland connection at all
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay && HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "Failed to initialize EGL display (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+    m_display = display;
+    
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL implementation does not support desktop OpenGL" << std::endl;
+        Shutdown();
+        return false;
+    }
+    
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "No suitable EGL config for offscreen rendering" << std::endl;
+        Shutdown();
+        return false;
+    }
+    
+    // Same version and profile as the windowed context
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    m_context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (m_context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create OpenGL 3.3 core context through EGL" << std::endl;
+        Shutdown();
+        return false;
+    }
+    
+    // Rendering goes to an FBO, so a surface is only needed when the
+    // implementation cannot make a context current without one
+    if (!HasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        m_surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        if (m_surface == EGL_NO_SURFACE) {
+            std::cerr << "Failed to create EGL pbuffer surface" << std::endl;
+            Shutdown();
+            return false;
+        }
+    }
+    
+    if (!eglMakeCurrent(display, m_surface, m_surface, m_context)) {
+        std::cerr << "Failed to make the EGL context current" << std::endl;
+        Shutdown();
+        return false;
+    }
+    
+    std::cout << "Headless EGL " << major << "." << minor << " context ("
+              << eglQueryString(display, EGL_VENDOR) << ")" << std::endl;
+    return true;
+}
+
+void HeadlessContext::Shutdown() {
+    if (m_display == EGL_NO_DISPLAY) return;
+    
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface != EGL_NO_SURFACE) {
+        eglDestroySurface(m_display, m_surface);
+        m_surface = EGL_NO_SURFACE;
+    }
+    if (m_context != EGL_NO_CONTEXT) {
+        eglDestroyContext(m_display, m_context);
+        m_context = EGL_NO_CONTEXT;
+    }
+    eglTerminate(m_display);
+    m_display = EGL_NO_DISPLAY;
+}
+
+HeadlessContext::ProcAddress HeadlessContext::GetProcAddressFunction() {
+    return &LoadProc;
+}
+
+#else
+
+HeadlessContext::HeadlessContext()
+    : m_display(nullptr)
+    , m_context(nullptr)
+    , m_surface(nullptr) {
+}
+
+HeadlessContext::~HeadlessContext() {
+}
+
+bool HeadlessContext::Initialize() {
+    std::cerr << "Headless rendering is not available: rebuild with -DFLIGHTSIM_HEADLESS=ON" << std::endl;
+    return false;
+}
+
+void HeadlessContext::Shutdown() {
+}
+
+HeadlessContext::ProcAddress HeadlessContext::GetProcAddressFunction() {
+    return nullptr;
+}
+
+#endif
+
+} // namespace FlightSim
@@ -0,0 +1,118 @@
+#include "core/ImageIO.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace FlightSim {
+namespace ImageIO {
+
+bool WritePPM(const std::string& path, const Image& image) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open image for writing: " << path << std::endl;
+        return false;
+    }
+    
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+    
+    std::vector<uint8_t> row(static_cast<size_t>(image.width) * 3);
+    for (int y = 0; y < image.height; ++y) {
+        const uint8_t* src = image.pixels.data() + static_cast<size_t>(y) * image.width * 4;
+        for (int x = 0; x < image.width; ++x) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    
+    return static_cast<bool>(file);
+}
+
+// Next header token, skipping whitespace and # comments
+static bool ReadHeaderValue(std::istream& stream, int& value) {
+    while (stream) {
+        int c = stream.peek();
+        if (c == '#') {
+            std::string comment;
+            std::getline(stream, comment);
+        } else if (std::isspace(c)) {
+            stream.get();
+        } else {
+            break;
+        }
+    }
+    return static_cast<bool>(stream >> value);
+}
+
+bool ReadPPM(const std::string& path, Image& image) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open image: " << path << std::endl;
+        return false;
+    }
+    
+    std::string magic;
+    file >> magic;
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    if (magic != "P6" || !ReadHeaderValue(file, width) || !ReadHeaderValue(file, height) ||
+        !ReadHeaderValue(file, maxValue) || maxValue != 255 || width <= 0 || height <= 0) {
+        std::cerr << "Unsupported image (expected 8-bit binary PPM): " << path << std::endl;
+        return false;
+    }
+    file.get(); // Single whitespace before the pixel data
+    
+    std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+    file.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+    if (!file) {
+        std::cerr << "Truncated image: " << path << std::endl;
+        return false;
+    }
+    
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0, count = static_cast<size_t>(width) * height; i < count; ++i) {
+        image.pixels[i * 4 + 0] = rgb[i * 3 + 0];
+        image.pixels[i * 4 + 1] = rgb[i * 3 + 1];
+        image.pixels[i * 4 + 2] = rgb[i * 3 + 2];
+        image.pixels[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+bool Compare(const Image& a, const Image& b, int tolerance, ImageDifference& difference) {
+    difference = ImageDifference();
+    if (a.width != b.width || a.height != b.height) {
+        return false;
+    }
+    
+    // Alpha is ignored since PPM does not store it
+    const size_t pixelCount = static_cast<size_t>(a.width) * a.height;
+    size_t mismatched = 0;
+    double total = 0.0;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        bool mismatch = false;
+        for (int c = 0; c < 3; ++c) {
+            int error = std::abs(static_cast<int>(a.pixels[i * 4 + c]) - static_cast<int>(b.pixels[i * 4 + c]));
+            total += error;
+            if (error > difference.maxChannelError) {
+                difference.maxChannelError = error;
+            }
+            mismatch = mismatch || error > tolerance;
+        }
+        if (mismatch) {
+            mismatched++;
+        }
+    }
+    
+    difference.meanChannelError = pixelCount > 0 ? total / (pixelCount * 3) : 0.0;
+    difference.mismatchedFraction = pixelCount > 0 ? static_cast<double>(mismatched) / pixelCount : 0.0;
+    return true;
+}
+
+} // namespace ImageIO
+} // namespace FlightSim
@@ -0,0 +1,133 @@
+#include "core/LodMesh.h"
+#include "core/MeshOptimizer.h"
+#include "core/MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <iostream>
+#include <numeric>
+
+namespace FlightSim {
+
+// A level that removes less than this share of the previous level's
+// triangles is not worth its draw; the chain ends there
+static constexpr float MIN_REDUCTION = 0.25f;
+
+LodMesh::LodMesh()
+    : m_center(0.0f)
+    , m_radius(0.0f)
+    , m_pixelError(DEFAULT_PIXEL_ERROR)
+    , m_impostorPixels(DEFAULT_IMPOSTOR_PIXELS) {
+}
+
+bool LodMesh::Build(const Mesh& source, const VertexLayout& layout, bool buildMerged) {
+    m_levels.clear();
+    m_merged = Mesh();
+    if (!source.HasCpuData()) {
+        std::cerr << "LOD source mesh has no CPU data" << std::endl;
+        return false;
+    }
+    
+    const std::vector<Vertex>& vertices = source.GetVertices();
+    std::vector<unsigned int> sourceIndices = source.GetIndices();
+    if (sourceIndices.empty()) {
+        sourceIndices.resize(vertices.size() - vertices.size() % 3);
+        std::iota(sourceIndices.begin(), sourceIndices.end(), 0u);
+    }
+    
+    glm::vec3 boundsMin = vertices.front().position;
+    glm::vec3 boundsMax = boundsMin;
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    m_center = 0.5f * (boundsMin + boundsMax);
+    m_radius = 0.0f;
+    for (const Vertex& vertex : vertices) {
+        m_radius = std::max(m_radius, glm::length(vertex.position - m_center));
+    }
+    
+    // Every level is simplified from the source, not from the level before,
+    // so the recorded error is measured against the full-detail surface
+    size_t previousCount = sourceIndices.size();
+    std::vector<Vertex> mergedVertices;
+    std::vector<unsigned int> mergedIndices;
+    for (int level = 0; level < MAX_LEVELS; ++level) {
+        std::vector<Vertex> levelVertices = vertices;
+        std::vector<unsigned int> levelIndices = sourceIndices;
+        float error = 0.0f;
+        if (level > 0) {
+            size_t target = (sourceIndices.size() / 3 >> level) * 3;
+            error = MeshSimplifier::Simplify(levelVertices, levelIndices, target, FLT_MAX);
+            if (levelIndices.empty() ||
+                static_cast<float>(levelIndices.size()) > (1.0f - MIN_REDUCTION) * previousCount) {
+                break;
+            }
+            MeshOptimizer::Optimize(levelVertices, levelIndices);
+            error = std::max(error, m_levels.back().error);
+        }
+        previousCount = levelIndices.size();
+        
+        Level entry;
+        entry.merged.firstIndex = static_cast<uint32_t>(mergedIndices.size());
+        entry.merged.baseVertex = static_cast<int32_t>(mergedVertices.size());
+        entry.merged.indexCount = static_cast<uint32_t>(levelIndices.size());
+        if (buildMerged) {
+            mergedVertices.insert(mergedVertices.end(), levelVertices.begin(), levelVertices.end());
+            mergedIndices.insert(mergedIndices.end(), levelIndices.begin(), levelIndices.end());
+        }
+        
+        entry.mesh.SetVertices(std::move(levelVertices));
+        entry.mesh.SetIndices(std::move(levelIndices));
+        entry.mesh.SetVertexLayout(layout);
+        entry.mesh.Upload(true);
+        entry.error = error;
+        m_levels.push_back(std::move(entry));
+    }
+    
+    // Simplified levels only reference source vertices, so the merged
+    // bounds and quantization match level 0's
+    if (buildMerged) {
+        m_merged.SetVertices(std::move(mergedVertices));
+        m_merged.SetIndices(std::move(mergedIndices));
+        m_merged.SetVertexLayout(layout);
+        m_merged.Upload(true);
+    }
+    return true;
+}
+
+int LodMesh::PickLevel(float pixelsPerUnit, bool allowImpostor) const {
+    if (allowImpostor && 2.0f * m_radius * pixelsPerUnit < m_impostorPixels) {
+        return GetImpostorLevel();
+    }
+    
+    // Coarsest level whose error stays within the pixel budget
+    int level = 0;
+    while (level + 1 < GetLevelCount() && m_levels[level + 1].error * pixelsPerUnit <= m_pixelError) {
+        level++;
+    }
+    return level;
+}
+
+int LodMesh::SelectLevel(float pixelsPerUnit, int currentLevel, bool allowImpostor) const {
+    if (m_levels.empty()) return 0;
+    
+    if (currentLevel < 0) {
+        return PickLevel(pixelsPerUnit, allowImpostor);
+    }
+    
+    // The levels chosen at a slightly larger and a slightly smaller size
+    // bracket the band in which the current level may stay
+    int finer = PickLevel(pixelsPerUnit * (1.0f + HYSTERESIS), allowImpostor);
+    int coarser = PickLevel(pixelsPerUnit * (1.0f - HYSTERESIS), allowImpostor);
+    return std::clamp(currentLevel, finer, coarser);
+}
+
+size_t LodMesh::GetGpuMemorySize() const {
+    size_t bytes = 0;
+    for (const Level& level : m_levels) {
+        bytes += level.mesh.GetGpuMemorySize();
+    }
+    return bytes + m_merged.GetGpuMemorySize();
+}
+
+} // namespace FlightSim
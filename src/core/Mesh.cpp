@@ -1,92 +1,276 @@
 #include "core/Mesh.h"
+#include "core/GLStateCache.h"
+#include "core/MappedFile.h"
+#include "core/MeshFormat.h"
+#include "core/MeshOptimizer.h"
 #include <glad/glad.h>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <utility>
 
 namespace FlightSim {
 
-Mesh::Mesh() : m_VAO(0), m_VBO(0), m_EBO(0), m_uploaded(false) {
+// Index i of a 2- or 4-byte index buffer; the mapping has no alignment
+// guarantee for the element type
+static uint32_t ReadMeshIndex(const unsigned char* indexData, uint32_t indexSize, size_t i) {
+    if (indexSize == 2) {
+        uint16_t index;
+        std::memcpy(&index, indexData + i * 2, sizeof(index));
+        return index;
+    }
+    uint32_t index;
+    std::memcpy(&index, indexData + i * 4, sizeof(index));
+    return index;
 }
 
-Mesh::~Mesh() {
-    Cleanup();
+// Point the layout's attributes at the bound GL_ARRAY_BUFFER (bound VAO)
+static void ApplyVertexLayout(const VertexLayout& layout) {
+    for (const VertexAttribute& attribute : layout.GetAttributes()) {
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+                              attribute.normalized ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(layout.GetStride()),
+                              reinterpret_cast<void*>(static_cast<uintptr_t>(attribute.offset)));
+        glEnableVertexAttribArray(attribute.location);
+    }
 }
 
-void Mesh::SetVertices(const std::vector<Vertex>& vertices) {
-    m_vertices = vertices;
+Mesh::Mesh()
+    : m_vertexCount(0)
+    , m_indexCount(0)
+    , m_indexType(GL_UNSIGNED_INT)
+    , m_boundsMin(0.0f)
+    , m_boundsMax(0.0f)
+    , m_uploaded(false) {
+}
+
+Mesh::~Mesh() = default;
+
+Mesh::Mesh(Mesh&& other) noexcept
+    : m_vertices(std::move(other.m_vertices))
+    , m_indices(std::move(other.m_indices))
+    , m_vertexCount(std::exchange(other.m_vertexCount, 0))
+    , m_indexCount(std::exchange(other.m_indexCount, 0))
+    , m_indexType(other.m_indexType)
+    , m_layout(std::move(other.m_layout))
+    , m_decode(other.m_decode)
+    , m_boundsMin(other.m_boundsMin)
+    , m_boundsMax(other.m_boundsMax)
+    , m_VAO(std::move(other.m_VAO))
+    , m_VBO(std::move(other.m_VBO))
+    , m_EBO(std::move(other.m_EBO))
+    , m_uploaded(std::exchange(other.m_uploaded, false)) {
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+    if (this != &other) {
+        m_vertices = std::move(other.m_vertices);
+        m_indices = std::move(other.m_indices);
+        m_vertexCount = std::exchange(other.m_vertexCount, 0);
+        m_indexCount = std::exchange(other.m_indexCount, 0);
+        m_indexType = other.m_indexType;
+        m_layout = std::move(other.m_layout);
+        m_decode = other.m_decode;
+        m_boundsMin = other.m_boundsMin;
+        m_boundsMax = other.m_boundsMax;
+        m_VAO = std::move(other.m_VAO);
+        m_VBO = std::move(other.m_VBO);
+        m_EBO = std::move(other.m_EBO);
+        m_uploaded = std::exchange(other.m_uploaded, false);
+    }
+    return *this;
+}
+
+void Mesh::SetVertices(std::vector<Vertex>&& vertices) {
+    m_vertices = std::move(vertices);
     m_uploaded = false;
 }
 
-void Mesh::SetIndices(const std::vector<unsigned int>& indices) {
-    m_indices = indices;
+void Mesh::SetIndices(std::vector<unsigned int>&& indices) {
+    m_indices = std::move(indices);
     m_uploaded = false;
 }
 
-void Mesh::Upload() {
+void Mesh::ReleaseCpuData() {
+    // swap rather than clear so the capacity is returned too
+    std::vector<Vertex>().swap(m_vertices);
+    std::vector<unsigned int>().swap(m_indices);
+}
+
+void Mesh::Upload(bool releaseCpuData) {
     if (m_vertices.empty()) return;
     
-    // Generate buffers
-    glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
-    if (!m_indices.empty()) {
-        glGenBuffers(1, &m_EBO);
+    m_boundsMin = m_vertices.front().position;
+    m_boundsMax = m_boundsMin;
+    for (const Vertex& vertex : m_vertices) {
+        m_boundsMin = glm::min(m_boundsMin, vertex.position);
+        m_boundsMax = glm::max(m_boundsMax, vertex.position);
+    }
+    m_decode = m_layout.GetDecode(m_boundsMin, m_boundsMax);
+    
+    // Half the index bandwidth whenever every vertex fits in 16 bits
+    std::vector<uint16_t> shortIndices;
+    const void* indexData = m_indices.data();
+    unsigned int indexType = GL_UNSIGNED_INT;
+    if (!m_indices.empty() && m_vertices.size() <= 65536) {
+        shortIndices.assign(m_indices.begin(), m_indices.end());
+        indexData = shortIndices.data();
+        indexType = GL_UNSIGNED_SHORT;
     }
     
-    glBindVertexArray(m_VAO);
+    if (m_layout.IsStandard()) {
+        UploadBuffers(m_vertices.data(), m_vertices.size(), indexData, m_indices.size(), indexType);
+    } else {
+        std::vector<uint8_t> encoded;
+        m_layout.Encode(m_vertices.data(), m_vertices.size(), m_boundsMin, m_boundsMax, encoded);
+        UploadBuffers(encoded.data(), m_vertices.size(), indexData, m_indices.size(), indexType);
+    }
     
-    // Upload vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), &m_vertices[0], GL_STATIC_DRAW);
+    if (releaseCpuData) {
+        ReleaseCpuData();
+    }
+}
+
+bool Mesh::LoadFromFile(const std::string& path, bool keepCpuData) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
     
-    // Upload index data
-    if (!m_indices.empty()) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
+    // Validate the header and that every range lies inside the file
+    const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(file.GetData());
+    uint64_t size = file.GetSize();
+    if (size < sizeof(MeshFileHeader) || header->magic != MESH_FILE_MAGIC) {
+        std::cerr << "Not a mesh file: " << path << std::endl;
+        return false;
+    }
+    
+    VertexLayout layout;
+    uint32_t indexSize = MeshFileIndexSize(header->format);
+    if (header->version < 1 || header->version > MESH_FILE_VERSION ||
+        !VertexLayout::FromCode(MeshFileLayoutCode(header->format), layout) ||
+        header->vertexStride != layout.GetStride() || (indexSize != 2 && indexSize != 4)) {
+        std::cerr << "Unsupported mesh file version " << header->version << ": " << path << std::endl;
+        return false;
+    }
+    
+    uint64_t vertexBytes = static_cast<uint64_t>(header->vertexCount) * header->vertexStride;
+    uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * indexSize;
+    if (header->vertexCount == 0 ||
+        header->vertexOffset % MESH_FILE_ALIGNMENT != 0 || header->indexOffset % MESH_FILE_ALIGNMENT != 0 ||
+        header->vertexOffset > size || vertexBytes > size - header->vertexOffset ||
+        header->indexOffset > size || indexBytes > size - header->indexOffset) {
+        std::cerr << "Corrupt mesh file: " << path << std::endl;
+        return false;
     }
     
-    // Setup vertex attributes
-    // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
+    // An index past the vertices would fetch out of bounds on the GPU and
+    // in CPU-side users of the indices
+    const unsigned char* data = file.GetData();
+    const unsigned char* indexData = data + header->indexOffset;
+    for (uint32_t i = 0; i < header->indexCount; ++i) {
+        if (ReadMeshIndex(indexData, indexSize, i) >= header->vertexCount) {
+            std::cerr << "Corrupt mesh file: index " << i << " out of range: " << path << std::endl;
+            return false;
+        }
+    }
     
-    // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
+    // Replacing a previous mesh releases its GL objects first
+    Cleanup();
+    ReleaseCpuData();
+    
+    m_layout = layout;
+    m_boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+    m_boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+    m_decode = m_layout.GetDecode(m_boundsMin, m_boundsMax);
+    
+    // The file is already in GPU layout. glBufferData copies out of the
+    // mapping; the file is unmapped on return.
+    UploadBuffers(data + header->vertexOffset, header->vertexCount, data + header->indexOffset, header->indexCount,
+                  indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+    
+    if (keepCpuData) {
+        m_layout.Decode(data + header->vertexOffset, header->vertexCount, m_boundsMin, m_boundsMax, m_vertices);
+        m_indices.resize(header->indexCount);
+        for (size_t i = 0; i < m_indices.size(); ++i) {
+            m_indices[i] = ReadMeshIndex(indexData, indexSize, i);
+        }
+    }
+    return true;
+}
+
+void Mesh::UploadBuffers(const void* vertexData, size_t vertexCount, const void* indexData, size_t indexCount,
+                         unsigned int indexType) {
+    m_vertexCount = vertexCount;
+    m_indexCount = indexCount;
+    m_indexType = indexType;
+    
+    // Generate buffers; assigning over a previous upload deletes its objects
+    m_VAO = GLVertexArray::Create();
+    m_VBO = GLBuffer::Create();
+    m_EBO = indexCount > 0 ? GLBuffer::Create() : GLBuffer();
+    
+    GLStateCache::Get().BindVertexArray(m_VAO.Get());
     
-    // Texture coordinates
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-    glEnableVertexAttribArray(2);
+    // Upload vertex data
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO.Get());
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * m_layout.GetStride(), vertexData, GL_STATIC_DRAW);
     
-    glBindVertexArray(0);
+    // Upload index data
+    if (indexCount > 0) {
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO.Get());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indexData, GL_STATIC_DRAW);
+    }
+    
+    // Setup vertex attributes from the layout descriptor
+    ApplyVertexLayout(m_layout);
+    
+    GLStateCache::Get().BindVertexArray(0);
     m_uploaded = true;
 }
 
+size_t Mesh::GetGpuMemorySize() const {
+    size_t indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    return m_vertexCount * m_layout.GetStride() + m_indexCount * indexSize;
+}
+
 void Mesh::Render() const {
     if (!m_uploaded) return;
     
-    glBindVertexArray(m_VAO);
+    // The VAO stays bound; the state cache skips the bind for the next
+    // draw of the same mesh
+    GLStateCache& state = GLStateCache::Get();
+    state.BindVertexArray(m_VAO.Get());
     
-    if (!m_indices.empty()) {
-        glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+    if (m_indexCount > 0) {
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indexCount), m_indexType, 0);
     } else {
-        glDrawArrays(GL_TRIANGLES, 0, m_vertices.size());
+        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(m_vertexCount));
     }
-    
-    glBindVertexArray(0);
+    state.CountDraw();
 }
 
 void Mesh::RenderInstanced(int instanceCount) const {
     if (!m_uploaded || instanceCount <= 0) return;
     
-    glBindVertexArray(m_VAO);
+    GLStateCache& state = GLStateCache::Get();
+    state.BindVertexArray(m_VAO.Get());
     
-    if (!m_indices.empty()) {
-        glDrawElementsInstanced(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
+    if (m_indexCount > 0) {
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(m_indexCount), m_indexType, 0, instanceCount);
     } else {
-        glDrawArraysInstanced(GL_TRIANGLES, 0, m_vertices.size(), instanceCount);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(m_vertexCount), instanceCount);
     }
+    state.CountDraw();
+}
+
+void Mesh::RenderIndirect(size_t offset, int drawCount) const {
+    if (!m_uploaded || m_indexCount == 0 || drawCount <= 0) return;
     
-    glBindVertexArray(0);
+    GLStateCache& state = GLStateCache::Get();
+    state.BindVertexArray(m_VAO.Get());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, m_indexType, reinterpret_cast<const void*>(offset), drawCount, 0);
+    state.CountDraw();
 }
 
 Mesh Mesh::CreateCube() {
@@ -139,8 +323,8 @@ Mesh Mesh::CreateCube() {
         20, 21, 22,  22, 23, 20   // Top
     };
     
-    mesh.SetVertices(vertices);
-    mesh.SetIndices(indices);
+    mesh.SetVertices(std::move(vertices));
+    mesh.SetIndices(std::move(indices));
     return mesh;
 }
 
@@ -188,8 +372,9 @@ Mesh Mesh::CreateSphere(int segments) {
         }
     }
     
-    mesh.SetVertices(vertices);
-    mesh.SetIndices(indices);
+    MeshOptimizer::Optimize(vertices, indices);
+    mesh.SetVertices(std::move(vertices));
+    mesh.SetIndices(std::move(indices));
     return mesh;
 }
 
@@ -210,8 +395,8 @@ Mesh Mesh::CreatePlane(float width, float height) {
         0, 1, 2,  2, 3, 0
     };
     
-    mesh.SetVertices(vertices);
-    mesh.SetIndices(indices);
+    mesh.SetVertices(std::move(vertices));
+    mesh.SetIndices(std::move(indices));
     return mesh;
 }
 
@@ -274,28 +459,16 @@ Mesh Mesh::CreateAircraft() {
     for (auto idx : fuselageIndices) indices.push_back(idx);
     for (auto idx : wingIndices) indices.push_back(idx);
     
-    mesh.SetVertices(vertices);
-    mesh.SetIndices(indices);
+    MeshOptimizer::Optimize(vertices, indices);
+    mesh.SetVertices(std::move(vertices));
+    mesh.SetIndices(std::move(indices));
     return mesh;
 }
 
-void Mesh::SetupMesh() {
-    // This is handled in Upload()
-}
-
 void Mesh::Cleanup() {
-    if (m_VAO != 0) {
-        glDeleteVertexArrays(1, &m_VAO);
-        m_VAO = 0;
-    }
-    if (m_VBO != 0) {
-        glDeleteBuffers(1, &m_VBO);
-        m_VBO = 0;
-    }
-    if (m_EBO != 0) {
-        glDeleteBuffers(1, &m_EBO);
-        m_EBO = 0;
-    }
+    m_VAO.Reset();
+    m_VBO.Reset();
+    m_EBO.Reset();
     m_uploaded = false;
 }
 
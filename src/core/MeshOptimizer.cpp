@@ -0,0 +1,306 @@
+#include "core/MeshOptimizer.h"
+#include <algorithm>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace FlightSim {
+
+namespace {
+
+// FIFO post-transform cache keyed by a running miss counter: a vertex is
+// cached while fewer than cacheSize misses happened since it was loaded.
+// Advancing the counter by cacheSize empties the cache without touching
+// the per-vertex state.
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, int cacheSize)
+        : m_loadedAt(vertexCount, UINT64_MAX)
+        , m_misses(0)
+        , m_size(static_cast<uint64_t>(cacheSize)) {
+    }
+    
+    // True on a miss (the vertex shader runs)
+    bool Access(unsigned int vertex) {
+        uint64_t loadedAt = m_loadedAt[vertex];
+        if (loadedAt != UINT64_MAX && m_misses - loadedAt < m_size) {
+            return false;
+        }
+        m_loadedAt[vertex] = m_misses++;
+        return true;
+    }
+    
+    void Flush() { m_misses += m_size; }
+    
+private:
+    std::vector<uint64_t> m_loadedAt;
+    uint64_t m_misses;
+    uint64_t m_size;
+};
+
+// Triangles using each vertex, in compressed row form
+struct VertexAdjacency {
+    std::vector<unsigned int> offsets;   // vertexCount + 1
+    std::vector<unsigned int> triangles;
+};
+
+void BuildAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount, VertexAdjacency& adjacency) {
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (unsigned int index : indices) {
+        adjacency.offsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+    }
+    
+    std::vector<unsigned int> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        adjacency.triangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+}
+
+bool IndicesInRange(const std::vector<unsigned int>& indices, size_t vertexCount) {
+    return std::all_of(indices.begin(), indices.end(),
+                       [vertexCount](unsigned int index) { return index < vertexCount; });
+}
+
+} // namespace
+
+namespace MeshOptimizer {
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.size() < 3 || !IndicesInRange(indices, vertexCount)) return stats;
+    
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t referencedCount = 0;
+    for (unsigned int index : indices) {
+        if (cache.Access(index)) {
+            misses++;
+        }
+        if (!referenced[index]) {
+            referenced[index] = true;
+            referencedCount++;
+        }
+    }
+    
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+    return stats;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2 || !IndicesInRange(indices, vertexCount)) return;
+    
+    VertexAdjacency adjacency;
+    BuildAdjacency(indices, vertexCount, adjacency);
+    
+    // Live (not yet emitted) triangle count and cache timestamp per vertex
+    std::vector<unsigned int> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+    const int64_t k = cacheSize;
+    std::vector<int64_t> cacheTime(vertexCount, 0);
+    int64_t time = k + 1;
+    
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds;   // Recently used vertices to restart from
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    
+    size_t scan = 0;
+    int64_t fan = 0;
+    while (fan >= 0) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        unsigned int begin = adjacency.offsets[fan];
+        unsigned int end = adjacency.offsets[fan + 1];
+        for (unsigned int a = begin; a < end; ++a) {
+            unsigned int triangle = adjacency.triangles[a];
+            if (emitted[triangle]) continue;
+            
+            for (int corner = 0; corner < 3; ++corner) {
+                unsigned int v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > k) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+        
+        // Next fan: the oldest candidate that will still be cached after
+        // its own triangles are emitted
+        fan = -1;
+        int64_t bestPriority = -1;
+        for (unsigned int v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+            
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * static_cast<int64_t>(liveTriangles[v]) <= k) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+        
+        // Dead end: fall back to a recently used vertex, then to scan order
+        while (fan < 0 && !deadEnds.empty()) {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) {
+                fan = v;
+            }
+        }
+        while (fan < 0 && scan < vertexCount) {
+            if (liveTriangles[scan] > 0) {
+                fan = static_cast<int64_t>(scan);
+            }
+            scan++;
+        }
+    }
+    
+    indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold,
+                      int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2 || !IndicesInRange(indices, vertices.size())) return;
+    
+    // Hard boundaries are where the cache order restarts anyway: every
+    // corner of the triangle misses
+    std::vector<bool> hardBoundary(triangleCount, false);
+    size_t totalMisses = 0;
+    {
+        FifoCache cache(vertices.size(), cacheSize);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            int misses = 0;
+            for (int corner = 0; corner < 3; ++corner) {
+                misses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+            }
+            hardBoundary[t] = misses == 3;
+            totalMisses += misses;
+        }
+    }
+    const float meshAcmr = static_cast<float>(totalMisses) / static_cast<float>(triangleCount);
+    
+    // Soft boundaries split a run as soon as it stands on its own: its
+    // ACMR from a cold cache is within threshold of the whole mesh
+    std::vector<size_t> clusterStarts;
+    {
+        FifoCache cache(vertices.size(), cacheSize);
+        size_t clusterMisses = 0;
+        size_t clusterTriangles = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            if (t == 0 || hardBoundary[t] || (clusterTriangles > 0 &&
+                static_cast<float>(clusterMisses) <= threshold * meshAcmr * static_cast<float>(clusterTriangles))) {
+                clusterStarts.push_back(t);
+                cache.Flush();
+                clusterMisses = 0;
+                clusterTriangles = 0;
+            }
+            for (int corner = 0; corner < 3; ++corner) {
+                clusterMisses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+            }
+            clusterTriangles++;
+        }
+    }
+    const size_t clusterCount = clusterStarts.size();
+    if (clusterCount < 2) return;
+    clusterStarts.push_back(triangleCount);
+    
+    // Area-weighted centroid and normal of each cluster
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float clusterArea = 0.0f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+            
+            clusterNormals[c] += normal;
+            clusterCentroids[c] += center * area;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) {
+            clusterCentroids[c] /= clusterArea;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+    
+    // Clusters facing away from the centre are the likely occluders
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float length = glm::length(clusterNormals[c]);
+        if (length > 0.0f) {
+            sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / length);
+        }
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+    
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    if (!IndicesInRange(indices, vertices.size())) return vertices.size();
+    
+    std::vector<unsigned int> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (unsigned int& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<unsigned int>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    
+    vertices.swap(result);
+    return vertices.size();
+}
+
+MeshOptimizationStats Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int cacheSize) {
+    MeshOptimizationStats stats;
+    stats.before = AnalyzeVertexCache(indices, vertices.size(), cacheSize);
+    
+    OptimizeVertexCache(indices, vertices.size(), cacheSize);
+    OptimizeOverdraw(indices, vertices, 1.05f, cacheSize);
+    OptimizeVertexFetch(vertices, indices);
+    
+    stats.after = AnalyzeVertexCache(indices, vertices.size(), cacheSize);
+    return stats;
+}
+
+} // namespace MeshOptimizer
+
+} // namespace FlightSim
@@ -0,0 +1,308 @@
+#include "core/MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <glm/glm.hpp>
+
+namespace FlightSim {
+
+namespace {
+
+// Boundary planes weigh this much more than the surface they border, so
+// open edges (wing tips, cut-outs) keep their outline
+constexpr double BOUNDARY_WEIGHT = 10.0;
+
+// Sum of squared distances to a set of weighted planes, stored as the
+// upper triangle of the symmetric 4x4 matrix
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+    double weight = 0.0;
+    
+    // Plane n.p + d = 0 with unit n
+    void AddPlane(const glm::dvec3& n, double d, double w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+        a22 += w * n.z * n.z; a23 += w * n.z * d;
+        a33 += w * d * d;
+        weight += w;
+    }
+    
+    void Add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+        weight += q.weight;
+    }
+    
+    double Evaluate(const glm::dvec3& p) const {
+        return a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x +
+               a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y +
+               a22 * p.z * p.z + 2.0 * a23 * p.z +
+               a33;
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    float error;
+};
+
+// Follows collapse remaps to the vertex that currently stands in for v
+unsigned int Resolve(std::vector<unsigned int>& remap, unsigned int v) {
+    unsigned int root = v;
+    while (remap[root] != root) {
+        root = remap[root];
+    }
+    while (remap[v] != root) {
+        unsigned int next = remap[v];
+        remap[v] = root;
+        v = next;
+    }
+    return root;
+}
+
+// Applies the remap and drops triangles that lost a corner
+void CompactIndices(std::vector<unsigned int>& indices, std::vector<unsigned int>& remap,
+                    const std::vector<unsigned int>& classOf) {
+    size_t write = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = Resolve(remap, indices[i]);
+        unsigned int b = Resolve(remap, indices[i + 1]);
+        unsigned int c = Resolve(remap, indices[i + 2]);
+        if (classOf[a] == classOf[b] || classOf[b] == classOf[c] || classOf[c] == classOf[a]) continue;
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+    }
+    indices.resize(write);
+}
+
+// Items per key in compressed row form
+struct Adjacency {
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> items;
+};
+
+} // namespace
+
+namespace MeshSimplifier {
+
+float Simplify(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, size_t targetIndexCount,
+               float maxError) {
+    const size_t vertexCount = vertices.size();
+    if (indices.size() <= targetIndexCount || vertexCount == 0) return 0.0f;
+    if (!std::all_of(indices.begin(), indices.end(), [vertexCount](unsigned int i) { return i < vertexCount; })) {
+        return 0.0f;
+    }
+    
+    // Weld vertices by position; collapses work on these classes so seams
+    // cannot tear open
+    std::vector<unsigned int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    auto less = [&vertices](unsigned int a, unsigned int b) {
+        const glm::vec3& p = vertices[a].position;
+        const glm::vec3& q = vertices[b].position;
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        return p.z < q.z;
+    };
+    std::sort(order.begin(), order.end(), less);
+    
+    std::vector<unsigned int> classOf(vertexCount);
+    std::vector<glm::dvec3> classPosition;
+    Adjacency classVertices;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (i == 0 || less(order[i - 1], order[i])) {
+            classPosition.push_back(glm::dvec3(vertices[order[i]].position));
+            classVertices.offsets.push_back(static_cast<unsigned int>(i));
+        }
+        classOf[order[i]] = static_cast<unsigned int>(classPosition.size() - 1);
+    }
+    const size_t classCount = classPosition.size();
+    classVertices.offsets.push_back(static_cast<unsigned int>(vertexCount));
+    classVertices.items = std::move(order);
+    
+    std::vector<unsigned int> remap(vertexCount);
+    std::iota(remap.begin(), remap.end(), 0u);
+    CompactIndices(indices, remap, classOf);
+    
+    // Area-weighted planes of the triangles around each class
+    std::vector<Quadric> quadrics(classCount);
+    std::vector<std::pair<uint64_t, unsigned int>> edges; // (ordered class pair, triangle)
+    for (size_t t = 0; t < indices.size() / 3; ++t) {
+        unsigned int c[3] = {classOf[indices[t * 3]], classOf[indices[t * 3 + 1]], classOf[indices[t * 3 + 2]]};
+        glm::dvec3 normal = glm::cross(classPosition[c[1]] - classPosition[c[0]],
+                                       classPosition[c[2]] - classPosition[c[0]]);
+        double length = glm::length(normal);
+        if (length <= 0.0) continue;
+        normal /= length;
+        double d = -glm::dot(normal, classPosition[c[0]]);
+        for (unsigned int corner : c) {
+            quadrics[corner].AddPlane(normal, d, 0.5 * length);
+        }
+        for (int e = 0; e < 3; ++e) {
+            unsigned int a = std::min(c[e], c[(e + 1) % 3]);
+            unsigned int b = std::max(c[e], c[(e + 1) % 3]);
+            edges.push_back({static_cast<uint64_t>(a) << 32 | b, static_cast<unsigned int>(t)});
+        }
+    }
+    
+    // Edges with one triangle are boundaries: add a plane through the edge,
+    // perpendicular to that triangle
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        bool shared = (i > 0 && edges[i - 1].first == edges[i].first) ||
+                      (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+        if (shared) continue;
+        
+        unsigned int a = static_cast<unsigned int>(edges[i].first >> 32);
+        unsigned int b = static_cast<unsigned int>(edges[i].first & 0xFFFFFFFFu);
+        size_t t = edges[i].second;
+        glm::dvec3 triangleNormal = glm::cross(
+            classPosition[classOf[indices[t * 3 + 1]]] - classPosition[classOf[indices[t * 3]]],
+            classPosition[classOf[indices[t * 3 + 2]]] - classPosition[classOf[indices[t * 3]]]);
+        glm::dvec3 edge = classPosition[b] - classPosition[a];
+        glm::dvec3 normal = glm::cross(edge, triangleNormal);
+        double length = glm::length(normal);
+        if (length <= 0.0) continue;
+        normal /= length;
+        double d = -glm::dot(normal, classPosition[a]);
+        double weight = BOUNDARY_WEIGHT * glm::dot(edge, edge);
+        quadrics[a].AddPlane(normal, d, weight);
+        quadrics[b].AddPlane(normal, d, weight);
+    }
+    
+    // Each pass collapses the cheapest edges whose neighborhoods do not
+    // overlap, so the adjacency built at its start stays valid throughout
+    float resultError = 0.0f;
+    std::vector<Collapse> collapses;
+    std::vector<uint64_t> uniqueEdges;
+    std::vector<char> locked(classCount);
+    Adjacency classTriangles;
+    while (indices.size() > targetIndexCount) {
+        const size_t triangleCount = indices.size() / 3;
+        
+        classTriangles.offsets.assign(classCount + 1, 0);
+        for (unsigned int index : indices) {
+            classTriangles.offsets[classOf[index] + 1]++;
+        }
+        for (size_t c = 0; c < classCount; ++c) {
+            classTriangles.offsets[c + 1] += classTriangles.offsets[c];
+        }
+        std::vector<unsigned int> cursor(classTriangles.offsets.begin(), classTriangles.offsets.end() - 1);
+        classTriangles.items.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            classTriangles.items[cursor[classOf[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+        }
+        
+        uniqueEdges.clear();
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int e = 0; e < 3; ++e) {
+                unsigned int a = classOf[indices[t * 3 + e]];
+                unsigned int b = classOf[indices[t * 3 + (e + 1) % 3]];
+                uniqueEdges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+            }
+        }
+        std::sort(uniqueEdges.begin(), uniqueEdges.end());
+        uniqueEdges.erase(std::unique(uniqueEdges.begin(), uniqueEdges.end()), uniqueEdges.end());
+        
+        // Collapse onto whichever endpoint the merged quadric prefers
+        collapses.clear();
+        for (uint64_t edge : uniqueEdges) {
+            unsigned int a = static_cast<unsigned int>(edge >> 32);
+            unsigned int b = static_cast<unsigned int>(edge & 0xFFFFFFFFu);
+            Quadric merged = quadrics[a];
+            merged.Add(quadrics[b]);
+            double weight = std::max(merged.weight, 1e-12);
+            double costA = std::max(merged.Evaluate(classPosition[a]), 0.0) / weight;
+            double costB = std::max(merged.Evaluate(classPosition[b]), 0.0) / weight;
+            if (costA < costB) {
+                collapses.push_back({b, a, static_cast<float>(std::sqrt(costA))});
+            } else {
+                collapses.push_back({a, b, static_cast<float>(std::sqrt(costB))});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+        
+        std::fill(locked.begin(), locked.end(), 0);
+        size_t trianglesLeft = triangleCount;
+        size_t applied = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > maxError || trianglesLeft * 3 <= targetIndexCount) break;
+            if (locked[collapse.from] || locked[collapse.to]) continue;
+            
+            // Reject collapses that would fold a surviving triangle over
+            const glm::dvec3& target = classPosition[collapse.to];
+            bool flips = false;
+            size_t removed = 0;
+            for (unsigned int i = classTriangles.offsets[collapse.from];
+                 i < classTriangles.offsets[collapse.from + 1] && !flips; ++i) {
+                unsigned int t = classTriangles.items[i];
+                unsigned int c[3] = {classOf[indices[t * 3]], classOf[indices[t * 3 + 1]],
+                                     classOf[indices[t * 3 + 2]]};
+                if (c[0] == collapse.to || c[1] == collapse.to || c[2] == collapse.to) {
+                    removed++;
+                    continue;
+                }
+                glm::dvec3 p[3] = {classPosition[c[0]], classPosition[c[1]], classPosition[c[2]]};
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; ++k) {
+                    if (c[k] == collapse.from) p[k] = target;
+                }
+                glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                flips = glm::dot(before, after) <= 0.0;
+            }
+            if (flips) continue;
+            
+            // Each moving vertex takes the target vertex with the closest
+            // normal, so hard edges and UV seams keep their sides
+            for (unsigned int i = classVertices.offsets[collapse.from];
+                 i < classVertices.offsets[collapse.from + 1]; ++i) {
+                unsigned int v = classVertices.items[i];
+                unsigned int best = classVertices.items[classVertices.offsets[collapse.to]];
+                float bestDot = -2.0f;
+                for (unsigned int j = classVertices.offsets[collapse.to];
+                     j < classVertices.offsets[collapse.to + 1]; ++j) {
+                    unsigned int w = classVertices.items[j];
+                    float d = glm::dot(vertices[v].normal, vertices[w].normal);
+                    if (d > bestDot) {
+                        bestDot = d;
+                        best = w;
+                    }
+                }
+                remap[v] = best;
+            }
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            
+            // Lock both one-rings for the rest of the pass
+            for (unsigned int end : {collapse.from, collapse.to}) {
+                for (unsigned int i = classTriangles.offsets[end]; i < classTriangles.offsets[end + 1]; ++i) {
+                    unsigned int t = classTriangles.items[i];
+                    for (int k = 0; k < 3; ++k) {
+                        locked[classOf[indices[t * 3 + k]]] = 1;
+                    }
+                }
+            }
+            
+            trianglesLeft -= std::min(removed, trianglesLeft);
+            resultError = std::max(resultError, collapse.error);
+            applied++;
+        }
+        
+        CompactIndices(indices, remap, classOf);
+        if (applied == 0) break;
+    }
+    
+    return resultError;
+}
+
+} // namespace MeshSimplifier
+
+} // namespace FlightSim
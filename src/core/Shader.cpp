@@ -1,22 +1,56 @@
 #include "core/Shader.h"
+#include "core/ShaderCache.h"
+#include "core/GLStateCache.h"
 #include <glad/glad.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace FlightSim {
 
-Shader::Shader() : m_programID(0) {
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ShaderCache* Shader::s_programCache = nullptr;
+
+Shader::Shader()
+    : m_programID(0)
+    , m_vertexShader(0)
+    , m_fragmentShader(0)
+    , m_cacheKey(0)
+    , m_loadPending(false)
+    , m_loadedFromCache(false)
+    , m_registeredWithCache(false) {
 }
 
 Shader::~Shader() {
+    if (m_registeredWithCache && s_programCache) {
+        s_programCache->RemovePending(this);
+    }
+    ReleaseStageShaders();
     if (m_programID != 0) {
+        GLStateCache::Get().OnProgramDeleted(m_programID);
         glDeleteProgram(m_programID);
     }
 }
 
+void Shader::SetProgramCache(ShaderCache* cache) {
+    s_programCache = cache;
+}
+
 bool Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
+    return BeginLoadFromFiles(vertexPath, fragmentPath) && FinishLoad();
+}
+
+bool Shader::LoadFromStrings(const std::string& vertexSource, const std::string& fragmentSource) {
+    return BeginLoadFromStrings(vertexSource, fragmentSource) && FinishLoad();
+}
+
+bool Shader::BeginLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                                LinkedCallback onLinked) {
     std::string vertexSource = ReadFile(vertexPath);
     std::string fragmentSource = ReadFile(fragmentPath);
     
@@ -25,70 +59,290 @@ bool Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fra
         return false;
     }
     
-    return LoadFromStrings(vertexSource, fragmentSource);
+    return BeginLoadFromStrings(vertexSource, fragmentSource, std::move(onLinked));
 }
 
-bool Shader::LoadFromStrings(const std::string& vertexSource, const std::string& fragmentSource) {
-    // Compile shaders
-    unsigned int vertexShader = CompileShader(vertexSource, GL_VERTEX_SHADER);
-    if (vertexShader == 0) return false;
+bool Shader::BeginLoadFromStrings(const std::string& vertexSource, const std::string& fragmentSource,
+                                  LinkedCallback onLinked) {
+    if (m_programID != 0) {
+        GLStateCache::Get().OnProgramDeleted(m_programID);
+        glDeleteProgram(m_programID);
+    }
+    ReleaseStageShaders();
     
-    unsigned int fragmentShader = CompileShader(fragmentSource, GL_FRAGMENT_SHADER);
-    if (fragmentShader == 0) {
-        glDeleteShader(vertexShader);
-        return false;
+    m_programID = glCreateProgram();
+    m_onLinked = std::move(onLinked);
+    m_loadedFromCache = false;
+    m_loadPending = true;
+    
+    if (s_programCache) {
+        m_cacheKey = s_programCache->MakeKey(vertexSource, fragmentSource);
+        m_loadedFromCache = s_programCache->LoadProgram(m_cacheKey, m_programID);
+        if (!m_registeredWithCache) {
+            s_programCache->AddPending(this);
+            m_registeredWithCache = true;
+        }
+    }
+    
+    if (m_loadedFromCache) {
+        return true;
+    }
+    
+    // Submit everything without querying status so the driver can compile
+    // and link this program while others are being submitted
+    m_vertexShader = CompileShader(vertexSource, GL_VERTEX_SHADER);
+    m_fragmentShader = CompileShader(fragmentSource, GL_FRAGMENT_SHADER);
+    
+    glAttachShader(m_programID, m_vertexShader);
+    glAttachShader(m_programID, m_fragmentShader);
+    if (s_programCache && s_programCache->IsBinaryCacheAvailable()) {
+        glProgramParameteri(m_programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(m_programID);
+    
+    return true;
+}
+
+bool Shader::IsLinkComplete() const {
+    if (!m_loadPending || m_loadedFromCache) {
+        return true;
+    }
+    if (!s_programCache || !s_programCache->IsParallelCompileAvailable()) {
+        return true; // Status queries will block regardless
+    }
+    
+    GLint complete = GL_FALSE;
+    glGetProgramiv(m_programID, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+bool Shader::FinishLoad() {
+    if (!m_loadPending) {
+        return IsValid();
+    }
+    m_loadPending = false;
+    
+    if (m_registeredWithCache) {
+        if (s_programCache) {
+            s_programCache->RemovePending(this);
+        }
+        m_registeredWithCache = false;
+    }
+    
+    if (!m_loadedFromCache) {
+        bool success = CheckCompileStatus(m_vertexShader) &&
+                       CheckCompileStatus(m_fragmentShader) &&
+                       CheckLinkStatus();
+        ReleaseStageShaders();
+        
+        if (!success) {
+            GLStateCache::Get().OnProgramDeleted(m_programID);
+            glDeleteProgram(m_programID);
+            m_programID = 0;
+            m_onLinked = nullptr;
+            return false;
+        }
+        
+        if (s_programCache) {
+            s_programCache->StoreProgram(m_cacheKey, m_programID);
+        }
+    }
+    
+    ReflectUniforms();
+    
+    if (m_onLinked) {
+        LinkedCallback onLinked = std::move(m_onLinked);
+        m_onLinked = nullptr;
+        onLinked(*this);
     }
     
-    // Link program
-    bool success = LinkProgram(vertexShader, fragmentShader);
+    return true;
+}
+
+bool Shader::LoadComputeFromString(const std::string& computeSource) {
+    if (m_programID != 0) {
+        GLStateCache::Get().OnProgramDeleted(m_programID);
+        glDeleteProgram(m_programID);
+    }
+    ReleaseStageShaders();
+    m_loadPending = false;
+    m_loadedFromCache = false;
+    m_onLinked = nullptr;
+    
+    m_programID = glCreateProgram();
+    GLuint computeShader = CompileShader(computeSource, GL_COMPUTE_SHADER);
+    glAttachShader(m_programID, computeShader);
+    glLinkProgram(m_programID);
+    
+    bool success = CheckCompileStatus(computeShader) && CheckLinkStatus();
+    glDetachShader(m_programID, computeShader);
+    glDeleteShader(computeShader);
     
-    // Clean up shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    if (!success) {
+        GLStateCache::Get().OnProgramDeleted(m_programID);
+        glDeleteProgram(m_programID);
+        m_programID = 0;
+        return false;
+    }
     
-    return success;
+    ReflectUniforms();
+    return true;
 }
 
 void Shader::Use() const {
     if (m_programID != 0) {
-        glUseProgram(m_programID);
+        GLStateCache::Get().UseProgram(m_programID);
     }
 }
 
 void Shader::Unbind() const {
-    glUseProgram(0);
+    GLStateCache::Get().UseProgram(0);
 }
 
-void Shader::SetBool(const std::string& name, bool value) {
-    glUniform1i(GetUniformLocation(name), static_cast<int>(value));
+template<typename T> struct UniformGLType;
+template<> struct UniformGLType<bool>      { static constexpr GLenum value = GL_BOOL; };
+template<> struct UniformGLType<int>       { static constexpr GLenum value = GL_INT; };
+template<> struct UniformGLType<float>     { static constexpr GLenum value = GL_FLOAT; };
+template<> struct UniformGLType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template<> struct UniformGLType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template<> struct UniformGLType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template<> struct UniformGLType<glm::mat3> { static constexpr GLenum value = GL_FLOAT_MAT3; };
+template<> struct UniformGLType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
+static bool IsSamplerType(GLenum type) {
+    switch (type) {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+    }
 }
 
-void Shader::SetInt(const std::string& name, int value) {
-    glUniform1i(GetUniformLocation(name), value);
+template<typename T>
+Uniform<T> Shader::GetUniform(const char* name) const {
+    const UniformInfo* info = FindUniform(name);
+    if (!info) {
+        std::cerr << "Warning: uniform '" << name << "' not found" << std::endl;
+        return Uniform<T>();
+    }
+    
+    // Samplers are set through int handles
+    bool compatible = info->type == UniformGLType<T>::value ||
+                      (UniformGLType<T>::value == GL_INT && IsSamplerType(info->type));
+    if (!compatible) {
+        std::cerr << "Warning: uniform '" << name << "' has mismatched type" << std::endl;
+        return Uniform<T>();
+    }
+    
+    return Uniform<T>(info->location);
 }
 
-void Shader::SetFloat(const std::string& name, float value) {
-    glUniform1f(GetUniformLocation(name), value);
+template Uniform<bool> Shader::GetUniform<bool>(const char*) const;
+template Uniform<int> Shader::GetUniform<int>(const char*) const;
+template Uniform<float> Shader::GetUniform<float>(const char*) const;
+template Uniform<glm::vec2> Shader::GetUniform<glm::vec2>(const char*) const;
+template Uniform<glm::vec3> Shader::GetUniform<glm::vec3>(const char*) const;
+template Uniform<glm::vec4> Shader::GetUniform<glm::vec4>(const char*) const;
+template Uniform<glm::mat3> Shader::GetUniform<glm::mat3>(const char*) const;
+template Uniform<glm::mat4> Shader::GetUniform<glm::mat4>(const char*) const;
+
+void Shader::Set(Uniform<bool> uniform, bool value) const {
+    glUniform1i(uniform.m_location, static_cast<int>(value));
 }
 
-void Shader::SetVec2(const std::string& name, const glm::vec2& value) {
-    glUniform2fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+void Shader::Set(Uniform<int> uniform, int value) const {
+    glUniform1i(uniform.m_location, value);
 }
 
-void Shader::SetVec3(const std::string& name, const glm::vec3& value) {
-    glUniform3fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+void Shader::Set(Uniform<float> uniform, float value) const {
+    glUniform1f(uniform.m_location, value);
 }
 
-void Shader::SetVec4(const std::string& name, const glm::vec4& value) {
-    glUniform4fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+void Shader::Set(Uniform<glm::vec2> uniform, const glm::vec2& value) const {
+    glUniform2fv(uniform.m_location, 1, glm::value_ptr(value));
 }
 
-void Shader::SetMat3(const std::string& name, const glm::mat3& value) {
-    glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::Set(Uniform<glm::vec3> uniform, const glm::vec3& value) const {
+    glUniform3fv(uniform.m_location, 1, glm::value_ptr(value));
 }
 
-void Shader::SetMat4(const std::string& name, const glm::mat4& value) {
-    glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::Set(Uniform<glm::vec4> uniform, const glm::vec4& value) const {
+    glUniform4fv(uniform.m_location, 1, glm::value_ptr(value));
+}
+
+void Shader::Set(Uniform<glm::mat3> uniform, const glm::mat3& value) const {
+    glUniformMatrix3fv(uniform.m_location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::Set(Uniform<glm::mat4> uniform, const glm::mat4& value) const {
+    glUniformMatrix4fv(uniform.m_location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::Set(Uniform<float> uniform, const float* values, int count) const {
+    glUniform1fv(uniform.m_location, count, values);
+}
+
+void Shader::Set(Uniform<glm::vec4> uniform, const glm::vec4* values, int count) const {
+    glUniform4fv(uniform.m_location, count, glm::value_ptr(values[0]));
+}
+
+void Shader::Set(Uniform<glm::mat4> uniform, const glm::mat4* values, int count) const {
+    glUniformMatrix4fv(uniform.m_location, count, GL_FALSE, glm::value_ptr(values[0]));
+}
+
+VertexDecodeUniforms Shader::GetVertexDecodeUniforms() const {
+    VertexDecodeUniforms uniforms;
+    uniforms.positionOffset = GetUniform<glm::vec3>("positionOffset");
+    uniforms.positionScale = GetUniform<glm::vec3>("positionScale");
+    uniforms.octahedralNormals = GetUniform<bool>("octahedralNormals");
+    return uniforms;
+}
+
+void Shader::Set(const VertexDecodeUniforms& uniforms, const VertexDecode& decode) const {
+    Set(uniforms.positionOffset, decode.positionOffset);
+    Set(uniforms.positionScale, decode.positionScale);
+    Set(uniforms.octahedralNormals, decode.octahedralNormals);
+}
+
+void Shader::SetBool(const char* name, bool value) {
+    glUniform1i(FindLocation(name), static_cast<int>(value));
+}
+
+void Shader::SetInt(const char* name, int value) {
+    glUniform1i(FindLocation(name), value);
+}
+
+void Shader::SetFloat(const char* name, float value) {
+    glUniform1f(FindLocation(name), value);
+}
+
+void Shader::SetVec2(const char* name, const glm::vec2& value) {
+    glUniform2fv(FindLocation(name), 1, glm::value_ptr(value));
+}
+
+void Shader::SetVec3(const char* name, const glm::vec3& value) {
+    glUniform3fv(FindLocation(name), 1, glm::value_ptr(value));
+}
+
+void Shader::SetVec4(const char* name, const glm::vec4& value) {
+    glUniform4fv(FindLocation(name), 1, glm::value_ptr(value));
+}
+
+void Shader::SetMat3(const char* name, const glm::mat3& value) {
+    glUniformMatrix3fv(FindLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::SetMat4(const char* name, const glm::mat4& value) {
+    glUniformMatrix4fv(FindLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 unsigned int Shader::CompileShader(const std::string& source, unsigned int type) {
@@ -96,7 +350,10 @@ unsigned int Shader::CompileShader(const std::string& source, unsigned int type)
     const char* src = source.c_str();
     glShaderSource(shader, 1, &src, nullptr);
     glCompileShader(shader);
-    
+    return shader;
+}
+
+bool Shader::CheckCompileStatus(unsigned int shader) {
     // Check for compilation errors
     int success;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -104,19 +361,13 @@ unsigned int Shader::CompileShader(const std::string& source, unsigned int type)
         char infoLog[512];
         glGetShaderInfoLog(shader, 512, nullptr, infoLog);
         std::cerr << "Shader compilation failed: " << infoLog << std::endl;
-        glDeleteShader(shader);
-        return 0;
+        return false;
     }
     
-    return shader;
+    return true;
 }
 
-bool Shader::LinkProgram(unsigned int vertexShader, unsigned int fragmentShader) {
-    m_programID = glCreateProgram();
-    glAttachShader(m_programID, vertexShader);
-    glAttachShader(m_programID, fragmentShader);
-    glLinkProgram(m_programID);
-    
+bool Shader::CheckLinkStatus() {
     // Check for linking errors
     int success;
     glGetProgramiv(m_programID, GL_LINK_STATUS, &success);
@@ -124,28 +375,105 @@ bool Shader::LinkProgram(unsigned int vertexShader, unsigned int fragmentShader)
         char infoLog[512];
         glGetProgramInfoLog(m_programID, 512, nullptr, infoLog);
         std::cerr << "Shader program linking failed: " << infoLog << std::endl;
-        glDeleteProgram(m_programID);
-        m_programID = 0;
         return false;
     }
     
     return true;
 }
 
-int Shader::GetUniformLocation(const std::string& name) {
-    auto it = m_uniformLocationCache.find(name);
-    if (it != m_uniformLocationCache.end()) {
-        return it->second;
+void Shader::ReleaseStageShaders() {
+    if (m_vertexShader != 0) {
+        if (m_programID != 0) glDetachShader(m_programID, m_vertexShader);
+        glDeleteShader(m_vertexShader);
+        m_vertexShader = 0;
     }
+    if (m_fragmentShader != 0) {
+        if (m_programID != 0) glDetachShader(m_programID, m_fragmentShader);
+        glDeleteShader(m_fragmentShader);
+        m_fragmentShader = 0;
+    }
+}
+
+void Shader::ReflectUniforms() {
+    m_uniforms.clear();
     
-    int location = glGetUniformLocation(m_programID, name.c_str());
-    m_uniformLocationCache[name] = location;
+    int count = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
     
-    if (location == -1) {
-        std::cerr << "Warning: uniform '" << name << "' not found" << std::endl;
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+    m_uniforms.reserve(count);
+    
+    for (int i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_programID, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                           &length, &size, &type, nameBuffer.data());
+        
+        std::string name(nameBuffer.data(), length);
+        int location = glGetUniformLocation(m_programID, name.c_str());
+        if (location == -1) {
+            continue; // Member of a uniform block
+        }
+        
+        // Arrays are reported as "name[0]"; key them by the bare name
+        if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
+        }
+        
+        uint32_t hash = HashUniformName(name.c_str());
+        m_uniforms.push_back({std::move(name), hash, location, type, size});
     }
     
-    return location;
+    std::sort(m_uniforms.begin(), m_uniforms.end(),
+              [](const UniformInfo& a, const UniformInfo& b) { return a.hash < b.hash; });
+    
+    // Handles and hash lookups cannot tell colliding names apart, so
+    // neither may resolve to the other's location
+    for (size_t i = 1; i < m_uniforms.size();) {
+        if (m_uniforms[i].hash != m_uniforms[i - 1].hash) {
+            ++i;
+            continue;
+        }
+        std::cerr << "Error: uniforms '" << m_uniforms[i - 1].name << "' and '" << m_uniforms[i].name
+                  << "' have the same name hash; both are disabled" << std::endl;
+        size_t end = i + 1;
+        while (end < m_uniforms.size() && m_uniforms[end].hash == m_uniforms[i].hash) {
+            ++end;
+        }
+        m_uniforms.erase(m_uniforms.begin() + (i - 1), m_uniforms.begin() + end);
+        i = std::max<size_t>(i - 1, 1);
+    }
+}
+
+const UniformInfo* Shader::FindUniform(uint32_t nameHash) const {
+    auto it = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), nameHash,
+                               [](const UniformInfo& info, uint32_t hash) { return info.hash < hash; });
+    if (it == m_uniforms.end() || it->hash != nameHash) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+const UniformInfo* Shader::FindUniform(const char* name) const {
+    // A name that is not active may still share a hash with one that is
+    const UniformInfo* info = FindUniform(HashUniformName(name));
+    if (!info || info->name != name) {
+        return nullptr;
+    }
+    return info;
+}
+
+int Shader::FindLocation(const char* name) const {
+    const UniformInfo* info = FindUniform(name);
+    return info ? info->location : -1;
+}
+
+int Shader::GetUniformLocation(uint32_t nameHash) const {
+    const UniformInfo* info = FindUniform(nameHash);
+    return info ? info->location : -1;
 }
 
 std::string Shader::ReadFile(const std::string& filePath) {
@@ -160,4 +488,17 @@ std::string Shader::ReadFile(const std::string& filePath) {
     return buffer.str();
 }
 
+std::string Shader::InsertAfterVersion(const std::string& source, const std::string& code) {
+    // Everything but comments and whitespace must follow #version
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return code + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + code;
+    }
+    return source.substr(0, lineEnd + 1) + code + source.substr(lineEnd + 1);
+}
+
 } // namespace FlightSim 
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "core/ShaderCache.h"
+#include "core/Shader.h"
+#include <glad/glad.h>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace FlightSim {
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x42505346; // "FSPB"
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+uint64_t HashBytes(uint64_t hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+long GetProcessId() {
+#ifdef _WIN32
+    return static_cast<long>(_getpid());
+#else
+    return static_cast<long>(getpid());
+#endif
+}
+
+std::string GetGLString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+} // namespace
+
+ShaderCache::ShaderCache()
+    : m_binaryCacheAvailable(false)
+    , m_parallelCompileAvailable(false)
+    , m_tempFileCounter(0) {
+}
+
+ShaderCache::~ShaderCache() {
+    for (Shader* shader : m_pending) {
+        shader->DetachFromCache();
+    }
+}
+
+bool ShaderCache::Initialize(const std::string& directory) {
+    m_directory = directory;
+    m_driverString = GetGLString(GL_VENDOR) + "|" + GetGLString(GL_RENDERER) + "|" + GetGLString(GL_VERSION);
+    
+    // Program binaries need GL 4.1 or ARB_get_program_binary and at least one format
+    if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary) {
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        m_binaryCacheAvailable = formatCount > 0;
+    }
+    
+    if (m_binaryCacheAvailable) {
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        if (error) {
+            std::cerr << "Shader cache disabled, cannot create " << m_directory << ": " << error.message() << std::endl;
+            m_binaryCacheAvailable = false;
+        }
+    }
+    
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu); // Let the driver pick
+        m_parallelCompileAvailable = true;
+    } else if (GLAD_GL_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        m_parallelCompileAvailable = true;
+    }
+    
+    return true;
+}
+
+uint64_t ShaderCache::MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const {
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashBytes(hash, vertexSource.data(), vertexSource.size() + 1);
+    hash = HashBytes(hash, fragmentSource.data(), fragmentSource.size() + 1);
+    hash = HashBytes(hash, m_driverString.data(), m_driverString.size());
+    return hash;
+}
+
+std::string ShaderCache::GetCachePath(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+bool ShaderCache::LoadProgram(uint64_t key, unsigned int program) {
+    if (!m_binaryCacheAvailable) {
+        m_stats.cacheMisses++;
+        return false;
+    }
+    
+    const std::string path = GetCachePath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        m_stats.cacheMisses++;
+        return false;
+    }
+    
+    CacheFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key) {
+        m_stats.cacheMisses++;
+        return false;
+    }
+    
+    // The binary fills the rest of the file; a corrupt length must not
+    // size the allocation
+    std::error_code error;
+    const uintmax_t fileSize = std::filesystem::file_size(path, error);
+    if (error || header.binaryLength == 0 || fileSize != sizeof(header) + header.binaryLength) {
+        m_stats.cacheMisses++;
+        return false;
+    }
+    
+    std::vector<char> binary(header.binaryLength);
+    file.read(binary.data(), binary.size());
+    if (!file) {
+        m_stats.cacheMisses++;
+        return false;
+    }
+    
+    glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+    
+    // Drivers reject binaries after updates; treat that as a miss and recompile
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        m_stats.cacheMisses++;
+        return false;
+    }
+    
+    m_stats.cacheHits++;
+    return true;
+}
+
+void ShaderCache::StoreProgram(uint64_t key, unsigned int program) {
+    if (!m_binaryCacheAvailable) return;
+    
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+    
+    CacheFileHeader header{CACHE_MAGIC, CACHE_VERSION, key, format, static_cast<uint32_t>(length)};
+    
+    // Write to a temporary and rename so a concurrently starting instance
+    // never reads a partial file. The temporary is unique to this process
+    // and store, so instances sharing the directory never write to or
+    // rename each other's.
+    std::string path = GetCachePath(key);
+    std::string tempPath = path + "." + std::to_string(GetProcessId()) + "." +
+                           std::to_string(m_tempFileCounter++) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file) return;
+    }
+    
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+    
+    m_stats.cacheStores++;
+}
+
+void ShaderCache::AddPending(Shader* shader) {
+    m_pending.push_back(shader);
+}
+
+void ShaderCache::RemovePending(Shader* shader) {
+    m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), shader), m_pending.end());
+}
+
+bool ShaderCache::FinishPending() {
+    bool success = true;
+    
+    while (!m_pending.empty()) {
+        // Finish whichever programs the driver has completed, in any order
+        bool progress = false;
+        for (size_t i = 0; i < m_pending.size();) {
+            Shader* shader = m_pending[i];
+            if (!shader->IsLinkComplete()) {
+                ++i;
+                continue;
+            }
+            
+            m_pending.erase(m_pending.begin() + i);
+            if (shader->FinishLoad()) {
+                m_stats.programsLinked++;
+            } else {
+                success = false;
+            }
+            progress = true;
+        }
+        
+        if (!progress) {
+            std::this_thread::yield();
+        }
+    }
+    
+    return success;
+}
+
+} // namespace FlightSim
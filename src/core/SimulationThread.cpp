@@ -0,0 +1,173 @@
+#include "core/SimulationThread.h"
+#include "physics/Traffic.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace FlightSim {
+
+SimulationThread::SimulationThread()
+    : m_trafficRadius(0.0f)
+    , m_tick(0)
+    , m_accumulator(0.0)
+    , m_stopRequested(false) {
+}
+
+SimulationThread::~SimulationThread() {
+    Stop();
+}
+
+bool SimulationThread::Initialize(int trafficCount, float trafficRadius) {
+    if (IsRunning()) {
+        std::cerr << "Simulation already running" << std::endl;
+        return false;
+    }
+    
+    m_aircraft = std::make_unique<Aircraft>();
+    m_traffic = std::make_unique<Traffic>();
+    m_trafficRadius = trafficRadius;
+    m_traffic->Spawn(trafficCount, glm::vec3(0.0f), m_trafficRadius);
+    
+    m_hudValues = HUDValues();
+    m_tick = 0;
+    m_accumulator = 0.0;
+    
+    m_trails.assign(1, TrailRecorder());
+    m_trails[0].Reset(m_aircraft->GetState().position, 0.0f);
+    ResetTrafficTrails();
+    
+    // The render thread must have something to draw before the first tick
+    Publish();
+    return true;
+}
+
+void SimulationThread::Start() {
+    if (IsRunning() || !m_aircraft) return;
+    
+    m_stopRequested = false;
+    m_thread = std::thread(&SimulationThread::ThreadLoop, this);
+}
+
+void SimulationThread::Stop() {
+    if (!IsRunning()) return;
+    
+    m_stopRequested = true;
+    m_thread.join();
+}
+
+void SimulationThread::Advance(double deltaTime) {
+    if (!m_aircraft || IsRunning()) return;
+    
+    ProcessCommands();
+    m_accumulator += deltaTime;
+    
+    int steps = 0;
+    while (m_accumulator >= FIXED_TIMESTEP && steps < MAX_STEPS_PER_UPDATE) {
+        Step(static_cast<float>(FIXED_TIMESTEP));
+        m_accumulator -= FIXED_TIMESTEP;
+        steps++;
+    }
+    if (steps == MAX_STEPS_PER_UPDATE) {
+        m_accumulator = 0.0;
+    }
+    
+    if (steps > 0) {
+        Publish();
+    }
+}
+
+bool SimulationThread::PushCommand(const Command& command) {
+    return m_commands.Push(command);
+}
+
+void SimulationThread::ThreadLoop() {
+    using Clock = std::chrono::steady_clock;
+    const auto tickDuration = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(FIXED_TIMESTEP));
+    
+    auto nextTick = Clock::now();
+    while (!m_stopRequested) {
+        ProcessCommands();
+        
+        // Catch up on missed ticks, but not indefinitely
+        int steps = 0;
+        auto now = Clock::now();
+        while (nextTick <= now && steps < MAX_STEPS_PER_UPDATE) {
+            Step(static_cast<float>(FIXED_TIMESTEP));
+            nextTick += tickDuration;
+            steps++;
+        }
+        if (steps == MAX_STEPS_PER_UPDATE) {
+            nextTick = now + tickDuration;
+        }
+        
+        if (steps > 0) {
+            Publish();
+        }
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+void SimulationThread::ProcessCommands() {
+    Command command;
+    while (m_commands.Pop(command)) {
+        switch (command.type) {
+            case Command::Type::Controls:
+                m_controls = command.controls;
+                break;
+            case Command::Type::ResetAircraft:
+                m_aircraft->Reset();
+                m_trails[0].Reset(m_aircraft->GetState().position, static_cast<float>(m_tick * FIXED_TIMESTEP));
+                break;
+            case Command::Type::SetTrafficCount:
+                m_traffic->Clear();
+                m_traffic->Spawn(command.trafficCount, glm::vec3(0.0f), m_trafficRadius);
+                ResetTrafficTrails();
+                break;
+        }
+    }
+}
+
+void SimulationThread::Step(float deltaTime) {
+    m_aircraft->Update(deltaTime, m_controls);
+    m_traffic->Update(deltaTime);
+    m_hudValues.Update(m_aircraft->GetState(), deltaTime);
+    m_tick++;
+    
+    // Every tick is sampled; the recorders keep only the points that matter
+    float time = static_cast<float>(m_tick * FIXED_TIMESTEP);
+    m_trails[0].AddSample(m_aircraft->GetState().position, time, m_tick);
+    const std::vector<AircraftState>& traffic = m_traffic->GetStates();
+    for (size_t i = 1; i < m_trails.size(); ++i) {
+        m_trails[i].AddSample(traffic[i - 1].position, time, m_tick);
+    }
+}
+
+void SimulationThread::ResetTrafficTrails() {
+    const std::vector<AircraftState>& traffic = m_traffic->GetStates();
+    size_t tracked = std::min(traffic.size(), WorldSnapshot::MAX_TRAILS - 1);
+    
+    m_trails.resize(tracked + 1);
+    float time = static_cast<float>(m_tick * FIXED_TIMESTEP);
+    for (size_t i = 1; i < m_trails.size(); ++i) {
+        m_trails[i].Reset(traffic[i - 1].position, time);
+    }
+}
+
+void SimulationThread::Publish() {
+    // The write slot is a snapshot the reader released two publishes ago,
+    // so assigning into it reuses its vector storage
+    WorldSnapshot& snapshot = m_snapshots.GetWriteBuffer();
+    snapshot.tick = m_tick;
+    snapshot.simulationTime = m_tick * FIXED_TIMESTEP;
+    snapshot.player = m_aircraft->GetState();
+    snapshot.traffic.assign(m_traffic->GetStates().begin(), m_traffic->GetStates().end());
+    snapshot.trails.resize(m_trails.size());
+    for (size_t i = 0; i < m_trails.size(); ++i) {
+        m_trails[i].Fill(snapshot.trails[i]);
+    }
+    snapshot.hud = m_hudValues;
+    m_snapshots.Publish();
+}
+
+} // namespace FlightSim
@@ -0,0 +1,185 @@
+#include "core/StreamingBuffer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+namespace FlightSim {
+
+// A partition's fence is normally long signaled; this only bounds a hang
+static constexpr GLuint64 MAX_WAIT_NS = 1000000000;
+
+StreamingBuffer::StreamingBuffer()
+    : m_mapped(nullptr)
+    , m_fences{}
+    , m_partitionSize(0)
+    , m_requiredSize(0)
+    , m_partition(0)
+    , m_frameOffset(0)
+    , m_frameOverflow(0)
+    , m_stallCount(0) {
+}
+
+StreamingBuffer::~StreamingBuffer() {
+    Shutdown();
+}
+
+bool StreamingBuffer::IsPersistentSupported() {
+    return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+bool StreamingBuffer::Initialize(size_t partitionSize) {
+    if (partitionSize == 0) return false;
+    if (!CreateStorage(partitionSize)) {
+        std::cerr << "Failed to create streaming buffer" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void StreamingBuffer::Shutdown() {
+    ReleaseStorage();
+    m_partitionSize = 0;
+    m_requiredSize = 0;
+    m_frameOffset = 0;
+    m_frameOverflow = 0;
+}
+
+void StreamingBuffer::BeginFrame() {
+    if (!m_buffer) return;
+    
+    // Grow for the largest frame seen. Every partition may still be read
+    // by the GPU, so all fences are waited on before the storage goes.
+    if (m_requiredSize > m_partitionSize) {
+        size_t size = m_partitionSize;
+        while (size < m_requiredSize) {
+            size *= 2;
+        }
+        for (int partition = 0; partition < PARTITION_COUNT; ++partition) {
+            WaitForPartition(partition);
+        }
+        ReleaseStorage();
+        if (!CreateStorage(size)) {
+            std::cerr << "Failed to grow streaming buffer to " << size << " bytes" << std::endl;
+            return;
+        }
+    }
+    
+    m_partition = (m_partition + 1) % PARTITION_COUNT;
+    m_frameOffset = 0;
+    m_frameOverflow = 0;
+    
+    if (m_mapped) {
+        WaitForPartition(m_partition);
+    } else {
+        // Orphan: the draws of earlier frames keep the old storage
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.Get());
+        glBufferData(GL_COPY_WRITE_BUFFER, m_partitionSize, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void StreamingBuffer::EndFrame() {
+    if (!m_mapped) return;
+    
+    if (m_fences[m_partition]) {
+        glDeleteSync(static_cast<GLsync>(m_fences[m_partition]));
+    }
+    m_fences[m_partition] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Allocate(size_t size, size_t alignment) {
+    if (!m_buffer || size == 0 || alignment == 0) return {};
+    
+    // Align the offset in the whole buffer, which is what draws see
+    const size_t base = m_mapped ? static_cast<size_t>(m_partition) * m_partitionSize : 0;
+    const size_t offset = (base + m_frameOffset + alignment - 1) / alignment * alignment - base;
+    if (offset + size > m_partitionSize) {
+        // Count the whole frame's demand so one grow step covers it
+        m_frameOverflow += size + alignment;
+        m_requiredSize = std::max(m_requiredSize, m_frameOffset + m_frameOverflow);
+        return {};
+    }
+    m_frameOffset = offset + size;
+    
+    Allocation allocation;
+    allocation.offset = base + offset;
+    allocation.size = size;
+    allocation.data = m_mapped ? static_cast<unsigned char*>(m_mapped) + allocation.offset
+                               : m_staging.data() + allocation.offset;
+    return allocation;
+}
+
+void StreamingBuffer::Commit(const Allocation& allocation) {
+    if (m_mapped || !allocation) return;
+    
+    // Ranges of one frame never overlap and the storage was orphaned, so
+    // the driver has nothing to wait for
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.Get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+size_t StreamingBuffer::GetGpuMemorySize() const {
+    if (!m_buffer) return 0;
+    return m_mapped ? m_partitionSize * PARTITION_COUNT : m_partitionSize;
+}
+
+bool StreamingBuffer::CreateStorage(size_t partitionSize) {
+    m_buffer = GLBuffer::Create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.Get());
+    
+    if (IsPersistentSupported()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const size_t size = partitionSize * PARTITION_COUNT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        m_mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+        if (!m_mapped) {
+            // Immutable storage cannot be respecified; start over for orphaning
+            m_buffer = GLBuffer::Create();
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.Get());
+        }
+    }
+    if (!m_mapped) {
+        glBufferData(GL_COPY_WRITE_BUFFER, partitionSize, nullptr, GL_STREAM_DRAW);
+        m_staging.resize(partitionSize);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    
+    m_partitionSize = partitionSize;
+    m_partition = 0;
+    m_frameOffset = 0;
+    return static_cast<bool>(m_buffer);
+}
+
+void StreamingBuffer::ReleaseStorage() {
+    for (void*& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(static_cast<GLsync>(fence));
+            fence = nullptr;
+        }
+    }
+    if (m_mapped) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.Get());
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_mapped = nullptr;
+    }
+    m_buffer.Reset();
+    m_staging.clear();
+    m_staging.shrink_to_fit();
+}
+
+void StreamingBuffer::WaitForPartition(int partition) {
+    GLsync fence = static_cast<GLsync>(m_fences[partition]);
+    if (!fence) return;
+    
+    // Poll first so only waits that actually block are counted
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        m_stallCount++;
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, MAX_WAIT_NS);
+    }
+    glDeleteSync(fence);
+    m_fences[partition] = nullptr;
+}
+
+} // namespace FlightSim
@@ -0,0 +1,221 @@
+#include "core/VertexLayout.h"
+#include "core/Mesh.h"
+#include <glad/glad.h> // GL type enums only; no GL calls, so meshconv needs no loader
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace FlightSim {
+
+// Attribute locations shared by every mesh shader
+static constexpr unsigned int POSITION_LOCATION = 0;
+static constexpr unsigned int NORMAL_LOCATION = 1;
+static constexpr unsigned int TEXCOORD_LOCATION = 2;
+
+// Map a unit vector onto the octahedron and unfold it into [-1, 1]^2
+static glm::vec2 EncodeOctahedral(const glm::vec3& normal) {
+    float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum <= 0.0f) {
+        return glm::vec2(0.0f); // Decodes to +Z
+    }
+    glm::vec3 n = normal / sum;
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.0f) {
+        encoded = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                            (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return encoded;
+}
+
+static glm::vec3 DecodeOctahedral(const glm::vec2& encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+static int16_t ToSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static int8_t ToSnorm8(float value) {
+    return static_cast<int8_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+}
+
+static uint16_t ToUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+VertexLayout::VertexLayout(PositionEncoding position, NormalEncoding normal, TexCoordEncoding texCoord)
+    : m_position(position)
+    , m_normal(normal)
+    , m_texCoord(texCoord)
+    , m_stride(0) {
+    // Every attribute starts on a 4-byte boundary
+    auto add = [this](unsigned int location, unsigned int type, int components, bool normalized, uint32_t size) {
+        m_attributes.push_back({location, type, components, normalized, m_stride});
+        m_stride += (size + 3) & ~3u;
+    };
+    
+    if (m_position == PositionEncoding::Unorm16) {
+        add(POSITION_LOCATION, GL_UNSIGNED_SHORT, 3, true, 6);
+    } else {
+        add(POSITION_LOCATION, GL_FLOAT, 3, false, 12);
+    }
+    
+    switch (m_normal) {
+        case NormalEncoding::Octahedral16:
+            add(NORMAL_LOCATION, GL_SHORT, 2, true, 4);
+            break;
+        case NormalEncoding::Octahedral8:
+            add(NORMAL_LOCATION, GL_BYTE, 2, true, 2);
+            break;
+        default:
+            add(NORMAL_LOCATION, GL_FLOAT, 3, false, 12);
+            break;
+    }
+    
+    switch (m_texCoord) {
+        case TexCoordEncoding::Half16:
+            add(TEXCOORD_LOCATION, GL_HALF_FLOAT, 2, false, 4);
+            break;
+        case TexCoordEncoding::Unorm16:
+            add(TEXCOORD_LOCATION, GL_UNSIGNED_SHORT, 2, true, 4);
+            break;
+        default:
+            add(TEXCOORD_LOCATION, GL_FLOAT, 2, false, 8);
+            break;
+    }
+}
+
+uint32_t VertexLayout::GetCode() const {
+    return static_cast<uint32_t>(m_position) |
+           static_cast<uint32_t>(m_normal) << 8 |
+           static_cast<uint32_t>(m_texCoord) << 16;
+}
+
+bool VertexLayout::FromCode(uint32_t code, VertexLayout& layout) {
+    uint32_t position = code & 0xFF;
+    uint32_t normal = (code >> 8) & 0xFF;
+    uint32_t texCoord = (code >> 16) & 0xFF;
+    if (position > 1 || normal > 2 || texCoord > 2 || (code >> 24) != 0) {
+        return false;
+    }
+    layout = VertexLayout(static_cast<PositionEncoding>(position), static_cast<NormalEncoding>(normal),
+                          static_cast<TexCoordEncoding>(texCoord));
+    return true;
+}
+
+bool VertexLayout::IsStandard() const {
+    return m_position == PositionEncoding::Float32 && m_normal == NormalEncoding::Float32 &&
+           m_texCoord == TexCoordEncoding::Float32;
+}
+
+void VertexLayout::Encode(const Vertex* vertices, size_t count, const glm::vec3& boundsMin,
+                          const glm::vec3& boundsMax, std::vector<uint8_t>& out) const {
+    out.assign(count * m_stride, 0);
+    
+    glm::vec3 extent = boundsMax - boundsMin;
+    glm::vec3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                            extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                            extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+    
+    const uint32_t normalOffset = m_attributes[1].offset;
+    const uint32_t texCoordOffset = m_attributes[2].offset;
+    
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex& vertex = vertices[i];
+        uint8_t* dst = out.data() + i * m_stride;
+        
+        if (m_position == PositionEncoding::Unorm16) {
+            glm::vec3 t = (vertex.position - boundsMin) * inverseExtent;
+            uint16_t packed[3] = {ToUnorm16(t.x), ToUnorm16(t.y), ToUnorm16(t.z)};
+            std::memcpy(dst, packed, sizeof(packed));
+        } else {
+            std::memcpy(dst, &vertex.position, sizeof(glm::vec3));
+        }
+        
+        if (m_normal == NormalEncoding::Float32) {
+            std::memcpy(dst + normalOffset, &vertex.normal, sizeof(glm::vec3));
+        } else {
+            glm::vec2 octahedral = EncodeOctahedral(vertex.normal);
+            if (m_normal == NormalEncoding::Octahedral16) {
+                int16_t packed[2] = {ToSnorm16(octahedral.x), ToSnorm16(octahedral.y)};
+                std::memcpy(dst + normalOffset, packed, sizeof(packed));
+            } else {
+                int8_t packed[2] = {ToSnorm8(octahedral.x), ToSnorm8(octahedral.y)};
+                std::memcpy(dst + normalOffset, packed, sizeof(packed));
+            }
+        }
+        
+        if (m_texCoord == TexCoordEncoding::Half16) {
+            uint16_t packed[2] = {glm::packHalf1x16(vertex.texCoords.x), glm::packHalf1x16(vertex.texCoords.y)};
+            std::memcpy(dst + texCoordOffset, packed, sizeof(packed));
+        } else if (m_texCoord == TexCoordEncoding::Unorm16) {
+            uint16_t packed[2] = {ToUnorm16(vertex.texCoords.x), ToUnorm16(vertex.texCoords.y)};
+            std::memcpy(dst + texCoordOffset, packed, sizeof(packed));
+        } else {
+            std::memcpy(dst + texCoordOffset, &vertex.texCoords, sizeof(glm::vec2));
+        }
+    }
+}
+
+void VertexLayout::Decode(const uint8_t* data, size_t count, const glm::vec3& boundsMin,
+                          const glm::vec3& boundsMax, std::vector<Vertex>& out) const {
+    out.resize(count);
+    
+    const glm::vec3 extent = boundsMax - boundsMin;
+    const uint32_t normalOffset = m_attributes[1].offset;
+    const uint32_t texCoordOffset = m_attributes[2].offset;
+    
+    for (size_t i = 0; i < count; ++i) {
+        Vertex& vertex = out[i];
+        const uint8_t* src = data + i * m_stride;
+        
+        if (m_position == PositionEncoding::Unorm16) {
+            uint16_t packed[3];
+            std::memcpy(packed, src, sizeof(packed));
+            vertex.position = boundsMin + glm::vec3(packed[0], packed[1], packed[2]) / 65535.0f * extent;
+        } else {
+            std::memcpy(&vertex.position, src, sizeof(glm::vec3));
+        }
+        
+        if (m_normal == NormalEncoding::Float32) {
+            std::memcpy(&vertex.normal, src + normalOffset, sizeof(glm::vec3));
+        } else if (m_normal == NormalEncoding::Octahedral16) {
+            int16_t packed[2];
+            std::memcpy(packed, src + normalOffset, sizeof(packed));
+            vertex.normal = DecodeOctahedral(glm::max(glm::vec2(packed[0], packed[1]) / 32767.0f, glm::vec2(-1.0f)));
+        } else {
+            int8_t packed[2];
+            std::memcpy(packed, src + normalOffset, sizeof(packed));
+            vertex.normal = DecodeOctahedral(glm::max(glm::vec2(packed[0], packed[1]) / 127.0f, glm::vec2(-1.0f)));
+        }
+        
+        if (m_texCoord == TexCoordEncoding::Half16) {
+            uint16_t packed[2];
+            std::memcpy(packed, src + texCoordOffset, sizeof(packed));
+            vertex.texCoords = glm::vec2(glm::unpackHalf1x16(packed[0]), glm::unpackHalf1x16(packed[1]));
+        } else if (m_texCoord == TexCoordEncoding::Unorm16) {
+            uint16_t packed[2];
+            std::memcpy(packed, src + texCoordOffset, sizeof(packed));
+            vertex.texCoords = glm::vec2(packed[0], packed[1]) / 65535.0f;
+        } else {
+            std::memcpy(&vertex.texCoords, src + texCoordOffset, sizeof(glm::vec2));
+        }
+    }
+}
+
+VertexDecode VertexLayout::GetDecode(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    VertexDecode decode;
+    if (m_position == PositionEncoding::Unorm16) {
+        decode.positionOffset = boundsMin;
+        decode.positionScale = boundsMax - boundsMin;
+    }
+    decode.octahedralNormals = m_normal != NormalEncoding::Float32;
+    return decode;
+}
+
+} // namespace FlightSim
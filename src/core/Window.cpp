@@ -64,6 +64,18 @@ void Window::PollEvents() {
     glfwPollEvents();
 }
 
+void Window::WaitEvents(double timeoutSeconds) {
+    glfwWaitEventsTimeout(timeoutSeconds);
+}
+
+bool Window::IsFocused() const {
+    return glfwGetWindowAttrib(m_window, GLFW_FOCUSED) != 0;
+}
+
+bool Window::IsMinimized() const {
+    return glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0;
+}
+
 void Window::SetKeyCallback(KeyCallback callback) {
     m_keyCallback = callback;
 }
@@ -80,10 +92,25 @@ void Window::SetResizeCallback(ResizeCallback callback) {
     m_resizeCallback = callback;
 }
 
+void Window::GetFramebufferSize(int& width, int& height) const {
+    // Differs from the window size on high-DPI displays
+    glfwGetFramebufferSize(m_window, &width, &height);
+}
+
 void Window::SetVSync(bool enabled) {
     glfwSwapInterval(enabled ? 1 : 0);
 }
 
+bool Window::SetAdaptiveVSync() {
+    // A negative interval enables late swap tearing
+    if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        glfwSwapInterval(-1);
+        return true;
+    }
+    glfwSwapInterval(1);
+    return false;
+}
+
 void Window::SetCursorMode(int mode) {
     glfwSetInputMode(m_window, GLFW_CURSOR, mode);
 }
@@ -1,11 +1,168 @@
 #include <iostream>
 #include <exception>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <string>
 
 #include "core/Application.h"
+#include "renderer/VolumetricClouds.h"
 
-int main() {
+static void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --headless         Render offscreen without a window (EGL)" << std::endl;
+    std::cout << "  --size WxH         Window or offscreen resolution (default 1280x720)" << std::endl;
+    std::cout << "  --frames N         Frames to render in headless mode (default 300)" << std::endl;
+    std::cout << "  --output FILE      Write the last headless frame as PPM" << std::endl;
+    std::cout << "  --golden FILE      Compare the last headless frame against a reference PPM" << std::endl;
+    std::cout << "  --tolerance N      Per-channel difference allowed by --golden (default 8)" << std::endl;
+    std::cout << "  --profile FILE     Write GPU pass timings as CSV after a headless run" << std::endl;
+    std::cout << "  --capture FILE     Record every frame (.y4m, otherwise raw RGBA)" << std::endl;
+    std::cout << "  --capture-fps N    Frame rate stored in the Y4M header (default 60)" << std::endl;
+    std::cout << "  --pacing MODE      off, vsync, adaptive or limiter (default vsync)" << std::endl;
+    std::cout << "  --fps N            Target frame rate for --pacing limiter (default 60)" << std::endl;
+    std::cout << "  --cpu-culling      Pick aircraft levels and batches on the CPU even with GL 4.3" << std::endl;
+    std::cout << "  --scenery FILE     Place trees and buildings from a file instead of procedurally" << std::endl;
+    std::cout << "  --clouds QUALITY   off, low, medium, high or ultra (default medium)" << std::endl;
+    std::cout << "  --cloud-budget MS  GPU time for clouds in windowed runs, 0 = fixed quality (default 1.5)"
+              << std::endl;
+    std::cout << "  --sensor WxH[@HZ]  Add a downward sensor view (repeatable; default every frame)" << std::endl;
+    std::cout << "  --sensor-output P  Write the last frame of sensor N as PN.ppm" << std::endl;
+}
+
+// Whole-string decimal integer of at least minimum
+static bool ParseInt(const char* text, int minimum, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < minimum || parsed > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// Whole-string finite decimal number of at least minimum
+static bool ParseFloat(const char* text, float minimum, float& value) {
+    char* end = nullptr;
+    float parsed = std::strtof(text, &end);
+    if (end == text || *end != '\0' || !std::isfinite(parsed) || parsed < minimum) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+static bool ParseArguments(int argc, char** argv, FlightSim::LaunchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                std::cerr << "Invalid size: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--frames" && hasValue) {
+            if (!ParseInt(argv[++i], 1, options.frames)) {
+                std::cerr << "Invalid frame count: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else if (arg == "--golden" && hasValue) {
+            options.goldenPath = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            if (!ParseInt(argv[++i], 0, options.goldenTolerance)) {
+                std::cerr << "Invalid tolerance: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--profile" && hasValue) {
+            options.profilePath = argv[++i];
+        } else if (arg == "--capture" && hasValue) {
+            options.capturePath = argv[++i];
+        } else if (arg == "--capture-fps" && hasValue) {
+            if (!ParseInt(argv[++i], 1, options.captureFramesPerSecond)) {
+                std::cerr << "Invalid capture frame rate: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--pacing" && hasValue) {
+            if (!FlightSim::FramePacer::ParseMode(argv[++i], options.pacing)) {
+                std::cerr << "Invalid pacing mode: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--fps" && hasValue) {
+            if (!ParseFloat(argv[++i], 1.0f, options.targetFps)) {
+                std::cerr << "Invalid frame rate: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--cpu-culling") {
+            options.gpuCulling = false;
+        } else if (arg == "--scenery" && hasValue) {
+            options.sceneryPath = argv[++i];
+        } else if (arg == "--clouds" && hasValue) {
+            if (!FlightSim::VolumetricClouds::ParseQuality(argv[++i], options.cloudQuality)) {
+                std::cerr << "Invalid cloud quality: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--cloud-budget" && hasValue) {
+            if (!ParseFloat(argv[++i], 0.0f, options.cloudBudgetMs)) {
+                std::cerr << "Invalid cloud budget: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--sensor" && hasValue) {
+            // Either WxH or WxH@HZ, with nothing left over
+            FlightSim::SensorOptions sensor;
+            const char* text = argv[++i];
+            int length = static_cast<int>(std::strlen(text));
+            int consumed = -1;
+            bool valid = std::sscanf(text, "%dx%d%n", &sensor.width, &sensor.height, &consumed) == 2 &&
+                         consumed == length;
+            if (!valid) {
+                consumed = -1;
+                valid = std::sscanf(text, "%dx%d@%f%n", &sensor.width, &sensor.height, &sensor.rateHz,
+                                    &consumed) == 3 && consumed == length;
+            }
+            if (!valid || sensor.width <= 0 || sensor.height <= 0 || !std::isfinite(sensor.rateHz) ||
+                sensor.rateHz < 0.0f) {
+                std::cerr << "Invalid sensor: " << argv[i] << std::endl;
+                return false;
+            }
+            options.sensors.push_back(sensor);
+        } else if (arg == "--sensor-output" && hasValue) {
+            options.sensorOutputPrefix = argv[++i];
+        } else {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            return false;
+        }
+    }
+    
+    if (!options.headless && (!options.outputPath.empty() || !options.goldenPath.empty())) {
+        std::cerr << "--output and --golden require --headless" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    FlightSim::LaunchOptions options;
+    if (argc > 1 && (std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+    if (!ParseArguments(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    
     try {
-        FlightSim::Application app;
+        FlightSim::Application app(options);
         
         if (!app.Initialize()) {
             std::cerr << "Failed to initialize Flight Simulator" << std::endl;
@@ -13,27 +170,28 @@ int main() {
         }
         
         std::cout << "Professional Flight Simulator v1.0 - Starting..." << std::endl;
-        std::cout << "Controls:" << std::endl;
-        std::cout << "  W/S: Pitch (Elevator)" << std::endl;
-        std::cout << "  A/D: Roll (Aileron)" << std::endl;
-        std::cout << "  Q/E: Yaw (Rudder)" << std::endl;
-        std::cout << "  Shift/Ctrl: Throttle" << std::endl;
-        std::cout << "  F: Toggle Flaps" << std::endl;
-        std::cout << "  G: Toggle Landing Gear" << std::endl;
-        std::cout << "  C: Change Camera Mode" << std::endl;
-        std::cout << "  R: Reset Aircraft" << std::endl;
-        std::cout << "  ESC: Exit" << std::endl;
-        std::cout << std::endl;
+        if (!options.headless) {
+            std::cout << "Controls:" << std::endl;
+            std::cout << "  W/S: Pitch (Elevator)" << std::endl;
+            std::cout << "  A/D: Roll (Aileron)" << std::endl;
+            std::cout << "  Q/E: Yaw (Rudder)" << std::endl;
+            std::cout << "  Shift/Ctrl: Throttle" << std::endl;
+            std::cout << "  F: Toggle Flaps" << std::endl;
+            std::cout << "  G: Toggle Landing Gear" << std::endl;
+            std::cout << "  C: Change Camera Mode" << std::endl;
+            std::cout << "  R: Reset Aircraft" << std::endl;
+            std::cout << "  ESC: Exit" << std::endl;
+            std::cout << std::endl;
+        }
         
         app.Run();
         
         app.Shutdown();
         std::cout << "Flight Simulator shutdown complete." << std::endl;
         
+        return app.GetExitCode();
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return -1;
     }
-    
-    return 0;
 } 
\ No newline at end of file
@@ -52,6 +52,7 @@ void Aircraft::Update(float deltaTime, const ControlInputs& controls) {
     
     // Update derived values
     UpdateDerivedValues();
+    m_state.throttle = controls.throttle;
 }
 
 glm::mat4 Aircraft::GetModelMatrix() const {
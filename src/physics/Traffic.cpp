@@ -0,0 +1,74 @@
+#include "physics/Traffic.h"
+#include <glm/gtc/quaternion.hpp>
+#include <random>
+#include <cmath>
+
+namespace FlightSim {
+
+Traffic::Traffic() {
+}
+
+Traffic::~Traffic() {
+}
+
+void Traffic::Spawn(int count, const glm::vec3& center, float radius, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    
+    m_orbits.reserve(m_orbits.size() + count);
+    m_states.reserve(m_states.size() + count);
+    
+    for (int i = 0; i < count; ++i) {
+        // Uniform over the disc, stacked in altitude bands
+        float r = radius * std::sqrt(unit(rng));
+        float theta = 6.2831853f * unit(rng);
+        
+        Orbit orbit;
+        orbit.center = center + glm::vec3(r * std::cos(theta), 300.0f + 4000.0f * unit(rng), r * std::sin(theta));
+        orbit.radius = 500.0f + 2500.0f * unit(rng);
+        
+        float speed = 60.0f + 120.0f * unit(rng); // m/s
+        orbit.angularSpeed = (unit(rng) < 0.5f ? -1.0f : 1.0f) * speed / orbit.radius;
+        orbit.phase = 6.2831853f * unit(rng);
+        
+        m_orbits.push_back(orbit);
+        m_states.emplace_back();
+        UpdateState(orbit, m_states.back());
+    }
+}
+
+void Traffic::Clear() {
+    m_orbits.clear();
+    m_states.clear();
+}
+
+void Traffic::Update(float deltaTime) {
+    for (size_t i = 0; i < m_orbits.size(); ++i) {
+        Orbit& orbit = m_orbits[i];
+        orbit.phase = std::fmod(orbit.phase + orbit.angularSpeed * deltaTime, 6.2831853f);
+        UpdateState(orbit, m_states[i]);
+    }
+}
+
+void Traffic::UpdateState(const Orbit& orbit, AircraftState& state) const {
+    float c = std::cos(orbit.phase);
+    float s = std::sin(orbit.phase);
+    
+    state.position = orbit.center + glm::vec3(orbit.radius * c, 0.0f, orbit.radius * s);
+    state.velocity = orbit.angularSpeed * orbit.radius * glm::vec3(-s, 0.0f, c);
+    
+    // Forward is +Z in body space; yaw onto the tangent and bank into the turn
+    float yaw = std::atan2(state.velocity.x, state.velocity.z);
+    float bank = orbit.angularSpeed > 0.0f ? -0.35f : 0.35f;
+    state.orientation = glm::angleAxis(yaw, glm::vec3(0.0f, 1.0f, 0.0f)) *
+                        glm::angleAxis(bank, glm::vec3(0.0f, 0.0f, 1.0f));
+    
+    state.airspeed = std::fabs(orbit.angularSpeed) * orbit.radius;
+    state.altitude = state.position.y;
+    state.verticalSpeed = 0.0f;
+    state.heading = std::fmod(glm::degrees(yaw) + 360.0f, 360.0f);
+    state.pitch = 0.0f;
+    state.roll = glm::degrees(bank);
+}
+
+} // namespace FlightSim
@@ -0,0 +1,97 @@
+#include "physics/TrailRecorder.h"
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/norm.hpp>
+#include <atomic>
+
+namespace FlightSim {
+
+// Generations are unique across recorders, so a renderer slot reused by a
+// different trail is always restarted
+static std::atomic<uint32_t> s_nextGeneration{1};
+
+// Squared distance from point to the segment start-end
+static float DistanceToSegmentSquared(const glm::vec3& point, const glm::vec3& start, const glm::vec3& end) {
+    glm::vec3 segment = end - start;
+    float lengthSquared = glm::length2(segment);
+    if (lengthSquared < 1e-8f) {
+        return glm::length2(point - start);
+    }
+    float t = glm::clamp(glm::dot(point - start, segment) / lengthSquared, 0.0f, 1.0f);
+    return glm::length2(point - (start + segment * t));
+}
+
+TrailRecorder::TrailRecorder(float tolerance, float maxSegmentLength)
+    : m_tolerance(tolerance)
+    , m_maxSegmentLength(maxSegmentLength)
+    , m_generation(0)
+    , m_committedCount(0)
+    , m_lastTick(0)
+    , m_anchor(0.0f)
+    , m_head(0.0f) {
+}
+
+void TrailRecorder::Reset(const glm::vec3& position, float time) {
+    m_generation = s_nextGeneration++;
+    m_committedCount = 0;
+    m_recent.clear();
+    m_pending.clear();
+    CommitPoint({position, time}, m_lastTick);
+    m_head = position;
+}
+
+void TrailRecorder::AddSample(const glm::vec3& position, float time, uint64_t tick) {
+    m_lastTick = tick;
+    m_head = position;
+    
+    // Drop commits the renderer can no longer be missing
+    while (!m_recent.empty() && m_recent.front().tick + PUBLISH_WINDOW_TICKS < tick) {
+        m_recent.pop_front();
+    }
+    
+    if (m_committedCount == 0) {
+        CommitPoint({position, time}, tick);
+        return;
+    }
+    
+    // Can the live segment be stretched to the new sample? If not, the
+    // previous sample becomes a vertex and the live segment starts there.
+    if (!m_pending.empty() &&
+        (m_pending.size() >= MAX_PENDING_SAMPLES || !FitsSegment(m_anchor, position))) {
+        TrailPoint corner = m_pending.back();
+        m_pending.clear();
+        CommitPoint(corner, tick);
+    }
+    m_pending.push_back({position, time});
+}
+
+bool TrailRecorder::FitsSegment(const glm::vec3& start, const glm::vec3& end) const {
+    if (glm::length2(end - start) > m_maxSegmentLength * m_maxSegmentLength) {
+        return false;
+    }
+    
+    float toleranceSquared = m_tolerance * m_tolerance;
+    for (const TrailPoint& sample : m_pending) {
+        if (DistanceToSegmentSquared(sample.position, start, end) > toleranceSquared) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TrailRecorder::CommitPoint(const TrailPoint& point, uint64_t tick) {
+    m_recent.push_back({point, tick});
+    m_anchor = point.position;
+    m_committedCount++;
+}
+
+void TrailRecorder::Fill(TrailUpdate& update) const {
+    update.generation = m_generation;
+    update.committedCount = m_committedCount;
+    update.head = m_head;
+    update.recentPoints.clear();
+    for (const Commit& commit : m_recent) {
+        update.recentPoints.push_back(commit.point);
+    }
+}
+
+} // namespace FlightSim
@@ -0,0 +1,549 @@
+#include "renderer/Atmosphere.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <cmath>
+#include <iostream>
+
+namespace FlightSim {
+
+// Texture units the tables are bound to while drawing
+static constexpr unsigned int TRANSMITTANCE_TEXTURE_UNIT = 4;
+static constexpr unsigned int SCATTERING_TEXTURE_UNIT = 5;
+static constexpr unsigned int IRRADIANCE_TEXTURE_UNIT = 6;
+
+static constexpr float PI = 3.14159265f;
+
+// Physical constants, lengths in kilometers (Earth, clear sky). Also the
+// table parameterizations shared by generation and lookup.
+static const char* ATMOSPHERE_COMMON_SOURCE = R"(
+const float PI = 3.14159265;
+const float BOTTOM_RADIUS = 6360.0;
+const float TOP_RADIUS = 6420.0;
+const vec3 RAYLEIGH_SCATTERING = vec3(5.802e-3, 13.558e-3, 33.1e-3);
+const float RAYLEIGH_SCALE_HEIGHT = 8.0;
+const vec3 MIE_SCATTERING = vec3(3.996e-3);
+const vec3 MIE_EXTINCTION = vec3(4.440e-3);
+const float MIE_SCALE_HEIGHT = 1.2;
+const float MIE_ASYMMETRY = 0.8;
+const vec3 OZONE_ABSORPTION = vec3(0.650e-3, 1.881e-3, 0.085e-3);
+const float SUN_ANGULAR_RADIUS = 0.004675;
+
+// A white surface facing the sun above the atmosphere reflects radiance 1
+const vec3 SUN_ILLUMINANCE = vec3(PI);
+
+uniform sampler2D transmittanceLut;
+uniform sampler3D scatteringLut;
+uniform sampler2D irradianceLut;
+
+float SafeSqrt(float a) { return sqrt(max(a, 0.0)); }
+float ClampCosine(float mu) { return clamp(mu, -1.0, 1.0); }
+float ClampRadius(float r) { return clamp(r, BOTTOM_RADIUS, TOP_RADIUS); }
+
+float DistanceToTop(float r, float mu) {
+    return max(-r * mu + SafeSqrt(r * r * (mu * mu - 1.0) + TOP_RADIUS * TOP_RADIUS), 0.0);
+}
+
+float DistanceToBottom(float r, float mu) {
+    return max(-r * mu - SafeSqrt(r * r * (mu * mu - 1.0) + BOTTOM_RADIUS * BOTTOM_RADIUS), 0.0);
+}
+
+bool RayHitsGround(float r, float mu) {
+    return mu < 0.0 && r * r * (mu * mu - 1.0) + BOTTOM_RADIUS * BOTTOM_RADIUS >= 0.0;
+}
+
+// Texel centers sit at 0 and 1 so the ends of each range do not clamp
+float ToTextureCoord(float x, float size) { return 0.5 / size + x * (1.0 - 1.0 / size); }
+float FromTextureCoord(float u, float size) { return (u - 0.5 / size) / (1.0 - 1.0 / size); }
+
+// Transmittance is indexed by the distance to the top of the atmosphere,
+// which puts most texels near the horizon where it changes fastest
+vec2 TransmittanceUv(float r, float mu) {
+    float H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+    float rho = SafeSqrt(r * r - BOTTOM_RADIUS * BOTTOM_RADIUS);
+    float d = DistanceToTop(r, mu);
+    float dMin = TOP_RADIUS - r;
+    float dMax = rho + H;
+    return vec2(ToTextureCoord((d - dMin) / (dMax - dMin), TRANSMITTANCE_SIZE.x),
+                ToTextureCoord(rho / H, TRANSMITTANCE_SIZE.y));
+}
+
+// Scattering: altitude with more texels near the ground, view zenith split
+// at the horizon (ground rays below 0.5) and sun zenith down to -0.2
+vec3 ScatteringUvw(float r, float mu, float muS) {
+    float xR = sqrt(clamp((r - BOTTOM_RADIUS) / (TOP_RADIUS - BOTTOM_RADIUS), 0.0, 1.0));
+    float muHorizon = -SafeSqrt(r * r - BOTTOM_RADIUS * BOTTOM_RADIUS) / r;
+    float xMu;
+    if (mu > muHorizon) {
+        xMu = 0.5 + 0.5 * pow((mu - muHorizon) / (1.0 - muHorizon), 0.2);
+    } else {
+        xMu = 0.5 - 0.5 * pow((muHorizon - mu) / (1.0 + muHorizon), 0.2);
+    }
+    float xMuS = clamp((1.0 - exp(-3.0 * muS - 0.6)) / (1.0 - exp(-3.6)), 0.0, 1.0);
+    return vec3(ToTextureCoord(xMu, SCATTERING_SIZE.x), ToTextureCoord(xMuS, SCATTERING_SIZE.y),
+                ToTextureCoord(xR, SCATTERING_SIZE.z));
+}
+
+vec2 IrradianceUv(float r, float muS) {
+    return vec2(ToTextureCoord(muS * 0.5 + 0.5, IRRADIANCE_SIZE.x),
+                ToTextureCoord((r - BOTTOM_RADIUS) / (TOP_RADIUS - BOTTOM_RADIUS), IRRADIANCE_SIZE.y));
+}
+
+vec3 GetTransmittanceToTop(float r, float mu) {
+    return texture(transmittanceLut, TransmittanceUv(r, mu)).rgb;
+}
+
+// Transmittance over distance d along (r, mu). Ground rays are looked up
+// reversed, since the table only covers rays that reach the top.
+vec3 GetTransmittance(float r, float mu, float d, bool hitsGround) {
+    float rD = ClampRadius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+    float muD = ClampCosine((r * mu + d) / rD);
+    if (hitsGround) {
+        return min(GetTransmittanceToTop(rD, -muD) / max(GetTransmittanceToTop(r, -mu), vec3(1e-6)), vec3(1.0));
+    }
+    return min(GetTransmittanceToTop(r, mu) / max(GetTransmittanceToTop(rD, muD), vec3(1e-6)), vec3(1.0));
+}
+
+// Fades the sun out as its disc sets below the horizon
+vec3 GetSunTransmittance(float r, float muS) {
+    float sinHorizon = BOTTOM_RADIUS / r;
+    float cosHorizon = -SafeSqrt(1.0 - sinHorizon * sinHorizon);
+    return GetTransmittanceToTop(r, muS) *
+           smoothstep(-sinHorizon * SUN_ANGULAR_RADIUS, sinHorizon * SUN_ANGULAR_RADIUS, muS - cosHorizon);
+}
+
+float RayleighPhase(float nu) {
+    return 3.0 / (16.0 * PI) * (1.0 + nu * nu);
+}
+
+float MiePhase(float nu) {
+    float g = MIE_ASYMMETRY;
+    float k = 3.0 / (8.0 * PI) * (1.0 - g * g) / (2.0 + g * g);
+    return k * (1.0 + nu * nu) / pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+}
+
+// Tables store Rayleigh in rgb and only the red channel of Mie in alpha;
+// the other Mie channels follow from the ratio of the coefficients
+vec3 GetExtrapolatedMie(vec4 scattering) {
+    if (scattering.r <= 0.0) return vec3(0.0);
+    return scattering.rgb * scattering.a / scattering.r * (RAYLEIGH_SCATTERING.r / MIE_SCATTERING.r) *
+           (MIE_SCATTERING / RAYLEIGH_SCATTERING);
+}
+
+// Radiance per unit sun illuminance for a table entry and view-sun cosine
+vec3 GetScattering(vec4 scattering, float nu) {
+    return scattering.rgb * RayleighPhase(nu) + GetExtrapolatedMie(scattering) * MiePhase(nu);
+}
+)";
+
+// Lookups used by the sky, terrain and aircraft shaders
+static const char* ATMOSPHERE_LIBRARY_SOURCE = R"(
+uniform vec3 sunDirection;
+uniform float exposure;
+
+// Meters with the ground at y = 0 to kilometers from the planet center
+vec3 WorldToAtmosphere(vec3 position) {
+    return vec3(position.x * 0.001, BOTTOM_RADIUS + max(position.y * 0.001, 0.001), position.z * 0.001);
+}
+
+// Radiance reaching camera along viewRay from outside the scene
+vec3 GetSkyRadiance(vec3 camera, vec3 viewRay, out vec3 transmittance) {
+    float r = length(camera);
+    float rmu = dot(camera, viewRay);
+    float distanceToTop = -rmu - SafeSqrt(rmu * rmu - r * r + TOP_RADIUS * TOP_RADIUS);
+    if (distanceToTop > 0.0) {
+        // Camera in space: start where the ray enters the atmosphere
+        camera += viewRay * distanceToTop;
+        r = TOP_RADIUS;
+        rmu += distanceToTop;
+    } else if (r > TOP_RADIUS) {
+        transmittance = vec3(1.0);
+        return vec3(0.0);
+    }
+    
+    float mu = rmu / r;
+    float muS = dot(camera, sunDirection) / r;
+    float nu = dot(viewRay, sunDirection);
+    transmittance = RayHitsGround(r, mu) ? vec3(0.0) : GetTransmittanceToTop(r, mu);
+    return GetScattering(texture(scatteringLut, ScatteringUvw(r, mu, muS)), nu) * SUN_ILLUMINANCE;
+}
+
+// Aerial perspective: light scattered into the segment from camera to
+// point, the difference of two table lookups
+vec3 GetSkyRadianceToPoint(vec3 camera, vec3 point, out vec3 transmittance) {
+    vec3 viewRay = point - camera;
+    float d = length(viewRay);
+    if (d < 1e-6) {
+        transmittance = vec3(1.0);
+        return vec3(0.0);
+    }
+    viewRay /= d;
+    
+    float r = ClampRadius(length(camera));
+    float mu = dot(camera, viewRay) / length(camera);
+    float muS = dot(camera, sunDirection) / length(camera);
+    float nu = dot(viewRay, sunDirection);
+    bool hitsGround = RayHitsGround(r, mu);
+    transmittance = GetTransmittance(r, mu, d, hitsGround);
+    
+    float rP = ClampRadius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+    float muP = ClampCosine((r * mu + d) / rP);
+    float muSP = ClampCosine((r * muS + d * nu) / rP);
+    vec4 scattering = texture(scatteringLut, ScatteringUvw(r, mu, muS));
+    vec4 scatteringP = texture(scatteringLut, ScatteringUvw(rP, muP, muSP));
+    scattering = max(scattering - transmittance.rgbr * scatteringP, vec4(0.0));
+    return GetScattering(scattering, nu) * SUN_ILLUMINANCE;
+}
+
+// Direct sun irradiance on a surface; skyIrradiance receives the light
+// from the rest of the sky, scaled for how much of it the normal sees
+vec3 GetSunAndSkyIrradiance(vec3 point, vec3 normal, out vec3 skyIrradiance) {
+    float r = ClampRadius(length(point));
+    vec3 up = normalize(point);
+    float muS = dot(up, sunDirection);
+    skyIrradiance = texture(irradianceLut, IrradianceUv(r, muS)).rgb * SUN_ILLUMINANCE *
+                    (1.0 + dot(normal, up)) * 0.5;
+    return SUN_ILLUMINANCE * GetSunTransmittance(r, muS) * max(dot(normal, sunDirection), 0.0);
+}
+
+// Exponential tone map and gamma for the default framebuffer
+vec3 ToDisplay(vec3 radiance) {
+    return pow(vec3(1.0) - exp(-radiance * exposure), vec3(1.0 / 2.2));
+}
+)";
+
+// Fullscreen triangle from gl_VertexID; the generation passes have no mesh
+static const char* TABLE_VERTEX_SOURCE = R"(
+#version 330 core
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+static const char* TRANSMITTANCE_FRAGMENT_SOURCE = R"(
+out vec4 FragColor;
+
+vec3 GetExtinction(float altitude) {
+    altitude = max(altitude, 0.0);
+    float ozone = max(0.0, 1.0 - abs(altitude - 25.0) / 15.0);
+    return RAYLEIGH_SCATTERING * exp(-altitude / RAYLEIGH_SCALE_HEIGHT) +
+           MIE_EXTINCTION * exp(-altitude / MIE_SCALE_HEIGHT) + OZONE_ABSORPTION * ozone;
+}
+
+void main() {
+    // Invert TransmittanceUv for this texel
+    vec2 uv = gl_FragCoord.xy / TRANSMITTANCE_SIZE;
+    float xMu = FromTextureCoord(uv.x, TRANSMITTANCE_SIZE.x);
+    float xR = FromTextureCoord(uv.y, TRANSMITTANCE_SIZE.y);
+    float H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+    float rho = H * xR;
+    float r = sqrt(rho * rho + BOTTOM_RADIUS * BOTTOM_RADIUS);
+    float dMin = TOP_RADIUS - r;
+    float dMax = rho + H;
+    float d = dMin + xMu * (dMax - dMin);
+    float mu = d == 0.0 ? 1.0 : ClampCosine((H * H - rho * rho - d * d) / (2.0 * r * d));
+    
+    // Trapezoidal optical depth to the top of the atmosphere
+    const int SAMPLES = 128;
+    float dx = DistanceToTop(r, mu) / float(SAMPLES);
+    vec3 opticalDepth = vec3(0.0);
+    for (int i = 0; i <= SAMPLES; ++i) {
+        float di = float(i) * dx;
+        float ri = sqrt(di * di + 2.0 * r * mu * di + r * r);
+        float weight = (i == 0 || i == SAMPLES) ? 0.5 : 1.0;
+        opticalDepth += GetExtinction(ri - BOTTOM_RADIUS) * weight * dx;
+    }
+    FragColor = vec4(exp(-opticalDepth), 1.0);
+}
+)";
+
+static const char* SCATTERING_FRAGMENT_SOURCE = R"(
+out vec4 FragColor;
+
+uniform float layer; // Texture coordinate of the altitude slice
+
+void main() {
+    // Invert ScatteringUvw for this texel
+    vec2 uv = gl_FragCoord.xy / SCATTERING_SIZE.xy;
+    float xMu = FromTextureCoord(uv.x, SCATTERING_SIZE.x);
+    float xMuS = FromTextureCoord(uv.y, SCATTERING_SIZE.y);
+    float xR = FromTextureCoord(layer, SCATTERING_SIZE.z);
+    
+    float r = BOTTOM_RADIUS + xR * xR * (TOP_RADIUS - BOTTOM_RADIUS);
+    float muHorizon = -SafeSqrt(r * r - BOTTOM_RADIUS * BOTTOM_RADIUS) / r;
+    bool hitsGround = xMu < 0.5;
+    float mu = hitsGround ? muHorizon - pow(1.0 - 2.0 * xMu, 5.0) * (1.0 + muHorizon)
+                          : muHorizon + pow(2.0 * xMu - 1.0, 5.0) * (1.0 - muHorizon);
+    float muS = -(log(1.0 - xMuS * (1.0 - exp(-3.6))) + 0.6) / 3.0;
+    
+    // The table has no view-sun azimuth; integrate with the sun 90 degrees
+    // from the view azimuth, the middle of the range
+    float nu = mu * muS;
+    
+    const int SAMPLES = 64;
+    float rayLength = hitsGround ? DistanceToBottom(r, mu) : DistanceToTop(r, mu);
+    float dx = rayLength / float(SAMPLES);
+    vec3 rayleigh = vec3(0.0);
+    vec3 mie = vec3(0.0);
+    for (int i = 0; i <= SAMPLES; ++i) {
+        float d = float(i) * dx;
+        float rD = ClampRadius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+        float muSD = ClampCosine((r * muS + d * nu) / rD);
+        vec3 transmittance = GetTransmittance(r, mu, d, hitsGround) * GetSunTransmittance(rD, muSD);
+        
+        float altitude = rD - BOTTOM_RADIUS;
+        float weight = (i == 0 || i == SAMPLES) ? 0.5 : 1.0;
+        rayleigh += transmittance * exp(-altitude / RAYLEIGH_SCALE_HEIGHT) * weight;
+        mie += transmittance * exp(-altitude / MIE_SCALE_HEIGHT) * weight;
+    }
+    rayleigh *= RAYLEIGH_SCATTERING * dx;
+    mie *= MIE_SCATTERING * dx;
+    FragColor = vec4(rayleigh, mie.r);
+}
+)";
+
+static const char* IRRADIANCE_FRAGMENT_SOURCE = R"(
+out vec4 FragColor;
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / IRRADIANCE_SIZE;
+    float muS = FromTextureCoord(uv.x, IRRADIANCE_SIZE.x) * 2.0 - 1.0;
+    float r = BOTTOM_RADIUS + FromTextureCoord(uv.y, IRRADIANCE_SIZE.y) * (TOP_RADIUS - BOTTOM_RADIUS);
+    vec3 sun = vec3(SafeSqrt(1.0 - muS * muS), muS, 0.0);
+    
+    // Cosine-weighted integral of the sky radiance over the upper hemisphere
+    const int THETA_STEPS = 16;
+    const int PHI_STEPS = 32;
+    float dTheta = 0.5 * PI / float(THETA_STEPS);
+    float dPhi = 2.0 * PI / float(PHI_STEPS);
+    vec3 irradiance = vec3(0.0);
+    for (int j = 0; j < THETA_STEPS; ++j) {
+        float theta = (float(j) + 0.5) * dTheta;
+        for (int i = 0; i < PHI_STEPS; ++i) {
+            float phi = (float(i) + 0.5) * dPhi;
+            vec3 direction = vec3(cos(phi) * sin(theta), cos(theta), sin(phi) * sin(theta));
+            vec4 scattering = texture(scatteringLut, ScatteringUvw(r, direction.y, muS));
+            irradiance += GetScattering(scattering, dot(direction, sun)) * direction.y * sin(theta) * dTheta * dPhi;
+        }
+    }
+    FragColor = vec4(irradiance, 1.0);
+}
+)";
+
+// Table sizes as GLSL constants, so shaders and C++ cannot disagree
+static std::string GetSizeConstants() {
+    auto vec = [](int x, int y) {
+        return "vec2(" + std::to_string(x) + ".0, " + std::to_string(y) + ".0)";
+    };
+    return "const vec2 TRANSMITTANCE_SIZE = " +
+           vec(Atmosphere::TRANSMITTANCE_WIDTH, Atmosphere::TRANSMITTANCE_HEIGHT) + ";\n" +
+           "const vec3 SCATTERING_SIZE = vec3(" +
+           vec(Atmosphere::SCATTERING_WIDTH, Atmosphere::SCATTERING_HEIGHT) + ", " +
+           std::to_string(Atmosphere::SCATTERING_DEPTH) + ".0);\n" +
+           "const vec2 IRRADIANCE_SIZE = " +
+           vec(Atmosphere::IRRADIANCE_WIDTH, Atmosphere::IRRADIANCE_HEIGHT) + ";\n";
+}
+
+static std::string MakeTableShaderSource(const char* body) {
+    return std::string("#version 330 core\n") + GetSizeConstants() + ATMOSPHERE_COMMON_SOURCE + body;
+}
+
+static unsigned int CreateTableTexture(unsigned int target, unsigned int internalFormat, int width, int height,
+                                       int depth) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    GLStateCache::Get().BindTexture(0, target, texture);
+    if (target == GL_TEXTURE_3D) {
+        glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, width, height, depth, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+Atmosphere::Atmosphere()
+    : m_transmittanceTexture(0)
+    , m_scatteringTexture(0)
+    , m_irradianceTexture(0)
+    , m_sunDirection(glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f)))
+    , m_timeOfDay(0.5f)
+    , m_exposure(4.0f)
+    , m_ready(false) {
+}
+
+Atmosphere::~Atmosphere() {
+    Shutdown();
+}
+
+bool Atmosphere::Initialize() {
+    if (!CreateTextures()) {
+        std::cerr << "Failed to create atmosphere lookup tables" << std::endl;
+        Shutdown();
+        return false;
+    }
+    if (!RenderTables()) {
+        Shutdown();
+        return false;
+    }
+    m_ready = true;
+    return true;
+}
+
+void Atmosphere::Shutdown() {
+    // Deleted names get recycled; the cache must not think they are still bound
+    if (m_transmittanceTexture != 0 || m_scatteringTexture != 0 || m_irradianceTexture != 0) {
+        GLStateCache::Get().Invalidate();
+    }
+    if (m_transmittanceTexture != 0) {
+        glDeleteTextures(1, &m_transmittanceTexture);
+        m_transmittanceTexture = 0;
+    }
+    if (m_scatteringTexture != 0) {
+        glDeleteTextures(1, &m_scatteringTexture);
+        m_scatteringTexture = 0;
+    }
+    if (m_irradianceTexture != 0) {
+        glDeleteTextures(1, &m_irradianceTexture);
+        m_irradianceTexture = 0;
+    }
+    m_ready = false;
+}
+
+void Atmosphere::SetSunDirection(const glm::vec3& direction) {
+    m_sunDirection = glm::normalize(direction);
+}
+
+void Atmosphere::SetTimeOfDay(float time) {
+    m_timeOfDay = time - std::floor(time);
+    
+    // The sun rises in +x and culminates about 70 degrees up, towards +z
+    float angle = (m_timeOfDay - 0.25f) * 2.0f * PI;
+    m_sunDirection = glm::normalize(glm::vec3(std::cos(angle), std::sin(angle) * 0.94f, std::sin(angle) * 0.34f));
+}
+
+std::string Atmosphere::AddShaderFunctions(const std::string& source) {
+    return Shader::InsertAfterVersion(source, GetSizeConstants() + ATMOSPHERE_COMMON_SOURCE + ATMOSPHERE_LIBRARY_SOURCE);
+}
+
+AtmosphereUniforms Atmosphere::GetUniforms(const Shader& shader) {
+    AtmosphereUniforms u;
+    u.transmittanceLut = shader.GetUniform<int>("transmittanceLut");
+    u.scatteringLut = shader.GetUniform<int>("scatteringLut");
+    u.irradianceLut = shader.GetUniform<int>("irradianceLut");
+    u.sunDirection = shader.GetUniform<glm::vec3>("sunDirection");
+    u.exposure = shader.GetUniform<float>("exposure");
+    return u;
+}
+
+void Atmosphere::Apply(const Shader& shader, const AtmosphereUniforms& uniforms) const {
+    GLStateCache& state = GLStateCache::Get();
+    state.BindTexture(TRANSMITTANCE_TEXTURE_UNIT, GL_TEXTURE_2D, m_transmittanceTexture);
+    state.BindTexture(SCATTERING_TEXTURE_UNIT, GL_TEXTURE_3D, m_scatteringTexture);
+    state.BindTexture(IRRADIANCE_TEXTURE_UNIT, GL_TEXTURE_2D, m_irradianceTexture);
+    
+    shader.Set(uniforms.transmittanceLut, static_cast<int>(TRANSMITTANCE_TEXTURE_UNIT));
+    shader.Set(uniforms.scatteringLut, static_cast<int>(SCATTERING_TEXTURE_UNIT));
+    shader.Set(uniforms.irradianceLut, static_cast<int>(IRRADIANCE_TEXTURE_UNIT));
+    shader.Set(uniforms.sunDirection, m_sunDirection);
+    shader.Set(uniforms.exposure, m_exposure);
+}
+
+bool Atmosphere::CreateTextures() {
+    // Transmittance is divided by itself in lookups, so it keeps full precision
+    m_transmittanceTexture = CreateTableTexture(GL_TEXTURE_2D, GL_RGBA32F, TRANSMITTANCE_WIDTH,
+                                                TRANSMITTANCE_HEIGHT, 1);
+    m_scatteringTexture = CreateTableTexture(GL_TEXTURE_3D, GL_RGBA16F, SCATTERING_WIDTH, SCATTERING_HEIGHT,
+                                             SCATTERING_DEPTH);
+    m_irradianceTexture = CreateTableTexture(GL_TEXTURE_2D, GL_RGBA16F, IRRADIANCE_WIDTH, IRRADIANCE_HEIGHT, 1);
+    return m_transmittanceTexture != 0 && m_scatteringTexture != 0 && m_irradianceTexture != 0;
+}
+
+bool Atmosphere::RenderTables() {
+    Shader transmittanceShader;
+    Shader scatteringShader;
+    Shader irradianceShader;
+    if (!transmittanceShader.LoadFromStrings(TABLE_VERTEX_SOURCE,
+                                             MakeTableShaderSource(TRANSMITTANCE_FRAGMENT_SOURCE)) ||
+        !scatteringShader.LoadFromStrings(TABLE_VERTEX_SOURCE, MakeTableShaderSource(SCATTERING_FRAGMENT_SOURCE)) ||
+        !irradianceShader.LoadFromStrings(TABLE_VERTEX_SOURCE, MakeTableShaderSource(IRRADIANCE_FRAGMENT_SOURCE))) {
+        std::cerr << "Failed to compile atmosphere table shaders" << std::endl;
+        return false;
+    }
+    
+    // Passes write every texel once; nothing else may touch the output
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    
+    GLuint framebuffer = 0;
+    GLuint emptyVAO = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glGenVertexArrays(1, &emptyVAO);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    
+    GLStateCache& state = GLStateCache::Get();
+    state.BindVertexArray(emptyVAO);
+    bool complete = true;
+    
+    // Transmittance
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_transmittanceTexture, 0);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glViewport(0, 0, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT);
+    state.UseProgram(transmittanceShader.GetID());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    // Single scattering, one altitude slice per draw
+    state.BindTexture(TRANSMITTANCE_TEXTURE_UNIT, GL_TEXTURE_2D, m_transmittanceTexture);
+    state.UseProgram(scatteringShader.GetID());
+    scatteringShader.Set(scatteringShader.GetUniform<int>("transmittanceLut"),
+                         static_cast<int>(TRANSMITTANCE_TEXTURE_UNIT));
+    Uniform<float> layerUniform = scatteringShader.GetUniform<float>("layer");
+    glViewport(0, 0, SCATTERING_WIDTH, SCATTERING_HEIGHT);
+    for (int layer = 0; layer < SCATTERING_DEPTH; ++layer) {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_scatteringTexture, 0, layer);
+        complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        scatteringShader.Set(layerUniform, (layer + 0.5f) / SCATTERING_DEPTH);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    
+    // Sky irradiance from the finished scattering table
+    state.BindTexture(SCATTERING_TEXTURE_UNIT, GL_TEXTURE_3D, m_scatteringTexture);
+    state.UseProgram(irradianceShader.GetID());
+    irradianceShader.Set(irradianceShader.GetUniform<int>("scatteringLut"), static_cast<int>(SCATTERING_TEXTURE_UNIT));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_irradianceTexture, 0);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glViewport(0, 0, IRRADIANCE_WIDTH, IRRADIANCE_HEIGHT);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    // Restore the caller's state
+    state.BindVertexArray(0);
+    state.OnVertexArrayDeleted(emptyVAO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glDeleteFramebuffers(1, &framebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+    
+    if (!complete) {
+        std::cerr << "Atmosphere table framebuffer incomplete" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace FlightSim
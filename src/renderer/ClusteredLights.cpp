@@ -0,0 +1,365 @@
+#include "renderer/ClusteredLights.h"
+#include "core/Camera.h"
+#include "core/GLStateCache.h"
+#include "core/StreamingBuffer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace FlightSim {
+
+// Texture units the light lists are bound to while drawing
+static constexpr unsigned int LIGHT_TEXTURE_UNIT = 8;
+static constexpr unsigned int CLUSTER_TEXTURE_UNIT = 9;
+static constexpr unsigned int INDEX_TEXTURE_UNIT = 10;
+
+static constexpr float DEFAULT_MAX_DISTANCE = 3000.0f; // Meters
+
+// Irradiance at which a light's radius ends; small against moonlight
+static constexpr float VISIBLE_IRRADIANCE = 0.02f;
+
+static const char* LIGHT_LIBRARY_SOURCE = R"(
+uniform bool localLightsEnabled;
+uniform samplerBuffer localLights;         // Position and radius, then color
+uniform usamplerBuffer localLightClusters; // First index and count per cluster
+uniform usamplerBuffer localLightIndices;
+uniform int localLightsOffset;             // Texels into each texture buffer
+uniform int localLightClustersOffset;
+uniform int localLightIndicesOffset;
+uniform mat4 localLightView;
+uniform vec4 localLightProjection;         // NDC scale, then log depth to slice
+
+int FindLightCluster(vec3 worldPosition) {
+    vec3 p = (localLightView * vec4(worldPosition, 1.0)).xyz;
+    float depth = -p.z;
+    if (depth <= 0.0) return -1;
+    
+    vec2 ndc = localLightProjection.xy * p.xy / depth;
+    int slice = max(int(floor(log(depth) * localLightProjection.z + localLightProjection.w)) + 1, 0);
+    if (slice >= LIGHT_CLUSTER_SLICES || any(greaterThanEqual(abs(ndc), vec2(1.0)))) return -1;
+    
+    ivec2 grid = ivec2(LIGHT_CLUSTER_TILES_X, LIGHT_CLUSTER_TILES_Y);
+    ivec2 tile = min(ivec2((ndc * 0.5 + 0.5) * vec2(grid)), grid - 1);
+    return (slice * grid.y + tile.y) * grid.x + tile.x;
+}
+
+vec3 GetLocalLightIrradiance(vec3 worldPosition, vec3 normal, vec3 viewDir, float shininess, out vec3 specular) {
+    specular = vec3(0.0);
+    int cluster = localLightsEnabled ? FindLightCluster(worldPosition) : -1;
+    if (cluster < 0) return vec3(0.0);
+    
+    uvec2 range = texelFetch(localLightClusters, localLightClustersOffset + cluster).xy;
+    vec3 irradiance = vec3(0.0);
+    for (uint i = 0u; i < range.y; ++i) {
+        int light = int(texelFetch(localLightIndices, localLightIndicesOffset + int(range.x + i)).r);
+        vec4 sphere = texelFetch(localLights, localLightsOffset + 2 * light);
+        vec3 color = texelFetch(localLights, localLightsOffset + 2 * light + 1).rgb;
+        
+        // Inverse square, windowed to reach zero at the radius. Lights are
+        // about a meter across, which keeps close surfaces from blowing out.
+        vec3 toLight = sphere.xyz - worldPosition;
+        float distanceSquared = dot(toLight, toLight);
+        float ratio = distanceSquared / (sphere.w * sphere.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        vec3 direction = toLight * inversesqrt(max(distanceSquared, 1e-6));
+        vec3 lightIrradiance = color * (window * window / max(distanceSquared, 1.0)) *
+                               max(dot(normal, direction), 0.0);
+        irradiance += lightIrradiance;
+        
+        vec3 halfway = normalize(direction + viewDir);
+        specular += lightIrradiance * pow(max(dot(normal, halfway), 0.0), shininess) *
+                    (shininess + 8.0) / (8.0 * 3.14159265);
+    }
+    return irradiance;
+}
+)";
+
+// Tiles covered along one screen axis by [center - radius, center + radius]
+// at view depths za..zb. Each bound is projected at the depth that pushes
+// it outward, so the range is conservative.
+static bool GetTileRange(float center, float radius, float za, float zb, float scale, int tiles, int& first,
+                         int& last) {
+    float low = center - radius;
+    float high = center + radius;
+    float ndcLow = scale * low / (low < 0.0f ? za : zb);
+    float ndcHigh = scale * high / (high > 0.0f ? za : zb);
+    if (ndcHigh < -1.0f || ndcLow > 1.0f) return false;
+    
+    first = std::clamp(static_cast<int>(std::floor((ndcLow * 0.5f + 0.5f) * tiles)), 0, tiles - 1);
+    last = std::clamp(static_cast<int>(std::floor((ndcHigh * 0.5f + 0.5f) * tiles)), 0, tiles - 1);
+    return true;
+}
+
+ClusteredLights::ClusteredLights()
+    : m_maxDistance(DEFAULT_MAX_DISTANCE)
+    , m_binnedCount(0)
+    , m_maxTexels(0)
+    , m_rangeSupported(false)
+    , m_rangeAlignment(1)
+    , m_view(1.0f)
+    , m_projection(0.0f)
+    , m_sliceDepths{}
+    , m_lightTexture(0)
+    , m_clusterTexture(0)
+    , m_indexTexture(0)
+    , m_lightsOffset(0)
+    , m_clustersOffset(0)
+    , m_indicesOffset(0)
+    , m_valid(false) {
+}
+
+ClusteredLights::~ClusteredLights() {
+    Shutdown();
+}
+
+bool ClusteredLights::Initialize() {
+    // Views into the streaming buffer, attached in Build
+    glGenTextures(1, &m_lightTexture);
+    glGenTextures(1, &m_clusterTexture);
+    glGenTextures(1, &m_indexTexture);
+    if (m_lightTexture == 0 || m_clusterTexture == 0 || m_indexTexture == 0) {
+        std::cerr << "Failed to create light cluster textures" << std::endl;
+        return false;
+    }
+    m_clusters.reserve(CLUSTER_COUNT * 2);
+    
+    // Attaching the whole streaming buffer can exceed the texel limit, so
+    // ranges are used where available
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &m_maxTexels);
+    m_rangeSupported = GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_texture_buffer_range;
+    if (m_rangeSupported) {
+        GLint alignment = 1;
+        glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_rangeAlignment = static_cast<size_t>(std::max(alignment, 1));
+    }
+    return true;
+}
+
+void ClusteredLights::Shutdown() {
+    GLStateCache& state = GLStateCache::Get();
+    for (unsigned int* texture : {&m_lightTexture, &m_clusterTexture, &m_indexTexture}) {
+        if (*texture != 0) {
+            state.OnTextureDeleted(*texture);
+            glDeleteTextures(1, texture);
+            *texture = 0;
+        }
+    }
+    m_lights.clear();
+    m_valid = false;
+}
+
+void ClusteredLights::AddLight(const glm::vec3& position, const glm::vec3& color, float intensity) {
+    m_lights.push_back(MakeLight(position, color, intensity));
+}
+
+void ClusteredLights::AddLights(const std::vector<PointLight>& lights) {
+    m_lights.insert(m_lights.end(), lights.begin(), lights.end());
+}
+
+PointLight ClusteredLights::MakeLight(const glm::vec3& position, const glm::vec3& color, float intensity) {
+    glm::vec3 scaled = color * intensity;
+    float brightest = std::max(scaled.r, std::max(scaled.g, scaled.b));
+    return {position, std::sqrt(std::max(brightest, 0.0f) / VISIBLE_IRRADIANCE), scaled};
+}
+
+template<typename Visit>
+void ClusteredLights::VisitClusters(const glm::vec3& center, float radius, Visit&& visit) const {
+    const float depth = -center.z;
+    const float nearDepth = std::max(depth - radius, m_sliceDepths[0]);
+    const float farDepth = std::min(depth + radius, m_sliceDepths[SLICES]);
+    if (nearDepth >= farDepth) return;
+    
+    const int lastSlice = GetSlice(farDepth);
+    for (int slice = GetSlice(nearDepth); slice <= lastSlice; ++slice) {
+        // The sphere's depth range within the slice; the whole range if
+        // rounding put an end in a neighboring slice
+        float za = std::max(nearDepth, m_sliceDepths[slice]);
+        float zb = std::min(farDepth, m_sliceDepths[slice + 1]);
+        if (za > zb) {
+            za = nearDepth;
+            zb = farDepth;
+        }
+        
+        int firstX, lastX, firstY, lastY;
+        if (!GetTileRange(center.x, radius, za, zb, m_projection.x, TILES_X, firstX, lastX) ||
+            !GetTileRange(center.y, radius, za, zb, m_projection.y, TILES_Y, firstY, lastY)) {
+            continue;
+        }
+        for (int y = firstY; y <= lastY; ++y) {
+            for (int x = firstX; x <= lastX; ++x) {
+                visit((slice * TILES_Y + y) * TILES_X + x);
+            }
+        }
+    }
+}
+
+int ClusteredLights::GetSlice(float depth) const {
+    // Same mapping as FindLightCluster in the shader library
+    int slice = static_cast<int>(std::floor(std::log(depth) * m_projection.z + m_projection.w)) + 1;
+    return std::clamp(slice, 0, SLICES - 1);
+}
+
+void ClusteredLights::Build(const Camera& camera, StreamingBuffer& stream) {
+    m_valid = false;
+    m_binnedCount = 0;
+    m_indices.clear();
+    if (m_lightTexture == 0) return;
+    
+    // Slice 0 ends at FIRST_SLICE_DEPTH, the rest are spaced
+    // logarithmically up to the far end of the grid
+    const float nearDepth = camera.GetNearPlane();
+    const float farDepth = std::max(std::min(camera.GetFarPlane(), m_maxDistance), 2.0f * FIRST_SLICE_DEPTH);
+    const float sliceScale = (SLICES - 1) / std::log(farDepth / FIRST_SLICE_DEPTH);
+    const glm::mat4 projection = camera.GetProjectionMatrix();
+    m_view = camera.GetViewMatrix();
+    m_projection = glm::vec4(projection[0][0], projection[1][1], sliceScale,
+                             -std::log(FIRST_SLICE_DEPTH) * sliceScale);
+    m_sliceDepths[0] = nearDepth;
+    for (int slice = 1; slice < SLICES; ++slice) {
+        m_sliceDepths[slice] = FIRST_SLICE_DEPTH * std::exp((slice - 1) / sliceScale);
+    }
+    m_sliceDepths[SLICES] = farDepth;
+    
+    // Lights outside the grid's depth range are dropped up front. Each
+    // light takes two texels of the light buffer.
+    const size_t maxLights = std::min(MAX_LIGHTS, static_cast<size_t>(m_maxTexels) / 2);
+    m_lightData.clear();
+    m_viewSpheres.clear();
+    for (const PointLight& light : m_lights) {
+        if (m_viewSpheres.size() == maxLights) break;
+        
+        glm::vec3 center = glm::vec3(m_view * glm::vec4(light.position, 1.0f));
+        if (-center.z + light.radius <= nearDepth || -center.z - light.radius >= farDepth) continue;
+        
+        m_viewSpheres.push_back(glm::vec4(center, light.radius));
+        m_lightData.push_back(glm::vec4(light.position, light.radius));
+        m_lightData.push_back(glm::vec4(light.color, 0.0f));
+    }
+    
+    // Count the lights of each cluster; prefix sums then give each
+    // cluster's first index, and a second pass fills the lists
+    m_clusters.assign(CLUSTER_COUNT * 2, 0);
+    for (const glm::vec4& sphere : m_viewSpheres) {
+        bool binned = false;
+        VisitClusters(glm::vec3(sphere), sphere.w, [&](int cluster) {
+            m_clusters[cluster * 2 + 1]++;
+            binned = true;
+        });
+        m_binnedCount += binned ? 1 : 0;
+    }
+    uint32_t total = 0;
+    for (int cluster = 0; cluster < CLUSTER_COUNT; ++cluster) {
+        m_clusters[cluster * 2] = total;
+        total += m_clusters[cluster * 2 + 1];
+        m_clusters[cluster * 2 + 1] = 0;
+    }
+    if (total == 0 || total > static_cast<uint32_t>(m_maxTexels)) return;
+    
+    m_indices.resize(total);
+    for (size_t light = 0; light < m_viewSpheres.size(); ++light) {
+        const glm::vec4& sphere = m_viewSpheres[light];
+        VisitClusters(glm::vec3(sphere), sphere.w, [&](int cluster) {
+            uint32_t& count = m_clusters[cluster * 2 + 1];
+            m_indices[m_clusters[cluster * 2] + count++] = static_cast<uint16_t>(light);
+        });
+    }
+    
+    // Aligned to each view's texel size, so offsets are whole texels, and
+    // to the range alignment when the views are ranges
+    const size_t lightBytes = m_lightData.size() * sizeof(glm::vec4);
+    const size_t clusterBytes = m_clusters.size() * sizeof(uint32_t);
+    const size_t indexBytes = m_indices.size() * sizeof(uint16_t);
+    const size_t alignment = m_rangeSupported ? m_rangeAlignment : 1;
+    StreamingBuffer::Allocation lights = stream.Allocate(lightBytes, std::max(sizeof(glm::vec4), alignment));
+    StreamingBuffer::Allocation clusters = stream.Allocate(clusterBytes, std::max(2 * sizeof(uint32_t), alignment));
+    StreamingBuffer::Allocation indices = stream.Allocate(indexBytes, std::max(sizeof(uint16_t), alignment));
+    if (!lights || !clusters || !indices) return;
+    
+    // Whole-buffer views only reach the first m_maxTexels texels
+    const size_t maxTexels = static_cast<size_t>(m_maxTexels);
+    if (!m_rangeSupported && ((lights.offset + lightBytes) / sizeof(glm::vec4) > maxTexels ||
+                              (clusters.offset + clusterBytes) / (2 * sizeof(uint32_t)) > maxTexels ||
+                              (indices.offset + indexBytes) / sizeof(uint16_t) > maxTexels)) {
+        return;
+    }
+    
+    std::memcpy(lights.data, m_lightData.data(), lightBytes);
+    std::memcpy(clusters.data, m_clusters.data(), clusterBytes);
+    std::memcpy(indices.data, m_indices.data(), indexBytes);
+    stream.Commit(lights);
+    stream.Commit(clusters);
+    stream.Commit(indices);
+    
+    // The stream's buffer and the ranges change between frames, so the
+    // views are attached every time
+    GLStateCache& state = GLStateCache::Get();
+    const unsigned int buffer = stream.GetBuffer();
+    if (m_rangeSupported) {
+        state.BindTexture(LIGHT_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_lightTexture);
+        glTexBufferRange(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer, lights.offset, lightBytes);
+        state.BindTexture(CLUSTER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_clusterTexture);
+        glTexBufferRange(GL_TEXTURE_BUFFER, GL_RG32UI, buffer, clusters.offset, clusterBytes);
+        state.BindTexture(INDEX_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_indexTexture);
+        glTexBufferRange(GL_TEXTURE_BUFFER, GL_R16UI, buffer, indices.offset, indexBytes);
+        m_lightsOffset = 0;
+        m_clustersOffset = 0;
+        m_indicesOffset = 0;
+    } else {
+        state.BindTexture(LIGHT_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_lightTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        state.BindTexture(CLUSTER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_clusterTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, buffer);
+        state.BindTexture(INDEX_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_indexTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, buffer);
+        m_lightsOffset = static_cast<int>(lights.offset / sizeof(glm::vec4));
+        m_clustersOffset = static_cast<int>(clusters.offset / (2 * sizeof(uint32_t)));
+        m_indicesOffset = static_cast<int>(indices.offset / sizeof(uint16_t));
+    }
+    m_valid = true;
+}
+
+std::string ClusteredLights::AddShaderFunctions(const std::string& source) {
+    std::string constants = "const int LIGHT_CLUSTER_TILES_X = " + std::to_string(TILES_X) + ";\n" +
+                            "const int LIGHT_CLUSTER_TILES_Y = " + std::to_string(TILES_Y) + ";\n" +
+                            "const int LIGHT_CLUSTER_SLICES = " + std::to_string(SLICES) + ";\n";
+    return Shader::InsertAfterVersion(source, constants + LIGHT_LIBRARY_SOURCE);
+}
+
+LocalLightUniforms ClusteredLights::GetUniforms(const Shader& shader) {
+    LocalLightUniforms u;
+    u.enabled = shader.GetUniform<bool>("localLightsEnabled");
+    u.lights = shader.GetUniform<int>("localLights");
+    u.clusters = shader.GetUniform<int>("localLightClusters");
+    u.indices = shader.GetUniform<int>("localLightIndices");
+    u.lightsOffset = shader.GetUniform<int>("localLightsOffset");
+    u.clustersOffset = shader.GetUniform<int>("localLightClustersOffset");
+    u.indicesOffset = shader.GetUniform<int>("localLightIndicesOffset");
+    u.view = shader.GetUniform<glm::mat4>("localLightView");
+    u.projection = shader.GetUniform<glm::vec4>("localLightProjection");
+    return u;
+}
+
+void ClusteredLights::Apply(const Shader& shader, const LocalLightUniforms& uniforms) const {
+    // Samplers always get their own units: a buffer sampler left on a unit
+    // holding a 2D texture fails the draw even if it is never read
+    GLStateCache& state = GLStateCache::Get();
+    state.BindTexture(LIGHT_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_lightTexture);
+    state.BindTexture(CLUSTER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_clusterTexture);
+    state.BindTexture(INDEX_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_indexTexture);
+    shader.Set(uniforms.lights, static_cast<int>(LIGHT_TEXTURE_UNIT));
+    shader.Set(uniforms.clusters, static_cast<int>(CLUSTER_TEXTURE_UNIT));
+    shader.Set(uniforms.indices, static_cast<int>(INDEX_TEXTURE_UNIT));
+    
+    shader.Set(uniforms.enabled, m_valid);
+    if (!m_valid) return;
+    
+    shader.Set(uniforms.lightsOffset, m_lightsOffset);
+    shader.Set(uniforms.clustersOffset, m_clustersOffset);
+    shader.Set(uniforms.indicesOffset, m_indicesOffset);
+    shader.Set(uniforms.view, m_view);
+    shader.Set(uniforms.projection, m_projection);
+}
+
+} // namespace FlightSim
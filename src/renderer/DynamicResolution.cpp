@@ -0,0 +1,180 @@
+#include "renderer/DynamicResolution.h"
+#include "renderer/GpuProfiler.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace FlightSim {
+
+static constexpr float DEFAULT_FRAME_BUDGET_MS = 1000.0f / 60.0f;
+static constexpr float DEFAULT_SHARPNESS = 0.5f;
+
+// Controller gains on the relative headroom (budget - time) / budget. GPU
+// times arrive GpuProfiler::FRAME_LATENCY frames late, so the loop is kept
+// slow; a frame at twice the budget drops the pixel count by 40% at once.
+static constexpr float PROPORTIONAL_GAIN = 0.4f;
+static constexpr float INTEGRAL_GAIN = 0.05f;
+
+// Headroom inside this band does not move the integral, so the scale
+// settles instead of hunting around the budget
+static constexpr float INTEGRAL_DEADBAND = 0.05f;
+
+static const char* UPSCALE_VERTEX_SOURCE = R"(
+#version 330 core
+out vec2 TexCoord;
+
+void main() {
+    // Fullscreen triangle
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoord = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+static const char* UPSCALE_FRAGMENT_SOURCE = R"(
+#version 330 core
+in vec2 TexCoord;
+out vec4 FragColor;
+
+uniform sampler2D sceneTexture;
+uniform vec2 uvScale;   // Rendered area / texture size
+uniform vec2 texelSize; // 1 / texture size
+uniform float sharpness;
+
+vec3 Sample(vec2 uv) {
+    // Bilinear taps must not reach past the rendered area
+    return texture(sceneTexture, clamp(uv, 0.5 * texelSize, uvScale - 0.5 * texelSize)).rgb;
+}
+
+void main() {
+    vec2 uv = TexCoord * uvScale;
+    vec3 color = Sample(uv);
+    if (sharpness > 0.0) {
+        // Contrast-adaptive sharpening: restores edges the upscale softened,
+        // less where local contrast is already high, so it does not ring
+        vec3 north = Sample(uv + vec2(0.0, texelSize.y));
+        vec3 south = Sample(uv - vec2(0.0, texelSize.y));
+        vec3 east = Sample(uv + vec2(texelSize.x, 0.0));
+        vec3 west = Sample(uv - vec2(texelSize.x, 0.0));
+        vec3 minColor = min(color, min(min(north, south), min(east, west)));
+        vec3 maxColor = max(color, max(max(north, south), max(east, west)));
+        vec3 amount = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, vec3(1e-4)), 0.0, 1.0));
+        vec3 weight = -amount * mix(0.125, 0.2, sharpness);
+        color = clamp((color + (north + south + east + west) * weight) / (1.0 + 4.0 * weight), 0.0, 1.0);
+    }
+    FragColor = vec4(color, 1.0);
+}
+)";
+
+DynamicResolution::DynamicResolution()
+    : m_samples(0)
+    , m_outputWidth(0)
+    , m_outputHeight(0)
+    , m_renderWidth(0)
+    , m_renderHeight(0)
+    , m_frameBudgetMs(DEFAULT_FRAME_BUDGET_MS)
+    , m_sharpness(DEFAULT_SHARPNESS)
+    , m_scale(MAX_SCALE)
+    , m_integral(MAX_SCALE * MAX_SCALE / INTEGRAL_GAIN)
+    , m_lastSample(0) {
+}
+
+DynamicResolution::~DynamicResolution() {
+    Shutdown();
+}
+
+bool DynamicResolution::Initialize(int samples) {
+    m_samples = samples > 1 ? samples : 0;
+    
+    m_upscaleShader = std::make_unique<Shader>();
+    if (!m_upscaleShader->BeginLoadFromStrings(UPSCALE_VERTEX_SOURCE, UPSCALE_FRAGMENT_SOURCE,
+                                               [this](const Shader& shader) {
+        UpscaleUniforms& u = m_upscaleUniforms;
+        u.sceneTexture = shader.GetUniform<int>("sceneTexture");
+        u.uvScale = shader.GetUniform<glm::vec2>("uvScale");
+        u.texelSize = shader.GetUniform<glm::vec2>("texelSize");
+        u.sharpness = shader.GetUniform<float>("sharpness");
+    })) {
+        std::cerr << "Failed to load upscale shader" << std::endl;
+        return false;
+    }
+    
+    m_emptyVAO = GLVertexArray::Create();
+    return true;
+}
+
+void DynamicResolution::Shutdown() {
+    m_emptyVAO.Reset();
+    m_upscaleShader.reset();
+}
+
+bool DynamicResolution::Resize(int width, int height) {
+    if (width <= 0 || height <= 0) return false;
+    
+    m_outputWidth = width;
+    m_outputHeight = height;
+    UpdateRenderSize();
+    return true;
+}
+
+void DynamicResolution::Update(const GpuProfiler& profiler) {
+    int sample = profiler.GetCollectedFrameCount();
+    if (sample == m_lastSample || m_frameBudgetMs <= 0.0f) return;
+    m_lastSample = sample;
+    
+    float headroom = (m_frameBudgetMs - profiler.GetLatestFrameMs()) / m_frameBudgetMs;
+    headroom = std::max(headroom, -1.0f);
+    
+    // GPU cost follows the pixel count, so that is what the loop controls
+    const float minFraction = MIN_SCALE * MIN_SCALE;
+    const float maxFraction = MAX_SCALE * MAX_SCALE;
+    float integral = m_integral;
+    if (std::abs(headroom) > INTEGRAL_DEADBAND) {
+        integral += headroom;
+    }
+    float fraction = PROPORTIONAL_GAIN * headroom + INTEGRAL_GAIN * integral;
+    
+    // Anti-windup: only keep integrating while the output is not saturated
+    if (fraction >= minFraction && fraction <= maxFraction) {
+        m_integral = integral;
+    }
+    fraction = std::clamp(fraction, minFraction, maxFraction);
+    
+    m_scale = std::sqrt(fraction);
+    UpdateRenderSize();
+}
+
+void DynamicResolution::UpdateRenderSize() {
+    m_renderWidth = std::max(1, static_cast<int>(std::lround(m_outputWidth * m_scale)));
+    m_renderHeight = std::max(1, static_cast<int>(std::lround(m_outputHeight * m_scale)));
+}
+
+void DynamicResolution::Upscale(unsigned int sceneTexture, int textureWidth, int textureHeight) {
+    // Later passes depth test against an empty buffer
+    GLStateCache& state = GLStateCache::Get();
+    state.SetDepthMask(true);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    
+    if (m_upscaleShader && m_upscaleShader->IsValid()) {
+        state.SetDepthFunc(GL_ALWAYS);
+        state.SetDepthMask(false);
+        state.UseProgram(m_upscaleShader->GetID());
+        state.BindTexture(0, GL_TEXTURE_2D, sceneTexture);
+        state.BindVertexArray(m_emptyVAO.Get());
+        
+        const UpscaleUniforms& u = m_upscaleUniforms;
+        glm::vec2 textureSize(static_cast<float>(textureWidth), static_cast<float>(textureHeight));
+        m_upscaleShader->Set(u.sceneTexture, 0);
+        m_upscaleShader->Set(u.uvScale, glm::vec2(m_renderWidth, m_renderHeight) / textureSize);
+        m_upscaleShader->Set(u.texelSize, 1.0f / textureSize);
+        m_upscaleShader->Set(u.sharpness, m_scale < MAX_SCALE ? m_sharpness : 0.0f);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        
+        state.SetDepthFunc(GL_LESS);
+        state.SetDepthMask(true);
+    }
+}
+
+} // namespace FlightSim
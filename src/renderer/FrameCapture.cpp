@@ -0,0 +1,237 @@
+#include "renderer/FrameCapture.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace FlightSim {
+
+FrameCapture::FrameCapture()
+    : m_format(CaptureFormat::Y4M)
+    , m_width(0)
+    , m_height(0)
+    , m_active(false)
+    , m_allocatedBuffers(0)
+    , m_stopping(false) {
+}
+
+FrameCapture::~FrameCapture() {
+    Stop();
+}
+
+CaptureFormat FrameCapture::FormatFromPath(const std::string& path) {
+    const std::string extension = ".y4m";
+    bool isY4M = path.size() >= extension.size() &&
+                 path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    return isY4M ? CaptureFormat::Y4M : CaptureFormat::RawRGBA;
+}
+
+bool FrameCapture::Start(const std::string& path, int width, int height, int framesPerSecond, CaptureFormat format) {
+    if (m_active) {
+        Stop();
+    }
+    
+    // 4:2:0 chroma needs even dimensions
+    if (format == CaptureFormat::Y4M) {
+        width &= ~1;
+        height &= ~1;
+    }
+    
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Failed to open capture file: " << path << std::endl;
+        return false;
+    }
+    
+    if (!m_readback.Initialize(width, height, READBACK_DEPTH)) {
+        std::cerr << "Failed to create capture readback buffers" << std::endl;
+        m_file.close();
+        return false;
+    }
+    
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_stats = Stats();
+    m_stopping = false;
+    
+    if (m_format == CaptureFormat::Y4M) {
+        // C420jpeg: full-range BT.601, chroma sited between samples
+        m_file << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond
+               << ":1 Ip A1:1 C420jpeg\n";
+    }
+    
+    m_writer = std::thread(&FrameCapture::WriterLoop, this);
+    m_active = true;
+    
+    std::cout << "Capturing " << width << "x" << height << " to " << path << std::endl;
+    return true;
+}
+
+void FrameCapture::Stop() {
+    if (!m_active) return;
+    
+    // Drain readbacks still in flight, then let the writer finish the queue.
+    // A wait that times out means the GPU is not finishing them at all.
+    while (m_readback.GetPendingCount() > 0) {
+        int pending = m_readback.GetPendingCount();
+        m_readback.Collect([this](const uint8_t* pixels) { EnqueueFrame(pixels); }, true);
+        if (m_readback.GetPendingCount() == pending) {
+            std::cerr << "Capture readbacks timed out; " << pending << " frames dropped" << std::endl;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.framesDropped += pending;
+            break;
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_writer.join();
+    
+    m_readback.Shutdown();
+    m_file.close();
+    m_writeQueue.clear();
+    m_freeBuffers.clear();
+    m_allocatedBuffers = 0;
+    m_active = false;
+    
+    std::cout << "Capture stopped: " << m_stats.framesWritten << " frames written, "
+              << m_stats.readbackStalls << " readback stalls, " << m_stats.writerStalls
+              << " writer stalls, " << m_stats.framesDropped << " frames dropped" << std::endl;
+}
+
+void FrameCapture::CaptureFrame(unsigned int framebuffer) {
+    if (!m_active) return;
+    
+    auto enqueue = [this](const uint8_t* pixels) { EnqueueFrame(pixels); };
+    
+    // Hand over whatever the GPU has finished since last frame
+    m_readback.Collect(enqueue, false);
+    
+    if (!m_readback.Queue(framebuffer)) {
+        // Every buffer still in flight: wait for the oldest rather than drop
+        m_readback.Collect(enqueue, true);
+        bool queued = m_readback.Queue(framebuffer);
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.readbackStalls++;
+        if (!queued) {
+            // The oldest readback outlived the wait; it stays in flight
+            std::cerr << "Capture readback timed out; frame dropped" << std::endl;
+            m_stats.framesDropped++;
+            return;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.framesCaptured++;
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void FrameCapture::EnqueueFrame(const uint8_t* pixels) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    std::vector<uint8_t> buffer;
+    if (!m_freeBuffers.empty()) {
+        buffer = std::move(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+    } else if (m_allocatedBuffers < MAX_BUFFERED_FRAMES) {
+        m_allocatedBuffers++;
+    } else {
+        m_stats.writerStalls++;
+        m_condition.wait(lock, [this] { return !m_freeBuffers.empty(); });
+        buffer = std::move(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+    }
+    
+    // Copy outside the lock; the mapped buffer is only valid during this call
+    lock.unlock();
+    buffer.assign(pixels, pixels + m_readback.GetFrameSize());
+    lock.lock();
+    
+    m_writeQueue.push_back(std::move(buffer));
+    m_condition.notify_all();
+}
+
+void FrameCapture::WriterLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    while (true) {
+        m_condition.wait(lock, [this] { return m_stopping || !m_writeQueue.empty(); });
+        if (m_writeQueue.empty()) {
+            break; // Stopping and drained
+        }
+        
+        std::vector<uint8_t> frame = std::move(m_writeQueue.front());
+        m_writeQueue.pop_front();
+        
+        lock.unlock();
+        WriteFrame(frame);
+        lock.lock();
+        
+        m_stats.framesWritten++;
+        m_freeBuffers.push_back(std::move(frame));
+        m_condition.notify_all();
+    }
+}
+
+void FrameCapture::WriteFrame(const std::vector<uint8_t>& pixels) {
+    const size_t rowSize = static_cast<size_t>(m_width) * 4;
+    
+    if (m_format == CaptureFormat::RawRGBA) {
+        // Readback rows are bottom-up
+        for (int y = m_height - 1; y >= 0; --y) {
+            m_file.write(reinterpret_cast<const char*>(pixels.data() + y * rowSize), rowSize);
+        }
+        return;
+    }
+    
+    // Full-range BT.601 in 8.8 fixed point, chroma averaged over 2x2 blocks
+    const int chromaWidth = m_width / 2;
+    const int chromaHeight = m_height / 2;
+    const size_t lumaSize = static_cast<size_t>(m_width) * m_height;
+    const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    m_conversion.resize(lumaSize + chromaSize * 2);
+    uint8_t* lumaPlane = m_conversion.data();
+    uint8_t* uPlane = lumaPlane + lumaSize;
+    uint8_t* vPlane = uPlane + chromaSize;
+    
+    for (int y = 0; y < m_height; ++y) {
+        const uint8_t* src = pixels.data() + (m_height - 1 - y) * rowSize;
+        uint8_t* dst = lumaPlane + static_cast<size_t>(y) * m_width;
+        for (int x = 0; x < m_width; ++x) {
+            int r = src[x * 4 + 0];
+            int g = src[x * 4 + 1];
+            int b = src[x * 4 + 2];
+            dst[x] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+    
+    for (int cy = 0; cy < chromaHeight; ++cy) {
+        const uint8_t* row0 = pixels.data() + (m_height - 1 - cy * 2) * rowSize;
+        const uint8_t* row1 = row0 - rowSize;
+        for (int cx = 0; cx < chromaWidth; ++cx) {
+            int i = cx * 8;
+            int r = row0[i + 0] + row0[i + 4] + row1[i + 0] + row1[i + 4];
+            int g = row0[i + 1] + row0[i + 5] + row1[i + 1] + row1[i + 5];
+            int b = row0[i + 2] + row0[i + 6] + row1[i + 2] + row1[i + 6];
+            
+            // Sums are 4x the average, folded into the shift
+            int u = ((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128;
+            int v = ((128 * r - 107 * g - 21 * b + 512) >> 10) + 128;
+            uPlane[cy * chromaWidth + cx] = static_cast<uint8_t>(std::clamp(u, 0, 255));
+            vPlane[cy * chromaWidth + cx] = static_cast<uint8_t>(std::clamp(v, 0, 255));
+        }
+    }
+    
+    m_file << "FRAME\n";
+    m_file.write(reinterpret_cast<const char*>(m_conversion.data()), m_conversion.size());
+}
+
+} // namespace FlightSim
@@ -0,0 +1,616 @@
+#include "renderer/GpuCulling.h"
+#include "core/GLStateCache.h"
+#include "core/Mesh.h"
+#include "renderer/RenderQueue.h"
+#include "renderer/TrafficRenderer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace FlightSim {
+
+static constexpr size_t INITIAL_CAPACITY = 1024;
+static constexpr unsigned int CULL_GROUP_SIZE = 64;
+static constexpr int PYRAMID_GROUP_SIZE = 8;
+
+// Layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+static const char* CULL_COMPUTE_SOURCE = R"(
+#version 430 core
+layout (local_size_x = 64) in;
+
+struct Instance {
+    vec4 positionScale;
+    vec4 rotation;
+    vec4 tint;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout (std430, binding = 1) buffer Levels { int levels[]; };
+layout (std430, binding = 2) writeonly buffer Visible { Instance visible[]; };
+layout (std430, binding = 3) buffer Commands { DrawCommand commands[]; };
+layout (binding = 0) uniform sampler2D depthPyramid;
+
+uniform int instanceCount;
+uniform vec4 frustumPlanes[6];
+uniform vec3 boundsCenter;
+uniform float boundsRadius;
+
+// Level selection, main view only (see LodMesh::SelectLevel)
+uniform bool selectLevels;
+uniform bool drawImpostors;
+uniform vec3 viewPos;
+uniform float nearPlane;
+uniform float pixelsPerUnit;
+uniform int levelCount;
+uniform float levelErrors[MAX_LEVELS];
+uniform float pixelError;
+uniform float impostorPixels;
+
+// Previous frame's depth, farthest value per texel of each mip
+uniform bool occlusionCulling;
+uniform mat4 pyramidViewProjection;
+uniform vec2 pyramidSize;
+uniform int pyramidLevels;
+
+vec3 rotateByQuat(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+int pickLevel(float ppu) {
+    if (drawImpostors && 2.0 * boundsRadius * ppu < impostorPixels) {
+        return levelCount;
+    }
+    int level = 0;
+    while (level + 1 < levelCount && levelErrors[level + 1] * ppu <= pixelError) {
+        level++;
+    }
+    return level;
+}
+
+bool isOccluded(vec3 center, float radius) {
+    // Screen rectangle and nearest depth of the sphere's box, as seen by
+    // the frame the pyramid was built from
+    vec3 ndcMin = vec3(1.0e30);
+    vec3 ndcMax = vec3(-1.0e30);
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                             (i & 2) != 0 ? 1.0 : -1.0,
+                                             (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = pyramidViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0) return false; // Reaches behind the camera
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+    
+    // Partly off screen last frame: no depth to compare against
+    if (any(lessThan(ndcMin.xy, vec2(-1.0))) || any(greaterThan(ndcMax.xy, vec2(1.0)))) {
+        return false;
+    }
+    
+    // The level at which the rectangle spans at most two texels per axis,
+    // so its four corner texels cover it
+    ivec2 size = ivec2(pyramidSize);
+    ivec2 texelMin = min(ivec2((ndcMin.xy * 0.5 + 0.5) * pyramidSize), size - 1);
+    ivec2 texelMax = min(ivec2((ndcMax.xy * 0.5 + 0.5) * pyramidSize), size - 1);
+    ivec2 extent = texelMax - texelMin;
+    int level = int(ceil(log2(float(max(max(extent.x, extent.y), 1)))));
+    level = min(level, pyramidLevels - 1);
+    
+    ivec2 levelMax = max(size >> level, ivec2(1)) - 1;
+    texelMin = min(texelMin >> level, levelMax);
+    texelMax = min(texelMax >> level, levelMax);
+    float farthest = max(max(texelFetch(depthPyramid, texelMin, level).r,
+                             texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+                         max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r,
+                             texelFetch(depthPyramid, texelMax, level).r));
+    return ndcMin.z * 0.5 + 0.5 > farthest;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uint(instanceCount)) return;
+    
+    Instance instance = instances[index];
+    float scale = instance.positionScale.w;
+    
+    // Levels are chosen for every instance, visible or not, so hysteresis
+    // carries across frames the instance spends culled
+    int level = levels[index];
+    if (selectLevels) {
+        float distance = max(length(instance.positionScale.xyz - viewPos), nearPlane);
+        float ppu = pixelsPerUnit * scale / distance;
+        if (level < 0) {
+            level = pickLevel(ppu);
+        } else {
+            int finer = pickLevel(ppu * (1.0 + HYSTERESIS));
+            int coarser = pickLevel(ppu * (1.0 - HYSTERESIS));
+            level = clamp(level, finer, coarser);
+        }
+        levels[index] = level;
+    }
+    if (level < 0 || (level == levelCount && !drawImpostors)) return;
+    
+    vec3 center = instance.positionScale.xyz + rotateByQuat(instance.rotation, boundsCenter * scale);
+    float radius = boundsRadius * scale;
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius) return;
+    }
+    if (occlusionCulling && isOccluded(center, radius)) return;
+    
+    uint slot = atomicAdd(commands[level].instanceCount, 1u);
+    visible[commands[level].baseInstance + slot] = instance;
+}
+)";
+
+static const char* PYRAMID_COMPUTE_SOURCE = R"(
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D sourceDepth;
+layout (r32f, binding = 0) uniform readonly image2D sourceLevel;
+layout (r32f, binding = 1) uniform writeonly image2D targetLevel;
+
+uniform bool copyDepth;
+uniform vec2 sourceSize;
+uniform vec2 targetSize;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 target = ivec2(targetSize);
+    if (any(greaterThanEqual(texel, target))) return;
+    
+    if (copyDepth) {
+        imageStore(targetLevel, texel, vec4(texelFetch(sourceDepth, texel, 0).r));
+        return;
+    }
+    
+    // Farthest of the 2x2 source texels; the odd last row or column of the
+    // source folds into the texel before it so nothing is left uncovered
+    ivec2 source = ivec2(sourceSize);
+    ivec2 first = texel * 2;
+    ivec2 last = first + 1 + ivec2(equal(texel, target - 1)) * (source & 1);
+    last = min(last, source - 1);
+    
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; ++y) {
+        for (int x = first.x; x <= last.x; ++x) {
+            depth = max(depth, imageLoad(sourceLevel, ivec2(x, y)).r);
+        }
+    }
+    imageStore(targetLevel, texel, vec4(depth));
+}
+)";
+
+// Planes with inward normals, normalized so distances are in world units
+static void ExtractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for (int i = 0; i < 6; ++i) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+GpuCulling::GpuCulling()
+    : m_lods(nullptr)
+    , m_impostorQuad(nullptr)
+    , m_levelCount(0)
+    , m_drawImpostors(false)
+    , m_instanceBuffer(0)
+    , m_instanceOffset(0)
+    , m_instanceCount(0)
+    , m_levelBuffer(0)
+    , m_visibleBuffers{}
+    , m_commandBuffers{}
+    , m_capacity(0)
+    , m_commandTemplate(0)
+    , m_depthCopy(0)
+    , m_depthCopyFramebuffer(0)
+    , m_pyramid(0)
+    , m_pyramidWidth(0)
+    , m_pyramidHeight(0)
+    , m_pyramidLevels(0)
+    , m_validWidth(0)
+    , m_validHeight(0)
+    , m_validLevels(0)
+    , m_pyramidViewProjection(1.0f)
+    , m_pyramidValid(false) {
+}
+
+GpuCulling::~GpuCulling() {
+    Shutdown();
+}
+
+bool GpuCulling::IsSupported() {
+    return GLAD_GL_VERSION_4_3;
+}
+
+bool GpuCulling::Initialize(const LodMesh& lods, const Mesh* impostorQuad) {
+    if (!lods.HasMergedMesh() || lods.GetLevelCount() == 0) {
+        std::cerr << "GPU culling needs merged detail levels" << std::endl;
+        return false;
+    }
+    m_lods = &lods;
+    m_impostorQuad = impostorQuad;
+    m_levelCount = lods.GetLevelCount();
+    
+    std::string defines = "#define MAX_LEVELS " + std::to_string(LodMesh::MAX_LEVELS) + "\n" +
+                          "#define HYSTERESIS " + std::to_string(LodMesh::HYSTERESIS) + "\n";
+    if (!m_cullShader.LoadComputeFromString(Shader::InsertAfterVersion(CULL_COMPUTE_SOURCE, defines)) ||
+        !m_pyramidShader.LoadComputeFromString(PYRAMID_COMPUTE_SOURCE)) {
+        std::cerr << "Failed to compile GPU culling shaders" << std::endl;
+        return false;
+    }
+    
+    const Shader& shader = m_cullShader;
+    CullUniforms& u = m_cullUniforms;
+    u.instanceCount = shader.GetUniform<int>("instanceCount");
+    u.frustumPlanes = shader.GetUniform<glm::vec4>("frustumPlanes");
+    u.boundsCenter = shader.GetUniform<glm::vec3>("boundsCenter");
+    u.boundsRadius = shader.GetUniform<float>("boundsRadius");
+    u.selectLevels = shader.GetUniform<bool>("selectLevels");
+    u.drawImpostors = shader.GetUniform<bool>("drawImpostors");
+    u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+    u.nearPlane = shader.GetUniform<float>("nearPlane");
+    u.pixelsPerUnit = shader.GetUniform<float>("pixelsPerUnit");
+    u.levelCount = shader.GetUniform<int>("levelCount");
+    u.levelErrors = shader.GetUniform<float>("levelErrors");
+    u.pixelError = shader.GetUniform<float>("pixelError");
+    u.impostorPixels = shader.GetUniform<float>("impostorPixels");
+    u.occlusionCulling = shader.GetUniform<bool>("occlusionCulling");
+    u.pyramidViewProjection = shader.GetUniform<glm::mat4>("pyramidViewProjection");
+    u.pyramidSize = shader.GetUniform<glm::vec2>("pyramidSize");
+    u.pyramidLevels = shader.GetUniform<int>("pyramidLevels");
+    
+    m_pyramidUniforms.copyDepth = m_pyramidShader.GetUniform<bool>("copyDepth");
+    m_pyramidUniforms.sourceSize = m_pyramidShader.GetUniform<glm::vec2>("sourceSize");
+    m_pyramidUniforms.targetSize = m_pyramidShader.GetUniform<glm::vec2>("targetSize");
+    
+    // The mesh's shape does not change, so neither do these
+    float errors[LodMesh::MAX_LEVELS] = {};
+    for (int level = 0; level < m_levelCount; ++level) {
+        errors[level] = lods.GetLevelError(level);
+    }
+    GLStateCache::Get().UseProgram(shader.GetID());
+    shader.Set(u.boundsCenter, lods.GetCenter());
+    shader.Set(u.boundsRadius, lods.GetRadius());
+    shader.Set(u.levelCount, m_levelCount);
+    shader.Set(u.levelErrors, errors, LodMesh::MAX_LEVELS);
+    
+    const size_t commandBytes = (m_levelCount + 1) * sizeof(DrawElementsIndirectCommand);
+    glGenBuffers(1, &m_levelBuffer);
+    glGenBuffers(1, &m_commandTemplate);
+    glGenBuffers(VIEW_COUNT, m_visibleBuffers);
+    glGenBuffers(VIEW_COUNT, m_commandBuffers);
+    for (unsigned int buffer : m_commandBuffers) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    
+    // Pyramid textures are allocated by the first build
+    glGenFramebuffers(1, &m_depthCopyFramebuffer);
+    
+    EnsureCapacity(INITIAL_CAPACITY);
+    return m_levelBuffer != 0 && m_commandTemplate != 0;
+}
+
+void GpuCulling::Shutdown() {
+    if (m_levelBuffer != 0) {
+        glDeleteBuffers(1, &m_levelBuffer);
+        glDeleteBuffers(1, &m_commandTemplate);
+        glDeleteBuffers(VIEW_COUNT, m_visibleBuffers);
+        glDeleteBuffers(VIEW_COUNT, m_commandBuffers);
+        m_levelBuffer = 0;
+        m_commandTemplate = 0;
+    }
+    if (m_pyramid != 0) {
+        GLStateCache::Get().OnTextureDeleted(m_depthCopy);
+        GLStateCache::Get().OnTextureDeleted(m_pyramid);
+        glDeleteTextures(1, &m_depthCopy);
+        glDeleteTextures(1, &m_pyramid);
+        m_depthCopy = 0;
+        m_pyramid = 0;
+    }
+    if (m_depthCopyFramebuffer != 0) {
+        glDeleteFramebuffers(1, &m_depthCopyFramebuffer);
+        m_depthCopyFramebuffer = 0;
+    }
+    m_capacity = 0;
+    m_instanceCount = 0;
+    m_pyramidWidth = 0;
+    m_pyramidHeight = 0;
+    m_pyramidValid = false;
+}
+
+void GpuCulling::SetInstances(unsigned int buffer, size_t offset, size_t count) {
+    m_instanceBuffer = buffer;
+    m_instanceOffset = offset;
+    if (count == m_instanceCount) return;
+    
+    // A changed traffic list starts over, as on the CPU path
+    EnsureCapacity(count);
+    const GLint none = -1;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_levelBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32I, GL_RED_INTEGER, GL_INT, &none);
+    m_instanceCount = count;
+}
+
+void GpuCulling::CullMain(const glm::mat4& viewProjection, const glm::vec3& viewPos, float nearPlane,
+                          float pixelsPerUnit, bool allowImpostors) {
+    const Shader& shader = m_cullShader;
+    const CullUniforms& u = m_cullUniforms;
+    m_drawImpostors = allowImpostors && m_impostorQuad;
+    
+    GLStateCache::Get().UseProgram(shader.GetID());
+    shader.Set(u.viewPos, viewPos);
+    shader.Set(u.nearPlane, nearPlane);
+    shader.Set(u.pixelsPerUnit, pixelsPerUnit);
+    shader.Set(u.pixelError, m_lods->GetPixelError());
+    shader.Set(u.impostorPixels, m_lods->GetImpostorPixels());
+    Dispatch(MAIN_VIEW, viewProjection, true, m_drawImpostors, m_pyramidValid);
+}
+
+void GpuCulling::Cull(View view, const glm::mat4& viewProjection) {
+    Dispatch(view, viewProjection, false, m_drawImpostors && view != SHADOW_VIEW, false);
+}
+
+void GpuCulling::Dispatch(View view, const glm::mat4& viewProjection, bool selectLevels, bool drawImpostors,
+                          bool occlusionCulling) {
+    // Counts back to zero; ordered before the dispatch like any GL command
+    const size_t commandBytes = (m_levelCount + 1) * sizeof(DrawElementsIndirectCommand);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_commandTemplate);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffers[view]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, commandBytes);
+    if (m_instanceCount == 0 || m_instanceBuffer == 0) return;
+    
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProjection, planes);
+    
+    GLStateCache& state = GLStateCache::Get();
+    const Shader& shader = m_cullShader;
+    const CullUniforms& u = m_cullUniforms;
+    state.UseProgram(shader.GetID());
+    shader.Set(u.instanceCount, static_cast<int>(m_instanceCount));
+    shader.Set(u.frustumPlanes, planes, 6);
+    shader.Set(u.selectLevels, selectLevels);
+    shader.Set(u.drawImpostors, drawImpostors);
+    shader.Set(u.occlusionCulling, occlusionCulling);
+    if (occlusionCulling) {
+        state.BindTexture(0, GL_TEXTURE_2D, m_pyramid);
+        shader.Set(u.pyramidViewProjection, m_pyramidViewProjection);
+        shader.Set(u.pyramidSize, glm::vec2(m_validWidth, m_validHeight));
+        shader.Set(u.pyramidLevels, m_validLevels);
+    }
+    
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer, m_instanceOffset,
+                      m_instanceCount * sizeof(AircraftInstance));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_levelBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_visibleBuffers[view]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_commandBuffers[view]);
+    glDispatchCompute(static_cast<GLuint>((m_instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+    
+    // Commands and instances are read as draw parameters and vertex
+    // attributes; levels by the other views' dispatches
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCulling::SubmitDraws(RenderQueue& queue, View view, const Shader& shader, uint32_t material) const {
+    queue.SubmitIndirect(RenderLayer::Opaque, shader, m_lods->GetMergedMesh(), material, 0.0f, 0,
+                         static_cast<uint32_t>(m_levelCount), static_cast<uint32_t>(view));
+}
+
+void GpuCulling::SubmitImpostorDraws(RenderQueue& queue, View view, const Shader& shader, uint32_t material) const {
+    if (!m_impostorQuad || view == SHADOW_VIEW) return;
+    
+    const uint32_t offset = static_cast<uint32_t>(m_levelCount * sizeof(DrawElementsIndirectCommand));
+    queue.SubmitIndirect(RenderLayer::Opaque, shader, *m_impostorQuad, material, 0.0f, offset, 1,
+                         static_cast<uint32_t>(view));
+}
+
+void GpuCulling::BindView(uint32_t view) const {
+    // The commands' base instances select each level's region
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffers[view]);
+    TrafficRenderer::BindInstanceAttributes(m_visibleBuffers[view], 0, 0);
+}
+
+void GpuCulling::BuildDepthPyramid(unsigned int sourceFramebuffer, int width, int height,
+                                   const glm::mat4& viewProjection) {
+    if (width <= 0 || height <= 0 || !m_pyramidShader.IsValid()) return;
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+    
+    // Depth blits need matching formats; anything else leaves occlusion
+    // culling off rather than testing against a stale pyramid
+    GLint depthBits = 0;
+    GLint stencilBits = 0;
+    GLenum attachment = sourceFramebuffer == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE,
+                                          &depthBits);
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE,
+                                          &stencilBits);
+    if (depthBits != 24 || stencilBits != 8) {
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+        m_pyramidValid = false;
+        return;
+    }
+    
+    // Resolves multisampled depth as well
+    EnsurePyramid(width, height);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthCopyFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    
+    GLStateCache& state = GLStateCache::Get();
+    const Shader& shader = m_pyramidShader;
+    const PyramidUniforms& u = m_pyramidUniforms;
+    state.UseProgram(shader.GetID());
+    state.BindTexture(0, GL_TEXTURE_2D, m_depthCopy);
+    
+    int levelWidth = width;
+    int levelHeight = height;
+    int levels = 0;
+    for (int level = 0; level < m_pyramidLevels; ++level) {
+        int sourceWidth = levelWidth;
+        int sourceHeight = levelHeight;
+        if (level > 0) {
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+            glBindImageTexture(0, m_pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        }
+        glBindImageTexture(1, m_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        
+        shader.Set(u.copyDepth, level == 0);
+        shader.Set(u.sourceSize, glm::vec2(sourceWidth, sourceHeight));
+        shader.Set(u.targetSize, glm::vec2(levelWidth, levelHeight));
+        glDispatchCompute(static_cast<GLuint>((levelWidth + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE),
+                          static_cast<GLuint>((levelHeight + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        
+        levels++;
+        if (levelWidth == 1 && levelHeight == 1) break;
+    }
+    
+    // Read by the next frame's cull through a sampler
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    
+    m_validWidth = width;
+    m_validHeight = height;
+    m_validLevels = levels;
+    m_pyramidViewProjection = viewProjection;
+    m_pyramidValid = true;
+}
+
+int GpuCulling::ReadVisibleCount(View view, int level) const {
+    if (level < 0 || level > m_levelCount || m_commandBuffers[view] == 0) return 0;
+    
+    uint32_t count = 0;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffers[view]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER,
+                       level * sizeof(DrawElementsIndirectCommand) + offsetof(DrawElementsIndirectCommand,
+                                                                              instanceCount),
+                       sizeof(count), &count);
+    return static_cast<int>(count);
+}
+
+size_t GpuCulling::GetGpuMemorySize() const {
+    size_t bytes = m_capacity * sizeof(GLint);
+    bytes += VIEW_COUNT * (m_levelCount + 1) * (m_capacity * sizeof(AircraftInstance) +
+                                                sizeof(DrawElementsIndirectCommand));
+    
+    // Depth copy, plus the R32F chain (about a third more than level 0)
+    const size_t texels = static_cast<size_t>(m_pyramidWidth) * m_pyramidHeight;
+    return bytes + texels * 4 + texels * 4 * 4 / 3;
+}
+
+void GpuCulling::EnsureCapacity(size_t instanceCount) {
+    if (instanceCount <= m_capacity) return;
+    
+    size_t capacity = std::max(m_capacity, INITIAL_CAPACITY);
+    while (capacity < instanceCount) {
+        capacity *= 2;
+    }
+    m_capacity = capacity;
+    
+    // Levels are lost with the old storage; SetInstances clears them
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_levelBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(GLint), nullptr, GL_DYNAMIC_COPY);
+    for (unsigned int buffer : m_visibleBuffers) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (m_levelCount + 1) * m_capacity * sizeof(AircraftInstance), nullptr,
+                     GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_instanceCount = 0;
+    
+    WriteCommandTemplate();
+}
+
+void GpuCulling::WriteCommandTemplate() {
+    // One command per level, then the impostor quad; each draws from its
+    // own capacity-sized region of the visible instances
+    std::vector<DrawElementsIndirectCommand> commands(m_levelCount + 1);
+    for (int level = 0; level < m_levelCount; ++level) {
+        const LodMesh::MergedRange& range = m_lods->GetMergedRange(level);
+        commands[level] = {range.indexCount, 0, range.firstIndex, range.baseVertex,
+                           static_cast<uint32_t>(level * m_capacity)};
+    }
+    uint32_t quadIndices = m_impostorQuad ? static_cast<uint32_t>(m_impostorQuad->GetIndexCount()) : 0;
+    commands[m_levelCount] = {quadIndices, 0, 0, 0, static_cast<uint32_t>(m_levelCount * m_capacity)};
+    
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandTemplate);
+    glBufferData(GL_COPY_WRITE_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(),
+                 GL_STATIC_DRAW);
+}
+
+void GpuCulling::EnsurePyramid(int width, int height) {
+    if (width <= m_pyramidWidth && height <= m_pyramidHeight) return;
+    
+    // Grown, never shrunk, so dynamic resolution does not reallocate;
+    // storage is immutable, so growing means new textures
+    GLStateCache& state = GLStateCache::Get();
+    if (m_pyramid != 0) {
+        state.OnTextureDeleted(m_depthCopy);
+        state.OnTextureDeleted(m_pyramid);
+        glDeleteTextures(1, &m_depthCopy);
+        glDeleteTextures(1, &m_pyramid);
+    }
+    glGenTextures(1, &m_depthCopy);
+    glGenTextures(1, &m_pyramid);
+    
+    m_pyramidWidth = std::max(width, m_pyramidWidth);
+    m_pyramidHeight = std::max(height, m_pyramidHeight);
+    m_pyramidLevels = static_cast<int>(std::floor(std::log2(std::max(m_pyramidWidth, m_pyramidHeight)))) + 1;
+    
+    state.BindTexture(0, GL_TEXTURE_2D, m_depthCopy);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, m_pyramidWidth, m_pyramidHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    state.BindTexture(0, GL_TEXTURE_2D, m_pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, m_pyramidWidth, m_pyramidHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_depthCopyFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthCopy, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    m_pyramidValid = false;
+}
+
+} // namespace FlightSim
@@ -0,0 +1,232 @@
+#include "renderer/GpuProfiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace FlightSim {
+
+static constexpr const char* FRAME_SCOPE = "Frame";
+
+// Nearest-rank percentile of a sorted sample set
+static float Percentile(const std::vector<float>& sorted, float fraction) {
+    if (sorted.empty()) return 0.0f;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5f);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+GpuProfiler::GpuProfiler()
+    : m_enabled(false)
+    , m_inFrame(false)
+    , m_frameIndex(0)
+    , m_droppedFrames(0)
+    , m_collectedFrames(0) {
+}
+
+GpuProfiler::~GpuProfiler() {
+    Shutdown();
+}
+
+bool GpuProfiler::Initialize() {
+    // Timer queries are core in GL 3.3
+    if (!GLAD_GL_VERSION_3_3 && !GLAD_GL_ARB_timer_query) {
+        std::cerr << "GPU profiler disabled: timer queries not supported" << std::endl;
+        return false;
+    }
+    
+    GLint counterBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+    if (counterBits == 0) {
+        std::cerr << "GPU profiler disabled: timestamp counter has no bits" << std::endl;
+        return false;
+    }
+    
+    // Scope 0 is always the whole frame
+    FindScope(FRAME_SCOPE);
+    m_enabled = true;
+    return true;
+}
+
+void GpuProfiler::Shutdown() {
+    for (FrameQueries& frame : m_frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        }
+        frame = FrameQueries();
+    }
+    m_openScopes.clear();
+    m_enabled = false;
+}
+
+void GpuProfiler::BeginFrame() {
+    if (!m_enabled) return;
+    
+    // This slot was last used FRAME_LATENCY frames ago; its results should be ready
+    FrameQueries& frame = m_frames[m_frameIndex % FRAME_LATENCY];
+    if (frame.submitted) {
+        CollectFrame(frame);
+    }
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+    frame.submitted = false;
+    
+    m_openScopes.clear();
+    m_inFrame = true;
+    BeginScope(FRAME_SCOPE);
+}
+
+void GpuProfiler::EndFrame() {
+    if (!m_enabled || !m_inFrame) return;
+    
+    // Close anything left open, including the frame scope
+    while (!m_openScopes.empty()) {
+        EndScope();
+    }
+    
+    m_frames[m_frameIndex % FRAME_LATENCY].submitted = true;
+    m_frameIndex++;
+    m_inFrame = false;
+}
+
+void GpuProfiler::BeginScope(const char* name) {
+    if (!m_enabled || !m_inFrame) return;
+    
+    FrameQueries& frame = m_frames[m_frameIndex % FRAME_LATENCY];
+    PendingScope scope;
+    scope.scope = FindScope(name);
+    scope.beginQuery = AllocateQuery(frame);
+    scope.endQuery = AllocateQuery(frame);
+    glQueryCounter(scope.beginQuery, GL_TIMESTAMP);
+    
+    m_openScopes.push_back(static_cast<int>(frame.scopes.size()));
+    frame.scopes.push_back(scope);
+}
+
+void GpuProfiler::EndScope() {
+    if (!m_enabled || !m_inFrame || m_openScopes.empty()) return;
+    
+    FrameQueries& frame = m_frames[m_frameIndex % FRAME_LATENCY];
+    glQueryCounter(frame.scopes[m_openScopes.back()].endQuery, GL_TIMESTAMP);
+    m_openScopes.pop_back();
+}
+
+int GpuProfiler::FindScope(const char* name) {
+    // Names are literals, so a pointer match almost always hits first
+    for (size_t i = 0; i < m_history.size(); ++i) {
+        if (m_history[i].name == name || std::strcmp(m_history[i].name, name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    
+    ScopeHistory history;
+    history.name = name;
+    history.samples.resize(HISTORY_LENGTH, 0.0f);
+    m_history.push_back(std::move(history));
+    return static_cast<int>(m_history.size() - 1);
+}
+
+unsigned int GpuProfiler::AllocateQuery(FrameQueries& frame) {
+    if (frame.usedQueries == frame.queries.size()) {
+        size_t grow = std::max<size_t>(frame.queries.size(), 16);
+        frame.queries.resize(frame.queries.size() + grow);
+        glGenQueries(static_cast<GLsizei>(grow), frame.queries.data() + frame.usedQueries);
+    }
+    return frame.queries[frame.usedQueries++];
+}
+
+void GpuProfiler::CollectFrame(FrameQueries& frame) {
+    if (frame.scopes.empty()) return;
+    
+    // Queries complete in order, so the frame scope's end covers all of them
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(frame.scopes.front().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        m_droppedFrames++;
+        return;
+    }
+    
+    m_frameTotals.assign(m_history.size(), -1.0);
+    for (const PendingScope& scope : frame.scopes) {
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+        
+        double ms = end > begin ? static_cast<double>(end - begin) * 1e-6 : 0.0;
+        double& total = m_frameTotals[scope.scope];
+        total = total < 0.0 ? ms : total + ms;
+    }
+    
+    for (size_t i = 0; i < m_history.size(); ++i) {
+        if (m_frameTotals[i] < 0.0) continue;
+        
+        ScopeHistory& history = m_history[i];
+        history.samples[history.next] = static_cast<float>(m_frameTotals[i]);
+        history.next = (history.next + 1) % HISTORY_LENGTH;
+        history.count = std::min<size_t>(history.count + 1, HISTORY_LENGTH);
+    }
+    m_collectedFrames++;
+}
+
+float GpuProfiler::GetLatestFrameMs() const {
+    if (m_history.empty() || m_history.front().count == 0) return 0.0f;
+    
+    const ScopeHistory& frame = m_history.front();
+    return frame.samples[(frame.next + HISTORY_LENGTH - 1) % HISTORY_LENGTH];
+}
+
+float GpuProfiler::GetLatestScopeMs(const char* name) const {
+    for (const ScopeHistory& history : m_history) {
+        if (history.name != name && std::strcmp(history.name, name) != 0) continue;
+        if (history.count == 0) return 0.0f;
+        return history.samples[(history.next + HISTORY_LENGTH - 1) % HISTORY_LENGTH];
+    }
+    return 0.0f;
+}
+
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::GetStats() const {
+    std::vector<ScopeStats> stats;
+    std::vector<float> sorted;
+    
+    for (const ScopeHistory& history : m_history) {
+        if (history.count == 0) continue;
+        
+        sorted.assign(history.samples.begin(), history.samples.begin() + history.count);
+        std::sort(sorted.begin(), sorted.end());
+        
+        float sum = 0.0f;
+        for (float sample : sorted) {
+            sum += sample;
+        }
+        
+        ScopeStats entry;
+        entry.name = history.name;
+        entry.sampleCount = static_cast<int>(history.count);
+        entry.lastMs = history.samples[(history.next + HISTORY_LENGTH - 1) % HISTORY_LENGTH];
+        entry.averageMs = sum / history.count;
+        entry.p50Ms = Percentile(sorted, 0.50f);
+        entry.p95Ms = Percentile(sorted, 0.95f);
+        entry.p99Ms = Percentile(sorted, 0.99f);
+        stats.push_back(entry);
+    }
+    
+    return stats;
+}
+
+bool GpuProfiler::WriteReport(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write GPU profile: " << path << std::endl;
+        return false;
+    }
+    
+    file << "scope,samples,avg_ms,p50_ms,p95_ms,p99_ms\n";
+    for (const ScopeStats& scope : GetStats()) {
+        file << scope.name << ',' << scope.sampleCount << ',' << scope.averageMs << ','
+             << scope.p50Ms << ',' << scope.p95Ms << ',' << scope.p99Ms << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+} // namespace FlightSim
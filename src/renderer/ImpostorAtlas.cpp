@@ -0,0 +1,205 @@
+#include "renderer/ImpostorAtlas.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace FlightSim {
+
+static constexpr unsigned int IMPOSTOR_TEXTURE_UNIT = 2;
+
+// Mip levels down to one texel per frame would blend neighboring frames
+static constexpr int MAX_MIP_LEVEL = 4;
+
+static const char* BAKE_VERTEX_SOURCE = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 Normal;
+
+uniform mat4 viewProjection;
+
+// Vertex decode for compressed mesh layouts (see VertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
+
+vec3 decodeNormal(vec3 encoded) {
+    if (!octahedralNormals) return encoded;
+    vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    Normal = decodeNormal(aNormal);
+    gl_Position = viewProjection * vec4(positionOffset + aPos * positionScale, 1.0);
+}
+)";
+
+static const char* BAKE_FRAGMENT_SOURCE = R"(
+#version 330 core
+in vec3 Normal;
+out vec4 FragColor;
+
+void main() {
+    // Object-space normal; alpha marks coverage
+    FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
+)";
+
+// Same mapping as impostor.vert: octahedral square to unit direction
+static glm::vec3 DecodeOctahedral(const glm::vec2& encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+ImpostorAtlas::ImpostorAtlas()
+    : m_texture(0)
+    , m_center(0.0f)
+    , m_radius(0.0f) {
+}
+
+ImpostorAtlas::~ImpostorAtlas() {
+    Shutdown();
+}
+
+bool ImpostorAtlas::Initialize() {
+    // Unit quad in the frame plane; impostor.vert scales and orients it
+    std::vector<Vertex> vertices = {
+        {{-1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
+        {{ 1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
+        {{ 1.0f,  1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+        {{-1.0f,  1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}}
+    };
+    m_quad.SetVertices(std::move(vertices));
+    m_quad.SetIndices({0, 1, 2,  2, 3, 0});
+    m_quad.Upload(true);
+    
+    const int size = GRID * FRAME_SIZE;
+    glGenTextures(1, &m_texture);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MAX_MIP_LEVEL);
+    return m_texture != 0 && m_quad.IsUploaded();
+}
+
+void ImpostorAtlas::Shutdown() {
+    if (m_texture != 0) {
+        GLStateCache::Get().OnTextureDeleted(m_texture);
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+}
+
+bool ImpostorAtlas::Bake(const Mesh& mesh, const glm::vec3& center, float radius) {
+    if (m_texture == 0 || !mesh.IsUploaded() || radius <= 0.0f) return false;
+    
+    Shader shader;
+    if (!shader.LoadFromStrings(BAKE_VERTEX_SOURCE, BAKE_FRAGMENT_SOURCE)) {
+        std::cerr << "Failed to compile impostor bake shader" << std::endl;
+        return false;
+    }
+    
+    const int size = GRID * FRAME_SIZE;
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    
+    GLuint framebuffer = 0;
+    GLuint depthBuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    
+    if (complete) {
+        GLStateCache& state = GLStateCache::Get();
+        state.SetDepthMask(true);
+        glViewport(0, 0, size, size);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        
+        state.UseProgram(shader.GetID());
+        shader.Set(shader.GetVertexDecodeUniforms(), mesh.GetVertexDecode());
+        Uniform<glm::mat4> viewProjection = shader.GetUniform<glm::mat4>("viewProjection");
+        
+        // Orthographic views of the bounding sphere from each frame's
+        // direction. impostor.vert rebuilds the same basis from the
+        // direction alone, so the quad lines up with the image.
+        glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+        for (int y = 0; y < GRID; ++y) {
+            for (int x = 0; x < GRID; ++x) {
+                glm::vec2 cell((x + 0.5f) / GRID, (y + 0.5f) / GRID);
+                glm::vec3 direction = DecodeOctahedral(cell * 2.0f - 1.0f);
+                glm::vec3 up = std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f)
+                                                              : glm::vec3(0.0f, 1.0f, 0.0f);
+                glm::mat4 view = glm::lookAt(center + direction * (2.0f * radius), center, up);
+                
+                glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+                shader.Set(viewProjection, projection * view);
+                mesh.Render();
+            }
+        }
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (!complete) {
+        std::cerr << "Impostor atlas framebuffer incomplete" << std::endl;
+        return false;
+    }
+    
+    // The background is zero, so mips hold premultiplied normals; the
+    // impostor shader divides by coverage
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_texture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    
+    m_center = center;
+    m_radius = radius;
+    return true;
+}
+
+size_t ImpostorAtlas::GetGpuMemorySize() const {
+    // RGBA8 plus the mip chain (about a third more)
+    const size_t size = static_cast<size_t>(GRID) * FRAME_SIZE;
+    return m_texture != 0 ? size * size * 4 * 4 / 3 : 0;
+}
+
+ImpostorAtlas::Uniforms ImpostorAtlas::GetUniforms(const Shader& shader) {
+    Uniforms uniforms;
+    uniforms.atlas = shader.GetUniform<int>("impostorAtlas");
+    uniforms.grid = shader.GetUniform<int>("impostorGrid");
+    uniforms.center = shader.GetUniform<glm::vec3>("impostorCenter");
+    uniforms.radius = shader.GetUniform<float>("impostorRadius");
+    return uniforms;
+}
+
+void ImpostorAtlas::Apply(const Shader& shader, const Uniforms& uniforms) const {
+    GLStateCache::Get().BindTexture(IMPOSTOR_TEXTURE_UNIT, GL_TEXTURE_2D, m_texture);
+    shader.Set(uniforms.atlas, static_cast<int>(IMPOSTOR_TEXTURE_UNIT));
+    shader.Set(uniforms.grid, GRID);
+    shader.Set(uniforms.center, m_center);
+    shader.Set(uniforms.radius, m_radius);
+}
+
+} // namespace FlightSim
@@ -0,0 +1,112 @@
+#include "renderer/PixelReadbackRing.h"
+#include <glad/glad.h>
+#include <iostream>
+
+namespace FlightSim {
+
+// Upper bound on a blocking wait in Collect; a readback taking longer than
+// this stays pending rather than blocking the caller any longer
+static constexpr GLuint64 MAX_WAIT_NS = 1000000000ull;
+
+PixelReadbackRing::PixelReadbackRing()
+    : m_head(0)
+    , m_pending(0)
+    , m_width(0)
+    , m_height(0) {
+}
+
+PixelReadbackRing::~PixelReadbackRing() {
+    Shutdown();
+}
+
+bool PixelReadbackRing::Initialize(int width, int height, int depth) {
+    Shutdown();
+    m_width = width;
+    m_height = height;
+    m_slots.resize(depth);
+    
+    for (Slot& slot : m_slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GetFrameSize(), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    return depth > 0;
+}
+
+void PixelReadbackRing::Shutdown() {
+    for (Slot& slot : m_slots) {
+        if (slot.fence) {
+            glDeleteSync(static_cast<GLsync>(slot.fence));
+        }
+        if (slot.buffer != 0) {
+            glDeleteBuffers(1, &slot.buffer);
+        }
+    }
+    m_slots.clear();
+    m_head = 0;
+    m_pending = 0;
+}
+
+bool PixelReadbackRing::Queue(unsigned int framebuffer) {
+    if (m_slots.empty() || m_pending == static_cast<int>(m_slots.size())) {
+        return false;
+    }
+    
+    Slot& slot = m_slots[m_head];
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    
+    // With a pack buffer bound the last argument is an offset and the call
+    // only enqueues the copy
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_head = (m_head + 1) % static_cast<int>(m_slots.size());
+    m_pending++;
+    return true;
+}
+
+int PixelReadbackRing::Collect(const Consumer& consumer, bool waitForOldest) {
+    int collected = 0;
+    const int slotCount = static_cast<int>(m_slots.size());
+    
+    while (m_pending > 0) {
+        Slot& slot = m_slots[(m_head - m_pending + slotCount) % slotCount];
+        GLsync fence = static_cast<GLsync>(slot.fence);
+        
+        bool wait = waitForOldest && collected == 0;
+        GLenum status = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? MAX_WAIT_NS : 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            break; // Still in flight; a later Collect picks it up
+        }
+        
+        glDeleteSync(fence);
+        slot.fence = nullptr;
+        m_pending--;
+        
+        if (status == GL_WAIT_FAILED) {
+            std::cerr << "Readback fence wait failed; frame dropped" << std::endl;
+            continue;
+        }
+        
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GetFrameSize(), GL_MAP_READ_BIT);
+        if (pixels) {
+            consumer(static_cast<const uint8_t*>(pixels));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            collected++;
+        } else {
+            std::cerr << "Failed to map readback buffer; frame dropped" << std::endl;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    
+    return collected;
+}
+
+} // namespace FlightSim
@@ -0,0 +1,449 @@
+#include "renderer/RenderGraph.h"
+#include "renderer/GpuProfiler.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace FlightSim {
+
+static bool IsDepthFormat(unsigned int format) {
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F ||
+           format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool HasStencil(unsigned int format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t GetBytesPerPixel(unsigned int format) {
+    switch (format) {
+        case GL_R8:                 return 1;
+        case GL_RG8:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16:  return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:  return 8;
+        case GL_RGBA32F:            return 16;
+        default:                    return 4; // RGBA8, R11F_G11F_B10F, R32F, 24/32-bit depth
+    }
+}
+
+void RenderGraph::Builder::Read(RenderResource resource) {
+    Resource& r = m_graph.m_resources[resource];
+    if (!r.imported && r.writers.empty()) {
+        std::cerr << "Render pass " << m_graph.m_passes[m_pass].name << " reads " << r.name
+                  << " before any pass writes it" << std::endl;
+    }
+    std::vector<RenderResource>& reads = m_graph.m_passes[m_pass].reads;
+    if (std::find(reads.begin(), reads.end(), resource) == reads.end()) {
+        reads.push_back(resource);
+    }
+}
+
+void RenderGraph::Builder::Write(RenderResource resource) {
+    std::vector<RenderResource>& writes = m_graph.m_passes[m_pass].writes;
+    if (std::find(writes.begin(), writes.end(), resource) == writes.end()) {
+        writes.push_back(resource);
+        m_graph.m_resources[resource].writers.push_back(m_pass);
+    }
+}
+
+void RenderGraph::Builder::SetSideEffect() {
+    m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+RenderGraph::RenderGraph()
+    : m_resourceCount(0)
+    , m_passCount(0)
+    , m_frame(0) {
+}
+
+RenderGraph::~RenderGraph() {
+    Shutdown();
+}
+
+void RenderGraph::Shutdown() {
+    for (const CachedFramebuffer& cached : m_framebuffers) {
+        glDeleteFramebuffers(1, &cached.framebuffer);
+    }
+    GLStateCache& state = GLStateCache::Get();
+    for (const PooledTexture& pooled : m_pool) {
+        state.OnTextureDeleted(pooled.texture);
+        glDeleteTextures(1, &pooled.texture);
+    }
+    m_framebuffers.clear();
+    m_pool.clear();
+    m_resources.clear();
+    m_passes.clear();
+    m_resourceCount = 0;
+    m_passCount = 0;
+}
+
+void RenderGraph::Reset() {
+    m_resourceCount = 0;
+    m_passCount = 0;
+}
+
+RenderResource RenderGraph::CreateTexture(const char* name, const RenderTextureDesc& desc) {
+    if (m_resourceCount == static_cast<int>(m_resources.size())) {
+        m_resources.emplace_back();
+    }
+    Resource& r = m_resources[m_resourceCount];
+    r.name = name;
+    r.desc = desc;
+    r.imported = false;
+    r.isFramebuffer = false;
+    r.output = false;
+    r.object = 0;
+    r.physical = -1;
+    r.readers = 0;
+    r.firstPass = -1;
+    r.lastPass = -1;
+    r.writers.clear();
+    return m_resourceCount++;
+}
+
+RenderResource RenderGraph::ImportFramebuffer(const char* name, unsigned int framebuffer, int width, int height) {
+    RenderTextureDesc desc;
+    desc.width = width;
+    desc.height = height;
+    RenderResource resource = CreateTexture(name, desc);
+    Resource& r = m_resources[resource];
+    r.imported = true;
+    r.isFramebuffer = true;
+    r.object = framebuffer;
+    return resource;
+}
+
+RenderResource RenderGraph::ImportTexture(const char* name, unsigned int texture) {
+    RenderResource resource = CreateTexture(name, RenderTextureDesc());
+    Resource& r = m_resources[resource];
+    r.imported = true;
+    r.object = texture;
+    return resource;
+}
+
+void RenderGraph::MarkOutput(RenderResource resource) {
+    m_resources[resource].output = true;
+}
+
+void RenderGraph::AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute) {
+    if (m_passCount == static_cast<int>(m_passes.size())) {
+        m_passes.emplace_back();
+    }
+    Pass& pass = m_passes[m_passCount];
+    pass.name = name;
+    pass.execute = execute;
+    pass.reads.clear();
+    pass.writes.clear();
+    pass.sideEffect = false;
+    pass.references = 0;
+    pass.culled = false;
+    
+    Builder builder(*this, m_passCount++);
+    setup(builder);
+}
+
+void RenderGraph::Cull() {
+    for (int i = 0; i < m_resourceCount; ++i) {
+        m_resources[i].readers = m_resources[i].output ? 1 : 0;
+    }
+    for (int i = 0; i < m_passCount; ++i) {
+        Pass& pass = m_passes[i];
+        pass.references = static_cast<int>(pass.writes.size()) + (pass.sideEffect ? 1 : 0);
+        pass.culled = false;
+        for (RenderResource read : pass.reads) {
+            m_resources[read].readers++;
+        }
+    }
+    
+    // Passes with nothing observable go first, then unread resources are
+    // walked back to their writers until every remaining pass is needed
+    std::vector<RenderResource>& unread = m_unread;
+    unread.clear();
+    auto cullPass = [this, &unread](Pass& pass) {
+        pass.culled = true;
+        for (RenderResource read : pass.reads) {
+            if (--m_resources[read].readers == 0) {
+                unread.push_back(read);
+            }
+        }
+    };
+    for (int i = 0; i < m_passCount; ++i) {
+        if (m_passes[i].references == 0) {
+            cullPass(m_passes[i]);
+        }
+    }
+    for (int i = 0; i < m_resourceCount; ++i) {
+        if (m_resources[i].readers == 0) {
+            unread.push_back(i);
+        }
+    }
+    
+    while (!unread.empty()) {
+        RenderResource resource = unread.back();
+        unread.pop_back();
+        for (int writer : m_resources[resource].writers) {
+            Pass& pass = m_passes[writer];
+            if (!pass.culled && --pass.references == 0) {
+                cullPass(pass);
+            }
+        }
+    }
+}
+
+void RenderGraph::ComputeLifetimes() {
+    for (int i = 0; i < m_passCount; ++i) {
+        const Pass& pass = m_passes[i];
+        if (pass.culled) continue;
+        
+        for (const std::vector<RenderResource>* list : {&pass.reads, &pass.writes}) {
+            for (RenderResource resource : *list) {
+                Resource& r = m_resources[resource];
+                if (r.firstPass < 0) {
+                    r.firstPass = i;
+                }
+                r.lastPass = std::max(r.lastPass, i);
+            }
+        }
+    }
+}
+
+int RenderGraph::Acquire(const RenderTextureDesc& desc) {
+    for (size_t i = 0; i < m_pool.size(); ++i) {
+        PooledTexture& pooled = m_pool[i];
+        if (!pooled.inUse && pooled.desc == desc) {
+            pooled.inUse = true;
+            pooled.lastUsedFrame = m_frame;
+            return static_cast<int>(i);
+        }
+    }
+    
+    PooledTexture pooled;
+    pooled.desc = desc;
+    pooled.lastUsedFrame = m_frame;
+    pooled.inUse = true;
+    glGenTextures(1, &pooled.texture);
+    
+    GLStateCache& state = GLStateCache::Get();
+    if (desc.samples > 1) {
+        state.BindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, pooled.texture);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.format, desc.width, desc.height, GL_TRUE);
+    } else {
+        // Storage only; the format and type describe the absent initial data
+        bool depth = IsDepthFormat(desc.format);
+        GLenum format = depth ? (HasStencil(desc.format) ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT) : GL_RGBA;
+        GLenum type = HasStencil(desc.format) ? (desc.format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV
+                                                                                      : GL_UNSIGNED_INT_24_8)
+                                              : (depth ? GL_FLOAT : GL_UNSIGNED_BYTE);
+        GLint filter = depth ? GL_NEAREST : GL_LINEAR;
+        state.BindTexture(0, GL_TEXTURE_2D, pooled.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    
+    m_pool.push_back(pooled);
+    return static_cast<int>(m_pool.size()) - 1;
+}
+
+void RenderGraph::RetireUnused() {
+    for (size_t i = 0; i < m_pool.size();) {
+        const PooledTexture& pooled = m_pool[i];
+        if (m_frame - pooled.lastUsedFrame <= POOL_RETIRE_FRAMES) {
+            ++i;
+            continue;
+        }
+        
+        // Framebuffers built on the texture go with it
+        unsigned int texture = pooled.texture;
+        m_framebuffers.erase(std::remove_if(m_framebuffers.begin(), m_framebuffers.end(),
+                                            [texture](const CachedFramebuffer& cached) {
+            if (cached.color != texture && cached.depth != texture) return false;
+            glDeleteFramebuffers(1, &cached.framebuffer);
+            return true;
+        }), m_framebuffers.end());
+        
+        // GL reuses the name, and Acquire binds new textures through the
+        // cache, which must not think the reused name is still bound
+        GLStateCache::Get().OnTextureDeleted(texture);
+        glDeleteTextures(1, &texture);
+        m_pool.erase(m_pool.begin() + i);
+    }
+}
+
+void RenderGraph::Execute(GpuProfiler* profiler) {
+    m_frame++;
+    
+    // Pool indices are only held during Execute, so entries can go here
+    RetireUnused();
+    for (PooledTexture& pooled : m_pool) {
+        pooled.inUse = false;
+    }
+    
+    Cull();
+    ComputeLifetimes();
+    
+    for (int i = 0; i < m_passCount; ++i) {
+        Pass& pass = m_passes[i];
+        if (pass.culled) continue;
+        
+        for (const std::vector<RenderResource>* list : {&pass.writes, &pass.reads}) {
+            for (RenderResource resource : *list) {
+                Resource& r = m_resources[resource];
+                if (!r.imported && r.firstPass == i && r.physical < 0) {
+                    r.physical = Acquire(r.desc);
+                }
+            }
+        }
+        
+        if (profiler) profiler->BeginScope(pass.name);
+        pass.execute(*this);
+        if (profiler) profiler->EndScope();
+        
+        // Targets whose last use this was go back to the pool for later passes
+        for (const std::vector<RenderResource>* list : {&pass.writes, &pass.reads}) {
+            for (RenderResource resource : *list) {
+                const Resource& r = m_resources[resource];
+                if (!r.imported && r.lastPass == i && r.physical >= 0) {
+                    m_pool[r.physical].inUse = false;
+                }
+            }
+        }
+    }
+    
+    BuildReport();
+}
+
+unsigned int RenderGraph::GetTexture(RenderResource resource) const {
+    const Resource& r = m_resources[resource];
+    if (r.imported) {
+        return r.isFramebuffer ? 0 : r.object;
+    }
+    return r.physical >= 0 ? m_pool[r.physical].texture : 0;
+}
+
+unsigned int RenderGraph::GetFramebuffer(RenderResource color, RenderResource depth) {
+    if (color != NO_RENDER_RESOURCE && m_resources[color].isFramebuffer) {
+        return m_resources[color].object;
+    }
+    
+    unsigned int colorTexture = color != NO_RENDER_RESOURCE ? GetTexture(color) : 0;
+    unsigned int depthTexture = depth != NO_RENDER_RESOURCE ? GetTexture(depth) : 0;
+    for (const CachedFramebuffer& cached : m_framebuffers) {
+        if (cached.color == colorTexture && cached.depth == depthTexture) {
+            return cached.framebuffer;
+        }
+    }
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    
+    CachedFramebuffer cached = {colorTexture, depthTexture, 0};
+    glGenFramebuffers(1, &cached.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, cached.framebuffer);
+    if (colorTexture != 0) {
+        GLenum target = m_resources[color].desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, colorTexture, 0);
+    } else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    if (depthTexture != 0) {
+        const RenderTextureDesc& desc = m_resources[depth].desc;
+        GLenum target = desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+        GLenum attachment = HasStencil(desc.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, target, depthTexture, 0);
+    }
+    
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render graph framebuffer for " << (color != NO_RENDER_RESOURCE ? m_resources[color].name : "")
+                  << (depth != NO_RENDER_RESOURCE ? " " : "") << (depth != NO_RENDER_RESOURCE ? m_resources[depth].name : "")
+                  << " incomplete: 0x" << std::hex << status << std::dec << std::endl;
+    }
+    
+    m_framebuffers.push_back(cached);
+    return cached.framebuffer;
+}
+
+void RenderGraph::BindTarget(RenderResource color, RenderResource depth) {
+    glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(color, depth));
+    const RenderTextureDesc& desc = m_resources[color != NO_RENDER_RESOURCE ? color : depth].desc;
+    glViewport(0, 0, desc.width, desc.height);
+}
+
+size_t RenderGraph::GetTextureBytes(const RenderTextureDesc& desc) {
+    return static_cast<size_t>(desc.width) * desc.height * GetBytesPerPixel(desc.format) * std::max(desc.samples, 1);
+}
+
+void RenderGraph::BuildReport() {
+    m_report.passes.clear();
+    m_report.resources.clear();
+    m_report.transientBytes = 0;
+    m_report.pooledBytes = 0;
+    m_report.pooledTextures = static_cast<int>(m_pool.size());
+    
+    for (int i = 0; i < m_passCount; ++i) {
+        m_report.passes.push_back({m_passes[i].name, m_passes[i].culled});
+    }
+    for (int i = 0; i < m_resourceCount; ++i) {
+        const Resource& r = m_resources[i];
+        size_t bytes = r.imported ? 0 : GetTextureBytes(r.desc);
+        m_report.resources.push_back({r.name, r.imported, r.physical, bytes});
+        if (r.physical >= 0) {
+            m_report.transientBytes += bytes;
+        }
+    }
+    for (const PooledTexture& pooled : m_pool) {
+        m_report.pooledBytes += GetTextureBytes(pooled.desc);
+    }
+}
+
+void RenderGraph::WriteReport(std::ostream& stream, const GpuProfiler* profiler) const {
+    std::vector<GpuProfiler::ScopeStats> scopes;
+    if (profiler) {
+        scopes = profiler->GetStats();
+    }
+    
+    const double megabyte = 1024.0 * 1024.0;
+    stream << std::fixed << std::setprecision(2);
+    stream << "Render graph: " << m_report.passes.size() << " passes, " << m_report.pooledTextures
+           << " pooled textures, " << m_report.pooledBytes / megabyte << " MB held ("
+           << m_report.transientBytes / megabyte << " MB without reuse)\n";
+    
+    for (const PassReport& pass : m_report.passes) {
+        stream << "  pass " << std::left << std::setw(16) << pass.name << std::right;
+        if (pass.culled) {
+            stream << " culled\n";
+            continue;
+        }
+        auto scope = std::find_if(scopes.begin(), scopes.end(), [&pass](const GpuProfiler::ScopeStats& stats) {
+            return stats.name == pass.name;
+        });
+        if (scope != scopes.end()) {
+            stream << ' ' << scope->averageMs << " ms avg, " << scope->p95Ms << " ms p95";
+        }
+        stream << '\n';
+    }
+    
+    for (const ResourceReport& resource : m_report.resources) {
+        stream << "  resource " << std::left << std::setw(16) << resource.name << std::right;
+        if (resource.imported) {
+            stream << " imported\n";
+        } else if (resource.physical < 0) {
+            stream << " unused\n";
+        } else {
+            stream << " pool #" << resource.physical << ", " << resource.bytes / megabyte << " MB\n";
+        }
+    }
+    stream << std::defaultfloat;
+}
+
+} // namespace FlightSim
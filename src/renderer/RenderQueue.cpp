@@ -0,0 +1,217 @@
+#include "renderer/RenderQueue.h"
+#include "core/GLStateCache.h"
+#include "core/Shader.h"
+#include "core/Mesh.h"
+#include "renderer/GpuProfiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace FlightSim {
+
+// Key layout, most significant first:
+//   opaque/sky/overlay: layer:2 | program:12 | material:12 | vao:14 | depth:24
+//   transparent:        layer:2 | ~depth:24  | program:12  | material:12 | vao:14
+// Ids are truncated to their field width; a collision only costs a
+// redundant bind, never a wrong draw, because execution compares the
+// packets themselves.
+static constexpr int LAYER_SHIFT = 62;
+static constexpr uint64_t PROGRAM_MASK = 0xFFF;
+static constexpr uint64_t MATERIAL_MASK = 0xFFF;
+static constexpr uint64_t VAO_MASK = 0x3FFF;
+static constexpr uint64_t DEPTH_MASK = 0xFFFFFF;
+
+RenderQueue::RenderQueue()
+    : m_profiler(nullptr)
+    , m_maxDepth(10000.0f)
+    , m_sorted(false) {
+}
+
+void RenderQueue::Clear() {
+    m_packets.clear();
+    m_materials.clear();
+    m_order.clear();
+    m_sorted = false;
+}
+
+uint32_t RenderQueue::AddMaterial(const RenderMaterial& material) {
+    m_materials.push_back(material);
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+void RenderQueue::Submit(RenderLayer layer, const Shader& shader, const Mesh& mesh, uint32_t material,
+                         float viewDepth, uint32_t instanceCount, uint32_t userData) {
+    if (!shader.IsValid() || !mesh.IsUploaded() || material >= m_materials.size()) return;
+    
+    float depth01 = std::clamp(viewDepth / m_maxDepth, 0.0f, 1.0f);
+    
+    DrawPacket packet;
+    packet.key = MakeKey(layer, shader.GetID(), material, mesh.GetVAO(), depth01);
+    packet.shader = &shader;
+    packet.mesh = &mesh;
+    packet.material = material;
+    packet.instanceCount = instanceCount;
+    packet.userData = userData;
+    packet.indirectOffset = 0;
+    packet.drawCount = 0;
+    m_packets.push_back(packet);
+    m_sorted = false;
+}
+
+void RenderQueue::SubmitIndirect(RenderLayer layer, const Shader& shader, const Mesh& mesh, uint32_t material,
+                                 float viewDepth, uint32_t indirectOffset, uint32_t drawCount,
+                                 uint32_t userData) {
+    if (drawCount == 0) return;
+    
+    size_t count = m_packets.size();
+    Submit(layer, shader, mesh, material, viewDepth, 0, userData);
+    if (m_packets.size() == count) return; // Rejected by Submit
+    
+    m_packets.back().indirectOffset = indirectOffset;
+    m_packets.back().drawCount = drawCount;
+}
+
+uint64_t RenderQueue::MakeKey(RenderLayer layer, unsigned int program, uint32_t material,
+                              unsigned int vao, float depth01) {
+    uint64_t depth = static_cast<uint64_t>(depth01 * DEPTH_MASK) & DEPTH_MASK;
+    uint64_t key = static_cast<uint64_t>(layer) << LAYER_SHIFT;
+    
+    if (layer == RenderLayer::Transparent) {
+        key |= (DEPTH_MASK - depth) << 38;
+        key |= (program & PROGRAM_MASK) << 26;
+        key |= (material & MATERIAL_MASK) << 14;
+        key |= (vao & VAO_MASK);
+    } else {
+        key |= (program & PROGRAM_MASK) << 50;
+        key |= (material & MATERIAL_MASK) << 38;
+        key |= (vao & VAO_MASK) << 24;
+        key |= depth;
+    }
+    return key;
+}
+
+void RenderQueue::Sort() {
+    const size_t count = m_packets.size();
+    m_order.resize(count);
+    m_scratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        m_order[i] = {m_packets[i].key, static_cast<uint32_t>(i)};
+    }
+    
+    // LSD radix sort, one byte per pass. Passes where every key has the
+    // same byte are skipped, which is most of them for typical scenes.
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (const SortEntry& entry : m_order) {
+            histogram[(entry.key >> shift) & 0xFF]++;
+        }
+        if (count == 0 || histogram[(m_order[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+        
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const SortEntry& entry : m_order) {
+            m_scratch[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        m_order.swap(m_scratch);
+    }
+    
+    m_sorted = true;
+}
+
+void RenderQueue::Execute() {
+    if (!m_sorted) {
+        Sort();
+    }
+    
+    GLStateCache& state = GLStateCache::Get();
+    int layer = -1;
+    const Shader* shader = nullptr;
+    uint32_t material = UINT32_MAX;
+    const char* scope = nullptr;
+    
+    for (const SortEntry& entry : m_order) {
+        const DrawPacket& packet = m_packets[entry.packet];
+        
+        int packetLayer = static_cast<int>(packet.key >> LAYER_SHIFT);
+        if (packetLayer != layer) {
+            ApplyLayerState(static_cast<RenderLayer>(packetLayer));
+            layer = packetLayer;
+        }
+        
+        // Uniforms live in the program, so a program change re-applies the material
+        if (packet.shader != shader) {
+            state.UseProgram(packet.shader->GetID());
+            shader = packet.shader;
+            material = UINT32_MAX;
+        }
+        
+        const RenderMaterial& renderMaterial = m_materials[packet.material];
+        if (m_profiler && renderMaterial.label != scope) {
+            if (scope) {
+                m_profiler->EndScope();
+            }
+            if (renderMaterial.label) {
+                m_profiler->BeginScope(renderMaterial.label);
+            }
+            scope = renderMaterial.label;
+        }
+        
+        if (packet.material != material) {
+            if (renderMaterial.apply) {
+                renderMaterial.apply(*shader, renderMaterial.context);
+            }
+            material = packet.material;
+        }
+        
+        state.BindVertexArray(packet.mesh->GetVAO());
+        if (renderMaterial.prepareDraw) {
+            renderMaterial.prepareDraw(packet, renderMaterial.context);
+        }
+        
+        if (packet.drawCount > 0) {
+            packet.mesh->RenderIndirect(packet.indirectOffset, static_cast<int>(packet.drawCount));
+        } else if (packet.instanceCount > 0) {
+            packet.mesh->RenderInstanced(static_cast<int>(packet.instanceCount));
+        } else {
+            packet.mesh->Render();
+        }
+    }
+    
+    if (m_profiler && scope) {
+        m_profiler->EndScope();
+    }
+    
+    // Leave the default state for passes that do not go through the queue
+    if (layer != static_cast<int>(RenderLayer::Opaque)) {
+        ApplyLayerState(RenderLayer::Opaque);
+    }
+}
+
+void RenderQueue::ApplyLayerState(RenderLayer layer) {
+    GLStateCache& state = GLStateCache::Get();
+    switch (layer) {
+        case RenderLayer::Opaque:
+            state.SetDepthFunc(GL_LESS);
+            state.SetDepthMask(true);
+            break;
+        case RenderLayer::Sky:
+            state.SetDepthFunc(GL_LEQUAL);
+            state.SetDepthMask(false);
+            break;
+        case RenderLayer::Transparent:
+            state.SetDepthFunc(GL_LESS);
+            state.SetDepthMask(false);
+            break;
+        case RenderLayer::Overlay:
+            state.SetDepthFunc(GL_ALWAYS);
+            state.SetDepthMask(false);
+            break;
+    }
+}
+
+} // namespace FlightSim
@@ -0,0 +1,118 @@
+#include "renderer/RenderTarget.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+namespace FlightSim {
+
+RenderTarget::RenderTarget()
+    : m_framebuffer(0)
+    , m_colorBuffer(0)
+    , m_colorTexture(0)
+    , m_depthBuffer(0)
+    , m_width(0)
+    , m_height(0)
+    , m_samples(0) {
+}
+
+RenderTarget::~RenderTarget() {
+    Shutdown();
+}
+
+bool RenderTarget::Initialize(int width, int height, int samples, bool colorTexture) {
+    Shutdown();
+    if (samples > 1 && colorTexture) {
+        std::cerr << "Render target cannot have both a multisampled and a texture color buffer" << std::endl;
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_samples = samples > 1 ? samples : 0;
+    
+    if (colorTexture) {
+        glGenTextures(1, &m_colorTexture);
+        GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        glGenRenderbuffers(1, &m_colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples, GL_RGBA8, width, height);
+    }
+    
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    if (colorTexture) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+    } else {
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    }
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render target " << width << "x" << height << " incomplete: 0x"
+                  << std::hex << status << std::dec << std::endl;
+        Shutdown();
+        return false;
+    }
+    
+    return true;
+}
+
+void RenderTarget::Shutdown() {
+    if (m_framebuffer != 0) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        m_framebuffer = 0;
+    }
+    if (m_colorBuffer != 0) {
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+        m_colorBuffer = 0;
+    }
+    if (m_colorTexture != 0) {
+        // Deleted names get recycled; the cache must not think it is still bound
+        GLStateCache::Get().Invalidate();
+        glDeleteTextures(1, &m_colorTexture);
+        m_colorTexture = 0;
+    }
+    if (m_depthBuffer != 0) {
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+}
+
+void RenderTarget::Bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTarget::BindDefault() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::ReadPixels(std::vector<uint8_t>& pixels) const {
+    const size_t rowSize = static_cast<size_t>(m_width) * 4;
+    pixels.resize(rowSize * m_height);
+    
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    
+    // GL rows start at the bottom; images start at the top
+    for (int y = 0; y < m_height / 2; ++y) {
+        std::swap_ranges(pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize,
+                         pixels.begin() + (m_height - 1 - y) * rowSize);
+    }
+}
+
+} // namespace FlightSim
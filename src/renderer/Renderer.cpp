@@ -1,27 +1,116 @@
 #include "renderer/Renderer.h"
-#include "physics/Aircraft.h"
+#include "core/WorldSnapshot.h"
 #include "core/Mesh.h"
 #include "core/Shader.h"
 #include "renderer/SkyBox.h"
 #include "renderer/Terrain.h"
 #include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <chrono>
+#include <filesystem>
 
 namespace FlightSim {
 
+static constexpr float FPS_UPDATE_INTERVAL = 0.5f; // Seconds
+
+// Optional model built with tools/meshconv
+static constexpr const char* AIRCRAFT_MODEL_PATH = "resources/models/aircraft.fsmesh";
+
+// Per frame; grows if a frame needs more (about 20k aircraft instances)
+static constexpr size_t STREAMING_PARTITION_SIZE = 1 << 20;
+
+static const char* DEBUG_LINE_VERTEX_SOURCE = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+out vec3 Color;
+
+uniform mat4 viewProjection;
+
+void main() {
+    Color = aColor;
+    gl_Position = viewProjection * vec4(aPos, 1.0);
+}
+)";
+
+static const char* DEBUG_LINE_FRAGMENT_SOURCE = R"(
+#version 330 core
+in vec3 Color;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(Color, 1.0);
+}
+)";
+
+// Stand-in runway: 900 m along z through the origin, 45 m wide, with
+// a parallel taxiway. A couple of hundred lights at fixed positions.
+static std::vector<PointLight> CreateAirfieldLights() {
+    const glm::vec3 white(1.0f, 0.9f, 0.7f);
+    const glm::vec3 green(0.2f, 1.0f, 0.3f);
+    const glm::vec3 red(1.0f, 0.1f, 0.05f);
+    const glm::vec3 blue(0.2f, 0.3f, 1.0f);
+    const float halfLength = 450.0f;
+    const float halfWidth = 23.0f;
+    const float taxiwayX = 120.0f;
+    
+    std::vector<PointLight> lights;
+    for (float z = -halfLength; z <= halfLength; z += 30.0f) {
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(-halfWidth, 0.5f, z), white, 10.0f));
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(halfWidth, 0.5f, z), white, 10.0f));
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(taxiwayX - 12.0f, 0.3f, z), blue, 4.0f));
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(taxiwayX + 12.0f, 0.3f, z), blue, 4.0f));
+    }
+    for (float z = -halfLength + 15.0f; z < halfLength; z += 15.0f) {
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(0.0f, 0.2f, z), white, 6.0f));
+    }
+    
+    // Threshold bars, green at the approach end and red at the far end,
+    // and two approach crossbars before the threshold
+    for (float x = -halfWidth; x <= halfWidth; x += 46.0f / 11.0f) {
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(x, 0.5f, -halfLength), green, 8.0f));
+        lights.push_back(ClusteredLights::MakeLight(glm::vec3(x, 0.5f, halfLength), red, 8.0f));
+    }
+    for (float z : {-halfLength - 20.0f, -halfLength - 40.0f}) {
+        for (float x = -16.0f; x <= 16.0f; x += 4.0f) {
+            lights.push_back(ClusteredLights::MakeLight(glm::vec3(x, 1.0f, z), white, 12.0f));
+        }
+    }
+    return lights;
+}
+
+static float GetTimeSeconds() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
+
 Renderer::Renderer()
     : m_aircraftShader(nullptr)
     , m_skybox(nullptr)
     , m_terrain(nullptr)
-    , m_aircraftMesh(nullptr)
+    , m_frameView(1.0f)
+    , m_frameProjection(1.0f)
+    , m_frameViewPos(0.0f)
+    , m_frameLightViewProjection(1.0f)
+    , m_frameCamera(nullptr)
+    , m_frameWorld(nullptr)
     , m_initialized(false)
+    , m_specularStrength(0.5f)
     , m_directionalLightDir(0.3f, -1.0f, 0.2f)
     , m_directionalLightColor(1.0f, 1.0f, 0.9f)
     , m_ambientLightColor(0.2f, 0.2f, 0.3f)
-    , m_fogDensity(0.00005f)
-    , m_fogColor(0.7f, 0.8f, 0.9f)
     , m_wireframeMode(false)
     , m_showInstruments(true)
+    , m_dynamicResolutionEnabled(false)
+    , m_dynamicResolutionActive(false)
+    , m_gpuCullingEnabled(true)
+    , m_viewportWidth(0)
+    , m_viewportHeight(0)
     , m_frameCount(0)
     , m_lastFPSUpdate(0.0f)
     , m_currentFPS(0.0f) {
@@ -43,16 +132,163 @@ bool Renderer::Initialize() {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_MULTISAMPLE);
     
-    // Create shaders
+    // Sky, terrain and aircraft all read the atmosphere tables
+    m_atmosphere = std::make_unique<Atmosphere>();
+    if (!m_atmosphere->Initialize()) {
+        std::cerr << "Failed to initialize atmosphere" << std::endl;
+        return false;
+    }
+    
+    m_shadows = std::make_unique<ShadowCascades>();
+    if (!m_shadows->Initialize()) {
+        std::cerr << "Failed to initialize shadow maps" << std::endl;
+        return false;
+    }
+    
+    m_localLights = std::make_unique<ClusteredLights>();
+    if (!m_localLights->Initialize()) {
+        return false;
+    }
+    m_airfieldLights = CreateAirfieldLights();
+    
+    // Create shaders; the aircraft fragment shader gets the atmosphere, shadow and local light libraries
+    std::string aircraftVertex = Shader::ReadFile("resources/shaders/aircraft.vert");
+    std::string aircraftFragment = Shader::ReadFile("resources/shaders/aircraft.frag");
     m_aircraftShader = std::make_unique<Shader>();
-    if (!m_aircraftShader->LoadFromFiles("resources/shaders/aircraft.vert", "resources/shaders/aircraft.frag")) {
+    if (aircraftVertex.empty() || aircraftFragment.empty() ||
+        !m_aircraftShader->BeginLoadFromStrings(aircraftVertex,
+                                                ClusteredLights::AddShaderFunctions(
+                                                    ShadowCascades::AddShaderFunctions(
+                                                        Atmosphere::AddShaderFunctions(aircraftFragment))),
+                                                [this](const Shader&) { ResolveUniforms(); })) {
         std::cerr << "Failed to load aircraft shader" << std::endl;
         return false;
     }
     
-    // Create meshes
-    m_aircraftMesh = std::make_unique<Mesh>();
-    m_aircraftMesh->CreateAircraft();
+    m_aircraftShadowShader = std::make_unique<Shader>();
+    if (!m_aircraftShadowShader->BeginLoadFromFiles("resources/shaders/aircraft_shadow.vert",
+                                                    "resources/shaders/shadow.frag",
+                                                    [this](const Shader& shader) {
+        AircraftShadowUniforms& u = m_aircraftShadowUniforms;
+        u.lightViewProjection = shader.GetUniform<glm::mat4>("lightViewProjection");
+        u.positionOffset = shader.GetUniform<glm::vec3>("positionOffset");
+        u.positionScale = shader.GetUniform<glm::vec3>("positionScale");
+    })) {
+        std::cerr << "Failed to load aircraft shadow shader" << std::endl;
+        return false;
+    }
+    
+    std::string impostorVertex = Shader::ReadFile("resources/shaders/impostor.vert");
+    std::string impostorFragment = Shader::ReadFile("resources/shaders/impostor.frag");
+    m_impostorShader = std::make_unique<Shader>();
+    if (impostorVertex.empty() || impostorFragment.empty() ||
+        !m_impostorShader->BeginLoadFromStrings(impostorVertex,
+                                                ShadowCascades::AddShaderFunctions(
+                                                    Atmosphere::AddShaderFunctions(impostorFragment)),
+                                                [this](const Shader& shader) {
+        ImpostorUniforms& u = m_impostorUniforms;
+        u.view = shader.GetUniform<glm::mat4>("view");
+        u.projection = shader.GetUniform<glm::mat4>("projection");
+        u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+        u.materialDiffuse = shader.GetUniform<glm::vec3>("material_diffuse");
+        u.impostor = ImpostorAtlas::GetUniforms(shader);
+        u.atmosphere = Atmosphere::GetUniforms(shader);
+        u.shadows = ShadowCascades::GetUniforms(shader);
+    })) {
+        std::cerr << "Failed to load impostor shader" << std::endl;
+        return false;
+    }
+    
+    // Create meshes; a converted model replaces the procedural aircraft.
+    // Its detail levels are simplified from a decoded CPU copy.
+    Mesh aircraftSource;
+    VertexLayout aircraftLayout = VertexLayout::Compact();
+    std::error_code error;
+    if (std::filesystem::exists(AIRCRAFT_MODEL_PATH, error) && aircraftSource.LoadFromFile(AIRCRAFT_MODEL_PATH, true)) {
+        aircraftLayout = aircraftSource.GetVertexLayout();
+    } else {
+        aircraftSource = Mesh::CreateAircraft();
+    }
+    // The GPU path draws every level from one merged mesh
+    const bool gpuCullingSupported = GpuCulling::IsSupported();
+    m_aircraftLods = std::make_unique<LodMesh>();
+    if (!m_aircraftLods->Build(aircraftSource, aircraftLayout, gpuCullingSupported)) {
+        std::cerr << "Failed to build aircraft detail levels" << std::endl;
+        return false;
+    }
+    
+    // Without an impostor distant aircraft stay on the coarsest level
+    m_aircraftImpostor = std::make_unique<ImpostorAtlas>();
+    if (!m_aircraftImpostor->Initialize() ||
+        !m_aircraftImpostor->Bake(m_aircraftLods->GetLevel(0), m_aircraftLods->GetCenter(),
+                                  m_aircraftLods->GetRadius())) {
+        std::cerr << "Failed to bake aircraft impostor" << std::endl;
+        m_aircraftImpostor.reset();
+    }
+    
+    m_debugLineShader = std::make_unique<Shader>();
+    if (!m_debugLineShader->BeginLoadFromStrings(DEBUG_LINE_VERTEX_SOURCE, DEBUG_LINE_FRAGMENT_SOURCE,
+                                                 [this](const Shader& shader) {
+        m_debugLineViewProjection = shader.GetUniform<glm::mat4>("viewProjection");
+    })) {
+        std::cerr << "Failed to load debug line shader" << std::endl;
+        return false;
+    }
+    m_debugLineVAO = GLVertexArray::Create();
+    
+    // Dynamic vertex and instance data of every frame goes through one ring
+    m_streamingBuffer = std::make_unique<StreamingBuffer>();
+    if (!m_streamingBuffer->Initialize(STREAMING_PARTITION_SIZE)) {
+        return false;
+    }
+    
+    m_trafficRenderer = std::make_unique<TrafficRenderer>();
+    if (!m_trafficRenderer->Initialize(*m_streamingBuffer)) {
+        std::cerr << "Failed to initialize traffic renderer" << std::endl;
+        return false;
+    }
+    
+    // Optional; without it levels are picked and batched on the CPU
+    if (gpuCullingSupported) {
+        m_gpuCulling = std::make_unique<GpuCulling>();
+        const Mesh* impostorQuad = m_aircraftImpostor ? &m_aircraftImpostor->GetQuad() : nullptr;
+        if (!m_gpuCulling->Initialize(*m_aircraftLods, impostorQuad)) {
+            std::cerr << "GPU culling unavailable, culling aircraft on the CPU" << std::endl;
+            m_gpuCulling.reset();
+        }
+    }
+    
+    m_trailRenderer = std::make_unique<TrailRenderer>();
+    if (!m_trailRenderer->Initialize(static_cast<int>(WorldSnapshot::MAX_TRAILS))) {
+        std::cerr << "Failed to initialize trail renderer" << std::endl;
+        return false;
+    }
+    
+    m_renderQueue = std::make_unique<RenderQueue>();
+    m_renderGraph = std::make_unique<RenderGraph>();
+    m_shadowQueue = std::make_unique<RenderQueue>();
+    m_sensorQueue = std::make_unique<RenderQueue>();
+    
+    // Profiling is optional; without timer queries the scopes are no-ops
+    m_gpuProfiler = std::make_unique<GpuProfiler>();
+    if (m_gpuProfiler->Initialize()) {
+        m_renderQueue->SetProfiler(m_gpuProfiler.get());
+    }
+    
+    // Targets are sized by SetViewport; scene MSAA matches the window's
+    GLint samples = 0;
+    glGetIntegerv(GL_SAMPLES, &samples);
+    m_dynamicResolution = std::make_unique<DynamicResolution>();
+    if (!m_dynamicResolution->Initialize(samples)) {
+        std::cerr << "Failed to initialize dynamic resolution" << std::endl;
+        return false;
+    }
+    
+    m_sensorViews = std::make_unique<SensorViews>();
+    if (!m_sensorViews->Initialize()) {
+        std::cerr << "Failed to initialize sensor views" << std::endl;
+        return false;
+    }
     
     // Create skybox
     m_skybox = std::make_unique<SkyBox>();
@@ -68,28 +304,77 @@ bool Renderer::Initialize() {
         return false;
     }
     
-    // Set up lighting
-    m_lightPosition = glm::vec3(1000.0f, 1000.0f, 1000.0f);
-    m_lightColor = glm::vec3(1.0f, 0.95f, 0.8f); // Warm sunlight
-    m_ambientStrength = 0.3f;
-    m_diffuseStrength = 0.7f;
-    m_specularStrength = 0.5f;
+    m_scenery = std::make_unique<Scenery>();
+    if (!m_scenery->Initialize()) {
+        std::cerr << "Failed to initialize scenery" << std::endl;
+        return false;
+    }
+    m_scenery->GenerateProcedural(*m_terrain);
+    
+    // Optional; without it the sky stays clear
+    m_clouds = std::make_unique<VolumetricClouds>();
+    if (!m_clouds->Initialize()) {
+        std::cerr << "Failed to initialize volumetric clouds" << std::endl;
+        m_clouds.reset();
+    }
     
+    m_frameCount = 0;
+    m_lastFPSUpdate = GetTimeSeconds();
     m_initialized = true;
     return true;
 }
 
 void Renderer::Shutdown() {
     m_aircraftShader.reset();
+    m_aircraftShadowShader.reset();
+    m_impostorShader.reset();
     m_skybox.reset();
     m_terrain.reset();
-    m_aircraftMesh.reset();
+    m_scenery.reset();
+    m_clouds.reset();
+    m_gpuCulling.reset();
+    m_aircraftLods.reset();
+    m_aircraftImpostor.reset();
+    m_aircraftLodState.clear();
+    m_trafficRenderer.reset();
+    m_debugLineShader.reset();
+    m_debugLineVAO.Reset();
+    m_debugLines.clear();
+    m_streamingBuffer.reset();
+    m_trailRenderer.reset();
+    m_atmosphere.reset();
+    m_shadows.reset();
+    m_localLights.reset();
+    m_airfieldLights.clear();
+    m_renderQueue.reset();
+    m_renderGraph.reset();
+    m_shadowQueue.reset();
+    m_sensorQueue.reset();
+    m_sensorViews.reset();
+    m_gpuProfiler.reset();
+    m_dynamicResolution.reset();
+    m_dynamicResolutionEnabled = false;
     m_initialized = false;
 }
 
 void Renderer::BeginFrame() {
-    glClearColor(0.2f, 0.3f, 0.5f, 1.0f); // Sky blue background
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    GLStateCache& state = GLStateCache::Get();
+    m_lastFrameStateCounters = state.GetCounters();
+    state.ResetCounters();
+    if (m_gpuProfiler) {
+        m_gpuProfiler->BeginFrame();
+    }
+    if (m_streamingBuffer) {
+        m_streamingBuffer->BeginFrame();
+    }
+    
+    m_dynamicResolutionActive = m_dynamicResolutionEnabled && m_viewportWidth > 0 && m_viewportHeight > 0;
+    if (m_dynamicResolutionActive) {
+        m_dynamicResolution->Update(*m_gpuProfiler);
+    }
+    if (m_clouds) {
+        m_clouds->Update(*m_gpuProfiler);
+    }
     
     if (m_wireframeMode) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -99,33 +384,234 @@ void Renderer::BeginFrame() {
 }
 
 void Renderer::EndFrame() {
+    if (m_gpuProfiler) {
+        m_gpuProfiler->EndFrame();
+    }
+    if (m_streamingBuffer) {
+        m_streamingBuffer->EndFrame();
+    }
+    
     m_frameCount++;
+    float now = GetTimeSeconds();
+    float elapsed = now - m_lastFPSUpdate;
+    if (elapsed >= FPS_UPDATE_INTERVAL) {
+        m_currentFPS = m_frameCount / elapsed;
+        m_frameCount = 0;
+        m_lastFPSUpdate = now;
+    }
 }
 
-void Renderer::RenderScene(const Camera& camera, const Aircraft& aircraft) {
+void Renderer::RenderScene(const Camera& camera, const WorldSnapshot& world) {
     if (!m_initialized) return;
     
+    // Subsystems submit packets; the queue sorts them by state and draws
+    // opaque geometry before the sky so covered sky pixels are rejected
+    // The graph ends in whatever the caller bound: the window or an offscreen target
+    GLint outputFramebuffer = 0;
+    GLint viewport[4] = {0, 0, 0, 0};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &outputFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    UpdateLocalLights(camera, world);
+    
+    m_renderQueue->Clear();
+    m_renderQueue->SetMaxDepth(camera.GetFarPlane());
+    m_skybox->Submit(*m_renderQueue, camera, *m_atmosphere);
+    m_terrain->Submit(*m_renderQueue, camera, *m_atmosphere, *m_shadows, *m_localLights);
+    m_scenery->Submit(*m_renderQueue, camera, *m_atmosphere, *m_shadows, *m_localLights, true);
+    SubmitAircraft(camera, world, viewport[3]);
+    m_frameCamera = &camera;
+    m_frameWorld = &world;
+    
+    RenderGraph& graph = *m_renderGraph;
+    graph.Reset();
+    RenderResource output = graph.ImportFramebuffer("Output", static_cast<unsigned int>(outputFramebuffer),
+                                                    viewport[2], viewport[3]);
+    RenderResource shadowMap = graph.ImportTexture("Shadow map", m_shadows->GetDepthTexture());
+    RenderResource sensorArray = graph.ImportTexture("Sensor array", m_sensorViews->GetTexture());
+    graph.MarkOutput(output);
+    if (m_sensorViews->GetViewCount() > 0) {
+        graph.MarkOutput(sensorArray);
+    }
+    
+    // Without sun light nothing samples the cascades, so their pass is culled
+    const bool sunUp = m_atmosphere->GetSunDirection().y > 0.0f;
+    
+    graph.AddPass("Shadows", [shadowMap](RenderGraph::Builder& builder) {
+        builder.Write(shadowMap);
+    }, [this](RenderGraph&) {
+        RenderShadows(*m_frameCamera);
+    });
+    
+    // Clouds are marched at a fraction of the output resolution, whatever
+    // the scene's scale, and composited by the scene pass
+    RenderResource clouds = NO_RENDER_RESOURCE;
+    if (m_clouds && m_clouds->IsEnabled() && m_clouds->Resize(viewport[2], viewport[3])) {
+        clouds = graph.ImportTexture("Clouds", m_clouds->GetTexture());
+        graph.AddPass(VolumetricClouds::PASS_NAME, [clouds](RenderGraph::Builder& builder) {
+            builder.Write(clouds);
+        }, [this](RenderGraph&) {
+            m_clouds->Render(*m_frameCamera, *m_atmosphere, m_frameWorld->simulationTime);
+        });
+    }
+    
+    // With dynamic resolution the scene goes into native-sized transients
+    // and only its scaled corner is drawn
+    RenderResource sceneColor = output;
+    RenderResource sceneDepth = NO_RENDER_RESOURCE;
+    RenderTextureDesc sceneDesc;
+    if (m_dynamicResolutionActive) {
+        sceneDesc.width = m_dynamicResolution->GetOutputWidth();
+        sceneDesc.height = m_dynamicResolution->GetOutputHeight();
+        sceneDesc.samples = m_dynamicResolution->GetSamples();
+        sceneDesc.format = GL_RGBA8;
+        sceneColor = graph.CreateTexture("Scene color", sceneDesc);
+        sceneDesc.format = GL_DEPTH24_STENCIL8;
+        sceneDepth = graph.CreateTexture("Scene depth", sceneDesc);
+    }
+    
+    graph.AddPass("Scene", [=](RenderGraph::Builder& builder) {
+        if (sunUp) builder.Read(shadowMap);
+        if (clouds != NO_RENDER_RESOURCE) builder.Read(clouds);
+        builder.Write(sceneColor);
+        if (sceneDepth != NO_RENDER_RESOURCE) builder.Write(sceneDepth);
+    }, [this, sceneColor, sceneDepth, viewport](RenderGraph& graph) {
+        graph.BindTarget(sceneColor, sceneDepth);
+        int width = viewport[2];
+        int height = viewport[3];
+        if (sceneDepth != NO_RENDER_RESOURCE) {
+            width = m_dynamicResolution->GetRenderWidth();
+            height = m_dynamicResolution->GetRenderHeight();
+            glViewport(0, 0, width, height);
+        }
+        DrawScene(*m_frameCamera, *m_frameWorld, width, height);
+    });
+    
+    // This frame's depth, reduced for the next frame's occlusion culling
+    if (IsGpuCullingActive()) {
+        RenderResource depthSource = sceneDepth != NO_RENDER_RESOURCE ? sceneDepth : output;
+        RenderResource pyramid = graph.ImportTexture("Depth pyramid", m_gpuCulling->GetDepthPyramid());
+        graph.MarkOutput(pyramid);
+        graph.AddPass("Depth pyramid", [=](RenderGraph::Builder& builder) {
+            builder.Read(depthSource);
+            builder.Write(pyramid);
+        }, [this, sceneColor, sceneDepth, viewport](RenderGraph& graph) {
+            const Camera& camera = *m_frameCamera;
+            GLuint framebuffer = graph.GetFramebuffer(sceneColor, sceneDepth);
+            int width = viewport[2];
+            int height = viewport[3];
+            if (sceneDepth != NO_RENDER_RESOURCE) {
+                width = m_dynamicResolution->GetRenderWidth();
+                height = m_dynamicResolution->GetRenderHeight();
+            }
+            m_gpuCulling->BuildDepthPyramid(framebuffer, width, height,
+                                            camera.GetProjectionMatrix() * camera.GetViewMatrix());
+        });
+    }
+    
+    // Back to native resolution for the HUD
+    if (m_dynamicResolutionActive) {
+        RenderResource upscaleSource = sceneColor;
+        if (sceneDesc.samples > 0) {
+            sceneDesc.format = GL_RGBA8;
+            sceneDesc.samples = 0;
+            RenderResource resolved = graph.CreateTexture("Scene resolved", sceneDesc);
+            graph.AddPass("Resolve", [=](RenderGraph::Builder& builder) {
+                builder.Read(sceneColor);
+                builder.Read(sceneDepth);
+                builder.Write(resolved);
+            }, [this, sceneColor, sceneDepth, resolved](RenderGraph& graph) {
+                GLuint source = graph.GetFramebuffer(sceneColor, sceneDepth);
+                GLuint destination = graph.GetFramebuffer(resolved);
+                int width = m_dynamicResolution->GetRenderWidth();
+                int height = m_dynamicResolution->GetRenderHeight();
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            });
+            upscaleSource = resolved;
+        }
+        
+        graph.AddPass("Upscale", [=](RenderGraph::Builder& builder) {
+            builder.Read(upscaleSource);
+            builder.Write(output);
+        }, [this, upscaleSource, output](RenderGraph& graph) {
+            graph.BindTarget(output);
+            const RenderTextureDesc& source = graph.GetDesc(upscaleSource);
+            m_dynamicResolution->Upscale(graph.GetTexture(upscaleSource), source.width, source.height);
+        });
+    }
+    
+    graph.AddPass("Sensor views", [=](RenderGraph::Builder& builder) {
+        if (sunUp) builder.Read(shadowMap);
+        builder.Write(sensorArray);
+    }, [this](RenderGraph&) {
+        RenderSensorViews(*m_frameWorld);
+    });
+    
+    graph.Execute(m_gpuProfiler.get());
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(outputFramebuffer));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    m_dynamicResolutionActive = false;
+    m_frameCamera = nullptr;
+    m_frameWorld = nullptr;
+}
+
+void Renderer::DrawScene(const Camera& camera, const WorldSnapshot& world, int width, int height) {
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 projection = camera.GetProjectionMatrix();
     
-    // Render skybox
-    m_skybox->Render(view, projection);
+    GLStateCache::Get().SetDepthMask(true);
+    glClearColor(0.2f, 0.3f, 0.5f, 1.0f); // Sky blue background
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // Render terrain
-    m_terrain->Render(view, projection, m_lightPosition, m_lightColor);
+    m_renderQueue->Sort();
+    m_renderQueue->Execute();
     
-    // Render aircraft with enhanced visuals
-    RenderAircraft(camera, aircraft, view, projection);
+    // Over the sky, behind nearer geometry
+    if (m_clouds && m_clouds->IsEnabled()) {
+        m_gpuProfiler->BeginScope("Cloud composite");
+        m_clouds->Composite(camera, *m_atmosphere, width, height);
+        m_gpuProfiler->EndScope();
+    }
+    
+    // Only points committed since the last frame are uploaded
+    m_gpuProfiler->BeginScope("Trails");
+    m_trailRenderer->Update(world.trails);
+    m_trailRenderer->Render(view, projection, camera.GetNearPlane(), static_cast<float>(world.simulationTime));
+    m_gpuProfiler->EndScope();
+    
+    m_gpuProfiler->BeginScope("Debug lines");
     
-    // Render flight path trail
-    RenderFlightPath(aircraft, view, projection);
+    // Aircraft orientation indicators and the ground reference grid
+    AddOrientationIndicators(world.player);
+    AddGroundGrid();
+    RenderDebugLines(projection * view);
     
-    // Render ground reference grid
-    RenderGroundGrid(view, projection);
+    m_gpuProfiler->EndScope();
 }
 
 void Renderer::SetViewport(int width, int height) {
+    // Minimized windows report 0x0; keep the targets for the restore
+    if (width <= 0 || height <= 0) return;
+    
     glViewport(0, 0, width, height);
+    m_viewportWidth = width;
+    m_viewportHeight = height;
+    if (m_dynamicResolutionEnabled && !m_dynamicResolution->Resize(width, height)) {
+        m_dynamicResolutionEnabled = false;
+    }
+}
+
+void Renderer::SetDynamicResolution(bool enabled) {
+    if (enabled == m_dynamicResolutionEnabled || !m_dynamicResolution) return;
+    
+    // Targets are allocated on first use
+    if (enabled && m_viewportWidth > 0 && !m_dynamicResolution->Resize(m_viewportWidth, m_viewportHeight)) {
+        return;
+    }
+    m_dynamicResolutionEnabled = enabled;
 }
 
 void Renderer::SetDirectionalLight(const glm::vec3& direction, const glm::vec3& color) {
@@ -137,160 +623,406 @@ void Renderer::SetAmbientLight(const glm::vec3& color) {
     m_ambientLightColor = color;
 }
 
-void Renderer::SetFog(float density, const glm::vec3& color) {
-    m_fogDensity = density;
-    m_fogColor = color;
+void Renderer::SetTimeOfDay(float time) {
+    if (m_atmosphere) {
+        m_atmosphere->SetTimeOfDay(time);
+    }
 }
 
-void Renderer::RenderAircraft(const Camera& camera, const Aircraft& aircraft, 
-                             const glm::mat4& view, const glm::mat4& projection) {
-    const AircraftState& state = aircraft.GetState();
-    glm::mat4 model = aircraft.GetModelMatrix();
-    
-    m_aircraftShader->Use();
-    
-    // Set matrices
-    m_aircraftShader->SetMat4("model", model);
-    m_aircraftShader->SetMat4("view", view);
-    m_aircraftShader->SetMat4("projection", projection);
-    
-    // Set lighting
-    m_aircraftShader->SetVec3("lightPos", m_lightPosition);
-    m_aircraftShader->SetVec3("lightColor", m_lightColor);
-    m_aircraftShader->SetVec3("viewPos", camera.GetPosition());
-    m_aircraftShader->SetFloat("ambientStrength", m_ambientStrength);
-    m_aircraftShader->SetFloat("diffuseStrength", m_diffuseStrength);
-    m_aircraftShader->SetFloat("specularStrength", m_specularStrength);
+bool Renderer::LoadScenery(const std::string& path) {
+    if (!m_initialized) return false;
     
-    // Set material properties for better visibility
-    m_aircraftShader->SetVec3("material.ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    m_aircraftShader->SetVec3("material.diffuse", glm::vec3(0.8f, 0.8f, 0.8f));
-    m_aircraftShader->SetVec3("material.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-    m_aircraftShader->SetFloat("material.shininess", 32.0f);
+    // Static cascades were drawn with the old scenery
+    if (!m_scenery->LoadPlacementFile(path, *m_terrain)) return false;
+    m_shadows->InvalidateStatic();
+    return true;
+}
+
+// Navigation lights at the wingtips of the procedural airframe, a flashing
+// red beacon on top and a white strobe under the tail. Flash phases are
+// spread over the fleet so the aircraft do not blink in step.
+static void AddAircraftLights(ClusteredLights& lights, const AircraftState& state, size_t index, float time) {
+    auto place = [&](const glm::vec3& offset) { return state.position + state.orientation * offset; };
+    lights.AddLight(place(glm::vec3(0.0f, 0.0f, -4.2f)), glm::vec3(1.0f, 0.05f, 0.05f), 3.0f);
+    lights.AddLight(place(glm::vec3(0.0f, 0.0f, 4.2f)), glm::vec3(0.05f, 1.0f, 0.2f), 3.0f);
     
-    // Add aircraft color based on state
+    float phase = time + static_cast<float>(index) * 0.37f;
+    if (std::fmod(phase, 1.0f) < 0.15f) {
+        lights.AddLight(place(glm::vec3(0.0f, 0.8f, 0.0f)), glm::vec3(1.0f, 0.1f, 0.05f), 8.0f);
+    }
+    if (std::fmod(phase, 1.5f) < 0.05f) {
+        lights.AddLight(place(glm::vec3(-4.5f, -0.6f, 0.0f)), glm::vec3(1.0f), 40.0f);
+    }
+}
+
+void Renderer::UpdateLocalLights(const Camera& camera, const WorldSnapshot& world) {
+    // Binned on the CPU before any pass draws; sensor views reuse the lists
+    float time = static_cast<float>(world.simulationTime);
+    m_localLights->Clear();
+    m_localLights->AddLights(m_airfieldLights);
+    AddAircraftLights(*m_localLights, world.player, 0, time);
+    for (size_t i = 0; i < world.traffic.size(); ++i) {
+        AddAircraftLights(*m_localLights, world.traffic[i], i + 1, time);
+    }
+    m_localLights->Build(camera, *m_streamingBuffer);
+}
+
+static glm::vec3 GetAircraftTint(const AircraftState& state) {
     glm::vec3 aircraftColor = glm::vec3(0.7f, 0.7f, 0.9f); // Default blue-gray
     if (state.airspeed > 50.0f) {
         aircraftColor = glm::vec3(0.9f, 0.7f, 0.7f); // Red tint at high speed
     } else if (state.altitude > 1000.0f) {
         aircraftColor = glm::vec3(0.7f, 0.9f, 0.7f); // Green tint at high altitude
     }
-    m_aircraftShader->SetVec3("aircraftColor", aircraftColor);
-    
-    // Render aircraft mesh
-    m_aircraftMesh->Render();
-    
-    // Render aircraft orientation indicators
-    RenderOrientationIndicators(aircraft, view, projection);
-    
-    m_aircraftShader->Unbind();
+    return aircraftColor;
 }
 
-void Renderer::RenderOrientationIndicators(const Aircraft& aircraft, 
-                                          const glm::mat4& view, const glm::mat4& projection) {
-    const AircraftState& state = aircraft.GetState();
-    glm::vec3 position = state.position;
+void Renderer::SubmitAircraft(const Camera& camera, const WorldSnapshot& world, int viewportHeight) {
+    if (!m_aircraftShader->IsValid()) return;
     
-    // Render forward direction indicator (red arrow)
-    glm::vec3 forward = aircraft.GetForward();
-    RenderArrow(position, position + forward * 10.0f, glm::vec3(1.0f, 0.0f, 0.0f), view, projection);
+    // Screen pixels per object-space unit at distance 1; levels are chosen
+    // for the main camera and reused by the sensor views
+    float pixelsPerUnit = static_cast<float>(viewportHeight) /
+                          (2.0f * std::tan(glm::radians(camera.GetFov()) * 0.5f));
     
-    // Render up direction indicator (green arrow)
-    glm::vec3 up = aircraft.GetUp();
-    RenderArrow(position, position + up * 5.0f, glm::vec3(0.0f, 1.0f, 0.0f), view, projection);
+    // GPU path: instances go up as they are, in one batch; the cull
+    // dispatch picks levels, rejects hidden instances and fills the
+    // indirect draws
+    if (IsGpuCullingActive()) {
+        const Mesh& merged = m_aircraftLods->GetMergedMesh();
+        m_trafficRenderer->Begin();
+        m_trafficRenderer->Submit(merged, 0, world.player.position, world.player.orientation,
+                                  GetAircraftTint(world.player));
+        for (const AircraftState& state : world.traffic) {
+            m_trafficRenderer->Submit(merged, 0, state.position, state.orientation, GetAircraftTint(state));
+        }
+        m_trafficRenderer->Upload();
+        
+        bool allowImpostors = m_aircraftImpostor && m_impostorShader->IsValid();
+        m_gpuCulling->SetInstances(m_trafficRenderer->GetInstanceBuffer(), m_trafficRenderer->GetInstanceOffset(),
+                                   static_cast<size_t>(m_trafficRenderer->GetInstanceCount()));
+        m_gpuProfiler->BeginScope("Aircraft culling");
+        m_gpuCulling->CullMain(camera.GetProjectionMatrix() * camera.GetViewMatrix(), camera.GetPosition(),
+                               camera.GetNearPlane(), pixelsPerUnit, allowImpostors);
+        m_gpuProfiler->EndScope();
+        
+        SubmitAircraftDraws(*m_renderQueue, camera, GpuCulling::MAIN_VIEW);
+        return;
+    }
+    
+    // Instances keep their level between frames for hysteresis; a changed
+    // traffic list starts over
+    size_t instanceCount = world.traffic.size() + 1;
+    if (m_aircraftLodState.size() != instanceCount) {
+        m_aircraftLodState.assign(instanceCount, -1);
+    }
     
-    // Render right direction indicator (blue arrow)
-    glm::vec3 right = aircraft.GetRight();
-    RenderArrow(position, position + right * 5.0f, glm::vec3(0.0f, 0.0f, 1.0f), view, projection);
+    // Instances sharing a level (and the player, usually on level 0) go out
+    // in one instanced draw
+    m_trafficRenderer->Begin();
+    SubmitAircraftInstance(0, world.player, camera, pixelsPerUnit);
+    for (size_t i = 0; i < world.traffic.size(); ++i) {
+        SubmitAircraftInstance(i + 1, world.traffic[i], camera, pixelsPerUnit);
+    }
+    m_trafficRenderer->Upload();
+    
+    SubmitAircraftDraws(*m_renderQueue, camera, GpuCulling::MAIN_VIEW);
 }
 
-void Renderer::RenderArrow(const glm::vec3& start, const glm::vec3& end, 
-                          const glm::vec3& color, const glm::mat4& view, const glm::mat4& projection) {
-    // Simple line rendering for direction indicators
-    glUseProgram(0); // Use fixed function pipeline for simple lines
-    
-    glMatrixMode(GL_PROJECTION);
-    glLoadMatrixf(glm::value_ptr(projection));
+void Renderer::SubmitAircraftInstance(size_t index, const AircraftState& state, const Camera& camera,
+                                      float pixelsPerUnitAtUnitDistance) {
+    const LodMesh& lods = *m_aircraftLods;
+    float distance = std::max(glm::length(state.position - camera.GetPosition()), camera.GetNearPlane());
+    bool allowImpostor = m_aircraftImpostor && m_impostorShader->IsValid();
+    int level = lods.SelectLevel(pixelsPerUnitAtUnitDistance / distance, m_aircraftLodState[index], allowImpostor);
+    m_aircraftLodState[index] = static_cast<int8_t>(level);
     
-    glMatrixMode(GL_MODELVIEW);
-    glLoadMatrixf(glm::value_ptr(view));
+    const Mesh& mesh = level == lods.GetImpostorLevel() ? m_aircraftImpostor->GetQuad() : lods.GetLevel(level);
+    m_trafficRenderer->Submit(mesh, level, state.position, state.orientation, GetAircraftTint(state));
+}
+
+void Renderer::SubmitAircraftDraws(RenderQueue& queue, const Camera& camera, GpuCulling::View view) {
+    m_frameView = camera.GetViewMatrix();
+    m_frameProjection = camera.GetProjectionMatrix();
+    m_frameViewPos = camera.GetPosition();
     
-    glBegin(GL_LINES);
-    glColor3f(color.r, color.g, color.b);
-    glVertex3f(start.x, start.y, start.z);
-    glVertex3f(end.x, end.y, end.z);
-    glEnd();
+    // On the GPU path the view must have been culled already
+    const bool gpuCulling = IsGpuCullingActive();
+    const int impostorLevel = m_aircraftLods->GetImpostorLevel();
+    uint32_t material = queue.AddMaterial({"Aircraft", &Renderer::ApplyAircraftMaterial,
+                                           &Renderer::PrepareAircraftDraw, this});
+    if (gpuCulling) {
+        m_gpuCulling->SubmitDraws(queue, view, *m_aircraftShader, material);
+    } else {
+        m_trafficRenderer->SubmitDraws(queue, *m_aircraftShader, material, 0, impostorLevel);
+    }
     
-    glColor3f(1.0f, 1.0f, 1.0f); // Reset color
+    if (m_aircraftImpostor && m_impostorShader->IsValid()) {
+        uint32_t impostorMaterial = queue.AddMaterial({"Aircraft impostors", &Renderer::ApplyImpostorMaterial,
+                                                       &Renderer::PrepareImpostorDraw, this});
+        if (gpuCulling) {
+            m_gpuCulling->SubmitImpostorDraws(queue, view, *m_impostorShader, impostorMaterial);
+        } else {
+            m_trafficRenderer->SubmitDraws(queue, *m_impostorShader, impostorMaterial, impostorLevel,
+                                           impostorLevel + 1);
+        }
+    }
 }
 
-void Renderer::RenderFlightPath(const Aircraft& aircraft, 
-                               const glm::mat4& view, const glm::mat4& projection) {
-    // Render a simple flight path trail
-    static std::vector<glm::vec3> trail;
-    static int trailIndex = 0;
+void Renderer::WriteLodReport(std::ostream& stream) const {
+    if (!m_aircraftLods) return;
     
-    const AircraftState& state = aircraft.GetState();
+    // The GPU path only counts instances that survived the main view's cull
+    const bool gpuCulling = IsGpuCullingActive();
+    auto levelInstances = [this, gpuCulling](int level) {
+        return gpuCulling ? m_gpuCulling->ReadVisibleCount(GpuCulling::MAIN_VIEW, level)
+                          : m_trafficRenderer->GetInstanceCount(level);
+    };
     
-    // Add current position to trail every few frames
-    if (trailIndex % 10 == 0) {
-        trail.push_back(state.position);
-        if (trail.size() > 100) { // Keep trail length manageable
-            trail.erase(trail.begin());
-        }
+    const LodMesh& lods = *m_aircraftLods;
+    size_t triangles = 0;
+    stream << "Aircraft LODs (" << lods.GetGpuMemorySize() / 1024 << " KB";
+    if (gpuCulling) {
+        stream << ", GPU culled, " << m_gpuCulling->GetGpuMemorySize() / 1024 << " KB culling buffers";
+    }
+    stream << "):" << std::endl;
+    for (int level = 0; level < lods.GetLevelCount(); ++level) {
+        int instances = levelInstances(level);
+        triangles += lods.GetTriangleCount(level) * instances;
+        stream << "  LOD " << level << ": " << lods.GetTriangleCount(level) << " triangles, error "
+               << lods.GetLevelError(level) << " m, " << instances << " instances" << std::endl;
     }
-    trailIndex++;
+    if (m_aircraftImpostor) {
+        int instances = levelInstances(lods.GetImpostorLevel());
+        triangles += 2 * static_cast<size_t>(instances);
+        stream << "  Impostor (" << m_aircraftImpostor->GetGpuMemorySize() / 1024 << " KB atlas): "
+               << instances << " instances" << std::endl;
+    }
+    stream << "  " << triangles << " triangles for " << m_trafficRenderer->GetInstanceCount() << " aircraft"
+           << std::endl;
+}
+
+void Renderer::RenderShadows(const Camera& camera) {
+    // Cached cascades thin scenery around a fixed origin; once the camera
+    // has moved on, their scenery shadows no longer match what is drawn
+    if (m_scenery->UpdateCachedShadowOrigin()) {
+        m_shadows->InvalidateStatic();
+    }
+    m_shadows->Update(camera, m_atmosphere->GetSunDirection());
     
-    // Render trail
-    if (trail.size() > 1) {
-        glUseProgram(0);
+    for (int cascade = 0; cascade < ShadowCascades::CASCADE_COUNT; ++cascade) {
+        if (!m_shadows->NeedsRender(cascade)) continue;
         
-        glMatrixMode(GL_PROJECTION);
-        glLoadMatrixf(glm::value_ptr(projection));
+        // Static cascades hold terrain and scenery only; aircraft go into
+        // the cascade that is redrawn every frame anyway
+        m_shadowQueue->Clear();
+        m_terrain->SubmitShadow(*m_shadowQueue, m_shadows->GetViewProjection(cascade));
+        m_scenery->SubmitShadow(*m_shadowQueue, m_shadows->GetViewProjection(cascade),
+                                !ShadowCascades::IsDynamic(cascade));
+        if (ShadowCascades::IsDynamic(cascade) && m_aircraftShader->IsValid() && m_aircraftShadowShader->IsValid()) {
+            m_frameLightViewProjection = m_shadows->GetViewProjection(cascade);
+            uint32_t material = m_shadowQueue->AddMaterial({"Aircraft shadow", &Renderer::ApplyAircraftShadowMaterial,
+                                                            &Renderer::PrepareAircraftShadowDraw, this});
+            if (IsGpuCullingActive()) {
+                m_gpuCulling->Cull(GpuCulling::SHADOW_VIEW, m_frameLightViewProjection);
+                m_gpuCulling->SubmitDraws(*m_shadowQueue, GpuCulling::SHADOW_VIEW, *m_aircraftShadowShader,
+                                          material);
+            } else {
+                m_trafficRenderer->SubmitDraws(*m_shadowQueue, *m_aircraftShadowShader, material, 0,
+                                               m_aircraftLods->GetImpostorLevel());
+            }
+        }
         
-        glMatrixMode(GL_MODELVIEW);
-        glLoadMatrixf(glm::value_ptr(view));
+        m_shadows->BeginCascade(cascade);
+        m_shadowQueue->Execute();
+    }
+    m_shadows->End();
+}
+
+void Renderer::RenderSensorViews(const WorldSnapshot& world) {
+    m_sensorViews->Collect();
+    
+    // Sensor rates follow the simulation clock, so headless runs are reproducible
+    float time = static_cast<float>(world.simulationTime);
+    bool anyDue = false;
+    for (int view = 0; view < m_sensorViews->GetViewCount() && !anyDue; ++view) {
+        anyDue = m_sensorViews->IsDue(view, time);
+    }
+    if (!anyDue) return;
+    
+    // Traffic instances, trail points and shadow cascades are already
+    // current for this frame; only the view-dependent packets are queued again
+    for (int view = 0; view < m_sensorViews->GetViewCount(); ++view) {
+        if (!m_sensorViews->IsDue(view, time)) continue;
         
-        glBegin(GL_LINE_STRIP);
-        glColor3f(1.0f, 1.0f, 0.0f); // Yellow trail
-        for (const auto& point : trail) {
-            glVertex3f(point.x, point.y, point.z);
+        const Camera& camera = m_sensorViews->GetCamera(view);
+        m_sensorQueue->Clear();
+        m_sensorQueue->SetMaxDepth(camera.GetFarPlane());
+        m_skybox->Submit(*m_sensorQueue, camera, *m_atmosphere);
+        m_terrain->Submit(*m_sensorQueue, camera, *m_atmosphere, *m_shadows, *m_localLights);
+        m_scenery->Submit(*m_sensorQueue, camera, *m_atmosphere, *m_shadows, *m_localLights, false);
+        if (m_aircraftShader->IsValid()) {
+            if (IsGpuCullingActive()) {
+                m_gpuCulling->Cull(GpuCulling::SENSOR_VIEW, camera.GetProjectionMatrix() * camera.GetViewMatrix());
+            }
+            SubmitAircraftDraws(*m_sensorQueue, camera, GpuCulling::SENSOR_VIEW);
         }
-        glEnd();
         
-        glColor3f(1.0f, 1.0f, 1.0f);
+        m_sensorViews->BeginView(view, time);
+        m_sensorQueue->Sort();
+        m_sensorQueue->Execute();
+        m_trailRenderer->Render(camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.GetNearPlane(), time);
+        m_sensorViews->EndView(view);
+    }
+    m_sensorViews->End();
+}
+
+void Renderer::ApplyAircraftMaterial(const Shader& shader, const void* context) {
+    const Renderer& renderer = *static_cast<const Renderer*>(context);
+    const AircraftUniforms& u = renderer.m_aircraftUniforms;
+    
+    // Set matrices
+    shader.Set(u.view, renderer.m_frameView);
+    shader.Set(u.projection, renderer.m_frameProjection);
+    
+    // Set lighting; sun and sky light come from the atmosphere
+    shader.Set(u.viewPos, renderer.m_frameViewPos);
+    shader.Set(u.specularStrength, renderer.m_specularStrength);
+    renderer.m_atmosphere->Apply(shader, u.atmosphere);
+    renderer.m_shadows->Apply(shader, u.shadows);
+    renderer.m_localLights->Apply(shader, u.localLights);
+    
+    // Set material properties for better visibility
+    shader.Set(u.materialDiffuse, glm::vec3(0.8f, 0.8f, 0.8f));
+    shader.Set(u.materialSpecular, glm::vec3(1.0f, 1.0f, 1.0f));
+    shader.Set(u.materialShininess, 32.0f);
+}
+
+void Renderer::PrepareAircraftDraw(const DrawPacket& packet, const void* context) {
+    const Renderer& renderer = *static_cast<const Renderer*>(context);
+    renderer.BindAircraftInstances(packet);
+    
+    // Batches may use different meshes, each with its own quantization bounds
+    packet.shader->Set(renderer.m_aircraftUniforms.vertexDecode, packet.mesh->GetVertexDecode());
+}
+
+void Renderer::ApplyAircraftShadowMaterial(const Shader& shader, const void* context) {
+    const Renderer& renderer = *static_cast<const Renderer*>(context);
+    shader.Set(renderer.m_aircraftShadowUniforms.lightViewProjection, renderer.m_frameLightViewProjection);
+}
+
+void Renderer::PrepareAircraftShadowDraw(const DrawPacket& packet, const void* context) {
+    const Renderer& renderer = *static_cast<const Renderer*>(context);
+    const AircraftShadowUniforms& u = renderer.m_aircraftShadowUniforms;
+    renderer.BindAircraftInstances(packet);
+    
+    const VertexDecode& decode = packet.mesh->GetVertexDecode();
+    packet.shader->Set(u.positionOffset, decode.positionOffset);
+    packet.shader->Set(u.positionScale, decode.positionScale);
+}
+
+void Renderer::ApplyImpostorMaterial(const Shader& shader, const void* context) {
+    const Renderer& renderer = *static_cast<const Renderer*>(context);
+    const ImpostorUniforms& u = renderer.m_impostorUniforms;
+    
+    shader.Set(u.view, renderer.m_frameView);
+    shader.Set(u.projection, renderer.m_frameProjection);
+    shader.Set(u.viewPos, renderer.m_frameViewPos);
+    shader.Set(u.materialDiffuse, glm::vec3(0.8f, 0.8f, 0.8f));
+    renderer.m_aircraftImpostor->Apply(shader, u.impostor);
+    renderer.m_atmosphere->Apply(shader, u.atmosphere);
+    renderer.m_shadows->Apply(shader, u.shadows);
+}
+
+void Renderer::PrepareImpostorDraw(const DrawPacket& packet, const void* context) {
+    const Renderer& renderer = *static_cast<const Renderer*>(context);
+    renderer.BindAircraftInstances(packet);
+}
+
+void Renderer::BindAircraftInstances(const DrawPacket& packet) const {
+    // Indirect packets carry their culled view, instanced ones their batch
+    if (packet.drawCount > 0) {
+        m_gpuCulling->BindView(packet.userData);
+    } else {
+        m_trafficRenderer->BindBatch(packet.userData);
     }
 }
 
-void Renderer::RenderGroundGrid(const glm::mat4& view, const glm::mat4& projection) {
-    // Render a reference grid on the ground
-    glUseProgram(0);
+void Renderer::ResolveUniforms() {
+    const Shader& shader = *m_aircraftShader;
+    AircraftUniforms& u = m_aircraftUniforms;
     
-    glMatrixMode(GL_PROJECTION);
-    glLoadMatrixf(glm::value_ptr(projection));
+    u.view = shader.GetUniform<glm::mat4>("view");
+    u.projection = shader.GetUniform<glm::mat4>("projection");
+    u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+    u.specularStrength = shader.GetUniform<float>("specularStrength");
+    u.materialDiffuse = shader.GetUniform<glm::vec3>("material_diffuse");
+    u.materialSpecular = shader.GetUniform<glm::vec3>("material_specular");
+    u.materialShininess = shader.GetUniform<float>("material_shininess");
+    u.vertexDecode = shader.GetVertexDecodeUniforms();
+    u.atmosphere = Atmosphere::GetUniforms(shader);
+    u.shadows = ShadowCascades::GetUniforms(shader);
+    u.localLights = ClusteredLights::GetUniforms(shader);
+}
+
+void Renderer::AddOrientationIndicators(const AircraftState& state) {
+    glm::vec3 position = state.position;
     
-    glMatrixMode(GL_MODELVIEW);
-    glLoadMatrixf(glm::value_ptr(view));
+    // Forward (red), up (green) and right (blue)
+    glm::vec3 forward = state.orientation * glm::vec3(0.0f, 0.0f, 1.0f);
+    AddDebugLine(position, position + forward * 10.0f, glm::vec3(1.0f, 0.0f, 0.0f));
     
-    glBegin(GL_LINES);
-    glColor3f(0.5f, 0.5f, 0.5f); // Gray grid
+    glm::vec3 up = state.orientation * glm::vec3(0.0f, 1.0f, 0.0f);
+    AddDebugLine(position, position + up * 5.0f, glm::vec3(0.0f, 1.0f, 0.0f));
     
-    // Draw grid lines
+    glm::vec3 right = state.orientation * glm::vec3(1.0f, 0.0f, 0.0f);
+    AddDebugLine(position, position + right * 5.0f, glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+void Renderer::AddGroundGrid() {
+    const glm::vec3 gray(0.5f, 0.5f, 0.5f);
     for (int i = -50; i <= 50; i += 10) {
-        // X lines
-        glVertex3f(i * 10.0f, 0.0f, -500.0f);
-        glVertex3f(i * 10.0f, 0.0f, 500.0f);
+        AddDebugLine(glm::vec3(i * 10.0f, 0.0f, -500.0f), glm::vec3(i * 10.0f, 0.0f, 500.0f), gray);
+        AddDebugLine(glm::vec3(-500.0f, 0.0f, i * 10.0f), glm::vec3(500.0f, 0.0f, i * 10.0f), gray);
+    }
+}
+
+void Renderer::AddDebugLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color) {
+    m_debugLines.push_back({start, color});
+    m_debugLines.push_back({end, color});
+}
+
+void Renderer::RenderDebugLines(const glm::mat4& viewProjection) {
+    // The vector keeps its capacity, so steady-state frames do not allocate
+    const size_t bytes = m_debugLines.size() * sizeof(DebugLineVertex);
+    StreamingBuffer::Allocation allocation = m_streamingBuffer->Allocate(bytes, sizeof(DebugLineVertex));
+    if (allocation && m_debugLineShader->IsValid()) {
+        std::memcpy(allocation.data, m_debugLines.data(), bytes);
+        m_streamingBuffer->Commit(allocation);
         
-        // Z lines
-        glVertex3f(-500.0f, 0.0f, i * 10.0f);
-        glVertex3f(500.0f, 0.0f, i * 10.0f);
+        GLStateCache& state = GLStateCache::Get();
+        state.UseProgram(m_debugLineShader->GetID());
+        m_debugLineShader->Set(m_debugLineViewProjection, viewProjection);
+        
+        // The stream's buffer can change between frames, so the attributes
+        // are pointed at it every time
+        state.BindVertexArray(m_debugLineVAO.Get());
+        glBindBuffer(GL_ARRAY_BUFFER, m_streamingBuffer->GetBuffer());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugLineVertex),
+                              (void*)offsetof(DebugLineVertex, position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(DebugLineVertex),
+                              (void*)offsetof(DebugLineVertex, color));
+        glEnableVertexAttribArray(1);
+        
+        glDrawArrays(GL_LINES, static_cast<GLint>(allocation.offset / sizeof(DebugLineVertex)),
+                     static_cast<GLsizei>(m_debugLines.size()));
+        state.CountDraw();
     }
-    glEnd();
-    
-    glColor3f(1.0f, 1.0f, 1.0f);
+    m_debugLines.clear();
 }
 
-void Renderer::RenderInstruments(const Aircraft& aircraft) {
+void Renderer::RenderInstruments(const AircraftState& state) {
     // This would render additional instrument overlays
     // For now, it's handled by the HUD class
 }
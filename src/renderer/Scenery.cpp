@@ -0,0 +1,871 @@
+#include "renderer/Scenery.h"
+#include "core/Camera.h"
+#include "renderer/RenderQueue.h"
+#include "renderer/Terrain.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace FlightSim {
+
+static constexpr unsigned int INSTANCE_POSITION_LOCATION = 3;
+static constexpr unsigned int INSTANCE_PARAMS_LOCATION = 4;
+
+// Fraction of the ranks over which an instance shrinks out as the density
+// drops past it; must match FADE_BAND in the shaders
+static constexpr float FADE_BAND = 0.1f;
+
+// Camera travel, as a fraction of the fade length, after which cached
+// shadow cascades are thinned around the camera again
+static constexpr float CACHED_SHADOW_TOLERANCE = 0.1f;
+
+// Procedural placement
+static constexpr float TREE_SPACING = 1.6f;      // Meters between forest candidates
+static constexpr float BUILDING_SPACING = 30.0f;
+static constexpr float HAMLET_SPACING = 45.0f;   // Houses scattered outside the forest
+static constexpr float MAX_TREE_SLOPE = 0.7f;    // Rise over run
+static constexpr float MAX_BUILDING_SLOPE = 0.15f;
+static constexpr float TREE_LINE = 2200.0f;      // Meters above the terrain origin
+static constexpr float SLOPE_STEP = 2.0f;        // Meters between height samples
+
+// Clearances around the airfield of Renderer's runway lights: the runway
+// with its approach, the parallel taxiway, and the apron where the
+// buildings stand
+static constexpr float RUNWAY_CLEAR_X = 75.0f;
+static constexpr float RUNWAY_CLEAR_Z = 560.0f;
+static constexpr float TAXIWAY_MIN_X = 95.0f;
+static constexpr float TAXIWAY_MAX_X = 145.0f;
+static constexpr float TAXIWAY_CLEAR_Z = 480.0f;
+static constexpr float APRON_MIN_X = 160.0f;
+static constexpr float APRON_MAX_X = 320.0f;
+static constexpr float APRON_CLEAR_Z = 320.0f;
+
+// Included by both vertex shaders after #version
+static const char* SCENERY_TRANSFORM_SOURCE = R"(
+layout (location = 3) in vec4 instancePositionScale;
+layout (location = 4) in vec4 instanceParams;
+
+uniform vec3 fadeOrigin;
+uniform vec3 densityFade; // Full density up to x meters, falling to z at y meters
+
+const float FADE_BAND = 0.1;
+
+// 1 while the instance's rank is well inside the density kept at its
+// distance, falling to 0 once the density drops past it
+float GetDensityScale() {
+    float distanceToOrigin = distance(fadeOrigin, instancePositionScale.xyz);
+    float density = mix(1.0, densityFade.z, smoothstep(densityFade.x, densityFade.y, distanceToOrigin));
+    return clamp((density * (1.0 + FADE_BAND) - instanceParams.z) / FADE_BAND, 0.0, 1.0);
+}
+
+vec3 RotateHeading(vec3 v) {
+    return vec3(instanceParams.x * v.x + instanceParams.y * v.z, v.y,
+                -instanceParams.y * v.x + instanceParams.x * v.z);
+}
+
+vec3 GetSceneryWorldPosition(vec3 position) {
+    return instancePositionScale.xyz + RotateHeading(position) * (instancePositionScale.w * GetDensityScale());
+}
+)";
+
+static const char* SCENERY_VERTEX_SOURCE = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Albedo;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 primaryColor;   // Foliage, walls
+uniform vec3 secondaryColor; // Trunks, roofs
+
+// Vertex decode for compressed mesh layouts (see VertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
+
+vec3 DecodeNormal(vec3 encoded) {
+    if (!octahedralNormals) return encoded;
+    vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    FragPos = GetSceneryWorldPosition(positionOffset + aPos * positionScale);
+    Normal = RotateHeading(DecodeNormal(aNormal));
+    
+    // The texture coordinate picks the part's display color; the tint
+    // varies brightness per instance. Lit in linear space.
+    vec3 color = aTexCoord.x < 0.5 ? primaryColor : secondaryColor;
+    Albedo = pow(color * instanceParams.w, vec3(2.2));
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
+)";
+
+static const char* SCENERY_FRAGMENT_SOURCE = R"(
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 Albedo;
+
+uniform vec3 viewPos;
+
+void main() {
+    vec3 norm = normalize(Normal);
+    vec3 point = WorldToAtmosphere(FragPos);
+    
+    vec3 skyIrradiance;
+    vec3 sunIrradiance = GetSunAndSkyIrradiance(point, norm, skyIrradiance);
+    sunIrradiance *= GetSunShadow(FragPos, norm);
+    
+    vec3 localSpecular;
+    vec3 localIrradiance = GetLocalLightIrradiance(FragPos, norm, normalize(viewPos - FragPos), 1.0,
+                                                   localSpecular);
+    vec3 radiance = Albedo / PI * (sunIrradiance + skyIrradiance + localIrradiance);
+    
+    vec3 transmittance;
+    vec3 inScatter = GetSkyRadianceToPoint(WorldToAtmosphere(viewPos), point, transmittance);
+    FragColor = vec4(ToDisplay(radiance * transmittance + inScatter), 1.0);
+}
+)";
+
+// Depth only, thinned like the main view so shadows match what is drawn;
+// cached cascades come close, thinning around a recent camera position
+static const char* SCENERY_SHADOW_VERTEX_SOURCE = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 lightViewProjection;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+void main() {
+    gl_Position = lightViewProjection * vec4(GetSceneryWorldPosition(positionOffset + aPos * positionScale), 1.0);
+}
+)";
+
+static const char* SCENERY_SHADOW_FRAGMENT_SOURCE = R"(
+#version 330 core
+void main() {
+}
+)";
+
+// Planes with inward normals, normalized so distances are in world units
+static void ExtractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for (int i = 0; i < 6; ++i) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+static float SmoothStep(float edge0, float edge1, float x) {
+    float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static float Hash(int x, int z, unsigned int seed) {
+    uint32_t h = static_cast<uint32_t>(x) * 374761393u + static_cast<uint32_t>(z) * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return static_cast<float>(h ^ (h >> 16)) / 4294967296.0f;
+}
+
+// Smoothly interpolated lattice noise in [0, 1) with features of about period meters
+static float ValueNoise(const glm::vec2& position, float period, unsigned int seed) {
+    glm::vec2 p = position / period;
+    glm::vec2 cell = glm::floor(p);
+    glm::vec2 f = p - cell;
+    f = f * f * (3.0f - 2.0f * f);
+    int x = static_cast<int>(cell.x);
+    int z = static_cast<int>(cell.y);
+    float h0 = Hash(x, z, seed) + (Hash(x + 1, z, seed) - Hash(x, z, seed)) * f.x;
+    float h1 = Hash(x, z + 1, seed) + (Hash(x + 1, z + 1, seed) - Hash(x, z + 1, seed)) * f.x;
+    return h0 + (h1 - h0) * f.y;
+}
+
+static bool IsPlaceable(const Terrain& terrain, const glm::vec2& p, float maxSlope, float maxHeight) {
+    if (terrain.GetHeightAt(p.x, p.y) > maxHeight) return false;
+    float dx = terrain.GetHeightAt(p.x + SLOPE_STEP, p.y) - terrain.GetHeightAt(p.x - SLOPE_STEP, p.y);
+    float dz = terrain.GetHeightAt(p.x, p.y + SLOPE_STEP) - terrain.GetHeightAt(p.x, p.y - SLOPE_STEP);
+    return glm::length(glm::vec2(dx, dz)) <= maxSlope * 2.0f * SLOPE_STEP;
+}
+
+static bool IsOnAirfield(const glm::vec2& p) {
+    float x = p.x;
+    float z = std::abs(p.y);
+    return (std::abs(x) < RUNWAY_CLEAR_X && z < RUNWAY_CLEAR_Z) ||
+           (x > TAXIWAY_MIN_X && x < TAXIWAY_MAX_X && z < TAXIWAY_CLEAR_Z);
+}
+
+static bool IsOnApron(const glm::vec2& p) {
+    return p.x > APRON_MIN_X && p.x < APRON_MAX_X && std::abs(p.y) < APRON_CLEAR_Z;
+}
+
+// Conifer: a six-sided trunk under an eight-sided cone with a base cap,
+// about 8 m tall at scale 1. Texture coordinate x = 1 marks the trunk.
+static Mesh CreateTreeMesh() {
+    const int trunkSides = 6;
+    const int crownSides = 8;
+    const float trunkRadius = 0.3f;
+    const float trunkHeight = 2.0f;
+    const float crownRadius = 2.2f;
+    const float crownBase = 1.5f;
+    const float crownTop = 8.0f;
+    const float twoPi = 6.2831853f;
+    
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    auto addVertex = [&](const glm::vec3& position, const glm::vec3& normal, float part) {
+        vertices.push_back({position, normal, glm::vec2(part, 0.0f)});
+        return static_cast<unsigned int>(vertices.size() - 1);
+    };
+    
+    for (int i = 0; i < trunkSides; ++i) {
+        float a0 = twoPi * i / trunkSides;
+        float a1 = twoPi * (i + 1) / trunkSides;
+        glm::vec3 d0(std::cos(a0), 0.0f, std::sin(a0));
+        glm::vec3 d1(std::cos(a1), 0.0f, std::sin(a1));
+        unsigned int b0 = addVertex(d0 * trunkRadius, d0, 1.0f);
+        unsigned int b1 = addVertex(d1 * trunkRadius, d1, 1.0f);
+        unsigned int t0 = addVertex(d0 * trunkRadius + glm::vec3(0.0f, trunkHeight, 0.0f), d0, 1.0f);
+        unsigned int t1 = addVertex(d1 * trunkRadius + glm::vec3(0.0f, trunkHeight, 0.0f), d1, 1.0f);
+        indices.insert(indices.end(), {b1, b0, t0, b1, t0, t1});
+    }
+    
+    // Smooth cone normals; the apex is split per side so it keeps them
+    const float slant = crownTop - crownBase;
+    unsigned int center = addVertex(glm::vec3(0.0f, crownBase, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), 0.0f);
+    for (int i = 0; i < crownSides; ++i) {
+        float a0 = twoPi * i / crownSides;
+        float a1 = twoPi * (i + 1) / crownSides;
+        float am = 0.5f * (a0 + a1);
+        glm::vec3 d0(std::cos(a0), 0.0f, std::sin(a0));
+        glm::vec3 d1(std::cos(a1), 0.0f, std::sin(a1));
+        glm::vec3 dm(std::cos(am), 0.0f, std::sin(am));
+        auto coneNormal = [&](const glm::vec3& d) {
+            return glm::normalize(d * slant + glm::vec3(0.0f, crownRadius, 0.0f));
+        };
+        glm::vec3 p0 = d0 * crownRadius + glm::vec3(0.0f, crownBase, 0.0f);
+        glm::vec3 p1 = d1 * crownRadius + glm::vec3(0.0f, crownBase, 0.0f);
+        unsigned int s0 = addVertex(p0, coneNormal(d0), 0.0f);
+        unsigned int s1 = addVertex(p1, coneNormal(d1), 0.0f);
+        unsigned int apex = addVertex(glm::vec3(0.0f, crownTop, 0.0f), coneNormal(dm), 0.0f);
+        indices.insert(indices.end(), {s1, s0, apex});
+        
+        unsigned int c0 = addVertex(p0, glm::vec3(0.0f, -1.0f, 0.0f), 0.0f);
+        unsigned int c1 = addVertex(p1, glm::vec3(0.0f, -1.0f, 0.0f), 0.0f);
+        indices.insert(indices.end(), {center, c0, c1});
+    }
+    
+    Mesh mesh;
+    mesh.SetVertices(std::move(vertices));
+    mesh.SetIndices(std::move(indices));
+    return mesh;
+}
+
+// House: 10 x 8 m walls, 7 m high, under a gable roof along x. Texture
+// coordinate x = 1 marks the roof. No floor; it is never seen.
+static Mesh CreateBuildingMesh() {
+    const float hx = 5.0f;
+    const float hz = 4.0f;
+    const float wall = 7.0f;
+    const float ridge = 10.0f;
+    
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    auto addPolygon = [&](std::initializer_list<glm::vec3> corners, const glm::vec3& normal, float part) {
+        unsigned int first = static_cast<unsigned int>(vertices.size());
+        for (const glm::vec3& corner : corners) {
+            vertices.push_back({corner, normal, glm::vec2(part, 0.0f)});
+        }
+        for (unsigned int i = 2; i < corners.size(); ++i) {
+            indices.insert(indices.end(), {first, first + i - 1, first + i});
+        }
+    };
+    
+    // Counter-clockwise seen from outside
+    addPolygon({{-hx, 0.0f, hz}, {hx, 0.0f, hz}, {hx, wall, hz}, {-hx, wall, hz}}, {0.0f, 0.0f, 1.0f}, 0.0f);
+    addPolygon({{hx, 0.0f, -hz}, {-hx, 0.0f, -hz}, {-hx, wall, -hz}, {hx, wall, -hz}}, {0.0f, 0.0f, -1.0f}, 0.0f);
+    addPolygon({{hx, 0.0f, hz}, {hx, 0.0f, -hz}, {hx, wall, -hz}, {hx, ridge, 0.0f}, {hx, wall, hz}},
+               {1.0f, 0.0f, 0.0f}, 0.0f);
+    addPolygon({{-hx, 0.0f, -hz}, {-hx, 0.0f, hz}, {-hx, wall, hz}, {-hx, ridge, 0.0f}, {-hx, wall, -hz}},
+               {-1.0f, 0.0f, 0.0f}, 0.0f);
+    
+    glm::vec3 frontSlope = glm::normalize(glm::vec3(0.0f, hz, ridge - wall));
+    glm::vec3 backSlope = glm::normalize(glm::vec3(0.0f, hz, wall - ridge));
+    addPolygon({{-hx, wall, hz}, {hx, wall, hz}, {hx, ridge, 0.0f}, {-hx, ridge, 0.0f}}, frontSlope, 1.0f);
+    addPolygon({{hx, wall, -hz}, {-hx, wall, -hz}, {-hx, ridge, 0.0f}, {hx, ridge, 0.0f}}, backSlope, 1.0f);
+    
+    Mesh mesh;
+    mesh.SetVertices(std::move(vertices));
+    mesh.SetIndices(std::move(indices));
+    return mesh;
+}
+
+Scenery::Scenery()
+    : m_primaryColors{glm::vec3(0.16f, 0.32f, 0.12f), glm::vec3(0.78f, 0.74f, 0.66f)}
+    , m_secondaryColors{glm::vec3(0.35f, 0.24f, 0.15f), glm::vec3(0.55f, 0.22f, 0.16f)}
+    , m_instanceCount(0)
+    , m_root(NO_NODE)
+    , m_fadeStart(150.0f)
+    , m_fadeEnd(800.0f)
+    , m_minDensity(0.15f)
+    , m_maxDistance(2000.0f)
+    , m_view(1.0f)
+    , m_projection(1.0f)
+    , m_viewPos(0.0f)
+    , m_fadeOrigin(0.0f)
+    , m_atmosphere(nullptr)
+    , m_shadows(nullptr)
+    , m_lights(nullptr)
+    , m_lightViewProjection(1.0f)
+    , m_shadowFadeOrigin(0.0f)
+    , m_mainViewPos(0.0f)
+    , m_cachedShadowOrigin(0.0f)
+    , m_cachedShadowOriginValid(false)
+    , m_visibleCells(0)
+    , m_drawCalls(0)
+    , m_drawnInstances(0) {
+}
+
+Scenery::~Scenery() {
+    Shutdown();
+}
+
+bool Scenery::Initialize() {
+    if (!SetupShaders()) {
+        std::cerr << "Failed to load scenery shaders" << std::endl;
+        return false;
+    }
+    CreateMeshes();
+    return true;
+}
+
+void Scenery::Shutdown() {
+    m_shader.reset();
+    m_shadowShader.reset();
+    for (Mesh& mesh : m_meshes) {
+        mesh = Mesh();
+    }
+    m_instanceBuffer.Reset();
+    m_instanceCount = 0;
+    m_cells.clear();
+    m_nodes.clear();
+    m_root = NO_NODE;
+}
+
+void Scenery::SetDensityFade(float start, float end, float minimum) {
+    m_fadeStart = std::max(start, 0.0f);
+    m_fadeEnd = std::max(end, m_fadeStart + 1.0f);
+    m_minDensity = std::clamp(minimum, 0.0f, 1.0f);
+    m_cachedShadowOriginValid = false;
+}
+
+float Scenery::GetDensity(float distance) const {
+    // Same curve as GetDensityScale in the shaders
+    float t = SmoothStep(m_fadeStart, m_fadeEnd, distance);
+    return 1.0f + (m_minDensity - 1.0f) * t;
+}
+
+void Scenery::GenerateProcedural(const Terrain& terrain, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float half = terrain.GetSize() * 0.5f;
+    const float halfTurn = 3.1415927f;
+    
+    std::vector<SceneryPlacement> placements;
+    
+    // Forest: a jittered grid thinned by two octaves of noise into stands
+    // and clearings
+    for (float z = -half + TREE_SPACING * 0.5f; z < half; z += TREE_SPACING) {
+        for (float x = -half + TREE_SPACING * 0.5f; x < half; x += TREE_SPACING) {
+            glm::vec2 p(x + (unit(rng) - 0.5f) * TREE_SPACING, z + (unit(rng) - 0.5f) * TREE_SPACING);
+            if (IsOnAirfield(p) || IsOnApron(p)) continue;
+            
+            float forest = 0.65f * ValueNoise(p, 90.0f, seed) + 0.35f * ValueNoise(p, 23.0f, seed + 1);
+            if (unit(rng) > SmoothStep(0.35f, 0.6f, forest)) continue;
+            if (!IsPlaceable(terrain, p, MAX_TREE_SLOPE, TREE_LINE)) continue;
+            placements.push_back({SceneryType::Tree, p, 0.7f + 0.6f * unit(rng), 6.2831853f * unit(rng)});
+        }
+    }
+    
+    // Hangars and offices in rows on the apron, squared to the runway
+    for (float z = -APRON_CLEAR_Z + BUILDING_SPACING * 0.5f; z < APRON_CLEAR_Z; z += BUILDING_SPACING) {
+        for (float x = APRON_MIN_X + BUILDING_SPACING * 0.5f; x < APRON_MAX_X; x += BUILDING_SPACING) {
+            if (unit(rng) < 0.2f) continue;
+            glm::vec2 p(x + (unit(rng) - 0.5f) * 4.0f, z + (unit(rng) - 0.5f) * 4.0f);
+            if (!IsPlaceable(terrain, p, MAX_BUILDING_SLOPE, TREE_LINE)) continue;
+            float heading = unit(rng) < 0.5f ? 0.0f : halfTurn;
+            placements.push_back({SceneryType::Building, p, 1.0f + 0.5f * unit(rng), heading});
+        }
+    }
+    
+    // Houses in the clearings
+    for (float z = -half + HAMLET_SPACING * 0.5f; z < half; z += HAMLET_SPACING) {
+        for (float x = -half + HAMLET_SPACING * 0.5f; x < half; x += HAMLET_SPACING) {
+            glm::vec2 jitter(unit(rng) - 0.5f, unit(rng) - 0.5f);
+            glm::vec2 p = glm::vec2(x, z) + jitter * (HAMLET_SPACING * 0.6f);
+            if (IsOnAirfield(p) || IsOnApron(p) || unit(rng) > 0.35f) continue;
+            
+            float forest = 0.65f * ValueNoise(p, 90.0f, seed) + 0.35f * ValueNoise(p, 23.0f, seed + 1);
+            if (forest > 0.4f || !IsPlaceable(terrain, p, MAX_BUILDING_SLOPE, TREE_LINE)) continue;
+            placements.push_back({SceneryType::Building, p, 0.7f + 0.4f * unit(rng), 6.2831853f * unit(rng)});
+        }
+    }
+    
+    SetPlacements(placements, terrain);
+}
+
+bool Scenery::LoadPlacementFile(const std::string& path, const Terrain& terrain) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open scenery placement file: " << path << std::endl;
+        return false;
+    }
+    
+    std::vector<SceneryPlacement> placements;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string typeName;
+        if (!(fields >> typeName)) continue;
+        
+        SceneryPlacement placement;
+        if (typeName == "tree") {
+            placement.type = SceneryType::Tree;
+        } else if (typeName == "building") {
+            placement.type = SceneryType::Building;
+        } else {
+            std::cerr << path << ":" << lineNumber << ": unknown scenery type '" << typeName << "'" << std::endl;
+            return false;
+        }
+        if (!(fields >> placement.position.x >> placement.position.y)) {
+            std::cerr << path << ":" << lineNumber << ": expected x and z" << std::endl;
+            return false;
+        }
+        
+        // Scale and heading are optional
+        placement.scale = 1.0f;
+        placement.heading = 0.0f;
+        float value = 0.0f;
+        if (fields >> value) {
+            placement.scale = value;
+            if (fields >> value) {
+                placement.heading = glm::radians(value);
+            }
+        }
+        placements.push_back(placement);
+    }
+    
+    SetPlacements(placements, terrain);
+    std::cout << "Loaded " << placements.size() << " scenery objects from " << path << std::endl;
+    return true;
+}
+
+void Scenery::SetPlacements(const std::vector<SceneryPlacement>& requested, const Terrain& terrain) {
+    m_instanceBuffer.Reset();
+    m_instanceCount = 0;
+    m_cells.clear();
+    m_nodes.clear();
+    m_root = NO_NODE;
+    
+    // The cell grid spans the placements, so one stray or corrupt
+    // coordinate would size it to cover everything in between
+    const float half = terrain.GetSize() * 0.5f;
+    std::vector<SceneryPlacement> placements;
+    placements.reserve(requested.size());
+    for (const SceneryPlacement& placement : requested) {
+        if (std::abs(placement.position.x) <= half && std::abs(placement.position.y) <= half) {
+            placements.push_back(placement);
+        }
+    }
+    if (placements.size() < requested.size()) {
+        std::cerr << "Scenery: skipped " << requested.size() - placements.size()
+                  << " placements outside the terrain" << std::endl;
+    }
+    if (placements.empty()) return;
+    
+    // Cell grid over the placements
+    glm::vec2 minPosition = placements.front().position;
+    glm::vec2 maxPosition = minPosition;
+    for (const SceneryPlacement& placement : placements) {
+        minPosition = glm::min(minPosition, placement.position);
+        maxPosition = glm::max(maxPosition, placement.position);
+    }
+    const int gridWidth = static_cast<int>((maxPosition.x - minPosition.x) / CELL_SIZE) + 1;
+    const int gridHeight = static_cast<int>((maxPosition.y - minPosition.y) / CELL_SIZE) + 1;
+    auto getBucket = [&](const SceneryPlacement& placement) {
+        int x = std::min(static_cast<int>((placement.position.x - minPosition.x) / CELL_SIZE), gridWidth - 1);
+        int z = std::min(static_cast<int>((placement.position.y - minPosition.y) / CELL_SIZE), gridHeight - 1);
+        return (static_cast<size_t>(z) * gridWidth + x) * TYPE_COUNT + static_cast<size_t>(placement.type);
+    };
+    
+    // Counting sort into (cell, type) buckets
+    const size_t bucketCount = static_cast<size_t>(gridWidth) * gridHeight * TYPE_COUNT;
+    std::vector<uint32_t> bucketStart(bucketCount + 1, 0);
+    for (const SceneryPlacement& placement : placements) {
+        bucketStart[getBucket(placement) + 1]++;
+    }
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+        bucketStart[bucket + 1] += bucketStart[bucket];
+    }
+    std::vector<uint32_t> order(placements.size());
+    std::vector<uint32_t> cursor(bucketStart.begin(), bucketStart.end() - 1);
+    for (size_t i = 0; i < placements.size(); ++i) {
+        order[cursor[getBucket(placements[i])]++] = static_cast<uint32_t>(i);
+    }
+    
+    // Horizontal reach and height of each mesh at scale 1, for the bounds
+    float reach[TYPE_COUNT];
+    for (int type = 0; type < TYPE_COUNT; ++type) {
+        const glm::vec3 extent = glm::max(glm::abs(m_meshes[type].GetBoundsMin()),
+                                          glm::abs(m_meshes[type].GetBoundsMax()));
+        reach[type] = glm::length(glm::vec2(extent.x, extent.z));
+    }
+    
+    // Shuffle each run so any prefix is an even thinning, then rank it
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> tint(0.85f, 1.15f);
+    std::vector<SceneryInstance> instances(placements.size());
+    std::vector<int32_t> cellGrid(static_cast<size_t>(gridWidth) * gridHeight, -1);
+    for (size_t gridCell = 0; gridCell < cellGrid.size(); ++gridCell) {
+        const uint32_t first = bucketStart[gridCell * TYPE_COUNT];
+        const uint32_t last = bucketStart[(gridCell + 1) * TYPE_COUNT];
+        if (first == last) continue;
+        
+        Cell cell;
+        cell.boundsMin = glm::vec3(FLT_MAX);
+        cell.boundsMax = glm::vec3(-FLT_MAX);
+        for (int type = 0; type < TYPE_COUNT; ++type) {
+            const uint32_t runFirst = bucketStart[gridCell * TYPE_COUNT + type];
+            const uint32_t runCount = bucketStart[gridCell * TYPE_COUNT + type + 1] - runFirst;
+            cell.first[type] = runFirst;
+            cell.count[type] = runCount;
+            std::shuffle(order.begin() + runFirst, order.begin() + runFirst + runCount, rng);
+            
+            const Mesh& mesh = m_meshes[type];
+            for (uint32_t i = 0; i < runCount; ++i) {
+                const SceneryPlacement& placement = placements[order[runFirst + i]];
+                glm::vec3 base(placement.position.x, terrain.GetHeightAt(placement.position.x, placement.position.y),
+                               placement.position.y);
+                
+                SceneryInstance& instance = instances[runFirst + i];
+                instance.positionScale = glm::vec4(base, placement.scale);
+                instance.params = glm::vec4(std::cos(placement.heading), std::sin(placement.heading),
+                                            static_cast<float>(i) / static_cast<float>(runCount), tint(rng));
+                
+                glm::vec3 extent(reach[type] * placement.scale, 0.0f, reach[type] * placement.scale);
+                cell.boundsMin = glm::min(cell.boundsMin, base - extent +
+                                          glm::vec3(0.0f, mesh.GetBoundsMin().y * placement.scale, 0.0f));
+                cell.boundsMax = glm::max(cell.boundsMax, base + extent +
+                                          glm::vec3(0.0f, mesh.GetBoundsMax().y * placement.scale, 0.0f));
+            }
+        }
+        cellGrid[gridCell] = static_cast<int32_t>(m_cells.size());
+        m_cells.push_back(cell);
+    }
+    
+    m_instanceBuffer = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.Get());
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(SceneryInstance), instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_instanceCount = instances.size();
+    
+    m_root = BuildNode(0, 0, gridWidth, gridHeight, cellGrid, gridWidth);
+    std::cout << "Scenery: " << m_instanceCount << " instances in " << m_cells.size() << " cells, "
+              << m_nodes.size() << " nodes, " << GetGpuMemorySize() / 1024 << " KB" << std::endl;
+}
+
+uint32_t Scenery::BuildNode(int x0, int z0, int x1, int z1, const std::vector<int32_t>& cellGrid, int gridWidth) {
+    if (x1 - x0 == 1 && z1 - z0 == 1) {
+        int32_t cell = cellGrid[static_cast<size_t>(z0) * gridWidth + x0];
+        if (cell < 0) return NO_NODE;
+        
+        Node leaf = {};
+        leaf.boundsMin = m_cells[cell].boundsMin;
+        leaf.boundsMax = m_cells[cell].boundsMax;
+        leaf.cell = cell;
+        m_nodes.push_back(leaf);
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+    
+    // Halve each side that is longer than one cell
+    const int xm = x1 - x0 > 1 ? (x0 + x1) / 2 : x1;
+    const int zm = z1 - z0 > 1 ? (z0 + z1) / 2 : z1;
+    Node node = {};
+    node.boundsMin = glm::vec3(FLT_MAX);
+    node.boundsMax = glm::vec3(-FLT_MAX);
+    node.cell = -1;
+    const int xs[3] = {x0, xm, x1};
+    const int zs[3] = {z0, zm, z1};
+    for (int j = 0; j < 2; ++j) {
+        for (int i = 0; i < 2; ++i) {
+            if (xs[i] == xs[i + 1] || zs[j] == zs[j + 1]) continue;
+            uint32_t child = BuildNode(xs[i], zs[j], xs[i + 1], zs[j + 1], cellGrid, gridWidth);
+            if (child == NO_NODE) continue;
+            node.children[node.childCount++] = child;
+            node.boundsMin = glm::min(node.boundsMin, m_nodes[child].boundsMin);
+            node.boundsMax = glm::max(node.boundsMax, m_nodes[child].boundsMax);
+        }
+    }
+    
+    // A node with one child would only repeat its test
+    if (node.childCount == 0) return NO_NODE;
+    if (node.childCount == 1) return node.children[0];
+    m_nodes.push_back(node);
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void Scenery::Submit(RenderQueue& queue, const Camera& camera, const Atmosphere& atmosphere,
+                     const ShadowCascades& shadows, const ClusteredLights& lights, bool mainView) {
+    if (mainView) {
+        m_visibleCells = 0;
+        m_drawCalls = 0;
+        m_drawnInstances = 0;
+        m_mainViewPos = camera.GetPosition();
+    }
+    if (!m_shader || !m_shader->IsValid() || m_root == NO_NODE || !atmosphere.IsReady() || !shadows.IsReady()) {
+        return;
+    }
+    
+    m_view = camera.GetViewMatrix();
+    m_projection = camera.GetProjectionMatrix();
+    m_viewPos = camera.GetPosition();
+    m_fadeOrigin = m_viewPos;
+    m_atmosphere = &atmosphere;
+    m_shadows = &shadows;
+    m_lights = &lights;
+    
+    uint32_t material = queue.AddMaterial({"Scenery", &Scenery::ApplyMaterial, &Scenery::PrepareDraw, this});
+    SubmitCells(queue, m_projection * m_view, m_fadeOrigin, *m_shader, material, mainView);
+}
+
+bool Scenery::UpdateCachedShadowOrigin() {
+    const float tolerance = CACHED_SHADOW_TOLERANCE * (m_fadeEnd - m_fadeStart);
+    if (m_cachedShadowOriginValid && glm::length(m_mainViewPos - m_cachedShadowOrigin) <= tolerance) {
+        return false;
+    }
+    m_cachedShadowOrigin = m_mainViewPos;
+    m_cachedShadowOriginValid = true;
+    return true;
+}
+
+void Scenery::SubmitShadow(RenderQueue& queue, const glm::mat4& lightViewProjection, bool cached) {
+    if (!m_shadowShader || !m_shadowShader->IsValid() || m_root == NO_NODE) return;
+    
+    // The queue executes before the next cascade is submitted, so one set
+    // of pass state is enough
+    m_lightViewProjection = lightViewProjection;
+    m_shadowFadeOrigin = cached ? m_cachedShadowOrigin : m_mainViewPos;
+    uint32_t material = queue.AddMaterial({"Scenery shadow", &Scenery::ApplyShadowMaterial,
+                                           &Scenery::PrepareShadowDraw, this});
+    SubmitCells(queue, lightViewProjection, m_shadowFadeOrigin, *m_shadowShader, material, false);
+}
+
+void Scenery::SubmitCells(RenderQueue& queue, const glm::mat4& viewProjection, const glm::vec3& fadeOrigin,
+                          const Shader& shader, uint32_t material, bool collectStats) {
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProjection, planes);
+    
+    // A node inside a plane leaves it out of its subtree's tests; a node
+    // inside all six is accepted with its whole subtree
+    m_stack.clear();
+    m_stack.push_back({m_root, 0x3Fu});
+    while (!m_stack.empty()) {
+        StackEntry entry = m_stack.back();
+        m_stack.pop_back();
+        const Node& node = m_nodes[entry.node];
+        
+        glm::vec3 nearest = glm::clamp(fadeOrigin, node.boundsMin, node.boundsMax);
+        float distance = glm::length(nearest - fadeOrigin);
+        if (distance > m_maxDistance) continue;
+        
+        bool outside = false;
+        for (int i = 0; i < 6 && entry.planeMask != 0; ++i) {
+            if (!(entry.planeMask & (1u << i))) continue;
+            
+            glm::vec3 normal(planes[i]);
+            glm::vec3 farthest(normal.x >= 0.0f ? node.boundsMax.x : node.boundsMin.x,
+                               normal.y >= 0.0f ? node.boundsMax.y : node.boundsMin.y,
+                               normal.z >= 0.0f ? node.boundsMax.z : node.boundsMin.z);
+            if (glm::dot(normal, farthest) + planes[i].w < 0.0f) {
+                outside = true;
+                break;
+            }
+            glm::vec3 closest(normal.x >= 0.0f ? node.boundsMin.x : node.boundsMax.x,
+                              normal.y >= 0.0f ? node.boundsMin.y : node.boundsMax.y,
+                              normal.z >= 0.0f ? node.boundsMin.z : node.boundsMax.z);
+            if (glm::dot(normal, closest) + planes[i].w >= 0.0f) {
+                entry.planeMask &= ~(1u << i);
+            }
+        }
+        if (outside) continue;
+        
+        if (node.cell < 0) {
+            for (uint32_t child = 0; child < node.childCount; ++child) {
+                m_stack.push_back({node.children[child], entry.planeMask});
+            }
+            continue;
+        }
+        
+        // The cell's nearest point has its highest density; instances
+        // ranked past it are collapsed by the shader anyway
+        const Cell& cell = m_cells[node.cell];
+        const float kept = std::min(GetDensity(distance) * (1.0f + FADE_BAND), 1.0f);
+        for (int type = 0; type < TYPE_COUNT; ++type) {
+            uint32_t count = std::min(cell.count[type],
+                                      static_cast<uint32_t>(std::ceil(cell.count[type] * kept)));
+            if (count == 0) continue;
+            queue.Submit(RenderLayer::Opaque, shader, m_meshes[type], material, distance, count, cell.first[type]);
+            if (collectStats) {
+                m_drawCalls++;
+                m_drawnInstances += count;
+            }
+        }
+        if (collectStats) {
+            m_visibleCells++;
+        }
+    }
+}
+
+void Scenery::ApplyMaterial(const Shader& shader, const void* context) {
+    const Scenery& scenery = *static_cast<const Scenery*>(context);
+    const SceneryUniforms& u = scenery.m_uniforms;
+    
+    shader.Set(u.view, scenery.m_view);
+    shader.Set(u.projection, scenery.m_projection);
+    shader.Set(u.viewPos, scenery.m_viewPos);
+    shader.Set(u.fadeOrigin, scenery.m_fadeOrigin);
+    shader.Set(u.densityFade, glm::vec3(scenery.m_fadeStart, scenery.m_fadeEnd, scenery.m_minDensity));
+    scenery.m_atmosphere->Apply(shader, u.atmosphere);
+    scenery.m_shadows->Apply(shader, u.shadows);
+    scenery.m_lights->Apply(shader, u.localLights);
+}
+
+void Scenery::PrepareDraw(const DrawPacket& packet, const void* context) {
+    const Scenery& scenery = *static_cast<const Scenery*>(context);
+    const SceneryUniforms& u = scenery.m_uniforms;
+    scenery.BindInstances(packet);
+    
+    const size_t type = static_cast<size_t>(packet.mesh - scenery.m_meshes);
+    packet.shader->Set(u.vertexDecode, packet.mesh->GetVertexDecode());
+    packet.shader->Set(u.primaryColor, scenery.m_primaryColors[type]);
+    packet.shader->Set(u.secondaryColor, scenery.m_secondaryColors[type]);
+}
+
+void Scenery::ApplyShadowMaterial(const Shader& shader, const void* context) {
+    const Scenery& scenery = *static_cast<const Scenery*>(context);
+    const ShadowPassUniforms& u = scenery.m_shadowUniforms;
+    
+    shader.Set(u.lightViewProjection, scenery.m_lightViewProjection);
+    shader.Set(u.fadeOrigin, scenery.m_shadowFadeOrigin);
+    shader.Set(u.densityFade, glm::vec3(scenery.m_fadeStart, scenery.m_fadeEnd, scenery.m_minDensity));
+}
+
+void Scenery::PrepareShadowDraw(const DrawPacket& packet, const void* context) {
+    const Scenery& scenery = *static_cast<const Scenery*>(context);
+    const ShadowPassUniforms& u = scenery.m_shadowUniforms;
+    scenery.BindInstances(packet);
+    
+    const VertexDecode& decode = packet.mesh->GetVertexDecode();
+    packet.shader->Set(u.positionOffset, decode.positionOffset);
+    packet.shader->Set(u.positionScale, decode.positionScale);
+}
+
+void Scenery::BindInstances(const DrawPacket& packet) const {
+    // GL 3.3 has no base instance, so point the attributes at the cell's run
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.Get());
+    const size_t base = static_cast<size_t>(packet.userData) * sizeof(SceneryInstance);
+    const GLsizei stride = sizeof(SceneryInstance);
+    
+    glVertexAttribPointer(INSTANCE_POSITION_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(SceneryInstance, positionScale)));
+    glEnableVertexAttribArray(INSTANCE_POSITION_LOCATION);
+    glVertexAttribDivisor(INSTANCE_POSITION_LOCATION, 1);
+    
+    glVertexAttribPointer(INSTANCE_PARAMS_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(SceneryInstance, params)));
+    glEnableVertexAttribArray(INSTANCE_PARAMS_LOCATION);
+    glVertexAttribDivisor(INSTANCE_PARAMS_LOCATION, 1);
+}
+
+size_t Scenery::GetGpuMemorySize() const {
+    size_t size = m_instanceCount * sizeof(SceneryInstance);
+    for (const Mesh& mesh : m_meshes) {
+        size += mesh.GetGpuMemorySize();
+    }
+    return size;
+}
+
+void Scenery::CreateMeshes() {
+    // 16 bytes per vertex; the part flag survives as a half float
+    m_meshes[static_cast<int>(SceneryType::Tree)] = CreateTreeMesh();
+    m_meshes[static_cast<int>(SceneryType::Building)] = CreateBuildingMesh();
+    for (Mesh& mesh : m_meshes) {
+        mesh.SetVertexLayout(VertexLayout::Compact());
+        mesh.Upload(true);
+    }
+}
+
+bool Scenery::SetupShaders() {
+    std::string vertexSource = Shader::InsertAfterVersion(SCENERY_VERTEX_SOURCE, SCENERY_TRANSFORM_SOURCE);
+    std::string fragmentSource = ClusteredLights::AddShaderFunctions(
+        ShadowCascades::AddShaderFunctions(Atmosphere::AddShaderFunctions(SCENERY_FRAGMENT_SOURCE)));
+    
+    m_shader = std::make_unique<Shader>();
+    bool loaded = m_shader->BeginLoadFromStrings(vertexSource, fragmentSource, [this](const Shader& shader) {
+        SceneryUniforms& u = m_uniforms;
+        u.view = shader.GetUniform<glm::mat4>("view");
+        u.projection = shader.GetUniform<glm::mat4>("projection");
+        u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+        u.fadeOrigin = shader.GetUniform<glm::vec3>("fadeOrigin");
+        u.densityFade = shader.GetUniform<glm::vec3>("densityFade");
+        u.primaryColor = shader.GetUniform<glm::vec3>("primaryColor");
+        u.secondaryColor = shader.GetUniform<glm::vec3>("secondaryColor");
+        u.vertexDecode = shader.GetVertexDecodeUniforms();
+        u.atmosphere = Atmosphere::GetUniforms(shader);
+        u.shadows = ShadowCascades::GetUniforms(shader);
+        u.localLights = ClusteredLights::GetUniforms(shader);
+    });
+    
+    m_shadowShader = std::make_unique<Shader>();
+    std::string shadowVertexSource = Shader::InsertAfterVersion(SCENERY_SHADOW_VERTEX_SOURCE,
+                                                                SCENERY_TRANSFORM_SOURCE);
+    loaded &= m_shadowShader->BeginLoadFromStrings(shadowVertexSource, SCENERY_SHADOW_FRAGMENT_SOURCE,
+                                                   [this](const Shader& shader) {
+        ShadowPassUniforms& u = m_shadowUniforms;
+        u.lightViewProjection = shader.GetUniform<glm::mat4>("lightViewProjection");
+        u.fadeOrigin = shader.GetUniform<glm::vec3>("fadeOrigin");
+        u.densityFade = shader.GetUniform<glm::vec3>("densityFade");
+        u.positionOffset = shader.GetUniform<glm::vec3>("positionOffset");
+        u.positionScale = shader.GetUniform<glm::vec3>("positionScale");
+    });
+    return loaded;
+}
+
+} // namespace FlightSim
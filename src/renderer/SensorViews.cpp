@@ -0,0 +1,198 @@
+#include "renderer/SensorViews.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+namespace FlightSim {
+
+SensorViews::SensorViews()
+    : m_colorTexture(0)
+    , m_depthBuffer(0)
+    , m_framebuffer(0)
+    , m_arrayWidth(0)
+    , m_arrayHeight(0)
+    , m_arrayLayers(0)
+    , m_previousFramebuffer(0)
+    , m_previousViewport{0, 0, 0, 0}
+    , m_inPass(false) {
+}
+
+SensorViews::~SensorViews() {
+    Shutdown();
+}
+
+bool SensorViews::Initialize() {
+    glGenFramebuffers(1, &m_framebuffer);
+    return m_framebuffer != 0;
+}
+
+void SensorViews::Shutdown() {
+    m_views.clear();
+    if (m_framebuffer != 0) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        m_framebuffer = 0;
+    }
+    if (m_colorTexture != 0) {
+        GLStateCache::Get().OnTextureDeleted(m_colorTexture);
+        glDeleteTextures(1, &m_colorTexture);
+        m_colorTexture = 0;
+    }
+    if (m_depthBuffer != 0) {
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+    m_arrayWidth = 0;
+    m_arrayHeight = 0;
+    m_arrayLayers = 0;
+}
+
+int SensorViews::AddView(int width, int height, float rateHz, PixelReadbackRing::Consumer consumer) {
+    if (m_framebuffer == 0 || width <= 0 || height <= 0) return -1;
+    if (static_cast<int>(m_views.size()) >= MAX_VIEWS) {
+        std::cerr << "At most " << MAX_VIEWS << " sensor views are supported" << std::endl;
+        return -1;
+    }
+    
+    // The array grows to the largest view; existing layers are views that
+    // have not rendered yet, so nothing is lost
+    if (!Allocate(std::max(width, m_arrayWidth), std::max(height, m_arrayHeight),
+                  static_cast<int>(m_views.size()) + 1)) {
+        return -1;
+    }
+    
+    View view;
+    view.camera.SetAspectRatio(static_cast<float>(width) / static_cast<float>(height));
+    view.width = width;
+    view.height = height;
+    view.period = rateHz > 0.0f ? 1.0f / rateHz : 0.0f;
+    view.lastRendered = -1.0f;
+    view.consumer = std::move(consumer);
+    if (view.consumer) {
+        view.readback = std::make_unique<PixelReadbackRing>();
+        if (!view.readback->Initialize(width, height, READBACK_DEPTH)) {
+            std::cerr << "Failed to create sensor view readback buffers" << std::endl;
+            return -1;
+        }
+    }
+    
+    m_views.push_back(std::move(view));
+    return static_cast<int>(m_views.size()) - 1;
+}
+
+bool SensorViews::Allocate(int width, int height, int layers) {
+    if (width == m_arrayWidth && height == m_arrayHeight && layers == m_arrayLayers) {
+        return true;
+    }
+    
+    if (m_colorTexture == 0) {
+        glGenTextures(1, &m_colorTexture);
+    }
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, m_colorTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    // Views render one after another, so one depth buffer serves them all
+    if (m_depthBuffer == 0) {
+        glGenRenderbuffers(1, &m_depthBuffer);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Sensor view framebuffer " << width << "x" << height << " incomplete: 0x"
+                  << std::hex << status << std::dec << std::endl;
+        return false;
+    }
+    
+    m_arrayWidth = width;
+    m_arrayHeight = height;
+    m_arrayLayers = layers;
+    return true;
+}
+
+bool SensorViews::IsDue(int view, float time) const {
+    const View& v = m_views[view];
+    // A clock that went backwards (simulation reset) restarts the schedule
+    return v.lastRendered < 0.0f || time < v.lastRendered || time - v.lastRendered >= v.period;
+}
+
+void SensorViews::BeginView(int view, float time) {
+    if (!m_inPass) {
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        m_inPass = true;
+    }
+    
+    View& v = m_views[view];
+    
+    // Advance by whole periods so the feed does not drift below its rate
+    if (v.lastRendered < 0.0f || v.period <= 0.0f || time < v.lastRendered ||
+        time - v.lastRendered >= 2.0f * v.period) {
+        v.lastRendered = time;
+    } else {
+        v.lastRendered += v.period;
+    }
+    
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, view);
+    glViewport(0, 0, v.width, v.height);
+    
+    GLStateCache::Get().SetDepthMask(true);
+    glClearColor(0.2f, 0.3f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void SensorViews::EndView(int view) {
+    View& v = m_views[view];
+    v.stats.framesRendered++;
+    if (!v.readback) return;
+    
+    // The ring reads the lower-left width x height of the bound layer
+    if (!v.readback->Queue(m_framebuffer)) {
+        v.stats.readbacksDropped++;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void SensorViews::End() {
+    if (!m_inPass) return;
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_previousFramebuffer));
+    glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+    m_inPass = false;
+}
+
+void SensorViews::Collect() {
+    for (View& view : m_views) {
+        if (view.readback) {
+            view.stats.framesReadBack += view.readback->Collect(view.consumer, false);
+        }
+    }
+}
+
+void SensorViews::Flush() {
+    for (View& view : m_views) {
+        while (view.readback && view.readback->GetPendingCount() > 0) {
+            int pending = view.readback->GetPendingCount();
+            view.stats.framesReadBack += view.readback->Collect(view.consumer, true);
+            if (view.readback->GetPendingCount() == pending) {
+                view.stats.readbacksDropped += pending; // Timed out; Shutdown releases them
+                break;
+            }
+        }
+    }
+}
+
+} // namespace FlightSim
@@ -0,0 +1,259 @@
+#include "renderer/ShadowCascades.h"
+#include "core/Camera.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace FlightSim {
+
+// Texture unit the depth array is bound to while drawing
+static constexpr unsigned int SHADOW_TEXTURE_UNIT = 7;
+
+static constexpr float DEFAULT_SHADOW_DISTANCE = 4000.0f; // Meters
+
+// Blend between logarithmic (1) and uniform (0) cascade splits
+static constexpr float SPLIT_LAMBDA = 0.8f;
+
+// Static cascades cover this much more than their slice, so the camera can
+// travel (margin - 1) * radius before they have to be redrawn
+static constexpr float STATIC_CASCADE_MARGIN = 1.25f;
+
+// How far towards the sun casters outside the slice are still captured
+static constexpr float CASTER_DISTANCE = 2000.0f; // Meters
+
+// Sun movement below this keeps the static cascades (about 0.25 degrees)
+static constexpr float SUN_TOLERANCE_COS = 0.99999f;
+
+// Receivers are pushed out along their normal by this many texels
+static constexpr float NORMAL_OFFSET_TEXELS = 1.5f;
+
+static const char* SHADOW_LIBRARY_SOURCE = R"(
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 shadowMatrices[SHADOW_CASCADE_COUNT];
+uniform vec4 shadowNormalOffsets;
+
+float GetSunShadow(vec3 worldPosition, vec3 normal) {
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i) {
+        vec3 p = (shadowMatrices[i] * vec4(worldPosition + normal * shadowNormalOffsets[i], 1.0)).xyz;
+        
+        // First cascade that covers the point with room for the filter
+        if (any(lessThan(p.xy, 2.0 * texel)) || any(greaterThan(p.xy, 1.0 - 2.0 * texel)) || p.z > 1.0) {
+            continue;
+        }
+        
+        // 3x3 taps of hardware 2x2 PCF
+        float lit = 0.0;
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                lit += texture(shadowMap, vec4(p.xy + vec2(x, y) * texel, float(i), p.z));
+            }
+        }
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+)";
+
+// Rotation into a light basis that depends only on the sun direction, so
+// texel snapping in it is stable under camera movement
+static glm::mat4 GetLightView(const glm::vec3& sunDirection) {
+    glm::vec3 up = std::abs(sunDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), -sunDirection, up);
+}
+
+ShadowCascades::ShadowCascades()
+    : m_depthTexture(0)
+    , m_framebuffer(0)
+    , m_normalOffsets(0.0f)
+    , m_shadowDistance(DEFAULT_SHADOW_DISTANCE)
+    , m_renderedCount(0)
+    , m_previousFramebuffer(0)
+    , m_previousViewport{0, 0, 0, 0}
+    , m_inPass(false)
+    , m_ready(false) {
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        m_cascades[i] = {glm::mat4(1.0f), glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, false, false};
+        m_shadowMatrices[i] = glm::mat4(1.0f);
+    }
+}
+
+ShadowCascades::~ShadowCascades() {
+    Shutdown();
+}
+
+bool ShadowCascades::Initialize() {
+    glGenTextures(1, &m_depthTexture);
+    GLStateCache::Get().BindTexture(SHADOW_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, RESOLUTION, RESOLUTION, CASCADE_COUNT, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    
+    if (!complete) {
+        std::cerr << "Shadow map framebuffer incomplete" << std::endl;
+        Shutdown();
+        return false;
+    }
+    
+    InvalidateStatic();
+    m_ready = true;
+    return true;
+}
+
+void ShadowCascades::Shutdown() {
+    if (m_framebuffer != 0) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        m_framebuffer = 0;
+    }
+    if (m_depthTexture != 0) {
+        // Deleted names get recycled; the cache must not think it is still bound
+        GLStateCache::Get().Invalidate();
+        glDeleteTextures(1, &m_depthTexture);
+        m_depthTexture = 0;
+    }
+    m_ready = false;
+}
+
+void ShadowCascades::InvalidateStatic() {
+    for (Cascade& cascade : m_cascades) {
+        cascade.valid = false;
+    }
+}
+
+void ShadowCascades::Update(const Camera& camera, const glm::vec3& sunDirection) {
+    const float nearPlane = camera.GetNearPlane();
+    const float farPlane = std::min(m_shadowDistance, camera.GetFarPlane());
+    
+    // Practical split scheme (Zhang et al. 2006)
+    float splits[CASCADE_COUNT + 1];
+    splits[0] = nearPlane;
+    for (int i = 1; i <= CASCADE_COUNT; ++i) {
+        float t = static_cast<float>(i) / CASCADE_COUNT;
+        float logarithmic = nearPlane * std::pow(farPlane / nearPlane, t);
+        float uniform = nearPlane + (farPlane - nearPlane) * t;
+        splits[i] = SPLIT_LAMBDA * logarithmic + (1.0f - SPLIT_LAMBDA) * uniform;
+    }
+    
+    // Squared tangent of the angle between the view axis and a frustum corner
+    float tanHalfFov = std::tan(glm::radians(camera.GetFov()) * 0.5f);
+    float aspect = camera.GetAspectRatio();
+    float cornerTan2 = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+    
+    m_renderedCount = 0;
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        Cascade& cascade = m_cascades[i];
+        const bool dynamic = IsDynamic(i);
+        
+        // Smallest sphere around the slice; it depends only on the
+        // projection, so the cascade size does not change as the camera turns
+        float a = splits[i];
+        float b = splits[i + 1];
+        float centerDistance = std::min(0.5f * (a + b) * (1.0f + cornerTan2), b);
+        float radius = std::sqrt((b - centerDistance) * (b - centerDistance) + b * b * cornerTan2);
+        radius = std::ceil(radius);
+        glm::vec3 worldCenter = camera.GetPosition() + camera.GetFront() * centerDistance;
+        
+        float halfExtent = dynamic ? radius : radius * STATIC_CASCADE_MARGIN;
+        bool sunMoved = !cascade.valid || glm::dot(cascade.sunDirection, sunDirection) < SUN_TOLERANCE_COS;
+        glm::vec3 sun = (dynamic || sunMoved) ? sunDirection : cascade.sunDirection;
+        glm::mat4 lightView = GetLightView(sun);
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(worldCenter, 1.0f));
+        
+        // Static cascades keep their region while the slice stays inside it
+        bool redraw = dynamic || sunMoved || halfExtent != cascade.halfExtent;
+        if (!redraw) {
+            glm::vec3 drift = glm::abs(lightCenter - cascade.center);
+            redraw = std::max(drift.x, drift.y) + radius > halfExtent || drift.z + radius > halfExtent;
+        }
+        cascade.dirty = redraw;
+        if (!redraw) continue;
+        
+        // Move the region in whole texels so static texels land on themselves
+        float texelSize = 2.0f * halfExtent / RESOLUTION;
+        glm::vec3 center = glm::floor(lightCenter / texelSize) * texelSize;
+        float depthHalf = halfExtent + CASTER_DISTANCE;
+        glm::mat4 projection = glm::ortho(center.x - halfExtent, center.x + halfExtent,
+                                          center.y - halfExtent, center.y + halfExtent,
+                                          -center.z - depthHalf, -center.z + depthHalf);
+        
+        cascade.viewProjection = projection * lightView;
+        cascade.sunDirection = sun;
+        cascade.center = center;
+        cascade.halfExtent = halfExtent;
+        cascade.valid = true;
+        
+        // Clip space to texture space for lookups
+        glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+        m_shadowMatrices[i] = bias * cascade.viewProjection;
+        m_normalOffsets[i] = texelSize * NORMAL_OFFSET_TEXELS;
+        m_renderedCount++;
+    }
+}
+
+void ShadowCascades::BeginCascade(int cascade) {
+    if (!m_inPass) {
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glViewport(0, 0, RESOLUTION, RESOLUTION);
+        
+        // Slope-scaled bias against acne on surfaces facing away from the sun
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        m_inPass = true;
+    }
+    
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, cascade);
+    GLStateCache::Get().SetDepthMask(true);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowCascades::End() {
+    if (!m_inPass) return;
+    
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_previousFramebuffer));
+    glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+    m_inPass = false;
+}
+
+std::string ShadowCascades::AddShaderFunctions(const std::string& source) {
+    std::string constants = "const int SHADOW_CASCADE_COUNT = " + std::to_string(CASCADE_COUNT) + ";\n";
+    return Shader::InsertAfterVersion(source, constants + SHADOW_LIBRARY_SOURCE);
+}
+
+ShadowUniforms ShadowCascades::GetUniforms(const Shader& shader) {
+    ShadowUniforms u;
+    u.shadowMap = shader.GetUniform<int>("shadowMap");
+    u.shadowMatrices = shader.GetUniform<glm::mat4>("shadowMatrices");
+    u.shadowNormalOffsets = shader.GetUniform<glm::vec4>("shadowNormalOffsets");
+    return u;
+}
+
+void ShadowCascades::Apply(const Shader& shader, const ShadowUniforms& uniforms) const {
+    GLStateCache::Get().BindTexture(SHADOW_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    shader.Set(uniforms.shadowMap, static_cast<int>(SHADOW_TEXTURE_UNIT));
+    shader.Set(uniforms.shadowMatrices, m_shadowMatrices, CASCADE_COUNT);
+    shader.Set(uniforms.shadowNormalOffsets, m_normalOffsets);
+}
+
+} // namespace FlightSim
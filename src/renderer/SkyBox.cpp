@@ -1,18 +1,16 @@
 #include "renderer/SkyBox.h"
 #include "core/Camera.h"
+#include "renderer/RenderQueue.h"
 #include <glad/glad.h>
 #include <iostream>
+#include <vector>
 
 namespace FlightSim {
 
 SkyBox::SkyBox()
-    : m_topColor(0.5f, 0.7f, 1.0f)
-    , m_bottomColor(0.8f, 0.9f, 1.0f)
-    , m_sunPosition(0.3f, 0.7f, 0.2f)
-    , m_timeOfDay(0.5f)
-    , m_sunIntensity(1.0f)
-    , m_sunColor(1.0f, 0.9f, 0.7f)
-    , m_horizonColor(0.9f, 0.8f, 0.7f) {
+    : m_inverseViewProjection(1.0f)
+    , m_cameraPosition(0.0f)
+    , m_atmosphere(nullptr) {
 }
 
 SkyBox::~SkyBox() {
@@ -22,7 +20,6 @@ SkyBox::~SkyBox() {
 bool SkyBox::Initialize() {
     SetupShaders();
     CreateSkyMesh();
-    UpdateSkyColors();
     return true;
 }
 
@@ -31,55 +28,39 @@ void SkyBox::Shutdown() {
     m_skyShader.reset();
 }
 
-void SkyBox::Render(const Camera& camera) {
-    if (!m_skyShader || !m_skyMesh) return;
+void SkyBox::Submit(RenderQueue& queue, const Camera& camera, const Atmosphere& atmosphere) {
+    if (!m_skyShader || !m_skyShader->IsValid() || !m_skyMesh || !atmosphere.IsReady()) return;
     
-    // Disable depth writing for skybox
-    glDepthMask(GL_FALSE);
-    
-    m_skyShader->Use();
-    
-    // Remove translation from view matrix (keep only rotation)
+    // Rotation only: the shader turns each pixel into a view direction
     glm::mat4 view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-    glm::mat4 projection = camera.GetProjectionMatrix();
-    
-    m_skyShader->SetMat4("view", view);
-    m_skyShader->SetMat4("projection", projection);
-    
-    // Set sky colors
-    m_skyShader->SetVec3("topColor", m_topColor);
-    m_skyShader->SetVec3("bottomColor", m_bottomColor);
-    m_skyShader->SetVec3("sunPosition", m_sunPosition);
-    m_skyShader->SetVec3("sunColor", m_sunColor);
-    m_skyShader->SetFloat("sunIntensity", m_sunIntensity);
-    
-    // Render skybox
-    m_skyMesh->Render();
+    m_inverseViewProjection = glm::inverse(camera.GetProjectionMatrix() * view);
+    m_cameraPosition = camera.GetPosition();
+    m_atmosphere = &atmosphere;
     
-    m_skyShader->Unbind();
-    
-    // Re-enable depth writing
-    glDepthMask(GL_TRUE);
-}
-
-void SkyBox::SetSkyColor(const glm::vec3& topColor, const glm::vec3& bottomColor) {
-    m_topColor = topColor;
-    m_bottomColor = bottomColor;
+    // The sky layer disables depth writes and draws with LEQUAL at max depth
+    uint32_t material = queue.AddMaterial({"Sky", &SkyBox::ApplyMaterial, nullptr, this});
+    queue.Submit(RenderLayer::Sky, *m_skyShader, *m_skyMesh, material, 0.0f);
 }
 
-void SkyBox::SetSunPosition(const glm::vec3& position) {
-    m_sunPosition = glm::normalize(position);
-}
-
-void SkyBox::SetTimeOfDay(float time) {
-    m_timeOfDay = time;
-    UpdateSkyColors();
+void SkyBox::ApplyMaterial(const Shader& shader, const void* context) {
+    const SkyBox& sky = *static_cast<const SkyBox*>(context);
+    const SkyUniforms& u = sky.m_skyUniforms;
+    
+    shader.Set(u.inverseViewProjection, sky.m_inverseViewProjection);
+    shader.Set(u.cameraPosition, sky.m_cameraPosition);
+    sky.m_atmosphere->Apply(shader, u.atmosphere);
 }
 
 void SkyBox::CreateSkyMesh() {
-    // Create a large cube for the skybox
-    m_skyMesh = std::make_unique<Mesh>(Mesh::CreateCube());
-    m_skyMesh->Upload();
+    // One triangle covering the viewport in clip space
+    std::vector<Vertex> vertices(3);
+    vertices[0].position = glm::vec3(-1.0f, -1.0f, 0.0f);
+    vertices[1].position = glm::vec3(3.0f, -1.0f, 0.0f);
+    vertices[2].position = glm::vec3(-1.0f, 3.0f, 0.0f);
+    
+    m_skyMesh = std::make_unique<Mesh>();
+    m_skyMesh->SetVertices(std::move(vertices));
+    m_skyMesh->Upload(true);
 }
 
 void SkyBox::SetupShaders() {
@@ -89,15 +70,11 @@ void SkyBox::SetupShaders() {
         #version 330 core
         layout (location = 0) in vec3 aPos;
         
-        out vec3 TexCoords;
-        
-        uniform mat4 projection;
-        uniform mat4 view;
+        out vec2 ScreenPos;
         
         void main() {
-            TexCoords = aPos;
-            vec4 pos = projection * view * vec4(aPos, 1.0);
-            gl_Position = pos.xyww; // Set z to w so that z/w = 1.0 (max depth)
+            ScreenPos = aPos.xy;
+            gl_Position = vec4(aPos.xy, 1.0, 1.0); // z/w = 1.0 (max depth)
         }
     )";
     
@@ -105,53 +82,34 @@ void SkyBox::SetupShaders() {
         #version 330 core
         out vec4 FragColor;
         
-        in vec3 TexCoords;
+        in vec2 ScreenPos;
         
-        uniform vec3 topColor;
-        uniform vec3 bottomColor;
-        uniform vec3 sunPosition;
-        uniform vec3 sunColor;
-        uniform float sunIntensity;
+        uniform mat4 inverseViewProjection;
+        uniform vec3 cameraPosition;
         
         void main() {
-            vec3 direction = normalize(TexCoords);
+            vec4 farPoint = inverseViewProjection * vec4(ScreenPos, 1.0, 1.0);
+            vec3 viewRay = normalize(farPoint.xyz / farPoint.w);
             
-            // Vertical gradient
-            float t = (direction.y + 1.0) * 0.5; // Convert from [-1,1] to [0,1]
-            vec3 skyColor = mix(bottomColor, topColor, t);
+            vec3 transmittance;
+            vec3 radiance = GetSkyRadiance(WorldToAtmosphere(cameraPosition), viewRay, transmittance);
             
-            // Sun effect
-            float sunDot = dot(direction, sunPosition);
-            float sunEffect = pow(max(sunDot, 0.0), 64.0);
-            skyColor += sunColor * sunEffect * sunIntensity;
+            // Sun disc, attenuated by the air in front of it
+            if (dot(viewRay, sunDirection) > cos(SUN_ANGULAR_RADIUS)) {
+                radiance += transmittance * SUN_ILLUMINANCE / (PI * SUN_ANGULAR_RADIUS * SUN_ANGULAR_RADIUS);
+            }
             
-            // Horizon glow
-            float horizonFactor = 1.0 - abs(direction.y);
-            horizonFactor = pow(horizonFactor, 2.0);
-            skyColor = mix(skyColor, vec3(1.0, 0.8, 0.6), horizonFactor * 0.1);
-            
-            FragColor = vec4(skyColor, 1.0);
+            FragColor = vec4(ToDisplay(radiance), 1.0);
         }
     )";
     
-    m_skyShader->LoadFromStrings(vertexSource, fragmentSource);
-}
-
-void SkyBox::UpdateSkyColors() {
-    // Update colors based on time of day
-    float dayFactor = sin(m_timeOfDay * 3.14159f); // 0 at midnight, 1 at noon
-    
-    if (dayFactor > 0.0f) {
-        // Day colors
-        m_topColor = glm::mix(glm::vec3(0.2f, 0.2f, 0.4f), glm::vec3(0.5f, 0.7f, 1.0f), dayFactor);
-        m_bottomColor = glm::mix(glm::vec3(0.1f, 0.1f, 0.2f), glm::vec3(0.8f, 0.9f, 1.0f), dayFactor);
-        m_sunIntensity = dayFactor;
-    } else {
-        // Night colors
-        m_topColor = glm::vec3(0.05f, 0.05f, 0.2f);
-        m_bottomColor = glm::vec3(0.02f, 0.02f, 0.1f);
-        m_sunIntensity = 0.0f;
-    }
+    m_skyShader->BeginLoadFromStrings(vertexSource, Atmosphere::AddShaderFunctions(fragmentSource),
+                                      [this](const Shader& shader) {
+        SkyUniforms& u = m_skyUniforms;
+        u.inverseViewProjection = shader.GetUniform<glm::mat4>("inverseViewProjection");
+        u.cameraPosition = shader.GetUniform<glm::vec3>("cameraPosition");
+        u.atmosphere = Atmosphere::GetUniforms(shader);
+    });
 }
 
 } // namespace FlightSim 
\ No newline at end of file
@@ -1,12 +1,21 @@
 #include "renderer/Terrain.h"
 #include "core/Camera.h"
+#include "core/MeshOptimizer.h"
+#include "renderer/RenderQueue.h"
 #include <glad/glad.h>
 #include <iostream>
 
 namespace FlightSim {
 
 Terrain::Terrain()
-    : m_gridSize(100)
+    : m_view(1.0f)
+    , m_projection(1.0f)
+    , m_viewPos(0.0f)
+    , m_atmosphere(nullptr)
+    , m_shadows(nullptr)
+    , m_lights(nullptr)
+    , m_lightViewProjection(1.0f)
+    , m_gridSize(100)
     , m_terrainScale(1000.0f)
     , m_terrainColor(0.3f, 0.7f, 0.2f)
     , m_terrainWidth(100)
@@ -27,30 +36,60 @@ bool Terrain::Initialize() {
 void Terrain::Shutdown() {
     m_terrainMesh.reset();
     m_terrainShader.reset();
+    m_shadowShader.reset();
 }
 
-void Terrain::Render(const Camera& camera) {
-    if (!m_terrainShader || !m_terrainMesh) return;
+void Terrain::Submit(RenderQueue& queue, const Camera& camera, const Atmosphere& atmosphere,
+                     const ShadowCascades& shadows, const ClusteredLights& lights) {
+    if (!m_terrainShader || !m_terrainShader->IsValid() || !m_terrainMesh || !atmosphere.IsReady() ||
+        !shadows.IsReady()) return;
     
-    m_terrainShader->Use();
+    m_view = camera.GetViewMatrix();
+    m_projection = camera.GetProjectionMatrix();
+    m_viewPos = camera.GetPosition();
+    m_atmosphere = &atmosphere;
+    m_shadows = &shadows;
+    m_lights = &lights;
+    
+    uint32_t material = queue.AddMaterial({"Terrain", &Terrain::ApplyMaterial, nullptr, this});
+    queue.Submit(RenderLayer::Opaque, *m_terrainShader, *m_terrainMesh, material, 0.0f);
+}
+
+void Terrain::SubmitShadow(RenderQueue& queue, const glm::mat4& lightViewProjection) {
+    if (!m_shadowShader || !m_shadowShader->IsValid() || !m_terrainMesh) return;
+    
+    m_lightViewProjection = lightViewProjection;
+    uint32_t material = queue.AddMaterial({"Terrain shadow", &Terrain::ApplyShadowMaterial, nullptr, this});
+    queue.Submit(RenderLayer::Opaque, *m_shadowShader, *m_terrainMesh, material, 0.0f);
+}
+
+void Terrain::ApplyMaterial(const Shader& shader, const void* context) {
+    const Terrain& terrain = *static_cast<const Terrain*>(context);
+    const TerrainUniforms& u = terrain.m_terrainUniforms;
     
     // Set matrices
     glm::mat4 model = glm::mat4(1.0f); // Identity matrix for terrain
-    glm::mat4 view = camera.GetViewMatrix();
-    glm::mat4 projection = camera.GetProjectionMatrix();
-    
-    m_terrainShader->SetMat4("model", model);
-    m_terrainShader->SetMat4("view", view);
-    m_terrainShader->SetMat4("projection", projection);
+    shader.Set(u.model, model);
+    shader.Set(u.view, terrain.m_view);
+    shader.Set(u.projection, terrain.m_projection);
+    shader.Set(u.vertexDecode, terrain.m_terrainMesh->GetVertexDecode());
     
     // Set terrain color
-    m_terrainShader->SetVec3("terrainColor", m_terrainColor);
-    m_terrainShader->SetVec3("viewPos", camera.GetPosition());
-    
-    // Render terrain mesh
-    m_terrainMesh->Render();
+    shader.Set(u.terrainColor, terrain.m_terrainColor);
+    shader.Set(u.viewPos, terrain.m_viewPos);
+    terrain.m_atmosphere->Apply(shader, u.atmosphere);
+    terrain.m_shadows->Apply(shader, u.shadows);
+    terrain.m_lights->Apply(shader, u.localLights);
+}
+
+void Terrain::ApplyShadowMaterial(const Shader& shader, const void* context) {
+    const Terrain& terrain = *static_cast<const Terrain*>(context);
+    const ShadowPassUniforms& u = terrain.m_shadowUniforms;
+    const VertexDecode& decode = terrain.m_terrainMesh->GetVertexDecode();
     
-    m_terrainShader->Unbind();
+    shader.Set(u.lightViewProjection, terrain.m_lightViewProjection);
+    shader.Set(u.positionOffset, decode.positionOffset);
+    shader.Set(u.positionScale, decode.positionScale);
 }
 
 void Terrain::GenerateTerrain(int width, int height, float scale) {
@@ -144,11 +183,18 @@ void Terrain::CreateTerrainMesh() {
         }
     }
     
+    // Scan-order grid indices reuse barely half the transformed vertices
+    MeshOptimizationStats stats = MeshOptimizer::Optimize(vertices, indices);
+    std::cout << "Terrain mesh: ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+              << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+    
     // Create mesh
+    // 16 bytes per vertex and 16-bit indices instead of 32 bytes and 32-bit
     m_terrainMesh = std::make_unique<Mesh>();
-    m_terrainMesh->SetVertices(vertices);
-    m_terrainMesh->SetIndices(indices);
-    m_terrainMesh->Upload();
+    m_terrainMesh->SetVertexLayout(VertexLayout::Compact());
+    m_terrainMesh->SetVertices(std::move(vertices));
+    m_terrainMesh->SetIndices(std::move(indices));
+    m_terrainMesh->Upload(true); // Heights are sampled from m_heightMap, not the mesh
 }
 
 void Terrain::SetupShaders() {
@@ -168,9 +214,23 @@ void Terrain::SetupShaders() {
         uniform mat4 view;
         uniform mat4 projection;
         
+        // Vertex decode for compressed mesh layouts (see VertexLayout)
+        uniform vec3 positionOffset;
+        uniform vec3 positionScale;
+        uniform bool octahedralNormals;
+        
+        vec3 DecodeNormal(vec3 encoded) {
+            if (!octahedralNormals) return encoded;
+            vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+            float t = max(-n.z, 0.0);
+            n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+            return normalize(n);
+        }
+        
         void main() {
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = mat3(transpose(inverse(model))) * aNormal;
+            vec3 position = positionOffset + aPos * positionScale;
+            FragPos = vec3(model * vec4(position, 1.0));
+            Normal = mat3(transpose(inverse(model))) * DecodeNormal(aNormal);
             TexCoord = aTexCoord;
             
             gl_Position = projection * view * vec4(FragPos, 1.0);
@@ -189,20 +249,70 @@ void Terrain::SetupShaders() {
         uniform vec3 viewPos;
         
         void main() {
-            vec3 lightDir = normalize(vec3(-0.3, -1.0, -0.2));
+            // terrainColor is a display color; light in linear space
+            vec3 albedo = pow(terrainColor, vec3(2.2));
             vec3 norm = normalize(Normal);
+            vec3 point = WorldToAtmosphere(FragPos);
             
-            float diff = max(dot(norm, -lightDir), 0.0);
-            vec3 diffuse = diff * terrainColor;
+            vec3 skyIrradiance;
+            vec3 sunIrradiance = GetSunAndSkyIrradiance(point, norm, skyIrradiance);
+            sunIrradiance *= GetSunShadow(FragPos, norm);
             
-            vec3 ambient = 0.3 * terrainColor;
-            vec3 result = ambient + diffuse;
+            // Runway and aircraft lights; the ground is diffuse
+            vec3 localSpecular;
+            vec3 localIrradiance = GetLocalLightIrradiance(FragPos, norm, normalize(viewPos - FragPos), 1.0,
+                                                           localSpecular);
+            vec3 radiance = albedo / PI * (sunIrradiance + skyIrradiance + localIrradiance);
             
-            FragColor = vec4(result, 1.0);
+            // Aerial perspective replaces distance fog
+            vec3 transmittance;
+            vec3 inScatter = GetSkyRadianceToPoint(WorldToAtmosphere(viewPos), point, transmittance);
+            FragColor = vec4(ToDisplay(radiance * transmittance + inScatter), 1.0);
+        }
+    )";
+    
+    std::string litFragmentSource = ClusteredLights::AddShaderFunctions(
+        ShadowCascades::AddShaderFunctions(Atmosphere::AddShaderFunctions(fragmentSource)));
+    m_terrainShader->BeginLoadFromStrings(vertexSource, litFragmentSource, [this](const Shader& shader) {
+        TerrainUniforms& u = m_terrainUniforms;
+        u.model = shader.GetUniform<glm::mat4>("model");
+        u.view = shader.GetUniform<glm::mat4>("view");
+        u.projection = shader.GetUniform<glm::mat4>("projection");
+        u.terrainColor = shader.GetUniform<glm::vec3>("terrainColor");
+        u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+        u.vertexDecode = shader.GetVertexDecodeUniforms();
+        u.atmosphere = Atmosphere::GetUniforms(shader);
+        u.shadows = ShadowCascades::GetUniforms(shader);
+        u.localLights = ClusteredLights::GetUniforms(shader);
+    });
+    
+    // Depth only; the mesh is drawn with the light's projection
+    std::string shadowVertexSource = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+        
+        uniform mat4 lightViewProjection;
+        uniform vec3 positionOffset;
+        uniform vec3 positionScale;
+        
+        void main() {
+            gl_Position = lightViewProjection * vec4(positionOffset + aPos * positionScale, 1.0);
+        }
+    )";
+    
+    std::string shadowFragmentSource = R"(
+        #version 330 core
+        void main() {
         }
     )";
     
-    m_terrainShader->LoadFromStrings(vertexSource, fragmentSource);
+    m_shadowShader = std::make_unique<Shader>();
+    m_shadowShader->BeginLoadFromStrings(shadowVertexSource, shadowFragmentSource, [this](const Shader& shader) {
+        ShadowPassUniforms& u = m_shadowUniforms;
+        u.lightViewProjection = shader.GetUniform<glm::mat4>("lightViewProjection");
+        u.positionOffset = shader.GetUniform<glm::vec3>("positionOffset");
+        u.positionScale = shader.GetUniform<glm::vec3>("positionScale");
+    });
 }
 
 } // namespace FlightSim 
\ No newline at end of file
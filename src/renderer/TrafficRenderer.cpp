@@ -0,0 +1,153 @@
+#include "renderer/TrafficRenderer.h"
+#include "core/Mesh.h"
+#include "core/StreamingBuffer.h"
+#include "renderer/RenderQueue.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+
+namespace FlightSim {
+
+// Attribute locations of the per-instance inputs in aircraft.vert
+static constexpr unsigned int INSTANCE_POSITION_LOCATION = 3;
+static constexpr unsigned int INSTANCE_ROTATION_LOCATION = 4;
+static constexpr unsigned int INSTANCE_TINT_LOCATION = 5;
+
+// GPU culling binds the instances as a storage buffer, whose offset
+// alignment is at most 256 bytes
+static constexpr size_t INSTANCE_ALIGNMENT = 256;
+
+TrafficRenderer::TrafficRenderer()
+    : m_stream(nullptr)
+    , m_instanceBuffer(0)
+    , m_instanceOffset(0)
+    , m_drawCalls(0)
+    , m_instanceCount(0) {
+}
+
+TrafficRenderer::~TrafficRenderer() {
+    Shutdown();
+}
+
+bool TrafficRenderer::Initialize(StreamingBuffer& stream) {
+    m_stream = &stream;
+    return stream.GetBuffer() != 0;
+}
+
+void TrafficRenderer::Shutdown() {
+    m_stream = nullptr;
+    m_instanceBuffer = 0;
+    m_batches.clear();
+}
+
+void TrafficRenderer::Begin() {
+    for (Batch& batch : m_batches) {
+        batch.instances.clear();
+    }
+}
+
+void TrafficRenderer::Submit(const Mesh& mesh, int lod, const glm::vec3& position, const glm::quat& orientation,
+                             const glm::vec3& tint, float scale) {
+    Batch& batch = GetBatch(mesh, lod);
+    batch.instances.push_back({
+        glm::vec4(position, scale),
+        glm::vec4(orientation.x, orientation.y, orientation.z, orientation.w),
+        glm::vec4(tint, 1.0f)
+    });
+}
+
+void TrafficRenderer::Upload() {
+    size_t total = 0;
+    m_drawCalls = 0;
+    for (Batch& batch : m_batches) {
+        batch.firstInstance = total;
+        total += batch.instances.size();
+        m_drawCalls += batch.instances.empty() ? 0 : 1;
+    }
+    m_instanceCount = static_cast<int>(total);
+    if (total == 0 || !m_stream) return;
+    
+    // Every batch back to back in this frame's partition. The stream grows
+    // before the next frame if it is full; draw nothing until then.
+    StreamingBuffer::Allocation allocation = m_stream->Allocate(total * sizeof(AircraftInstance),
+                                                                INSTANCE_ALIGNMENT);
+    if (!allocation) {
+        for (Batch& batch : m_batches) {
+            batch.instances.clear();
+        }
+        m_drawCalls = 0;
+        m_instanceCount = 0;
+        return;
+    }
+    
+    AircraftInstance* dst = static_cast<AircraftInstance*>(allocation.data);
+    for (const Batch& batch : m_batches) {
+        std::copy(batch.instances.begin(), batch.instances.end(), dst);
+        dst += batch.instances.size();
+    }
+    m_stream->Commit(allocation);
+    m_instanceBuffer = m_stream->GetBuffer();
+    m_instanceOffset = allocation.offset;
+}
+
+void TrafficRenderer::SubmitDraws(RenderQueue& queue, const Shader& shader, uint32_t material, int lodBegin,
+                                  int lodEnd) {
+    // One instanced draw per (mesh, LOD)
+    for (const Batch& batch : m_batches) {
+        if (batch.instances.empty() || batch.lod < lodBegin || batch.lod >= lodEnd) continue;
+        
+        queue.Submit(RenderLayer::Opaque, shader, *batch.mesh, material, 0.0f,
+                     static_cast<uint32_t>(batch.instances.size()),
+                     static_cast<uint32_t>(batch.firstInstance));
+    }
+}
+
+int TrafficRenderer::GetInstanceCount(int lod) const {
+    size_t count = 0;
+    for (const Batch& batch : m_batches) {
+        if (batch.lod == lod) {
+            count += batch.instances.size();
+        }
+    }
+    return static_cast<int>(count);
+}
+
+TrafficRenderer::Batch& TrafficRenderer::GetBatch(const Mesh& mesh, int lod) {
+    // A handful of batches at most, linear search beats hashing here
+    for (Batch& batch : m_batches) {
+        if (batch.mesh == &mesh && batch.lod == lod) {
+            return batch;
+        }
+    }
+    m_batches.push_back({&mesh, lod, {}, 0});
+    return m_batches.back();
+}
+
+void TrafficRenderer::BindBatch(uint32_t firstInstance) const {
+    // GL 3.3 has no base instance, so point the attributes at the batch's
+    // slice of the frame's allocation instead
+    BindInstanceAttributes(m_instanceBuffer, m_instanceOffset, firstInstance);
+}
+
+void TrafficRenderer::BindInstanceAttributes(unsigned int buffer, size_t offset, size_t firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    const size_t base = offset + firstInstance * sizeof(AircraftInstance);
+    const GLsizei stride = sizeof(AircraftInstance);
+    
+    glVertexAttribPointer(INSTANCE_POSITION_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(AircraftInstance, positionScale)));
+    glEnableVertexAttribArray(INSTANCE_POSITION_LOCATION);
+    glVertexAttribDivisor(INSTANCE_POSITION_LOCATION, 1);
+    
+    glVertexAttribPointer(INSTANCE_ROTATION_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(AircraftInstance, rotation)));
+    glEnableVertexAttribArray(INSTANCE_ROTATION_LOCATION);
+    glVertexAttribDivisor(INSTANCE_ROTATION_LOCATION, 1);
+    
+    glVertexAttribPointer(INSTANCE_TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(AircraftInstance, tint)));
+    glEnableVertexAttribArray(INSTANCE_TINT_LOCATION);
+    glVertexAttribDivisor(INSTANCE_TINT_LOCATION, 1);
+}
+
+} // namespace FlightSim
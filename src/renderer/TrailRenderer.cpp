@@ -0,0 +1,354 @@
+#include "renderer/TrailRenderer.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace FlightSim {
+
+// Texture units used while drawing trails
+static constexpr unsigned int POINT_TEXTURE_UNIT = 0;
+static constexpr unsigned int HEADER_TEXTURE_UNIT = 1;
+
+static constexpr int VERTICES_PER_SEGMENT = 6;
+static constexpr int HEADER_TEXELS_PER_TRAIL = 2;
+
+// Line half-width as a fraction of the viewport height
+static constexpr float TRAIL_HALF_WIDTH = 0.0025f;
+
+TrailRenderer::TrailRenderer()
+    : m_trailShader(nullptr)
+    , m_pointBuffer(0)
+    , m_pointTexture(0)
+    , m_headerBuffer(0)
+    , m_headerTexture(0)
+    , m_emptyVAO(0)
+    , m_maxTrails(0)
+    , m_pointsPerTrail(0)
+    , m_missedPoints(0) {
+}
+
+TrailRenderer::~TrailRenderer() {
+    Shutdown();
+}
+
+bool TrailRenderer::Initialize(int maxTrails) {
+    // Every ring lives in one buffer texture, so together they must fit
+    // its texel limit; rings shorten rather than reading out of range
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    m_pointsPerTrail = maxTrails > 0 ? std::min(POINTS_PER_TRAIL, maxTexels / maxTrails) : 0;
+    if (m_pointsPerTrail < 2) {
+        std::cerr << "Texture buffers of " << maxTexels << " texels cannot hold " << maxTrails << " trails"
+                  << std::endl;
+        m_pointsPerTrail = 0;
+        return false;
+    }
+    if (m_pointsPerTrail < POINTS_PER_TRAIL) {
+        std::cout << "Trails limited to " << m_pointsPerTrail << " points by a texture buffer size of "
+                  << maxTexels << std::endl;
+    }
+    
+    m_maxTrails = maxTrails;
+    m_slots.assign(maxTrails, TrailSlot());
+    m_headers.assign(maxTrails * HEADER_TEXELS_PER_TRAIL, glm::vec4(0.0f));
+    
+    // Ring storage is allocated up front so uploads never reallocate
+    glGenBuffers(1, &m_pointBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_pointBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(maxTrails) * m_pointsPerTrail * sizeof(TrailPoint),
+                 nullptr, GL_DYNAMIC_DRAW);
+    
+    glGenBuffers(1, &m_headerBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_headerBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, m_headers.size() * sizeof(glm::vec4), m_headers.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    
+    GLStateCache& state = GLStateCache::Get();
+    glGenTextures(1, &m_pointTexture);
+    state.BindTexture(POINT_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_pointTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_pointBuffer);
+    
+    glGenTextures(1, &m_headerTexture);
+    state.BindTexture(HEADER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_headerTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_headerBuffer);
+    
+    // Core profile draws need a VAO even without attributes
+    glGenVertexArrays(1, &m_emptyVAO);
+    
+    SetupShaders();
+    return m_pointBuffer != 0 && m_headerBuffer != 0 && m_emptyVAO != 0;
+}
+
+void TrailRenderer::Shutdown() {
+    m_trailShader.reset();
+    
+    if (m_emptyVAO != 0) {
+        GLStateCache::Get().OnVertexArrayDeleted(m_emptyVAO);
+        glDeleteVertexArrays(1, &m_emptyVAO);
+        m_emptyVAO = 0;
+    }
+    GLStateCache& state = GLStateCache::Get();
+    if (m_pointTexture != 0) {
+        state.OnTextureDeleted(m_pointTexture);
+        glDeleteTextures(1, &m_pointTexture);
+        m_pointTexture = 0;
+    }
+    if (m_headerTexture != 0) {
+        state.OnTextureDeleted(m_headerTexture);
+        glDeleteTextures(1, &m_headerTexture);
+        m_headerTexture = 0;
+    }
+    if (m_pointBuffer != 0) {
+        glDeleteBuffers(1, &m_pointBuffer);
+        m_pointBuffer = 0;
+    }
+    if (m_headerBuffer != 0) {
+        glDeleteBuffers(1, &m_headerBuffer);
+        m_headerBuffer = 0;
+    }
+    m_slots.clear();
+    m_maxTrails = 0;
+    m_pointsPerTrail = 0;
+}
+
+void TrailRenderer::Update(const std::vector<TrailUpdate>& trails) {
+    if (m_pointBuffer == 0) return;
+    
+    glBindBuffer(GL_TEXTURE_BUFFER, m_pointBuffer);
+    
+    int trailCount = std::min(static_cast<int>(trails.size()), m_maxTrails);
+    for (int i = 0; i < trailCount; ++i) {
+        const TrailUpdate& update = trails[i];
+        TrailSlot& slot = m_slots[i];
+        
+        if (!slot.active || slot.generation != update.generation) {
+            slot = TrailSlot();
+            slot.generation = update.generation;
+            slot.active = true;
+        }
+        
+        // The snapshot only carries recent commits. If more were made while
+        // this renderer was not looking, fill the gap with the first point
+        // we do have so the trail jumps straight across it.
+        uint64_t firstAvailable = update.committedCount - update.recentPoints.size();
+        if (slot.uploadedCount < firstAvailable) {
+            uint64_t missed = firstAvailable - slot.uploadedCount;
+            m_missedPoints += static_cast<int>(missed);
+            
+            TrailPoint fill = update.recentPoints.empty() ? TrailPoint{update.head, 0.0f} : update.recentPoints.front();
+            size_t fillCount = static_cast<size_t>(std::min<uint64_t>(missed, m_pointsPerTrail));
+            std::vector<TrailPoint> gap(fillCount, fill);
+            UploadPoints(i, firstAvailable - fillCount, gap.data(), gap.size());
+            slot.uploadedCount = firstAvailable;
+        }
+        
+        if (update.committedCount > slot.uploadedCount) {
+            size_t offset = static_cast<size_t>(slot.uploadedCount - firstAvailable);
+            UploadPoints(i, slot.uploadedCount, update.recentPoints.data() + offset,
+                         update.recentPoints.size() - offset);
+            slot.uploadedCount = update.committedCount;
+        }
+        slot.head = update.head;
+    }
+    for (int i = trailCount; i < m_maxTrails; ++i) {
+        m_slots[i].active = false;
+    }
+    
+    // One small upload for every header, and the draw ranges to match
+    m_drawFirst.clear();
+    m_drawCount.clear();
+    for (int i = 0; i < m_maxTrails; ++i) {
+        const TrailSlot& slot = m_slots[i];
+        uint64_t resident = std::min<uint64_t>(slot.uploadedCount, m_pointsPerTrail);
+        uint64_t ringStart = (slot.uploadedCount - resident) % m_pointsPerTrail;
+        
+        m_headers[i * HEADER_TEXELS_PER_TRAIL] = glm::vec4(static_cast<float>(ringStart),
+                                                           static_cast<float>(resident), 0.0f, 0.0f);
+        m_headers[i * HEADER_TEXELS_PER_TRAIL + 1] = glm::vec4(slot.head, 1.0f);
+        
+        // One segment per resident point; the last one joins the head
+        if (slot.active && resident > 0) {
+            m_drawFirst.push_back(i * m_pointsPerTrail * VERTICES_PER_SEGMENT);
+            m_drawCount.push_back(static_cast<int>(resident) * VERTICES_PER_SEGMENT);
+        }
+    }
+    
+    glBindBuffer(GL_TEXTURE_BUFFER, m_headerBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, m_headers.size() * sizeof(glm::vec4), m_headers.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void TrailRenderer::UploadPoints(int slot, uint64_t firstIndex, const TrailPoint* points, size_t count) {
+    // Only the newest ring length of points can be resident
+    const size_t ringLength = static_cast<size_t>(m_pointsPerTrail);
+    if (count > ringLength) {
+        firstIndex += count - ringLength;
+        points += count - ringLength;
+        count = ringLength;
+    }
+    
+    // At most two ranges: up to the end of the ring, then from its start
+    size_t base = static_cast<size_t>(slot) * ringLength;
+    size_t ringIndex = static_cast<size_t>(firstIndex % ringLength);
+    size_t firstRange = std::min(count, ringLength - ringIndex);
+    glBufferSubData(GL_TEXTURE_BUFFER, (base + ringIndex) * sizeof(TrailPoint),
+                    firstRange * sizeof(TrailPoint), points);
+    if (firstRange < count) {
+        glBufferSubData(GL_TEXTURE_BUFFER, base * sizeof(TrailPoint),
+                        (count - firstRange) * sizeof(TrailPoint), points + firstRange);
+    }
+}
+
+void TrailRenderer::Render(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float currentTime) {
+    if (m_drawFirst.empty() || !m_trailShader || !m_trailShader->IsValid()) return;
+    
+    GLStateCache& state = GLStateCache::Get();
+    state.UseProgram(m_trailShader->GetID());
+    
+    const TrailUniforms& u = m_trailUniforms;
+    m_trailShader->Set(u.view, view);
+    m_trailShader->Set(u.projection, projection);
+    m_trailShader->Set(u.nearPlane, nearPlane);
+    m_trailShader->Set(u.aspect, projection[1][1] / projection[0][0]);
+    m_trailShader->Set(u.halfWidth, TRAIL_HALF_WIDTH);
+    m_trailShader->Set(u.currentTime, currentTime);
+    m_trailShader->Set(u.points, static_cast<int>(POINT_TEXTURE_UNIT));
+    m_trailShader->Set(u.headers, static_cast<int>(HEADER_TEXTURE_UNIT));
+    m_trailShader->Set(u.pointsPerTrail, m_pointsPerTrail);
+    
+    state.BindTexture(POINT_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_pointTexture);
+    state.BindTexture(HEADER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_headerTexture);
+    state.BindVertexArray(m_emptyVAO);
+    
+    // Quads can face either way, and trails are translucent
+    glDisable(GL_CULL_FACE);
+    state.SetDepthMask(false);
+    
+    glMultiDrawArrays(GL_TRIANGLES, m_drawFirst.data(), m_drawCount.data(),
+                      static_cast<GLsizei>(m_drawFirst.size()));
+    state.CountDraw();
+    
+    state.SetDepthMask(true);
+    glEnable(GL_CULL_FACE);
+}
+
+uint64_t TrailRenderer::GetPointCount() const {
+    uint64_t total = 0;
+    for (const TrailSlot& slot : m_slots) {
+        if (slot.active) {
+            total += std::min<uint64_t>(slot.uploadedCount, m_pointsPerTrail);
+        }
+    }
+    return total;
+}
+
+void TrailRenderer::SetupShaders() {
+    m_trailShader = std::make_unique<Shader>();
+    
+    std::string vertexSource = R"(
+        #version 330 core
+        
+        // Trail points: xyz position, w commit time. Each trail owns
+        // pointsPerTrail consecutive texels used as a ring.
+        uniform samplerBuffer points;
+        // Two texels per trail: (ring start, point count) and (head position)
+        uniform samplerBuffer headers;
+        uniform int pointsPerTrail;
+        
+        uniform mat4 view;
+        uniform mat4 projection;
+        uniform float nearPlane;
+        uniform float aspect;
+        uniform float halfWidth;
+        uniform float currentTime;
+        
+        out float Age;
+        flat out int Trail;
+        
+        // (segment end, side) for the two triangles of a segment quad
+        const ivec2 CORNERS[6] = ivec2[6](ivec2(0, -1), ivec2(1, -1), ivec2(1, 1),
+                                          ivec2(0, -1), ivec2(1, 1), ivec2(0, 1));
+        
+        vec4 FetchPoint(int trail, int ringStart, int count, int index) {
+            if (index >= count) {
+                return vec4(texelFetch(headers, trail * 2 + 1).xyz, currentTime);
+            }
+            return texelFetch(points, trail * pointsPerTrail + (ringStart + index) % pointsPerTrail);
+        }
+        
+        void main() {
+            int verticesPerTrail = pointsPerTrail * 6;
+            int trail = gl_VertexID / verticesPerTrail;
+            int local = gl_VertexID - trail * verticesPerTrail;
+            int segment = local / 6;
+            ivec2 corner = CORNERS[local - segment * 6];
+            
+            vec4 header = texelFetch(headers, trail * 2);
+            int ringStart = int(header.x);
+            int count = int(header.y);
+            
+            vec4 p0 = FetchPoint(trail, ringStart, count, segment);
+            vec4 p1 = FetchPoint(trail, ringStart, count, segment + 1);
+            
+            // Clip the segment to the near plane so both ends project
+            vec3 v0 = (view * vec4(p0.xyz, 1.0)).xyz;
+            vec3 v1 = (view * vec4(p1.xyz, 1.0)).xyz;
+            float limit = -nearPlane;
+            if (v0.z > limit && v1.z > limit) {
+                gl_Position = vec4(2.0, 2.0, 2.0, 1.0); // Behind the camera: degenerate
+                Age = 0.0;
+                Trail = trail;
+                return;
+            }
+            if (v0.z > limit) v0 = mix(v0, v1, (v0.z - limit) / (v0.z - v1.z));
+            if (v1.z > limit) v1 = mix(v1, v0, (v1.z - limit) / (v1.z - v0.z));
+            
+            vec4 c0 = projection * vec4(v0, 1.0);
+            vec4 c1 = projection * vec4(v1, 1.0);
+            
+            // Extrude perpendicular to the segment in aspect-corrected screen space
+            vec2 screen = (c1.xy / c1.w - c0.xy / c0.w) * vec2(aspect, 1.0);
+            vec2 direction = dot(screen, screen) > 1e-12 ? normalize(screen) : vec2(1.0, 0.0);
+            vec2 normal = vec2(-direction.y, direction.x) / vec2(aspect, 1.0);
+            
+            vec4 clip = corner.x == 0 ? c0 : c1;
+            clip.xy += normal * (halfWidth * float(corner.y) * clip.w);
+            gl_Position = clip;
+            
+            Age = currentTime - (corner.x == 0 ? p0.w : p1.w);
+            Trail = trail;
+        }
+    )";
+    
+    std::string fragmentSource = R"(
+        #version 330 core
+        out vec4 FragColor;
+        
+        in float Age;
+        flat in int Trail;
+        
+        void main() {
+            // Player trail in yellow, tracked traffic in pale blue; fade over 15 minutes
+            vec3 color = Trail == 0 ? vec3(1.0, 1.0, 0.0) : vec3(0.6, 0.8, 1.0);
+            float alpha = mix(0.9, 0.25, clamp(Age / 900.0, 0.0, 1.0));
+            FragColor = vec4(color, alpha);
+        }
+    )";
+    
+    m_trailShader->BeginLoadFromStrings(vertexSource, fragmentSource, [this](const Shader& shader) {
+        TrailUniforms& u = m_trailUniforms;
+        u.view = shader.GetUniform<glm::mat4>("view");
+        u.projection = shader.GetUniform<glm::mat4>("projection");
+        u.nearPlane = shader.GetUniform<float>("nearPlane");
+        u.aspect = shader.GetUniform<float>("aspect");
+        u.halfWidth = shader.GetUniform<float>("halfWidth");
+        u.currentTime = shader.GetUniform<float>("currentTime");
+        u.points = shader.GetUniform<int>("points");
+        u.headers = shader.GetUniform<int>("headers");
+        u.pointsPerTrail = shader.GetUniform<int>("pointsPerTrail");
+    });
+}
+
+} // namespace FlightSim
@@ -0,0 +1,1009 @@
+#include "renderer/VolumetricClouds.h"
+#include "renderer/GpuProfiler.h"
+#include "core/Camera.h"
+#include "core/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+namespace FlightSim {
+
+static constexpr unsigned int SHAPE_TEXTURE_UNIT = 11;
+static constexpr unsigned int DETAIL_TEXTURE_UNIT = 12;
+static constexpr unsigned int WEATHER_TEXTURE_UNIT = 13;
+
+// Resolve and composite inputs reuse the units the march needs for noise
+static constexpr unsigned int COLOR_TEXTURE_UNIT = 11;
+static constexpr unsigned int DEPTH_TEXTURE_UNIT = 12;
+static constexpr unsigned int HISTORY_TEXTURE_UNIT = 13;
+
+static constexpr int SHAPE_NOISE_SIZE = 64;
+static constexpr int DETAIL_NOISE_SIZE = 32;
+static constexpr int WEATHER_MAP_SIZE = 256;
+
+// World size of one tile of each noise, in meters. The weather tile is a
+// multiple of the others, so wind drift can wrap at it without a seam.
+static constexpr double WEATHER_TILE = 48000.0;
+static constexpr float SHAPE_TILE = 6000.0f;
+static constexpr float DETAIL_TILE = 800.0f;
+
+static constexpr float DEFAULT_COVERAGE = 0.45f;
+
+// Budget controller. A higher preset costs roughly 1.5x the one below,
+// so stepping up only well under budget keeps it from oscillating; the
+// samples still in flight after a change measure the old quality.
+static constexpr float COST_SMOOTHING = 0.1f;
+static constexpr float STEP_UP_FRACTION = 0.6f;
+static constexpr int MIN_COST_SAMPLES = 8;
+static constexpr int QUALITY_COOLDOWN = GpuProfiler::FRAME_LATENCY + 1;
+
+struct QualitySettings {
+    int primarySteps;
+    int lightSteps;
+    bool detail;
+    float maxDistance; // Meters
+};
+
+// Indexed by CloudQuality
+static constexpr QualitySettings QUALITY_SETTINGS[] = {
+    {0, 0, false, 0.0f},
+    {32, 3, false, 20000.0f},
+    {48, 4, true, 30000.0f},
+    {64, 6, true, 40000.0f},
+    {96, 6, true, 50000.0f},
+};
+
+// Fullscreen triangle from gl_VertexID; none of the passes have a mesh
+static const char* FULLSCREEN_VERTEX_SOURCE = R"(
+#version 330 core
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+static const char* NOISE_FRAGMENT_SOURCE = R"(
+#version 330 core
+out vec4 FragColor;
+
+uniform int mode;    // 0 = shape, 1 = detail, 2 = weather
+uniform float layer; // Texture coordinate of the z slice
+uniform vec2 size;   // Slice size in texels
+
+uvec3 Hash(uvec3 v) {
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v ^= v >> 16u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    return v;
+}
+
+// Random point in a lattice cell; cells wrap at the period so every
+// octave tiles, and each period gets its own points
+vec3 Random3(ivec3 cell, int period) {
+    uvec3 wrapped = uvec3((cell % period + period) % period);
+    return vec3(Hash(wrapped + uint(period) * uvec3(73u, 151u, 211u)) & 0xFFFFu) / 65535.0;
+}
+
+// Inverted cellular noise: 1 at the feature points, 0 a cell away
+float Worley(vec3 uvw, int period) {
+    vec3 p = uvw * float(period);
+    ivec3 cell = ivec3(floor(p));
+    vec3 f = fract(p);
+    float minDistance = 1.0;
+    for (int z = -1; z <= 1; ++z) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                ivec3 offset = ivec3(x, y, z);
+                vec3 feature = vec3(offset) + Random3(cell + offset, period);
+                minDistance = min(minDistance, length(feature - f));
+            }
+        }
+    }
+    return 1.0 - minDistance;
+}
+
+float Fbm3(float a, float b, float c) {
+    return a * 0.625 + b * 0.25 + c * 0.125;
+}
+
+// Tiling gradient noise, about -1 to 1
+float Perlin(vec3 uvw, int period) {
+    vec3 p = uvw * float(period);
+    ivec3 cell = ivec3(floor(p));
+    vec3 f = fract(p);
+    vec3 u = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+    float corners[8];
+    for (int i = 0; i < 8; ++i) {
+        ivec3 corner = ivec3(i & 1, (i >> 1) & 1, i >> 2);
+        vec3 gradient = normalize(Random3(cell + corner, period) * 2.0 - 1.0 + 1e-4);
+        corners[i] = dot(gradient, f - vec3(corner));
+    }
+    return mix(mix(mix(corners[0], corners[1], u.x), mix(corners[2], corners[3], u.x), u.y),
+               mix(mix(corners[4], corners[5], u.x), mix(corners[6], corners[7], u.x), u.y), u.z);
+}
+
+// 0 to 1
+float PerlinFbm(vec3 uvw, int period, int octaves) {
+    float sum = 0.0;
+    float amplitude = 0.5;
+    for (int i = 0; i < octaves; ++i) {
+        sum += Perlin(uvw, period) * amplitude;
+        period *= 2;
+        amplitude *= 0.5;
+    }
+    return clamp(sum * 0.7 + 0.5, 0.0, 1.0);
+}
+
+float Remap(float value, float low, float high, float newLow, float newHigh) {
+    return newLow + (value - low) / (high - low) * (newHigh - newLow);
+}
+
+void main() {
+    vec3 uvw = vec3(gl_FragCoord.xy / size, layer);
+    if (mode == 2) {
+        // Coverage in broad patches; type 0 is stratus, 1 is cumulus
+        float coverage = Remap(PerlinFbm(vec3(uvw.xy, 0.37), 4, 6), 0.3, 0.7, 0.0, 1.0);
+        float type = smoothstep(0.35, 0.65, PerlinFbm(vec3(uvw.xy, 0.71), 2, 3));
+        FragColor = vec4(clamp(coverage, 0.0, 1.0), type, 0.0, 1.0);
+        return;
+    }
+    
+    // One Worley evaluation per frequency, shared by the octave sums
+    float w4 = Worley(uvw, 4);
+    float w8 = Worley(uvw, 8);
+    float w16 = Worley(uvw, 16);
+    float w32 = Worley(uvw, 32);
+    float w64 = Worley(uvw, 64);
+    vec3 worley = vec3(Fbm3(w4, w8, w16), Fbm3(w8, w16, w32), Fbm3(w16, w32, w64));
+    if (mode == 1) {
+        FragColor = vec4(worley, 1.0);
+        return;
+    }
+    
+    // Perlin-Worley: billowy gradient noise, pinched by the cells
+    float perlinWorley = Remap(PerlinFbm(uvw, 4, 5), worley.x - 1.0, 1.0, 0.0, 1.0);
+    FragColor = vec4(clamp(perlinWorley, 0.0, 1.0), worley);
+}
+)";
+
+// Shared by the march, resolve and composite passes
+static const char* CLOUD_COMMON_SOURCE = R"(
+vec3 GetRayDirection(mat4 inverseViewProjection, vec2 ndc) {
+    vec4 nearPoint = inverseViewProjection * vec4(ndc, -1.0, 1.0);
+    vec4 farPoint = inverseViewProjection * vec4(ndc, 1.0, 1.0);
+    return normalize(farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w);
+}
+)";
+
+static const char* MARCH_FRAGMENT_SOURCE = R"(
+#version 330 core
+layout(location = 0) out vec4 Scattering; // rgb = radiance, a = transmittance
+layout(location = 1) out float Depth;     // Meters along the ray
+
+uniform sampler3D shapeNoise;
+uniform sampler3D detailNoise;
+uniform sampler2D weatherMap;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+uniform vec2 cloudSize;
+uniform int frameIndex;
+uniform int primarySteps;
+uniform int lightSteps;
+uniform bool detailEnabled;
+uniform float maxDistance;
+uniform float coverage;
+uniform vec3 windOffset;
+
+const float EXTINCTION = 0.04;  // Per meter at density 1
+const float LIGHT_STEP = 50.0;  // First step towards the sun, doubling after
+
+float Remap(float value, float low, float high, float newLow, float newHigh) {
+    return newLow + (value - low) / (high - low) * (newHigh - newLow);
+}
+
+float HeightFraction(float y) {
+    return clamp((y - CLOUD_BOTTOM) / (CLOUD_TOP - CLOUD_BOTTOM), 0.0, 1.0);
+}
+
+// Rounded bottoms; stratus (type 0) stays low, cumulus (1) fills the layer
+float HeightProfile(float h, float type) {
+    float top = mix(0.35, 1.0, type);
+    return smoothstep(0.0, 0.08, h) * (1.0 - smoothstep(top * 0.55, top, h));
+}
+
+float SampleDensity(vec3 position, bool detail) {
+    vec3 p = position + windOffset;
+    vec4 weather = texture(weatherMap, p.xz * WEATHER_SCALE);
+    float cover = clamp(weather.r + 2.0 * coverage - 1.0, 0.0, 1.0);
+    if (cover <= 0.0) return 0.0;
+    
+    float h = HeightFraction(position.y);
+    vec4 shape = texture(shapeNoise, p * SHAPE_SCALE);
+    float base = Remap(shape.r, shape.g * 0.625 + shape.b * 0.25 + shape.a * 0.125 - 1.0, 1.0, 0.0, 1.0);
+    base *= HeightProfile(h, weather.g);
+    
+    // Thin cover keeps only the dense cores of the shape
+    float density = clamp(Remap(base, 1.0 - cover, 1.0, 0.0, 1.0), 0.0, 1.0) * cover;
+    if (detail && density > 0.0) {
+        vec3 noise = texture(detailNoise, p * DETAIL_SCALE).rgb;
+        float fbm = noise.r * 0.625 + noise.g * 0.25 + noise.b * 0.125;
+        
+        // Wispy at the base, billowing towards the top
+        float erosion = mix(fbm, 1.0 - fbm, clamp(h * 5.0, 0.0, 1.0));
+        density = clamp(Remap(density, erosion * 0.35, 1.0, 0.0, 1.0), 0.0, 1.0);
+    }
+    return density;
+}
+
+// Optical depth towards the sun, in steps of growing length
+float SampleLightDepth(vec3 position) {
+    float depth = 0.0;
+    float stepLength = LIGHT_STEP;
+    for (int i = 0; i < lightSteps; ++i) {
+        position += sunDirection * stepLength;
+        depth += SampleDensity(position, false) * stepLength;
+        stepLength *= 2.0;
+    }
+    return depth * EXTINCTION;
+}
+
+float HenyeyGreenstein(float cosAngle, float g) {
+    float g2 = g * g;
+    return (1.0 - g2) / (4.0 * PI * pow(1.0 + g2 - 2.0 * g * cosAngle, 1.5));
+}
+
+float InterleavedGradientNoise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+void main() {
+    // Texel x of this frame's half is cloud pixel 2x + checker
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    int checker = (texel.y + frameIndex) & 1;
+    vec2 pixel = vec2(texel.x * 2 + checker, texel.y) + 0.5;
+    vec3 direction = GetRayDirection(inverseViewProjection, pixel / cloudSize * 2.0 - 1.0);
+    
+    // Where the ray is inside the layer, up to the quality's distance
+    float tNear = 0.0;
+    float tFar = maxDistance;
+    if (abs(direction.y) > 1e-5) {
+        float tBottom = (CLOUD_BOTTOM - viewPos.y) / direction.y;
+        float tTop = (CLOUD_TOP - viewPos.y) / direction.y;
+        tNear = max(min(tBottom, tTop), 0.0);
+        tFar = min(max(tBottom, tTop), maxDistance);
+    } else if (viewPos.y < CLOUD_BOTTOM || viewPos.y > CLOUD_TOP) {
+        tFar = 0.0;
+    }
+    if (tFar <= tNear) {
+        Scattering = vec4(0.0, 0.0, 0.0, 1.0);
+        Depth = maxDistance;
+        return;
+    }
+    
+    // Light reaching the layer is taken once per ray, above the camera;
+    // the march only attenuates it
+    vec3 layerPoint = WorldToAtmosphere(vec3(viewPos.x, 0.5 * (CLOUD_BOTTOM + CLOUD_TOP), viewPos.z));
+    vec3 skyIrradiance;
+    vec3 unused;
+    vec3 sunIrradiance = GetSunAndSkyIrradiance(layerPoint, sunDirection, unused);
+    GetSunAndSkyIrradiance(layerPoint, normalize(layerPoint), skyIrradiance);
+    vec3 ambient = skyIrradiance / (2.0 * PI);
+    
+    // Strong forward lobe for silver linings, weak back lobe
+    float cosAngle = dot(direction, sunDirection);
+    float phase = mix(HenyeyGreenstein(cosAngle, 0.8), HenyeyGreenstein(cosAngle, -0.3), 0.3);
+    
+    // The start jitters per pixel and frame; the resolve averages it out
+    float stepLength = (tFar - tNear) / float(primarySteps);
+    float jitter = fract(InterleavedGradientNoise(gl_FragCoord.xy) + float(frameIndex) * 0.618034);
+    
+    vec3 scattering = vec3(0.0);
+    float transmittance = 1.0;
+    float depthSum = 0.0;
+    float depthWeight = 0.0;
+    for (int i = 0; i < primarySteps; ++i) {
+        float t = tNear + (float(i) + jitter) * stepLength;
+        vec3 position = viewPos + direction * t;
+        float density = SampleDensity(position, detailEnabled) *
+                        (1.0 - smoothstep(0.7 * maxDistance, maxDistance, t));
+        if (density <= 0.0) continue;
+        
+        // Beer's law with a softer tail standing in for multiple scattering
+        float lightDepth = SampleLightDepth(position);
+        float sunVisibility = max(exp(-lightDepth), 0.7 * exp(-0.25 * lightDepth));
+        vec3 radiance = sunIrradiance * phase * sunVisibility +
+                        ambient * mix(0.4, 1.0, HeightFraction(position.y));
+        
+        // Scattering integrated over the step, albedo 1
+        float stepTransmittance = exp(-density * EXTINCTION * stepLength);
+        float absorbed = transmittance * (1.0 - stepTransmittance);
+        scattering += radiance * absorbed;
+        depthSum += t * absorbed;
+        depthWeight += absorbed;
+        transmittance *= stepTransmittance;
+        if (transmittance < 0.01) break;
+    }
+    
+    // Aerial perspective from the camera to the clouds' mean depth
+    float depth = depthWeight > 1e-4 ? depthSum / depthWeight : tNear;
+    vec3 atmosphereTransmittance;
+    vec3 inScatter = GetSkyRadianceToPoint(WorldToAtmosphere(viewPos), WorldToAtmosphere(viewPos + direction * depth),
+                                           atmosphereTransmittance);
+    scattering = scattering * atmosphereTransmittance + inScatter * (1.0 - transmittance);
+    
+    Scattering = vec4(scattering, transmittance);
+    Depth = depth;
+}
+)";
+
+static const char* RESOLVE_FRAGMENT_SOURCE = R"(
+#version 330 core
+layout(location = 0) out vec4 CloudColor;
+layout(location = 1) out float CloudDepth;
+
+uniform sampler2D marchedColor;
+uniform sampler2D marchedDepth;
+uniform sampler2D historyColor;
+uniform mat4 inverseViewProjection;
+uniform mat4 previousViewProjection;
+uniform vec3 viewPos;
+uniform vec2 cloudSize;
+uniform int frameIndex;
+uniform bool historyValid;
+
+// History share of freshly marched pixels, against the step jitter
+const float HISTORY_WEIGHT = 0.5;
+
+bool IsMarched(ivec2 pixel) {
+    return (pixel.x & 1) == ((pixel.y + frameIndex) & 1);
+}
+
+// A pixel of this frame's half; neighbors past the edge are mirrored by
+// two pixels, which keeps them in the same half
+vec4 FetchMarched(ivec2 pixel, out float depth) {
+    ivec2 size = ivec2(cloudSize);
+    pixel.x += pixel.x < 0 ? 2 : (pixel.x >= size.x ? -2 : 0);
+    pixel.y += pixel.y < 0 ? 2 : (pixel.y >= size.y ? -2 : 0);
+    ivec2 texel = clamp(ivec2(pixel.x >> 1, pixel.y), ivec2(0), textureSize(marchedColor, 0) - 1);
+    depth = texelFetch(marchedDepth, texel, 0).r;
+    return texelFetch(marchedColor, texel, 0);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    bool marched = IsMarched(pixel);
+    vec4 current;
+    float depth;
+    vec4 minColor;
+    vec4 maxColor;
+    if (marched) {
+        // The diagonal neighbors were marched this frame too
+        current = FetchMarched(pixel, depth);
+        minColor = current;
+        maxColor = current;
+        for (int i = 0; i < 4; ++i) {
+            float neighborDepth;
+            vec4 neighbor = FetchMarched(pixel + ivec2(i & 1, i >> 1) * 2 - 1, neighborDepth);
+            minColor = min(minColor, neighbor);
+            maxColor = max(maxColor, neighbor);
+        }
+    } else {
+        // All four edge neighbors were; their depth is weighted by
+        // opacity so empty sky does not drag the estimate
+        const ivec2 OFFSETS[4] = ivec2[4](ivec2(-1, 0), ivec2(1, 0), ivec2(0, -1), ivec2(0, 1));
+        current = vec4(0.0);
+        minColor = vec4(1e9);
+        maxColor = vec4(-1e9);
+        float depthSum = 0.0;
+        float weightSum = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            float neighborDepth;
+            vec4 neighbor = FetchMarched(pixel + OFFSETS[i], neighborDepth);
+            float weight = 1.001 - neighbor.a;
+            current += neighbor * 0.25;
+            depthSum += neighborDepth * weight;
+            weightSum += weight;
+            minColor = min(minColor, neighbor);
+            maxColor = max(maxColor, neighbor);
+        }
+        depth = depthSum / weightSum;
+    }
+    
+    // Reproject the cloud point through last frame's camera; history
+    // outside the neighbors' range is stale and gets clamped into it
+    vec4 result = current;
+    if (historyValid) {
+        vec3 direction = GetRayDirection(inverseViewProjection, (vec2(pixel) + 0.5) / cloudSize * 2.0 - 1.0);
+        vec4 previous = previousViewProjection * vec4(viewPos + direction * depth, 1.0);
+        vec2 uv = previous.xy / previous.w * 0.5 + 0.5;
+        if (previous.w > 0.0 && all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0)))) {
+            vec4 history = clamp(texture(historyColor, uv), minColor, maxColor);
+            result = marched ? mix(current, history, HISTORY_WEIGHT) : history;
+        }
+    }
+    
+    CloudColor = result;
+    CloudDepth = depth;
+}
+)";
+
+static const char* COMPOSITE_FRAGMENT_SOURCE = R"(
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D cloudColor;
+uniform sampler2D cloudDepth;
+uniform mat4 viewProjection;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+uniform vec2 renderSize;
+
+// Clouds past the far plane still go in front of the sky
+const float MAX_DEPTH = 0.99999;
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / renderSize;
+    vec4 clouds = texture(cloudColor, uv);
+    float opacity = 1.0 - clouds.a;
+    if (opacity < 0.002) discard;
+    
+    // Depth tested at the clouds' mean depth, so nearer terrain and
+    // aircraft cover them
+    float depth = texture(cloudDepth, uv).r;
+    vec3 direction = GetRayDirection(inverseViewProjection, uv * 2.0 - 1.0);
+    vec4 clip = viewProjection * vec4(viewPos + direction * depth, 1.0);
+    gl_FragDepth = clamp(clip.z / clip.w * 0.5 + 0.5, 0.0, MAX_DEPTH);
+    
+    // The target is display space, so the clouds are tone mapped on
+    // their own and blended by opacity
+    FragColor = vec4(ToDisplay(clouds.rgb / opacity), opacity);
+}
+)";
+
+static std::string GetCloudConstants() {
+    auto constant = [](const char* name, const std::string& value) {
+        return std::string("const float ") + name + " = " + value + ";\n";
+    };
+    auto scale = [](double tile) { return "1.0 / " + std::to_string(tile); };
+    return constant("CLOUD_BOTTOM", std::to_string(VolumetricClouds::CLOUD_BOTTOM)) +
+           constant("CLOUD_TOP", std::to_string(VolumetricClouds::CLOUD_TOP)) +
+           constant("WEATHER_SCALE", scale(WEATHER_TILE)) +
+           constant("SHAPE_SCALE", scale(SHAPE_TILE)) +
+           constant("DETAIL_SCALE", scale(DETAIL_TILE));
+}
+
+static std::string MakeCloudShaderSource(const char* body) {
+    return Shader::InsertAfterVersion(body, GetCloudConstants() + CLOUD_COMMON_SOURCE);
+}
+
+static unsigned int CreateNoiseTexture(unsigned int target, int size) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    GLStateCache::Get().BindTexture(0, target, texture);
+    if (target == GL_TEXTURE_3D) {
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, size, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
+}
+
+static unsigned int CreateTargetTexture(unsigned int internalFormat, unsigned int format, int width, int height,
+                                        unsigned int filter) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// Color and depth as two draw buffers; 0 if incomplete
+static unsigned int CreateTargetFramebuffer(unsigned int color, unsigned int depth) {
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, depth, 0);
+    const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &framebuffer);
+        return 0;
+    }
+    return framebuffer;
+}
+
+VolumetricClouds::VolumetricClouds()
+    : m_shapeNoise(0)
+    , m_detailNoise(0)
+    , m_weatherMap(0)
+    , m_marchColor(0)
+    , m_marchDepth(0)
+    , m_marchFramebuffer(0)
+    , m_historyColor{0, 0}
+    , m_historyDepth{0, 0}
+    , m_historyFramebuffers{0, 0}
+    , m_current(0)
+    , m_width(0)
+    , m_height(0)
+    , m_marchWidth(0)
+    , m_historyValid(false)
+    , m_previousViewProjection(1.0f)
+    , m_frameIndex(0)
+    , m_quality(CloudQuality::Medium)
+    , m_activeQuality(CloudQuality::Medium)
+    , m_coverage(DEFAULT_COVERAGE)
+    , m_wind(8.0f, 3.0f)
+    , m_budgetMs(0.0f)
+    , m_costMs(0.0f)
+    , m_costSamples(0)
+    , m_cooldown(0)
+    , m_lastSample(0) {
+}
+
+VolumetricClouds::~VolumetricClouds() {
+    Shutdown();
+}
+
+bool VolumetricClouds::Initialize() {
+    if (!SetupShaders()) {
+        std::cerr << "Failed to load cloud shaders" << std::endl;
+        return false;
+    }
+    if (!RenderNoise()) {
+        Shutdown();
+        return false;
+    }
+    m_emptyVAO = GLVertexArray::Create();
+    return true;
+}
+
+void VolumetricClouds::Shutdown() {
+    ReleaseTargets();
+    if (m_shapeNoise != 0 || m_detailNoise != 0 || m_weatherMap != 0) {
+        GLStateCache& state = GLStateCache::Get();
+        state.OnTextureDeleted(m_shapeNoise);
+        state.OnTextureDeleted(m_detailNoise);
+        state.OnTextureDeleted(m_weatherMap);
+        glDeleteTextures(1, &m_shapeNoise);
+        glDeleteTextures(1, &m_detailNoise);
+        glDeleteTextures(1, &m_weatherMap);
+        m_shapeNoise = 0;
+        m_detailNoise = 0;
+        m_weatherMap = 0;
+    }
+    m_emptyVAO.Reset();
+    m_marchShader.reset();
+    m_resolveShader.reset();
+    m_compositeShader.reset();
+}
+
+bool VolumetricClouds::Resize(int width, int height) {
+    if (width <= 0 || height <= 0) return false;
+    
+    int cloudWidth = (width + 1) / 2;
+    int cloudHeight = (height + 1) / 2;
+    if (cloudWidth == m_width && cloudHeight == m_height) return true;
+    ReleaseTargets();
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    
+    // Marched depth is fetched texel by texel; the history is resampled
+    int marchWidth = (cloudWidth + 1) / 2;
+    m_marchColor = CreateTargetTexture(GL_RGBA16F, GL_RGBA, marchWidth, cloudHeight, GL_NEAREST);
+    m_marchDepth = CreateTargetTexture(GL_R32F, GL_RED, marchWidth, cloudHeight, GL_NEAREST);
+    m_marchFramebuffer = CreateTargetFramebuffer(m_marchColor, m_marchDepth);
+    bool complete = m_marchFramebuffer != 0;
+    for (int i = 0; i < 2; ++i) {
+        m_historyColor[i] = CreateTargetTexture(GL_RGBA16F, GL_RGBA, cloudWidth, cloudHeight, GL_LINEAR);
+        m_historyDepth[i] = CreateTargetTexture(GL_R32F, GL_RED, cloudWidth, cloudHeight, GL_NEAREST);
+        m_historyFramebuffers[i] = CreateTargetFramebuffer(m_historyColor[i], m_historyDepth[i]);
+        complete = complete && m_historyFramebuffers[i] != 0;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    
+    if (!complete) {
+        std::cerr << "Cloud framebuffer incomplete" << std::endl;
+        ReleaseTargets();
+        return false;
+    }
+    m_width = cloudWidth;
+    m_height = cloudHeight;
+    m_marchWidth = marchWidth;
+    return true;
+}
+
+void VolumetricClouds::ReleaseTargets() {
+    GLStateCache& state = GLStateCache::Get();
+    unsigned int textures[] = {m_marchColor, m_marchDepth, m_historyColor[0], m_historyDepth[0],
+                               m_historyColor[1], m_historyDepth[1]};
+    for (unsigned int texture : textures) {
+        if (texture != 0) {
+            state.OnTextureDeleted(texture);
+            glDeleteTextures(1, &texture);
+        }
+    }
+    unsigned int framebuffers[] = {m_marchFramebuffer, m_historyFramebuffers[0], m_historyFramebuffers[1]};
+    for (unsigned int framebuffer : framebuffers) {
+        if (framebuffer != 0) {
+            glDeleteFramebuffers(1, &framebuffer);
+        }
+    }
+    
+    m_marchColor = 0;
+    m_marchDepth = 0;
+    m_marchFramebuffer = 0;
+    for (int i = 0; i < 2; ++i) {
+        m_historyColor[i] = 0;
+        m_historyDepth[i] = 0;
+        m_historyFramebuffers[i] = 0;
+    }
+    m_width = 0;
+    m_height = 0;
+    m_marchWidth = 0;
+    m_historyValid = false;
+}
+
+void VolumetricClouds::SetQuality(CloudQuality quality) {
+    m_quality = quality;
+    SetActiveQuality(quality);
+}
+
+void VolumetricClouds::SetActiveQuality(CloudQuality quality) {
+    if (quality == m_activeQuality) return;
+    
+    // History from before clouds were off is stale everywhere
+    if (m_activeQuality == CloudQuality::Off) {
+        m_historyValid = false;
+    }
+    m_activeQuality = quality;
+    m_costSamples = 0;
+    m_cooldown = QUALITY_COOLDOWN;
+}
+
+void VolumetricClouds::CycleQuality() {
+    switch (m_quality) {
+        case CloudQuality::Off:    SetQuality(CloudQuality::Low); break;
+        case CloudQuality::Low:    SetQuality(CloudQuality::Medium); break;
+        case CloudQuality::Medium: SetQuality(CloudQuality::High); break;
+        case CloudQuality::High:   SetQuality(CloudQuality::Ultra); break;
+        case CloudQuality::Ultra:  SetQuality(CloudQuality::Off); break;
+    }
+}
+
+const char* VolumetricClouds::GetQualityName(CloudQuality quality) {
+    switch (quality) {
+        case CloudQuality::Off:    return "off";
+        case CloudQuality::Low:    return "low";
+        case CloudQuality::Medium: return "medium";
+        case CloudQuality::High:   return "high";
+        case CloudQuality::Ultra:  return "ultra";
+    }
+    return "unknown";
+}
+
+bool VolumetricClouds::ParseQuality(const std::string& name, CloudQuality& quality) {
+    for (CloudQuality candidate : {CloudQuality::Off, CloudQuality::Low, CloudQuality::Medium, CloudQuality::High,
+                                   CloudQuality::Ultra}) {
+        if (name == GetQualityName(candidate)) {
+            quality = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void VolumetricClouds::SetBudget(float milliseconds) {
+    m_budgetMs = std::max(milliseconds, 0.0f);
+    if (m_budgetMs == 0.0f) {
+        SetActiveQuality(m_quality);
+    }
+}
+
+void VolumetricClouds::SetCoverage(float coverage) {
+    m_coverage = std::clamp(coverage, 0.0f, 1.0f);
+}
+
+void VolumetricClouds::Update(const GpuProfiler& profiler) {
+    int sample = profiler.GetCollectedFrameCount();
+    if (sample == m_lastSample) return;
+    m_lastSample = sample;
+    if (!IsEnabled()) return;
+    
+    // Samples measured before the last change are skipped
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return;
+    }
+    float ms = profiler.GetLatestScopeMs(PASS_NAME);
+    if (ms <= 0.0f) return;
+    m_costMs = m_costSamples == 0 ? ms : m_costMs + (ms - m_costMs) * COST_SMOOTHING;
+    m_costSamples++;
+    if (m_budgetMs <= 0.0f || m_costSamples < MIN_COST_SAMPLES) return;
+    
+    int level = static_cast<int>(m_activeQuality);
+    if (m_costMs > m_budgetMs && m_activeQuality > CloudQuality::Low) {
+        SetActiveQuality(static_cast<CloudQuality>(level - 1));
+    } else if (m_costMs < m_budgetMs * STEP_UP_FRACTION && m_activeQuality < m_quality) {
+        SetActiveQuality(static_cast<CloudQuality>(level + 1));
+    }
+}
+
+void VolumetricClouds::Render(const Camera& camera, const Atmosphere& atmosphere, double time) {
+    if (!IsEnabled() || m_width == 0 || !m_marchShader->IsValid() || !m_resolveShader->IsValid()) return;
+    
+    const QualitySettings& settings = QUALITY_SETTINGS[static_cast<int>(m_activeQuality)];
+    glm::mat4 viewProjection = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    glm::vec3 viewPos = camera.GetPosition();
+    glm::vec2 cloudSize(static_cast<float>(m_width), static_cast<float>(m_height));
+    
+    // Noise moves against the wind; wrapped at the weather tile so the
+    // offset keeps its precision on long runs
+    glm::dvec2 drift = glm::dvec2(m_wind) * time;
+    drift -= WEATHER_TILE * glm::floor(drift / WEATHER_TILE);
+    glm::vec3 windOffset(static_cast<float>(-drift.x), 0.0f, static_cast<float>(-drift.y));
+    
+    // Float targets take the raw results
+    GLStateCache& state = GLStateCache::Get();
+    glDisable(GL_BLEND);
+    state.BindVertexArray(m_emptyVAO.Get());
+    
+    // March this frame's half of the checkerboard
+    const MarchUniforms& m = m_marchUniforms;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_marchFramebuffer);
+    glViewport(0, 0, m_marchWidth, m_height);
+    state.UseProgram(m_marchShader->GetID());
+    state.BindTexture(SHAPE_TEXTURE_UNIT, GL_TEXTURE_3D, m_shapeNoise);
+    state.BindTexture(DETAIL_TEXTURE_UNIT, GL_TEXTURE_3D, m_detailNoise);
+    state.BindTexture(WEATHER_TEXTURE_UNIT, GL_TEXTURE_2D, m_weatherMap);
+    atmosphere.Apply(*m_marchShader, m.atmosphere);
+    m_marchShader->Set(m.shapeNoise, static_cast<int>(SHAPE_TEXTURE_UNIT));
+    m_marchShader->Set(m.detailNoise, static_cast<int>(DETAIL_TEXTURE_UNIT));
+    m_marchShader->Set(m.weatherMap, static_cast<int>(WEATHER_TEXTURE_UNIT));
+    m_marchShader->Set(m.inverseViewProjection, inverseViewProjection);
+    m_marchShader->Set(m.viewPos, viewPos);
+    m_marchShader->Set(m.cloudSize, cloudSize);
+    m_marchShader->Set(m.frameIndex, m_frameIndex);
+    m_marchShader->Set(m.primarySteps, settings.primarySteps);
+    m_marchShader->Set(m.lightSteps, settings.lightSteps);
+    m_marchShader->Set(m.detailEnabled, settings.detail);
+    m_marchShader->Set(m.maxDistance, settings.maxDistance);
+    m_marchShader->Set(m.coverage, m_coverage);
+    m_marchShader->Set(m.windOffset, windOffset);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    // Fill the full buffer from the march and last frame's result
+    int previous = m_current;
+    m_current = 1 - m_current;
+    const ResolveUniforms& r = m_resolveUniforms;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_historyFramebuffers[m_current]);
+    glViewport(0, 0, m_width, m_height);
+    state.UseProgram(m_resolveShader->GetID());
+    state.BindTexture(COLOR_TEXTURE_UNIT, GL_TEXTURE_2D, m_marchColor);
+    state.BindTexture(DEPTH_TEXTURE_UNIT, GL_TEXTURE_2D, m_marchDepth);
+    state.BindTexture(HISTORY_TEXTURE_UNIT, GL_TEXTURE_2D, m_historyColor[previous]);
+    m_resolveShader->Set(r.marchedColor, static_cast<int>(COLOR_TEXTURE_UNIT));
+    m_resolveShader->Set(r.marchedDepth, static_cast<int>(DEPTH_TEXTURE_UNIT));
+    m_resolveShader->Set(r.historyColor, static_cast<int>(HISTORY_TEXTURE_UNIT));
+    m_resolveShader->Set(r.inverseViewProjection, inverseViewProjection);
+    m_resolveShader->Set(r.previousViewProjection, m_previousViewProjection);
+    m_resolveShader->Set(r.viewPos, viewPos);
+    m_resolveShader->Set(r.cloudSize, cloudSize);
+    m_resolveShader->Set(r.frameIndex, m_frameIndex);
+    m_resolveShader->Set(r.historyValid, m_historyValid);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    glEnable(GL_BLEND);
+    m_previousViewProjection = viewProjection;
+    m_historyValid = true;
+    m_frameIndex++;
+}
+
+void VolumetricClouds::Composite(const Camera& camera, const Atmosphere& atmosphere, int width, int height) {
+    if (!IsEnabled() || !m_historyValid || !m_compositeShader->IsValid()) return;
+    
+    glm::mat4 viewProjection = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+    GLStateCache& state = GLStateCache::Get();
+    state.SetDepthFunc(GL_LESS);
+    state.SetDepthMask(false);
+    state.UseProgram(m_compositeShader->GetID());
+    state.BindVertexArray(m_emptyVAO.Get());
+    state.BindTexture(COLOR_TEXTURE_UNIT, GL_TEXTURE_2D, m_historyColor[m_current]);
+    state.BindTexture(DEPTH_TEXTURE_UNIT, GL_TEXTURE_2D, m_historyDepth[m_current]);
+    
+    const CompositeUniforms& c = m_compositeUniforms;
+    atmosphere.Apply(*m_compositeShader, c.atmosphere);
+    m_compositeShader->Set(c.cloudColor, static_cast<int>(COLOR_TEXTURE_UNIT));
+    m_compositeShader->Set(c.cloudDepth, static_cast<int>(DEPTH_TEXTURE_UNIT));
+    m_compositeShader->Set(c.viewProjection, viewProjection);
+    m_compositeShader->Set(c.inverseViewProjection, glm::inverse(viewProjection));
+    m_compositeShader->Set(c.viewPos, camera.GetPosition());
+    m_compositeShader->Set(c.renderSize, glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    state.SetDepthMask(true);
+}
+
+size_t VolumetricClouds::GetGpuMemorySize() const {
+    // Full mip chains: 8/7 of the base level in 3D, 4/3 in 2D
+    size_t noise = static_cast<size_t>(SHAPE_NOISE_SIZE) * SHAPE_NOISE_SIZE * SHAPE_NOISE_SIZE * 4 * 8 / 7 +
+                   static_cast<size_t>(DETAIL_NOISE_SIZE) * DETAIL_NOISE_SIZE * DETAIL_NOISE_SIZE * 4 * 8 / 7 +
+                   static_cast<size_t>(WEATHER_MAP_SIZE) * WEATHER_MAP_SIZE * 4 * 4 / 3;
+    
+    // RGBA16F color and R32F depth
+    const size_t texelSize = 8 + 4;
+    size_t targets = (static_cast<size_t>(m_marchWidth) * m_height + 2 * static_cast<size_t>(m_width) * m_height) *
+                     texelSize;
+    return noise + targets;
+}
+
+void VolumetricClouds::WriteReport(std::ostream& stream) const {
+    stream << "Clouds: " << GetQualityName(m_activeQuality) << " (preset " << GetQualityName(m_quality) << "), ";
+    if (m_budgetMs > 0.0f) {
+        stream << m_costMs << " ms GPU of " << m_budgetMs << " ms budget, ";
+    } else {
+        stream << m_costMs << " ms GPU, ";
+    }
+    stream << GetMarchedPixelCount() << " pixels marched per frame at " << m_width << "x" << m_height << ", "
+           << GetGpuMemorySize() / 1024 << " KB" << std::endl;
+}
+
+bool VolumetricClouds::SetupShaders() {
+    m_marchShader = std::make_unique<Shader>();
+    bool loaded = m_marchShader->BeginLoadFromStrings(FULLSCREEN_VERTEX_SOURCE,
+        Atmosphere::AddShaderFunctions(MakeCloudShaderSource(MARCH_FRAGMENT_SOURCE)), [this](const Shader& shader) {
+        MarchUniforms& u = m_marchUniforms;
+        u.shapeNoise = shader.GetUniform<int>("shapeNoise");
+        u.detailNoise = shader.GetUniform<int>("detailNoise");
+        u.weatherMap = shader.GetUniform<int>("weatherMap");
+        u.inverseViewProjection = shader.GetUniform<glm::mat4>("inverseViewProjection");
+        u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+        u.cloudSize = shader.GetUniform<glm::vec2>("cloudSize");
+        u.frameIndex = shader.GetUniform<int>("frameIndex");
+        u.primarySteps = shader.GetUniform<int>("primarySteps");
+        u.lightSteps = shader.GetUniform<int>("lightSteps");
+        u.detailEnabled = shader.GetUniform<bool>("detailEnabled");
+        u.maxDistance = shader.GetUniform<float>("maxDistance");
+        u.coverage = shader.GetUniform<float>("coverage");
+        u.windOffset = shader.GetUniform<glm::vec3>("windOffset");
+        u.atmosphere = Atmosphere::GetUniforms(shader);
+    });
+    
+    m_resolveShader = std::make_unique<Shader>();
+    loaded &= m_resolveShader->BeginLoadFromStrings(FULLSCREEN_VERTEX_SOURCE,
+        MakeCloudShaderSource(RESOLVE_FRAGMENT_SOURCE), [this](const Shader& shader) {
+        ResolveUniforms& u = m_resolveUniforms;
+        u.marchedColor = shader.GetUniform<int>("marchedColor");
+        u.marchedDepth = shader.GetUniform<int>("marchedDepth");
+        u.historyColor = shader.GetUniform<int>("historyColor");
+        u.inverseViewProjection = shader.GetUniform<glm::mat4>("inverseViewProjection");
+        u.previousViewProjection = shader.GetUniform<glm::mat4>("previousViewProjection");
+        u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+        u.cloudSize = shader.GetUniform<glm::vec2>("cloudSize");
+        u.frameIndex = shader.GetUniform<int>("frameIndex");
+        u.historyValid = shader.GetUniform<bool>("historyValid");
+    });
+    
+    m_compositeShader = std::make_unique<Shader>();
+    loaded &= m_compositeShader->BeginLoadFromStrings(FULLSCREEN_VERTEX_SOURCE,
+        Atmosphere::AddShaderFunctions(MakeCloudShaderSource(COMPOSITE_FRAGMENT_SOURCE)), [this](const Shader& shader) {
+        CompositeUniforms& u = m_compositeUniforms;
+        u.cloudColor = shader.GetUniform<int>("cloudColor");
+        u.cloudDepth = shader.GetUniform<int>("cloudDepth");
+        u.viewProjection = shader.GetUniform<glm::mat4>("viewProjection");
+        u.inverseViewProjection = shader.GetUniform<glm::mat4>("inverseViewProjection");
+        u.viewPos = shader.GetUniform<glm::vec3>("viewPos");
+        u.renderSize = shader.GetUniform<glm::vec2>("renderSize");
+        u.atmosphere = Atmosphere::GetUniforms(shader);
+    });
+    return loaded;
+}
+
+bool VolumetricClouds::RenderNoise() {
+    m_shapeNoise = CreateNoiseTexture(GL_TEXTURE_3D, SHAPE_NOISE_SIZE);
+    m_detailNoise = CreateNoiseTexture(GL_TEXTURE_3D, DETAIL_NOISE_SIZE);
+    m_weatherMap = CreateNoiseTexture(GL_TEXTURE_2D, WEATHER_MAP_SIZE);
+    
+    Shader noiseShader;
+    if (!noiseShader.LoadFromStrings(FULLSCREEN_VERTEX_SOURCE, NOISE_FRAGMENT_SOURCE)) {
+        std::cerr << "Failed to compile cloud noise shader" << std::endl;
+        return false;
+    }
+    
+    // Passes write every texel once; nothing else may touch the output
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    
+    GLuint framebuffer = 0;
+    GLuint emptyVAO = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glGenVertexArrays(1, &emptyVAO);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    
+    GLStateCache& state = GLStateCache::Get();
+    state.BindVertexArray(emptyVAO);
+    state.UseProgram(noiseShader.GetID());
+    Uniform<int> modeUniform = noiseShader.GetUniform<int>("mode");
+    Uniform<float> layerUniform = noiseShader.GetUniform<float>("layer");
+    Uniform<glm::vec2> sizeUniform = noiseShader.GetUniform<glm::vec2>("size");
+    bool complete = true;
+    
+    // Volumes one slice per draw
+    const struct {
+        unsigned int texture;
+        int size;
+    } volumes[] = {{m_shapeNoise, SHAPE_NOISE_SIZE}, {m_detailNoise, DETAIL_NOISE_SIZE}};
+    for (int mode = 0; mode < 2; ++mode) {
+        int size = volumes[mode].size;
+        noiseShader.Set(modeUniform, mode);
+        noiseShader.Set(sizeUniform, glm::vec2(static_cast<float>(size)));
+        glViewport(0, 0, size, size);
+        for (int layer = 0; layer < size; ++layer) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, volumes[mode].texture, 0, layer);
+            complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            noiseShader.Set(layerUniform, (layer + 0.5f) / size);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+    
+    // Weather map
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_weatherMap, 0);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    noiseShader.Set(modeUniform, 2);
+    noiseShader.Set(sizeUniform, glm::vec2(static_cast<float>(WEATHER_MAP_SIZE)));
+    noiseShader.Set(layerUniform, 0.0f);
+    glViewport(0, 0, WEATHER_MAP_SIZE, WEATHER_MAP_SIZE);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    // Distant clouds sample the coarser levels
+    state.BindTexture(0, GL_TEXTURE_3D, m_shapeNoise);
+    glGenerateMipmap(GL_TEXTURE_3D);
+    state.BindTexture(0, GL_TEXTURE_3D, m_detailNoise);
+    glGenerateMipmap(GL_TEXTURE_3D);
+    state.BindTexture(0, GL_TEXTURE_2D, m_weatherMap);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    
+    // Restore the caller's state
+    state.BindVertexArray(0);
+    state.OnVertexArrayDeleted(emptyVAO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glDeleteFramebuffers(1, &framebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+    
+    if (!complete) {
+        std::cerr << "Cloud noise framebuffer incomplete" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace FlightSim
@@ -1,7 +1,12 @@
 #include "ui/HUD.h"
 #include "core/Camera.h"
 #include "core/Shader.h"
+#include "core/GLStateCache.h"
+#include "core/StreamingBuffer.h"
 #include <glad/glad.h>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -10,37 +15,37 @@ namespace FlightSim {
 
 HUD::HUD()
     : m_hudShader(nullptr)
+    , m_stream(nullptr)
     , m_VAO(0)
-    , m_VBO(0)
-    , m_smoothedAltitude(0.0f)
-    , m_smoothedSpeed(0.0f)
-    , m_smoothedVerticalSpeed(0.0f)
-    , m_smoothedHeading(0.0f)
-    , m_smoothedRoll(0.0f)
-    , m_hudColor(0.0f, 1.0f, 0.0f) // Bright green for visibility
+    , m_fontTexture(0)
+    , m_enabled(true)
+    , m_hudScale(1.0f)
     , m_hudAlpha(0.9f)
-    , m_showDebugInfo(true) {
+    , m_showDebugInfo(true)
+    , m_showPerformance(false) {
 }
 
 HUD::~HUD() {
     Shutdown();
 }
 
-bool HUD::Initialize() {
+bool HUD::Initialize(StreamingBuffer& stream) {
+    m_stream = &stream;
+    
     // Create HUD shader
     m_hudShader = std::make_unique<Shader>();
     
     std::string vertexSource = R"(
         #version 330 core
         layout (location = 0) in vec2 aPos;
-        layout (location = 1) in vec2 aTexCoord;
+        layout (location = 1) in vec3 aColor;
         
-        out vec2 TexCoord;
+        out vec3 Color;
         
         uniform mat4 projection;
         
         void main() {
-            TexCoord = aTexCoord;
+            Color = aColor;
             gl_Position = projection * vec4(aPos, 0.0, 1.0);
         }
     )";
@@ -49,17 +54,20 @@ bool HUD::Initialize() {
         #version 330 core
         out vec4 FragColor;
         
-        in vec2 TexCoord;
+        in vec3 Color;
         
-        uniform vec3 hudColor;
         uniform float alpha;
         
         void main() {
-            FragColor = vec4(hudColor, alpha);
+            FragColor = vec4(Color, alpha);
         }
     )";
     
-    if (!m_hudShader->LoadFromStrings(vertexSource, fragmentSource)) {
+    bool submitted = m_hudShader->BeginLoadFromStrings(vertexSource, fragmentSource, [this](const Shader& shader) {
+        m_hudUniforms.projection = shader.GetUniform<glm::mat4>("projection");
+        m_hudUniforms.alpha = shader.GetUniform<float>("alpha");
+    });
+    if (!submitted) {
         std::cerr << "Failed to load HUD shader" << std::endl;
         return false;
     }
@@ -69,53 +77,39 @@ bool HUD::Initialize() {
 }
 
 void HUD::SetupBuffers() {
-    // Create VAO and VBO for HUD elements
+    // Vertices live in the streaming buffer; Flush points the attributes at them
     glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
-    
-    glBindVertexArray(m_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
     
+    GLStateCache::Get().BindVertexArray(m_VAO);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    
-    glBindVertexArray(0);
+    GLStateCache::Get().BindVertexArray(0);
 }
 
-void HUD::Update(const AircraftState& state, float deltaTime) {
-    // Smooth the values for better visual display
-    float smoothing = 0.1f;
-    m_smoothedAltitude = glm::mix(m_smoothedAltitude, state.altitude, smoothing);
-    m_smoothedSpeed = glm::mix(m_smoothedSpeed, state.airspeed, smoothing);
-    m_smoothedVerticalSpeed = glm::mix(m_smoothedVerticalSpeed, state.verticalSpeed, smoothing);
-    m_smoothedHeading = glm::mix(m_smoothedHeading, state.heading, smoothing);
-    m_smoothedRoll = glm::mix(m_smoothedRoll, state.roll, smoothing);
+void HUDValues::Update(const AircraftState& state, float deltaTime) {
+    // Smooth the values for better visual display. The factor is 0.1 per
+    // 60 Hz step, scaled so the response does not depend on the tick rate.
+    float smoothing = 1.0f - std::pow(0.9f, deltaTime * 60.0f);
+    altitude = glm::mix(altitude, state.altitude, smoothing);
+    speed = glm::mix(speed, state.airspeed, smoothing);
+    verticalSpeed = glm::mix(verticalSpeed, state.verticalSpeed, smoothing);
+    heading = glm::mix(heading, state.heading, smoothing);
+    pitch = glm::mix(pitch, state.pitch, smoothing);
+    roll = glm::mix(roll, state.roll, smoothing);
     
     // Update HUD color based on aircraft state
     if (state.airspeed > 100.0f) {
-        m_hudColor = glm::vec3(1.0f, 0.0f, 0.0f); // Red for high speed
+        color = glm::vec3(1.0f, 0.0f, 0.0f); // Red for high speed
     } else if (state.altitude > 2000.0f) {
-        m_hudColor = glm::vec3(0.0f, 1.0f, 1.0f); // Cyan for high altitude
+        color = glm::vec3(0.0f, 1.0f, 1.0f); // Cyan for high altitude
     } else {
-        m_hudColor = glm::vec3(0.0f, 1.0f, 0.0f); // Green for normal flight
+        color = glm::vec3(0.0f, 1.0f, 0.0f); // Green for normal flight
     }
 }
 
 void HUD::Render(const Camera& camera, const AircraftState& state) {
     if (!m_hudShader) return;
     
-    // Set up orthographic projection for 2D HUD
-    glm::mat4 projection = glm::ortho(0.0f, 1280.0f, 720.0f, 0.0f, -1.0f, 1.0f);
-    
-    m_hudShader->Use();
-    m_hudShader->SetMat4("projection", projection);
-    m_hudShader->SetVec3("hudColor", m_hudColor);
-    m_hudShader->SetFloat("alpha", m_hudAlpha);
-    
-    glBindVertexArray(m_VAO);
-    
     // Render crosshair
     RenderCrosshair();
     
@@ -135,8 +129,7 @@ void HUD::Render(const Camera& camera, const AircraftState& state) {
     // Render control input indicators
     RenderControlIndicators(state);
     
-    glBindVertexArray(0);
-    m_hudShader->Unbind();
+    Flush();
 }
 
 void HUD::RenderCrosshair() {
@@ -170,7 +163,7 @@ void HUD::RenderAltitudeIndicator(const AircraftState& state) {
     RenderQuad(glm::vec2(x, y), glm::vec2(width, height), glm::vec3(0.0f, 0.0f, 0.0f));
     
     // Altitude tape
-    float alt = m_smoothedAltitude;
+    float alt = m_values.altitude;
     float centerY = y + height / 2.0f;
     float pixelsPerMeter = 2.0f;
     
@@ -209,7 +202,7 @@ void HUD::RenderSpeedIndicator(const AircraftState& state) {
     RenderQuad(glm::vec2(x, y), glm::vec2(width, height), glm::vec3(0.0f, 0.0f, 0.0f));
     
     // Speed tape
-    float speed = m_smoothedSpeed;
+    float speed = m_values.speed;
     float centerY = y + height / 2.0f;
     float pixelsPerKnot = 3.0f;
     
@@ -247,7 +240,7 @@ void HUD::RenderArtificialHorizon(const AircraftState& state) {
     RenderCircle(glm::vec2(centerX, centerY), radius, glm::vec3(0.0f, 0.0f, 0.0f), 32);
     
     // Horizon line
-    float roll = glm::radians(m_smoothedRoll);
+    float roll = glm::radians(m_values.roll);
     float pitch = glm::radians(state.pitch);
     
     float pitchOffset = pitch * 50.0f; // Scale pitch to pixels
@@ -271,7 +264,7 @@ void HUD::RenderHeadingIndicator(const AircraftState& state) {
     RenderQuad(glm::vec2(centerX - width/2, y), glm::vec2(width, height), glm::vec3(0.0f, 0.0f, 0.0f));
     
     // Heading marks
-    float heading = m_smoothedHeading;
+    float heading = m_values.heading;
     float centerX_actual = centerX;
     float pixelsPerDegree = 2.0f;
     
@@ -309,7 +302,7 @@ void HUD::RenderVerticalSpeedIndicator(const AircraftState& state) {
     RenderQuad(glm::vec2(x, y), glm::vec2(width, height), glm::vec3(0.0f, 0.0f, 0.0f));
     
     // Vertical speed indicator
-    float vspeed = m_smoothedVerticalSpeed;
+    float vspeed = m_values.verticalSpeed;
     float centerY = y + height / 2.0f;
     float pixelsPerFPS = 2.0f;
     
@@ -362,19 +355,19 @@ void HUD::RenderFlightInfo(const AircraftState& state) {
     RenderQuad(glm::vec2(x, y), glm::vec2(300, 120), glm::vec3(0.0f, 0.0f, 0.0f));
     
     std::stringstream ss;
-    ss << "ALT: " << std::fixed << std::setprecision(0) << m_smoothedAltitude << " ft";
+    ss << "ALT: " << std::fixed << std::setprecision(0) << m_values.altitude << " ft";
     RenderText(ss.str(), x + 10, y + 20, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
     
     ss.str("");
-    ss << "SPD: " << std::fixed << std::setprecision(0) << m_smoothedSpeed << " kts";
+    ss << "SPD: " << std::fixed << std::setprecision(0) << m_values.speed << " kts";
     RenderText(ss.str(), x + 10, y + 40, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
     
     ss.str("");
-    ss << "HDG: " << std::fixed << std::setprecision(0) << m_smoothedHeading << "°";
+    ss << "HDG: " << std::fixed << std::setprecision(0) << m_values.heading << "°";
     RenderText(ss.str(), x + 10, y + 60, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
     
     ss.str("");
-    ss << "VS: " << std::fixed << std::setprecision(0) << m_smoothedVerticalSpeed << " fpm";
+    ss << "VS: " << std::fixed << std::setprecision(0) << m_values.verticalSpeed << " fpm";
     RenderText(ss.str(), x + 10, y + 80, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
 }
 
@@ -393,107 +386,136 @@ void HUD::RenderControlIndicators(const AircraftState& state) {
     RenderText("C: Camera", x + 10, y + 100, 0.4f, glm::vec3(1.0f, 1.0f, 1.0f));
 }
 
+void HUD::RenderPerformanceOverlay(float fps, const std::vector<GpuProfiler::ScopeStats>& gpuScopes,
+                                   const GLStateCache::Counters& stateCounters) {
+    float x = 50.0f;
+    float y = 190.0f;
+    float lineHeight = 15.0f;
+    float height = 70.0f + lineHeight * gpuScopes.size();
+    
+    // Performance panel
+    RenderQuad(glm::vec2(x, y), glm::vec2(300, height), glm::vec3(0.0f, 0.0f, 0.0f));
+    
+    std::stringstream ss;
+    ss << "FPS: " << std::fixed << std::setprecision(1) << fps;
+    RenderText(ss.str(), x + 10, y + 20, 0.6f, glm::vec3(1.0f, 1.0f, 0.0f));
+    
+    // GPU time per pass: average and 95th percentile
+    float lineY = y + 40;
+    for (const GpuProfiler::ScopeStats& scope : gpuScopes) {
+        ss.str("");
+        ss << scope.name << ": " << std::fixed << std::setprecision(2) << scope.averageMs
+           << " ms (p95 " << scope.p95Ms << ")";
+        RenderText(ss.str(), x + 10, lineY, 0.4f, glm::vec3(1.0f, 1.0f, 1.0f));
+        lineY += lineHeight;
+    }
+    
+    ss.str("");
+    ss << "Draws: " << stateCounters.drawCalls
+       << "  Binds: " << stateCounters.programBinds + stateCounters.vertexArrayBinds + stateCounters.textureBinds
+       << " (" << stateCounters.programBindsSkipped + stateCounters.vertexArrayBindsSkipped
+                  + stateCounters.textureBindsSkipped << " skipped)";
+    RenderText(ss.str(), x + 10, lineY + 5, 0.4f, glm::vec3(1.0f, 1.0f, 1.0f));
+    
+    Flush();
+}
+
 void HUD::RenderText(const std::string& text, float x, float y, float scale, const glm::vec3& color) {
-    // Simple text rendering using OpenGL immediate mode
-    // In a real implementation, you'd use a proper text rendering library
-    glUseProgram(0);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, 1280, 720, 0, -1, 1);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    
-    glColor3f(color.r, color.g, color.b);
-    glRasterPos2f(x, y);
-    
-    // For now, just render a simple rectangle to represent text
-    glBegin(GL_QUADS);
-    glVertex2f(x, y);
-    glVertex2f(x + text.length() * 8 * scale, y);
-    glVertex2f(x + text.length() * 8 * scale, y + 15 * scale);
-    glVertex2f(x, y + 15 * scale);
-    glEnd();
-    
-    glColor3f(1.0f, 1.0f, 1.0f);
+    // There is no font yet; a box the size of the text stands in for it
+    float width = text.length() * 8 * scale;
+    float height = 15 * scale;
+    RenderQuad(glm::vec2(x, y), glm::vec2(width, height), color);
 }
 
 void HUD::RenderLine(const glm::vec2& start, const glm::vec2& end, const glm::vec3& color, float width) {
-    // Simple line rendering
-    glUseProgram(0);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, 1280, 720, 0, -1, 1);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    
-    glColor3f(color.r, color.g, color.b);
-    glLineWidth(width);
+    // Core profiles have no wide lines, so a line is a quad along it
+    glm::vec2 direction = end - start;
+    float length = glm::length(direction);
+    if (length <= 0.0f) return;
     
-    glBegin(GL_LINES);
-    glVertex2f(start.x, start.y);
-    glVertex2f(end.x, end.y);
-    glEnd();
-    
-    glColor3f(1.0f, 1.0f, 1.0f);
+    glm::vec2 side = glm::vec2(-direction.y, direction.x) * (0.5f * width / length);
+    AddQuad(start - side, end - side, end + side, start + side, color);
 }
 
 void HUD::RenderQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec3& color) {
-    // Simple quad rendering
-    glUseProgram(0);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, 1280, 720, 0, -1, 1);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    
-    glColor3f(color.r, color.g, color.b);
-    
-    glBegin(GL_QUADS);
-    glVertex2f(position.x, position.y);
-    glVertex2f(position.x + size.x, position.y);
-    glVertex2f(position.x + size.x, position.y + size.y);
-    glVertex2f(position.x, position.y + size.y);
-    glEnd();
-    
-    glColor3f(1.0f, 1.0f, 1.0f);
+    AddQuad(position, glm::vec2(position.x + size.x, position.y), position + size,
+            glm::vec2(position.x, position.y + size.y), color);
 }
 
 void HUD::RenderCircle(const glm::vec2& center, float radius, const glm::vec3& color, int segments) {
-    // Simple circle rendering
-    glUseProgram(0);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, 1280, 720, 0, -1, 1);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    
-    glColor3f(color.r, color.g, color.b);
-    
-    glBegin(GL_LINE_LOOP);
-    for (int i = 0; i < segments; i++) {
+    // Outline of one-pixel lines
+    glm::vec2 previous = center + glm::vec2(radius, 0.0f);
+    for (int i = 1; i <= segments; i++) {
         float angle = 2.0f * 3.14159f * i / segments;
-        float x = center.x + radius * cos(angle);
-        float y = center.y + radius * sin(angle);
-        glVertex2f(x, y);
+        glm::vec2 point = center + radius * glm::vec2(cos(angle), sin(angle));
+        RenderLine(previous, point, color, 1.0f);
+        previous = point;
+    }
+}
+
+void HUD::AddQuad(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d,
+                  const glm::vec3& color) {
+    m_vertices.push_back({a, color});
+    m_vertices.push_back({b, color});
+    m_vertices.push_back({c, color});
+    m_vertices.push_back({c, color});
+    m_vertices.push_back({d, color});
+    m_vertices.push_back({a, color});
+}
+
+void HUD::Flush() {
+    const size_t bytes = m_vertices.size() * sizeof(HUDVertex);
+    StreamingBuffer::Allocation allocation = m_stream ? m_stream->Allocate(bytes, sizeof(HUDVertex))
+                                                      : StreamingBuffer::Allocation();
+    if (!allocation || !m_hudShader->IsValid()) {
+        m_vertices.clear();
+        return;
     }
-    glEnd();
+    std::memcpy(allocation.data, m_vertices.data(), bytes);
+    m_stream->Commit(allocation);
     
-    glColor3f(1.0f, 1.0f, 1.0f);
+    // Orthographic projection for the 2D HUD
+    glm::mat4 projection = glm::ortho(0.0f, 1280.0f, 720.0f, 0.0f, -1.0f, 1.0f);
+    
+    GLStateCache& state = GLStateCache::Get();
+    state.UseProgram(m_hudShader->GetID());
+    m_hudShader->Set(m_hudUniforms.projection, projection);
+    m_hudShader->Set(m_hudUniforms.alpha, m_hudAlpha);
+    
+    // The stream's buffer can change between frames
+    state.BindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_stream->GetBuffer());
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HUDVertex), (void*)offsetof(HUDVertex, position));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(HUDVertex), (void*)offsetof(HUDVertex, color));
+    
+    // Drawn over the scene in submission order; the flipped projection
+    // reverses the winding
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    
+    glDrawArrays(GL_TRIANGLES, static_cast<GLint>(allocation.offset / sizeof(HUDVertex)),
+                 static_cast<GLsizei>(m_vertices.size()));
+    state.CountDraw();
+    
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    }
+    m_vertices.clear();
 }
 
 void HUD::Shutdown() {
     if (m_VAO) {
+        GLStateCache::Get().OnVertexArrayDeleted(m_VAO);
         glDeleteVertexArrays(1, &m_VAO);
         m_VAO = 0;
     }
-    if (m_VBO) {
-        glDeleteBuffers(1, &m_VBO);
-        m_VBO = 0;
-    }
+    m_vertices.clear();
+    m_stream = nullptr;
     m_hudShader.reset();
 }
 
@@ -0,0 +1,282 @@
+// Offline converter from Wavefront OBJ to the packed .fsmesh format read
+// by Mesh::LoadFromFile.
+//
+//   meshconv input.obj output.fsmesh [--scale s] [--flip-v] [--layout compact|standard]
+//            [--no-optimize]
+//
+// Polygons are fan-triangulated, identical position/uv/normal corners are
+// merged, and smooth normals are generated when any face lacks them.
+// Triangles and vertices are then reordered for the vertex cache, overdraw
+// and fetch locality (see MeshOptimizer).
+// Vertices are written in the compact layout (16 bytes) unless asked
+// otherwise, and indices are 16-bit whenever the vertex count allows.
+
+#include "core/MeshFormat.h"
+#include "core/MeshOptimizer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace FlightSim;
+
+struct CornerKey {
+    int position;
+    int texCoord;
+    int normal;
+    
+    bool operator==(const CornerKey& other) const {
+        return position == other.position && texCoord == other.texCoord && normal == other.normal;
+    }
+};
+
+struct CornerKeyHash {
+    size_t operator()(const CornerKey& key) const {
+        size_t hash = static_cast<size_t>(key.position) * 73856093u;
+        hash ^= static_cast<size_t>(key.texCoord) * 19349663u;
+        hash ^= static_cast<size_t>(key.normal) * 83492791u;
+        return hash;
+    }
+};
+
+struct ConvertedMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    bool generateNormals = false;
+};
+
+// OBJ indices are 1-based, or negative to count back from the end
+static int ResolveIndex(const std::string& token, size_t count) {
+    if (token.empty()) return -1;
+    int index = std::atoi(token.c_str());
+    if (index < 0) return static_cast<int>(count) + index;
+    return index - 1;
+}
+
+static CornerKey ParseCorner(const std::string& corner, size_t positions, size_t texCoords, size_t normals) {
+    std::string parts[3];
+    size_t part = 0;
+    for (char c : corner) {
+        if (c == '/') {
+            if (++part == 3) break;
+        } else {
+            parts[part] += c;
+        }
+    }
+    return {ResolveIndex(parts[0], positions), ResolveIndex(parts[1], texCoords), ResolveIndex(parts[2], normals)};
+}
+
+static bool LoadObj(const std::string& path, float scale, bool flipV, ConvertedMesh& mesh) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::unordered_map<CornerKey, uint32_t, CornerKeyHash> cornerIndices;
+    std::vector<uint32_t> face;
+    
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+        
+        if (type == "v") {
+            glm::vec3 p(0.0f);
+            stream >> p.x >> p.y >> p.z;
+            positions.push_back(p * scale);
+        } else if (type == "vt") {
+            glm::vec2 t(0.0f);
+            stream >> t.x >> t.y;
+            texCoords.push_back(flipV ? glm::vec2(t.x, 1.0f - t.y) : t);
+        } else if (type == "vn") {
+            glm::vec3 n(0.0f);
+            stream >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        } else if (type == "f") {
+            face.clear();
+            std::string token;
+            while (stream >> token) {
+                CornerKey key = ParseCorner(token, positions.size(), texCoords.size(), normals.size());
+                if (key.position < 0 || key.position >= static_cast<int>(positions.size()) ||
+                    key.texCoord >= static_cast<int>(texCoords.size()) ||
+                    key.normal >= static_cast<int>(normals.size())) {
+                    std::cerr << path << ":" << lineNumber << ": index out of range" << std::endl;
+                    return false;
+                }
+                
+                auto found = cornerIndices.find(key);
+                if (found == cornerIndices.end()) {
+                    Vertex vertex;
+                    vertex.position = positions[key.position];
+                    vertex.normal = key.normal >= 0 ? normals[key.normal] : glm::vec3(0.0f);
+                    vertex.texCoords = key.texCoord >= 0 ? texCoords[key.texCoord] : glm::vec2(0.0f);
+                    mesh.generateNormals = mesh.generateNormals || key.normal < 0;
+                    
+                    found = cornerIndices.emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+                    mesh.vertices.push_back(vertex);
+                }
+                face.push_back(found->second);
+            }
+            
+            // Fan triangulation; fine for the convex faces exporters write
+            for (size_t i = 2; i < face.size(); ++i) {
+                mesh.indices.push_back(face[0]);
+                mesh.indices.push_back(face[i - 1]);
+                mesh.indices.push_back(face[i]);
+            }
+        }
+        // Groups, materials and smoothing groups are ignored
+    }
+    
+    if (mesh.indices.empty()) {
+        std::cerr << path << ": no faces" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Area-weighted smooth normals, accumulated per vertex
+static void GenerateNormals(ConvertedMesh& mesh) {
+    for (Vertex& vertex : mesh.vertices) {
+        vertex.normal = glm::vec3(0.0f);
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        Vertex& a = mesh.vertices[mesh.indices[i]];
+        Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+        Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+        glm::vec3 faceNormal = glm::cross(b.position - a.position, c.position - a.position);
+        a.normal += faceNormal;
+        b.normal += faceNormal;
+        c.normal += faceNormal;
+    }
+    for (Vertex& vertex : mesh.vertices) {
+        float length = glm::length(vertex.normal);
+        vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+}
+
+static bool WriteMesh(const std::string& path, const ConvertedMesh& mesh, const VertexLayout& layout) {
+    glm::vec3 boundsMin = mesh.vertices.front().position;
+    glm::vec3 boundsMax = boundsMin;
+    for (const Vertex& vertex : mesh.vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    
+    std::vector<uint8_t> vertexData;
+    layout.Encode(mesh.vertices.data(), mesh.vertices.size(), boundsMin, boundsMax, vertexData);
+    
+    std::vector<uint16_t> shortIndices;
+    const char* indexData = reinterpret_cast<const char*>(mesh.indices.data());
+    uint32_t indexSize = sizeof(uint32_t);
+    if (mesh.vertices.size() <= 65536) {
+        shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+        indexData = reinterpret_cast<const char*>(shortIndices.data());
+        indexSize = sizeof(uint16_t);
+    }
+    
+    MeshFileHeader header = {};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.vertexStride = layout.GetStride();
+    header.format = MakeMeshFileFormat(layout, indexSize);
+    header.vertexOffset = AlignMeshFileOffset(sizeof(MeshFileHeader));
+    header.indexOffset = AlignMeshFileOffset(header.vertexOffset + vertexData.size());
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+    }
+    
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    
+    static const char padding[MESH_FILE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, header.vertexOffset - sizeof(header));
+    file.write(reinterpret_cast<const char*>(vertexData.data()), vertexData.size());
+    file.write(padding, header.indexOffset - (header.vertexOffset + vertexData.size()));
+    file.write(indexData, mesh.indices.size() * indexSize);
+    return static_cast<bool>(file);
+}
+
+static void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " input.obj output.fsmesh [--scale s] [--flip-v]"
+              << " [--layout compact|standard] [--no-optimize]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    
+    std::string input = argv[1];
+    std::string output = argv[2];
+    float scale = 1.0f;
+    bool flipV = false;
+    bool optimize = true;
+    VertexLayout layout = VertexLayout::Compact();
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--flip-v") == 0) {
+            flipV = true;
+        } else if (std::strcmp(argv[i], "--no-optimize") == 0) {
+            optimize = false;
+        } else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "standard") {
+                layout = VertexLayout::Standard();
+            } else if (name != "compact") {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    std::string extension = input.size() > 4 ? input.substr(input.size() - 4) : "";
+    if (extension != ".obj" && extension != ".OBJ") {
+        std::cerr << "Only Wavefront OBJ input is supported; export glTF models to OBJ first" << std::endl;
+        return 1;
+    }
+    
+    ConvertedMesh mesh;
+    if (!LoadObj(input, scale, flipV, mesh)) {
+        return 1;
+    }
+    if (mesh.generateNormals) {
+        GenerateNormals(mesh);
+    }
+    if (optimize) {
+        MeshOptimizationStats stats = MeshOptimizer::Optimize(mesh.vertices, mesh.indices);
+        std::cout << "Vertex cache: ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+                  << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+    }
+    if (!WriteMesh(output, mesh, layout)) {
+        return 1;
+    }
+    
+    std::cout << input << " -> " << output << ": " << mesh.vertices.size() << " vertices, "
+              << mesh.indices.size() / 3 << " triangles, " << layout.GetStride() << " bytes per vertex" << std::endl;
+    return 0;
+}